@@ -2,26 +2,150 @@
  * Compute the average of k-consecutive entries in an array.
  * Basic program implementing Sliding Window technique to compute avg. of
  * k-contiguous entries in an array.
+ *
+ * findBatchAvgK() computes all window averages at once, from a prefix-sum
+ * array, with AVX2 (x86-64) or NEON (AArch64) kernels when the compiler
+ * targets them, else with scalar loops.
+ *
+ * Usage: g++ -O2 [-mavx2] -o avg_of_k_entries avg_of_k_entries.cpp
+ *        ./avg_of_k_entries
  */
 #include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <chrono>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "sliding_window.h"
 
 using namespace std;
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(*a))
 
+// Function prototypes
+void run_batch_test(void);
+
+// **** Prefix-sum kernels for findBatchAvgK() ****
+
+/*
+ * prefix[0] = 0; prefix[i + 1] = (values[0] + ... + values[i]), for n values.
+ * The AVX2 / NEON kernels scan a vector of 4 / 2 sums in-register, by
+ * log2(lanes) shift-and-add steps, then add the carry from the previous one.
+ */
+static void
+prefix_sums(const int *values, size_t n, int64_t *prefix)
+{
+   size_t  i = 0;
+   int64_t carry = 0;
+
+   prefix[0] = 0;
+#if defined(__AVX2__)
+   const __m256i zero = _mm256_setzero_si256();
+   __m256i vcarry = zero;
+   for (; (i + 4) <= n; i += 4) {
+      __m256i x = _mm256_cvtepi32_epi64(
+                     _mm_loadu_si128((const __m128i *) (values + i)));
+
+      // [a, b, c, d] + [0, a, b, c] + [0, 0, a, a+b]
+      x = _mm256_add_epi64(x, _mm256_blend_epi32(
+                              _mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)),
+                              zero, 0x03));
+      x = _mm256_add_epi64(x, _mm256_blend_epi32(
+                              _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)),
+                              zero, 0x0F));
+      x = _mm256_add_epi64(x, vcarry);
+      _mm256_storeu_si256((__m256i *) (prefix + i + 1), x);
+      vcarry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+   }
+   if (i) {
+      carry = prefix[i];
+   }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+   const int64x2_t zero = vdupq_n_s64(0);
+   int64x2_t vcarry = zero;
+   for (; (i + 2) <= n; i += 2) {
+      int64x2_t x = vmovl_s32(vld1_s32(values + i));
+
+      // [a, b] + [0, a]
+      x = vaddq_s64(x, vextq_s64(zero, x, 1));
+      x = vaddq_s64(x, vcarry);
+      vst1q_s64(prefix + i + 1, x);
+      vcarry = vdupq_laneq_s64(x, 1);
+   }
+   if (i) {
+      carry = prefix[i];
+   }
+#endif
+   for (; i < n; i++) {
+      carry += values[i];
+      prefix[i + 1] = carry;
+   }
+}
+
+/*
+ * avgs[i] = ((prefix[i + k] - prefix[i]) / k), for i in [0, nwindows).
+ *
+ * AVX2 has no int64 -> double conversion; window sums are converted exactly
+ * by the "magic number" trick, adding 2^52 + 2^51 as an integer and then
+ * subtracting it as a double, which holds for |sum| < 2^51. Sums of k ints
+ * are within that for k <= Batch_simd_max_k; larger k's use scalar code.
+ */
+const int Batch_simd_max_k = (1 << 20);
+
+static void
+window_avgs(const int64_t *prefix, size_t nwindows, int k, float *avgs)
+{
+   size_t i = 0;
+   double inv_k = (1.0 / k);
+
+#if defined(__AVX2__)
+   if (k <= Batch_simd_max_k) {
+      const __m256i magic_i = _mm256_set1_epi64x(0x4338000000000000LL);
+      const __m256d magic_d = _mm256_castsi256_pd(magic_i);
+      const __m256d vinv_k  = _mm256_set1_pd(inv_k);
+      for (; (i + 4) <= nwindows; i += 4) {
+         __m256i sums = _mm256_sub_epi64(
+                           _mm256_loadu_si256((const __m256i *) (prefix + i + k)),
+                           _mm256_loadu_si256((const __m256i *) (prefix + i)));
+         __m256d d = _mm256_sub_pd(
+                        _mm256_castsi256_pd(_mm256_add_epi64(sums, magic_i)),
+                        magic_d);
+         _mm_storeu_ps(avgs + i, _mm256_cvtpd_ps(_mm256_mul_pd(d, vinv_k)));
+      }
+   }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+   const float64x2_t vinv_k = vdupq_n_f64(inv_k);
+   for (; (i + 2) <= nwindows; i += 2) {
+      int64x2_t sums = vsubq_s64(vld1q_s64(prefix + i + k), vld1q_s64(prefix + i));
+      float64x2_t d  = vmulq_f64(vcvtq_f64_s64(sums), vinv_k);
+      vst1_f32(avgs + i, vcvt_f32_f64(d));
+   }
+#endif
+   for (; i < nwindows; i++) {
+      avgs[i] = ((prefix[i + k] - prefix[i]) * inv_k);
+   }
+}
+
 /* Define a class to compute avg of k-entries in an array */
 class avgKEntriesArray
 {
    private:
-      int  intArray[20]; 
-      int  arraySize;
+      vector<int>      intArray;
+      int              arraySize;
+      vector<int64_t>  prefix;    // Prefix sums, built by findBatchAvgK()
    public:
       // Constructor
-      avgKEntriesArray(int *input, int nentries) {
-         for (auto i = 0; i < nentries; i++, input++) {
-            intArray[i] = *input;
-         }
-         arraySize = nentries;
+      avgKEntriesArray(int *input, int nentries)
+         : intArray(input, (input + nentries)), arraySize(nentries) {
       }
 
       /*
@@ -47,15 +171,15 @@ class avgKEntriesArray
       int
       findAvgK(int k, float *avgs) {
          if (k >= arraySize) {
-            *avgs = findAvgOfSubArray(intArray, arraySize);
+            *avgs = findAvgOfSubArray(intArray.data(), arraySize);
             return 1;
          }
 
          // Do brute-force walk of k-contiguous entries till we exhaust
          // the # of entries in the array.
-         int *start = intArray;
-         int *end   = (intArray + k);
-         int *arrayEnd = (intArray + arraySize);
+         int *start = intArray.data();
+         int *end   = (start + k);
+         int *arrayEnd = (start + arraySize);
          int  runid = 0;
 
          while (end <= arrayEnd) {
@@ -78,7 +202,7 @@ class avgKEntriesArray
       int
       findSmartAvgK(int k, float *avgs) {
          if (k >= arraySize) {
-            *avgs = findAvgOfSubArray(intArray, arraySize);
+            *avgs = findAvgOfSubArray(intArray.data(), arraySize);
             return 1;
          }
 
@@ -89,11 +213,11 @@ class avgKEntriesArray
           * the new sum by dropping the 0'th value from old sum and add
           * the next entry's value.
           */
-         int *start = intArray;
-         int *end   = (intArray + k - 1);
-         int *arrayEnd = (intArray + arraySize);
-         int  runid = 0;
-         int  currSum = 0;
+         int *start = intArray.data();
+         int *end   = (start + k - 1);
+         int *arrayEnd = (start + arraySize);
+         int      runid = 0;
+         int64_t  currSum = 0;
 
          for (int i = 0; i < k; i++) {
             currSum += *(start + i);
@@ -101,20 +225,94 @@ class avgKEntriesArray
 
          do {
             avgs[runid] = (currSum * 1.0 / k);
+            runid++;
+
+            // Move to next contiguous chunk, if there is one.
+            end++;
+            if (end == arrayEnd) {
+               break;
+            }
 
             // Recompute sum of next k-items
             currSum -= *start;
-
-            // Move to next contiguous chunk
             start++;
-            end++;
             currSum += *end;
-
-            runid++;
          } while (end < arrayEnd);
          return runid;
       }
 
+      /*
+       * Find the avg of k-contiguous entries, pushing entries one at a time
+       * through a SlidingWindow, as they would arrive on a stream. The sum
+       * is accumulated in 64-bits.
+       * Returns:
+       *  # of such k-contiguous runs.
+       *  Each k'th run's avg returned by avgs[] array.
+       */
+      int
+      findStreamAvgK(int k, float *avgs) {
+         SlidingWindow<int, WindowAvg<int> > window(min(k, arraySize));
+         int runid = 0;
+
+         for (auto v : intArray) {
+            window.push(v);
+            if (window.full()) {
+               avgs[runid++] = window.value();
+            }
+         }
+         return runid;
+      }
+
+      /*
+       * Find the avg of all k-contiguous runs at once, from the differences
+       * of prefix sums, using SIMD kernels where available. The prefix sums
+       * are built on the first call and reused, so later calls, for any k,
+       * do not allocate.
+       *
+       * Returns:
+       *  # of such k-contiguous runs; -1 if 'navgs' is too small for them.
+       *  Each k'th run's avg returned by avgs[] array.
+       */
+      int
+      findBatchAvgK(int k, float *avgs, size_t navgs) {
+         k = min(k, arraySize);
+         size_t nruns = (arraySize - k + 1);
+         if ((k <= 0) || (navgs < nruns)) {
+            return -1;
+         }
+         if (prefix.size() != (size_t) (arraySize + 1)) {
+            prefix.resize(arraySize + 1);
+            prefix_sums(intArray.data(), arraySize, prefix.data());
+         }
+         window_avgs(prefix.data(), nruns, k, avgs);
+         return nruns;
+      }
+
+      // Verify that the four methods compute the same averages.
+      bool
+      verify(int k) {
+         vector<float> slow(arraySize);
+         vector<float> smart(arraySize);
+         vector<float> stream(arraySize);
+         vector<float> batch(arraySize);
+
+         int nruns = findAvgK(k, slow.data());
+         if (   (findSmartAvgK(k, smart.data()) != nruns)
+             || (findStreamAvgK(k, stream.data()) != nruns)
+             || (findBatchAvgK(k, batch.data(), batch.size()) != nruns)) {
+            return false;
+         }
+         for (int i = 0; i < nruns; i++) {
+            float tolerance = (1e-5 * (1 + fabs(slow[i])));
+            if (   (fabs(slow[i] - smart[i]) > tolerance)
+                || (fabs(slow[i] - stream[i]) > tolerance)
+                || (fabs(slow[i] - batch[i]) > tolerance)) {
+               return false;
+            }
+         }
+         return true;
+      }
+
       void
       printArray(void) {
          cout << "[ ";
@@ -155,5 +353,79 @@ int main()
       cout << i << ": avg=" << *avgp << endl;
     }
 
+    nruns = my_array.findStreamAvgK(k, avgs);
+    cout << "\n" << "Streaming k-running averages result:" << endl;
+    avgp = avgs;
+    for (int i = 0; i < nruns; i++, avgp++) {
+      cout << i << ": avg=" << *avgp << endl;
+    }
+
+    nruns = my_array.findBatchAvgK(k, avgs, ARRAY_SIZE(avgs));
+    cout << "\n" << "Batch k-running averages result:" << endl;
+    avgp = avgs;
+    for (int i = 0; i < nruns; i++, avgp++) {
+      cout << i << ": avg=" << *avgp << endl;
+    }
+
+    cout << "Verification of four methods: " << my_array.verify(k) << endl;
+    for (int kk = 1; kk <= (int) ARRAY_SIZE(data) + 1; kk++) {
+      assert(my_array.verify(kk));
+    }
+
+    run_batch_test();
+
     return 0;
 }
+
+/*
+ * Verify batch averages against streaming averages, both computed from
+ * exact 64-bit sums, on a large input whose k-sums overflow 32-bits, for
+ * lengths that are not multiples of the SIMD widths. Report times; the time
+ * of the first batch call, for k=1, includes building the prefix sums.
+ */
+void
+run_batch_test(void)
+{
+   mt19937 rng(10);
+   uniform_int_distribution<int> dist(-2000 * 1000 * 1000, 2000 * 1000 * 1000);
+
+   for (int n : { 1, 3, 4, 5, 1001, (10 * 1000 * 1000) + 3 }) {
+      vector<int> data(n);
+      for (auto& v : data) {
+         v = dist(rng);
+      }
+      avgKEntriesArray test_array(data.data(), n);
+      vector<float> batch(n);
+      vector<float> stream(n);
+
+      for (int k : { 1, 2, 3, 7, 1000 }) {
+         auto start = chrono::steady_clock::now();
+         int nruns = test_array.findBatchAvgK(k, batch.data(), batch.size());
+         auto batch_us = chrono::duration_cast<chrono::microseconds>(
+                           chrono::steady_clock::now() - start).count();
+
+         start = chrono::steady_clock::now();
+         int nruns_smart = test_array.findSmartAvgK(k, stream.data());
+         auto smart_us = chrono::duration_cast<chrono::microseconds>(
+                           chrono::steady_clock::now() - start).count();
+         assert(nruns_smart == nruns);
+         for (int i = 0; i < nruns; i++) {
+            assert(fabs(batch[i] - stream[i]) <= (1e-6 * (1 + fabs(stream[i]))));
+         }
+
+         // Reuses stream[], now that the sliding-window results are checked.
+         assert(test_array.findStreamAvgK(k, stream.data()) == nruns);
+         for (int i = 0; i < nruns; i++) {
+            assert(fabs(batch[i] - stream[i]) <= (1e-6 * (1 + fabs(stream[i]))));
+         }
+         assert(test_array.findBatchAvgK(k, batch.data(), (nruns - 1)) == -1);
+
+         if (n > (1000 * 1000)) {
+            cout << "n=" << n << ", k=" << k
+                 << ": batch=" << batch_us << " us"
+                 << ", sliding=" << smart_us << " us"
+                 << endl;
+         }
+      }
+   }
+}
@@ -4,9 +4,21 @@
  * Compute the max-sum of k-consecutive entries in an array.
  * Basic program implementing Sliding Window technique to compute max(SUM) of
  * k-contiguous entries in an array.
+ *
+ * Usage: g++ -O2 -o max_sum_of_k_entries max_sum_of_k_entries.cpp
+ *        ./max_sum_of_k_entries
+ *        ./max_sum_of_k_entries --stream <k> < <file-of-ints>
  */
 #include <iostream>
 #include <vector>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cassert>
+
+#include "sliding_window.h"
 
 using namespace std;
 
@@ -14,24 +26,21 @@ using namespace std;
 
 // Function prototypes
 void run_test(void);
+void run_stream_test(void);
+void run_maxmin_test(void);
+int  streamMaxSum(istream& in, int k);
 
 /* Define a class to compute max(SUM) of k-entries in an array */
 class maxSumKEntriesArray
 {
    private:
-      int  intArray[20]; 
-      int  arraySize;
+      vector<int>  intArray;
+      int          arraySize;
 
    public:
       // Constructor
-      maxSumKEntriesArray(const vector<int>& input) {
-         // for (auto i = 0; i < nentries; i++, input++) {
-         auto i {0};
-         for (auto v : input) {
-            intArray[i] = v;
-            i++;
-         }
-         arraySize = input.size();
+      maxSumKEntriesArray(const vector<int>& input)
+         : intArray(input), arraySize(input.size()) {
       }
 
       /*
@@ -59,14 +68,14 @@ class maxSumKEntriesArray
       {
          if (k >= arraySize) {
             *maxStartIndex = 0;
-            return findSumOfN(intArray, arraySize);
+            return findSumOfN(intArray.data(), arraySize);
          }
 
          // Do brute-force walk of k-contiguous entries till we exhaust
          // the # of entries in the array.
-         int *start = intArray;
-         int *end   = (intArray + k);
-         int *arrayEnd = (intArray + arraySize);
+         int *start = intArray.data();
+         int *end   = (start + k);
+         int *arrayEnd = (start + arraySize);
          int  runid = 0;
          int  maxSum = 0;
 
@@ -74,7 +83,7 @@ class maxSumKEntriesArray
             int thisMaxSum = findSumOfN(start, k);
             if (thisMaxSum > maxSum) {
                maxSum = thisMaxSum;
-               *maxStartIndex = (start - intArray);
+               *maxStartIndex = (start - intArray.data());
             }
 
             // Move to next contiguous chunk
@@ -103,7 +112,7 @@ class maxSumKEntriesArray
       findMaxSum(int k, int *maxStartIndex) {
          if (k >= arraySize) {
             *maxStartIndex = 0;
-            return findSumOfN(intArray, arraySize);
+            return findSumOfN(intArray.data(), arraySize);
          }
 
          /*
@@ -111,9 +120,9 @@ class maxSumKEntriesArray
           * re-compute the new sum by dropping the 0'th value from old sum and
           * add the next entry's value.
           */
-         int *start = intArray;
-         int *end   = (intArray + k - 1);
-         int *arrayEnd = (intArray + arraySize - 1);
+         int *start = intArray.data();
+         int *end   = (start + k - 1);
+         int *arrayEnd = (start + arraySize - 1);
          int  runid = 0;
          int  currSum = 0;
          int  result = 0;
@@ -135,21 +144,124 @@ class maxSumKEntriesArray
             currSum += *end;
             if (currSum > result) {
                result = currSum;
-               *maxStartIndex = (start - intArray);
+               *maxStartIndex = (start - intArray.data());
+            }
+         }
+         return result;
+      }
+
+      /*
+       * Find the max SUM() of k-contiguous entries by pushing the entries, one
+       * at a time, through a SlidingWindow, as they would arrive on a stream.
+       * Sums are accumulated in 64-bits, so they do not overflow.
+       *
+       * Returns:
+       *  Max SUM() across all k-contiguous values.
+       */
+      int64_t
+      findMaxSumStream(int k, int *maxStartIndex) {
+         SlidingWindow<int> window(min(k, arraySize));
+         int64_t result = 0;
+
+         *maxStartIndex = 0;
+         for (auto v : intArray) {
+            window.push(v);
+            if (window.full()
+                && ((window.start() == 0) || (window.value() > result))) {
+               result = window.value();
+               *maxStartIndex = window.start();
             }
          }
          return result;
       }
 
-      // Verify the result by the two methods.
+      /*
+       * Find the max and min value of each k-contiguous run of entries, by
+       * a brute-force scan of each run; O(n * k).
+       *
+       * Returns:
+       *  # of such k-contiguous runs; 0 for an empty array or k <= 0.
+       *  Each k'th run's max, min returned in maxs[], mins[].
+       */
+      int
+      findMaxMinK_BruteForce(int k, vector<int>& maxs, vector<int>& mins)
+      {
+         if ((arraySize == 0) || (k <= 0)) {
+            maxs.clear();
+            mins.clear();
+            return 0;
+         }
+         k = min(k, arraySize);
+         int nruns = (arraySize - k + 1);
+         maxs.resize(nruns);
+         mins.resize(nruns);
+         for (int runid = 0; runid < nruns; runid++) {
+            int maxv = intArray[runid];
+            int minv = intArray[runid];
+            for (int i = (runid + 1); i < (runid + k); i++) {
+               maxv = MAX(maxv, intArray[i]);
+               minv = min(minv, intArray[i]);
+            }
+            maxs[runid] = maxv;
+            mins[runid] = minv;
+         }
+         return nruns;
+      }
+
+      /*
+       * Find the max and min value of each k-contiguous run of entries using
+       * sliding windows, each with a monotonic deque; O(n) overall.
+       *
+       * Returns:
+       *  # of such k-contiguous runs; 0 for an empty array or k <= 0.
+       *  Each k'th run's max, min returned in maxs[], mins[].
+       */
+      int
+      findMaxMinK(int k, vector<int>& maxs, vector<int>& mins)
+      {
+         maxs.clear();
+         mins.clear();
+         if ((arraySize == 0) || (k <= 0)) {
+            return 0;
+         }
+         k = min(k, arraySize);
+         SlidingWindow<int, WindowMax<int> > maxWindow(k);
+         SlidingWindow<int, WindowMin<int> > minWindow(k);
+         for (auto v : intArray) {
+            maxWindow.push(v);
+            minWindow.push(v);
+            if (maxWindow.full()) {
+               maxs.push_back(maxWindow.value());
+               mins.push_back(minWindow.value());
+            }
+         }
+         return maxs.size();
+      }
+
+      // Verify the rolling max / min by the two methods.
+      bool
+      verifyMaxMin(int k)
+      {
+         vector<int> maxs_slow, mins_slow;
+         vector<int> maxs_opt,  mins_opt;
+
+         int nruns = findMaxMinK_BruteForce(k, maxs_slow, mins_slow);
+         return (   (nruns == findMaxMinK(k, maxs_opt, mins_opt))
+                 && (maxs_slow == maxs_opt)
+                 && (mins_slow == mins_opt));
+      }
+
+      // Verify the result by the three methods.
       bool
       verify(int k)
       {
-         int startIndex_slow = -1;
-         int startIndex_opt  = -1;
+         int startIndex_slow   = -1;
+         int startIndex_opt    = -1;
+         int startIndex_stream = -1;
 
-         return (    findMaxSumK_BruteForce(k, &startIndex_slow)
-                     == findMaxSum(k, &startIndex_opt));
+         int result = findMaxSumK_BruteForce(k, &startIndex_slow);
+         return (   (result == findMaxSum(k, &startIndex_opt))
+                 && (result == findMaxSumStream(k, &startIndex_stream)));
       }
 
       void
@@ -175,8 +287,12 @@ class maxSumKEntriesArray
 /*
  * main() begins here.
  */
-int main()
+int main(int argc, char *argv[])
 {
+    if ((argc == 3) && (strcmp("--stream", argv[1]) == 0)) {
+        return streamMaxSum(cin, atoi(argv[2]));
+    }
+
     vector<int> data {2, 3, 4, 55, 6, 3, 2, 44, 232, 344, 101, 333};
 
     maxSumKEntriesArray my_array(data);
@@ -203,10 +319,50 @@ int main()
          << endl;
     my_array.print(startOfRun, k);
 
-    cout << "Verification of two methods: " << my_array.verify(k) << endl;
+    cout << "Verification of three methods: " << my_array.verify(k) << endl;
 
     run_test();
+    run_stream_test();
+    run_maxmin_test();
+
+    return 0;
+}
 
+/*
+ * Read ints from 'in' till EOF, and report the max SUM() of k-contiguous
+ * ints and where that run starts. Only the last k ints are held in memory.
+ */
+int
+streamMaxSum(istream& in, int k)
+{
+    if (k <= 0) {
+        cout << "Error: k must be > 0" << endl;
+        return 1;
+    }
+    SlidingWindow<int> window(k);
+    int64_t  maxSum = 0;
+    uint64_t maxStart = 0;
+    bool     found = false;
+    int      v;
+
+    while (in >> v) {
+        window.push(v);
+        if (window.full() && (!found || (window.value() > maxSum))) {
+            maxSum   = window.value();
+            maxStart = window.start();
+            found    = true;
+        }
+    }
+    if (!found) {
+        cout << "Fewer than k=" << k << " values in input: "
+             << window.count() << endl;
+        return 1;
+    }
+    cout << "# of values: " << window.count()
+         << ", k=" << k
+         << ", max SUM()=" << maxSum
+         << ", starting from index=" << maxStart
+         << endl;
     return 0;
 }
 
@@ -220,8 +376,18 @@ run_test(void)
    vector<vector <int>> test_data
          {  { 2, 3, 4, 5, 4, 3, 2, 1 }
           , { 1, 3, 9, 4, 3, 22, 11, 3, 4, 55 }
+          , { 7, 1, 8 }
          };
 
+   // Larger than the fixed-size array this class used to have.
+   mt19937 rng(8);
+   uniform_int_distribution<int> dist(0, 1000);
+   vector<int> large(10000);
+   for (auto& v : large) {
+      v = dist(rng);
+   }
+   test_data.push_back(large);
+
    auto k = 3;
    for (auto data : test_data) {
       auto startIndex = 0;
@@ -235,5 +401,102 @@ run_test(void)
            << ", starts at index=" << startIndex
            << ", verification=" << test_array.verify(k)
            << endl;
+      assert(test_array.verify(k));
+   }
+}
+
+/*
+ * Stream a million values near INT_MAX, whose k-sums overflow 32-bits,
+ * through the window, and check the max SUM() against the known answer.
+ */
+void
+run_stream_test(void)
+{
+   const int     k = 1000;
+   const int     n = (1000 * 1000);
+   const int64_t peakStart = 123456;
+
+   SlidingWindow<int> window(k);
+   int64_t  maxSum = 0;
+   uint64_t maxStart = 0;
+
+   // All values are (INT_MAX - 1), except for one k-run of INT_MAX's.
+   for (int i = 0; i < n; i++) {
+      bool inPeak = ((i >= peakStart) && (i < (peakStart + k)));
+      window.push(inPeak ? INT_MAX : (INT_MAX - 1));
+      if (window.full() && (window.value() > maxSum)) {
+         maxSum   = window.value();
+         maxStart = window.start();
+      }
+   }
+   assert(maxSum == ((int64_t) INT_MAX * k));
+   assert(maxStart == (uint64_t) peakStart);
+
+   cout << "Streamed " << window.count() << " values, k=" << k
+        << ", max SUM()=" << maxSum
+        << ", starts at index=" << maxStart
+        << endl;
+}
+
+/*
+ * Verify rolling max / min against brute-force, for inputs with runs of
+ * duplicates, sorted and reverse-sorted inputs, which exercise the deque's
+ * best and worst cases, and for all k's of a small input.
+ */
+void
+run_maxmin_test(void)
+{
+   mt19937 rng(9);
+   uniform_int_distribution<int> dist(-50, 50);
+
+   vector<int> dups(20000);
+   for (auto& v : dups) {
+      v = dist(rng);
+   }
+   vector<int> ascending(5000);
+   vector<int> descending(5000);
+   for (int i = 0; i < 5000; i++) {
+      ascending[i]  = i;
+      descending[i] = (5000 - i);
+   }
+
+   for (auto data : { dups, ascending, descending }) {
+      maxSumKEntriesArray test_array(data);
+      for (int k : { 1, 2, 17, 1000 }) {
+         assert(test_array.verifyMaxMin(k));
+      }
+   }
+
+   vector<int> small { 5, 1, 4, 4, 2, 8, -3, 7, 7, 0 };
+   maxSumKEntriesArray small_array(small);
+   for (int k = 1; k <= ((int) small.size() + 1); k++) {
+      assert(small_array.verifyMaxMin(k));
+   }
+
+   // No runs at all: Empty input, or k <= 0.
+   vector<int> maxs, mins;
+   maxSumKEntriesArray empty_array(vector<int>{});
+   assert(empty_array.findMaxMinK_BruteForce(3, maxs, mins) == 0);
+   assert(maxs.empty() && mins.empty());
+   assert(empty_array.verifyMaxMin(3));
+   assert(small_array.findMaxMinK_BruteForce(0, maxs, mins) == 0);
+   assert(small_array.verifyMaxMin(0));
+   assert(small_array.verifyMaxMin(-1));
+
+   // p100 over rolling 10K-sample windows of a 1M-sample stream.
+   const int k = 10000;
+   uniform_int_distribution<int> latency(1, 1000 * 1000);
+   SlidingWindow<int, WindowMax<int> > p100(k);
+   int64_t nwindows = 0;
+   int     maxp100  = 0;
+   for (int i = 0; i < (1000 * 1000); i++) {
+      p100.push(latency(rng));
+      if (p100.full()) {
+         maxp100 = MAX(maxp100, p100.value());
+         nwindows++;
+      }
    }
+   cout << "Rolling max / min verified; p100 over " << nwindows
+        << " windows of k=" << k << ", highest=" << maxp100
+        << endl;
 }
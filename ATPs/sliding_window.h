@@ -0,0 +1,155 @@
+/*
+ * sliding_window.h:
+ *
+ * Aggregate over the last k values of a push-based stream.
+ *
+ * SlidingWindow<T, Op> holds the most recent k values in a ring buffer of
+ * size k. Each push() drops the oldest value, when the window is full, and
+ * adds the new one; the aggregate 'Op' is updated from those two values in
+ * O(1), the same sliding technique as findMaxSum() and findSmartAvgK(), so
+ * the full input is never buffered.
+ *
+ * An aggregate 'Op' provides:
+ *
+ *    typedef ... result_type;
+ *    void        add(T value, uint64_t seq);      // value #seq entered
+ *    void        remove(T value, uint64_t seq);   // value #seq left
+ *    result_type value(size_t nvalues) const;     // for 'nvalues' in window
+ *
+ * where 'seq' is the 0-based position of the value in the stream.
+ *
+ * Aggregates provided: WindowSum, WindowAvg, WindowMax and WindowMin.
+ */
+#ifndef __SLIDING_WINDOW_H__
+#define __SLIDING_WINDOW_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <vector>
+#include <deque>
+#include <functional>
+
+/* Sum of the window, in a 64-bit accumulator. */
+template <typename T>
+struct WindowSum
+{
+   typedef int64_t result_type;
+
+   int64_t  sum = 0;
+
+   void add(T value, uint64_t seq)     { sum += value; (void) seq; }
+   void remove(T value, uint64_t seq)  { sum -= value; (void) seq; }
+
+   result_type
+   value(size_t nvalues) const { (void) nvalues; return sum; }
+};
+
+/* Average of the window; the sum is kept in a 64-bit accumulator. */
+template <typename T>
+struct WindowAvg : public WindowSum<T>
+{
+   typedef double result_type;
+
+   result_type
+   value(size_t nvalues) const {
+      return (nvalues ? ((double) this->sum / nvalues) : 0.0);
+   }
+};
+
+/*
+ * Max or min of the window, by a monotonic deque: It holds, oldest first,
+ * only those values which are 'Better' than all values pushed after them,
+ * so its front is the extreme of the window. Each value is added and removed
+ * from the deque at most once, which is O(1) amortized per push().
+ */
+template <typename T, typename Better>
+struct WindowExtreme
+{
+   typedef T result_type;
+
+   struct Entry
+   {
+      T        value;
+      uint64_t seq;
+   };
+   std::deque<Entry> entries;
+   Better            better;
+
+   void
+   add(T value, uint64_t seq) {
+      // Older values that are no better than 'value' can never be the
+      // extreme again, as 'value' will stay in the window longer.
+      while (!entries.empty() && !better(entries.back().value, value)) {
+         entries.pop_back();
+      }
+      entries.push_back({value, seq});
+   }
+
+   void
+   remove(T value, uint64_t seq) {
+      (void) value;
+      if (!entries.empty() && (entries.front().seq == seq)) {
+         entries.pop_front();
+      }
+   }
+
+   result_type
+   value(size_t nvalues) const {
+      (void) nvalues;
+      assert(!entries.empty());
+      return entries.front().value;
+   }
+};
+
+template <typename T>
+using WindowMax = WindowExtreme<T, std::greater<T> >;
+
+template <typename T>
+using WindowMin = WindowExtreme<T, std::less<T> >;
+
+template <typename T, typename Op = WindowSum<T> >
+class SlidingWindow
+{
+   private:
+      std::vector<T> ring;       // Last k values; ring[head] is the oldest
+      size_t         head;
+      size_t         nvalues;    // # of values in window, <= k
+      uint64_t       npushed;    // # of values pushed, ever
+      Op             op;
+
+   public:
+      explicit SlidingWindow(size_t k)
+         : ring(k), head(0), nvalues(0), npushed(0) {
+         assert(k > 0);
+      }
+
+      // Add the next value of the stream, dropping the oldest if full.
+      void
+      push(T value) {
+         if (nvalues == ring.size()) {
+            op.remove(ring[head], (npushed - nvalues));
+         } else {
+            nvalues++;
+         }
+         ring[head] = value;
+         op.add(value, npushed);
+         npushed++;
+         if (++head == ring.size()) {
+            head = 0;
+         }
+      }
+
+      typename Op::result_type
+      value(void) const { return op.value(nvalues); }
+
+      bool     full(void)     const { return (nvalues == ring.size()); }
+      size_t   size(void)     const { return nvalues; }
+      size_t   capacity(void) const { return ring.size(); }
+
+      // Stream position of the oldest value in the window.
+      uint64_t start(void)    const { return (npushed - nvalues); }
+      uint64_t count(void)    const { return npushed; }
+};
+
+#endif  // __SLIDING_WINDOW_H__
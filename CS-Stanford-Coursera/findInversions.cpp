@@ -13,6 +13,16 @@
  * The numeric answer for the given input file should be typed in the
  * space below.
  *
+ * Usage: g++ -O2 -pthread -o findInversions findInversions.cpp
+ *        ./findInversions [ <input-file> [ <nthreads> ] ]
+ *        ./findInversions --convert <input-file> <output-file>
+ *        ./findInversions --external <input-file> [ <run-items> [ <fanin> ] ]
+ *
+ * Input files are either text, one integer per line, or in a binary format
+ * (see BIN_HEADER). --convert converts a text file to binary, and vice-versa.
+ * --external counts inversions in a binary input file larger than memory, by
+ * external merge-sort of sorted runs of <run-items> items, spilled to $TMPDIR.
+ *
  * History:
  *   5.Mar.2022   - At Stanford Old Union building
  */
@@ -20,76 +30,321 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <random>
+#include <random>       // For the baseline, in run_rand_tests()
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <thread>
+#include <cstdlib>
+#include <chrono>
+#include <limits>
+#include <cstddef>      // For offsetof()
+#include <queue>
+
+#include <fcntl.h>      // For open()
+#include <unistd.h>     // For close()
+#include <sys/mman.h>   // For mmap(), munmap()
+#include <sys/stat.h>   // For fstat()
+
+#if __linux__
+#include <cstring>
+#include <cassert>
+#endif // __linux__
+
+#include "../Self-Study/Tools/rand_gen.h"     // RandInt, randFillParallel()
 
 using namespace std;
 
-const int Num_items = (100 * 1000);   // 100K
+const int One_K     = 1000;
 const int One_M     = (1000 * 1000);
 
+// Sub-lists of these many items, or fewer, are sorted serially in parallel mode
+const size_t Par_cutoff_default = (64 * 1024);
+
+// External-merge mode: # of items per sorted run, max # of runs merged at a
+// time and # of items buffered per run file reader / writer.
+const size_t   Ext_run_items_default = (64 * One_M);
+const unsigned Ext_fanin_default     = 64;
+const size_t   Ext_io_items          = (64 * One_K);
+
 // Function prototypes
 int run_random_tests(void);
 int run_test(int nitems);
+int run_reversed_tests(void);
+int run_parallel_tests(void);
+int run_loader_tests(void);
+int run_external_tests(void);
+int run_rand_tests(void);
+int convert(const char *inpfile, const char *outfile);
+int count_external(const char *inpfile, size_t run_items, unsigned fanin);
 
 // ----------------------------------------------------------------------------
-// Random-generator class.
-// Ref: Stroustrup's C++ book, 2nd Ed., Sec. 14.5, Pgs. 191.
+// Binary input file format: A fixed-size header followed by 'nitems' integers,
+// each of 'item_size' bytes (4 => int32, 8 => int64). All fields, and all the
+// items, are little-endian.
+//
+//   [ "FINV" | version | item_size | nitems ] [ item-0 ] [ item-1 ] ...
 // ----------------------------------------------------------------------------
-class Rand_int
+const char     Bin_magic[4] = { 'F', 'I', 'N', 'V' };
+const uint16_t Bin_version  = 1;
+
+typedef struct bin_header
+{
+    char        magic[4];
+    uint16_t    version;
+    uint16_t    item_size;      // # of bytes per item: 4 or 8
+    uint64_t    nitems;
+} BIN_HEADER;
+
+static_assert(sizeof(BIN_HEADER) == 16, "Binary file header must be 16 bytes");
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define HOST_IS_LITTLE_ENDIAN 1
+#else
+#define HOST_IS_LITTLE_ENDIAN 0
+#endif
+
+// Decode / encode a little-endian integer of type U, independent of host order.
+template <typename U>
+inline U
+le_decode(const uint8_t *src)
+{
+    U v;
+#if HOST_IS_LITTLE_ENDIAN
+    memcpy(&v, src, sizeof(v));
+#else
+    typename make_unsigned<U>::type uv = 0;
+    for (size_t b = 0; b < sizeof(U); b++) {
+        uv |= ((typename make_unsigned<U>::type) src[b] << (8 * b));
+    }
+    v = (U) uv;
+#endif
+    return v;
+}
+
+template <typename U>
+inline void
+le_encode(uint8_t *dst, U v)
+{
+#if HOST_IS_LITTLE_ENDIAN
+    memcpy(dst, &v, sizeof(v));
+#else
+    auto uv = (typename make_unsigned<U>::type) v;
+    for (size_t b = 0; b < sizeof(U); b++) {
+        dst[b] = (uint8_t) (uv >> (8 * b));
+    }
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Read-only memory-mapping of an input file. Unmapped when it goes out of scope.
+// ----------------------------------------------------------------------------
+class MappedFile
 {
   public:
-    Rand_int(int low, int high): dist{low, high} { }
+    ~MappedFile() {
+        if (addr) {
+            munmap(addr, length);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
 
-    int operator()() { return dist(rand_gen); }
+    bool
+    open(const char *filename) {
+        fd = ::open(filename, O_RDONLY);
+        if (fd < 0) {
+            cout << "Unable to open input file: '" << filename << "'\n";
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            cout << "Unable to stat input file: '" << filename << "'\n";
+            return false;
+        }
+        length = st.st_size;
+        if (length == 0) {
+            return true;
+        }
+        addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            addr = nullptr;
+            cout << "Unable to mmap input file: '" << filename << "'\n";
+            return false;
+        }
+        // Input is consumed front-to-back, once; let the kernel read-ahead.
+        madvise(addr, length, MADV_SEQUENTIAL);
+        return true;
+    }
 
-    void seed(int s) { rand_gen.seed(s); }
+    const char * data(void) { return (const char *) addr; }
+    size_t       size(void) { return length; }
 
   private:
-    default_random_engine rand_gen;
-    uniform_int_distribution<> dist;
+    int     fd = -1;
+    void *  addr = nullptr;
+    size_t  length = 0;
 };
 
 // ----------------------------------------------------------------------------
+// Fast text-parsing helpers, working on raw bytes of a mapped file.
+// ----------------------------------------------------------------------------
+inline bool
+is_digit(const char c) { return ((unsigned) (c - '0') < 10); }
+
+inline bool
+is_space(const char c) { return ((c == ' ') || ((unsigned) (c - '\t') < 5)); }
+
+// Are all 8 bytes of little-endian word 'v' ASCII digits? (SWAR check)
+inline bool
+is_8_digits(const uint64_t v)
+{
+    return ((((v & 0xF0F0F0F0F0F0F0F0ULL)
+              | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+             == 0x3333333333333333ULL));
+}
+
+// Convert 8 ASCII digits in little-endian word 'v' to their value, using
+// 3 multiplies instead of 8 multiply-adds. (SWAR conversion)
+inline uint32_t
+parse_8_digits(uint64_t v)
+{
+    v = ((v & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    v = ((v & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    return (uint32_t) (((v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+
+// ----------------------------------------------------------------------------
+// Inversions engine: Templated on the integer key-type, T, of the data items.
+//
+// Storage for the data items is sized at run-time, so the # of items is only
+// limited by available memory. The # of inversions is returned as a 64-bit
+// count, as n-items that are fully reversed have n*(n-1)/2 inversions, which
+// overflows an 'int' once n goes past ~65K items.
+//
+// The merge-step uses one scratch buffer, allocated once, sized to hold the
+// lower-half of the top-level merge. All recursive merges reuse this buffer.
+// ----------------------------------------------------------------------------
+typedef uint64_t ninv_t;    // Type of count of # of inversions
+
+template <typename T = int>
 class Inversions
 {
+   static_assert(std::is_integral<T>::value,
+                 "Inversions<T> requires an integral key-type");
+
    public:
-      // Load data items from input file
-      void
+      // Load data items from input file. The file is memory-mapped, and is
+      // either in the binary format, identified by its header, or is text
+      // with one integer per line, like the .dat files under TestData/.
+      bool
       load(const char *filename)
       {
-         ifstream inpfile(filename);
-         if (!inpfile.is_open()) {
-            cout << "Unable to open input file: '" << filename << "'\n";
-            return;
+         MappedFile inpfile;
+         if (!inpfile.open(filename)) {
+            return false;
+         }
+
+         bool rv = false;
+         if (   (inpfile.size() >= sizeof(BIN_HEADER))
+             && (memcmp(inpfile.data(), Bin_magic, sizeof(Bin_magic)) == 0)) {
+            rv = loadBinary(inpfile.data(), inpfile.size(), filename);
+         } else {
+            rv = loadText(inpfile.data(), inpfile.size(), filename);
+         }
+         if (rv) {
+            cout << "Read " << nelements << " ints from input file " << filename << endl;
+         }
+         return rv;
+      }
+
+      // Save data items to output file in binary format, with each item
+      // encoded in 'item_size' bytes. Returns false if an item does not fit.
+      bool
+      saveBinary(const char *filename, const uint16_t item_size = sizeof(T))
+      {
+         if ((item_size != sizeof(int32_t)) && (item_size != sizeof(int64_t))) {
+            cout << "Unsupported item size " << item_size << " for binary file\n";
+            return false;
+         }
+         ofstream outfile(filename, ios::binary | ios::trunc);
+         if (!outfile.is_open()) {
+            cout << "Unable to open output file: '" << filename << "'\n";
+            return false;
          }
 
-         // Read till eof contents into int array.
-         while (inpfile >> numbers[nelements]) {
-            nelements++;
+         uint8_t hdr[sizeof(BIN_HEADER)];
+         memcpy(hdr, Bin_magic, sizeof(Bin_magic));
+         le_encode<uint16_t>(hdr + offsetof(BIN_HEADER, version), Bin_version);
+         le_encode<uint16_t>(hdr + offsetof(BIN_HEADER, item_size), item_size);
+         le_encode<uint64_t>(hdr + offsetof(BIN_HEADER, nitems), nelements);
+         outfile.write((const char *) hdr, sizeof(hdr));
+
+         // Encode items in chunks, to write the file in large I/Os.
+         vector<uint8_t> buf(item_size * min(nelements, (size_t) (64 * One_K)));
+         size_t nbuf = 0;
+         for (size_t ictr = 0; ictr < nelements; ictr++) {
+            if (item_size == sizeof(int32_t)) {
+               if ((numbers[ictr] < (T) INT32_MIN) || (numbers[ictr] > (T) INT32_MAX)) {
+                  cout << "Item [" << ictr << "]: " << numbers[ictr]
+                       << " does not fit in " << item_size << " bytes\n";
+                  return false;
+               }
+               le_encode<int32_t>(&buf[nbuf], (int32_t) numbers[ictr]);
+            } else {
+               le_encode<int64_t>(&buf[nbuf], (int64_t) numbers[ictr]);
+            }
+            nbuf += item_size;
+            if (nbuf == buf.size()) {
+               outfile.write((const char *) buf.data(), nbuf);
+               nbuf = 0;
+            }
          }
+         outfile.write((const char *) buf.data(), nbuf);
+         return outfile.good();
+      }
 
-         inpfile.close();
-         cout << "Read " << nelements << " ints from input file " << filename << endl;
+      // Save data items to output file as text, one integer per line.
+      bool
+      saveText(const char *filename)
+      {
+         ofstream outfile(filename, ios::trunc);
+         if (!outfile.is_open()) {
+            cout << "Unable to open output file: '" << filename << "'\n";
+            return false;
+         }
+         for (size_t ictr = 0; ictr < nelements; ictr++) {
+            outfile << (int64_t) numbers[ictr] << '\n';
+         }
+         return outfile.good();
       }
 
       // Load random # of values in input array, within an arbitrary chosen range
-      // of -1M to 1M
+      // of 0 to 1M. Generated in bulk, by all CPUs for large inputs; the data
+      // depends only on 'seed' and 'nitems', not on the # of CPUs.
       void
-      loadRand(const int nitems) {
-        Rand_int rnd{0, One_M};
-
-        // NOTE: Uncomment this to get predictable random data for debugging.
-        // rnd.seed(nitems);
+      loadRand(const size_t nitems, const uint64_t seed = Rand_default_seed) {
+        numbers.resize(nitems);
+        randFillParallel(numbers.data(), nitems, (T) 0, (T) One_M, seed);
+        nelements = nitems;
+      }
 
-        for (auto ictr = 0; ictr < nitems; ictr++) {
-            numbers[ictr] = rnd();
+      // Load 'nitems' values in fully reversed order, i.e., [n-1, ..., 1, 0].
+      // This is the worst-case input, with n*(n-1)/2 inversions.
+      void
+      loadReversed(const size_t nitems) {
+        numbers.resize(nitems);
+        for (size_t ictr = 0; ictr < nitems; ictr++) {
+            numbers[ictr] = (T) (nitems - ictr - 1);
         }
         nelements = nitems;
       }
 
       // Find # of inversions in input array loaded by the load() method.
       // The input data will be sorted in-place upon return.
-      int
+      ninv_t
       numInversions()
       {
          if (nelements <= 1) {
@@ -99,28 +354,77 @@ class Inversions
             return numInvBase(0, nelements);
          }
 
+         // Scratch space for merge-step is at most the size of the lower-half
+         // of the top-level merge. Allocate it once, for use by all merges.
+         size_t nitems_lo = (nelements / 2);
+         scratch.resize(nitems_lo);
+
          // cout << __func__ << ": start=0" << ", nelements=" << nelements << endl;
-         int rv = 0;
-         int nitems_lo = (nelements / 2);
+         ninv_t rv = 0;
 
          // Recursive on left / right; sorting each half to count # inversions.
-         rv += numInvSort(0, nitems_lo);
+         T *tmp = scratch.data();
+         rv += numInvSort(0, nitems_lo, tmp);
 
          auto nitems_hi = (nelements - nitems_lo);
-         rv += numInvSort(nitems_lo, nitems_hi);
+         rv += numInvSort(nitems_lo, nitems_hi, tmp);
 
          // Merge the two sorted sub-lists
-         rv += numInvMerge(0, nitems_lo, nitems_lo, nitems_hi);
+         rv += numInvMerge(0, nitems_lo, nitems_lo, nitems_hi, tmp);
+         return rv;
+      }
+
+      // Multi-threaded version of numInversions(), using up to 'nthreads'.
+      // The merge-sort recursion is run as a fork-join tree of tasks; each
+      // fork hands half of its threads to the lower sub-list. Sub-lists of
+      // 'cutoff' or fewer items, or with no more threads to hand out, fall
+      // back to the serial numInvSort(). Large merges are split across the
+      // threads available at that level, using parallelMerge().
+      // The input data will be sorted in-place upon return.
+      ninv_t
+      numInversionsParallel(unsigned nthreads = thread::hardware_concurrency(),
+                            size_t cutoff = Par_cutoff_default)
+      {
+         if (nelements <= 1) {
+            return 0;
+         }
+         if (nthreads == 0) {
+            nthreads = 1;
+         }
+         if (cutoff < 2) {
+            cutoff = 2;
+         }
+
+         // Each sub-list uses the region of scratch at the same offset as its
+         // items in numbers[], so concurrent tasks never share scratch space.
+         scratch.resize(nelements);
+         return numInvSortParallel(0, nelements, nthreads, cutoff);
+      }
+
+      // Count # of inversions using the brute-force O(n^2) method.
+      // Input data is not changed. Used to verify numInversions() on small
+      // data sets. Needs to be called before numInversions().
+      ninv_t
+      numInversionsBruteForce(void)
+      {
+         ninv_t rv = 0;
+         for (size_t i = 0; i < nelements; i++) {
+            for (size_t j = (i + 1); j < nelements; j++) {
+                if (numbers[i] > numbers[j]) {
+                    rv++;
+                }
+            }
+         }
          return rv;
       }
 
       // Verify that the contents are in sorted order
       bool
-      verify(int& error_index)
+      verify(size_t& error_index)
       {
-         for (auto ictr = 0; ictr < (nelements - 1); ictr++) {
-            if (numbers[ictr] > numbers[ictr + 1]) {
-                error_index = ictr + 1;
+         for (size_t ictr = 1; ictr < nelements; ictr++) {
+            if (numbers[ictr - 1] > numbers[ictr]) {
+                error_index = ictr;
                 return false;
             }
          }
@@ -133,19 +437,154 @@ class Inversions
       dump(void)
       {
          cout << nelements << " ints loaded" << endl;
-         for (auto ictr = 0; ictr < nelements; ictr++) {
+         for (size_t ictr = 0; ictr < nelements; ictr++) {
             cout << "[" << ictr << "]: " << numbers[ictr] << endl;
          }
       }
+
+      size_t size(void) { return nelements; }
+
+      // Item 'i' of the loaded / sorted data.
+      T operator[](size_t i) { return numbers[i]; }
+
+      // Resize data to 'nitems' items. Returns pointer to the items, for the
+      // caller to load them in-place.
+      T *
+      resize(const size_t nitems) {
+        numbers.resize(nitems);
+        nelements = nitems;
+        return numbers.data();
+      }
+
+      const T * data(void) { return numbers.data(); }
+
    private:
-      int nelements = 0;
-      int numbers[Num_items] = {0};
+      size_t    nelements = 0;
+      vector<T> numbers;
+      vector<T> scratch;    // Reusable scratch buffer for numInvMerge()
+
+      // Load items from a mapped binary file, validating its header.
+      bool
+      loadBinary(const char *data, size_t length, const char *filename)
+      {
+         const uint8_t *src = (const uint8_t *) data;
+         auto version   = le_decode<uint16_t>(src + offsetof(BIN_HEADER, version));
+         auto item_size = le_decode<uint16_t>(src + offsetof(BIN_HEADER, item_size));
+         auto nitems    = le_decode<uint64_t>(src + offsetof(BIN_HEADER, nitems));
+
+         if (version != Bin_version) {
+            cout << "Unsupported binary file version " << version
+                 << " in input file: '" << filename << "'\n";
+            return false;
+         }
+         if ((item_size != sizeof(int32_t)) && (item_size != sizeof(int64_t))) {
+            cout << "Unsupported item size " << item_size
+                 << " in input file: '" << filename << "'\n";
+            return false;
+         }
+         if (nitems > ((length - sizeof(BIN_HEADER)) / item_size)) {
+            cout << "Truncated input file: '" << filename << "', expected "
+                 << nitems << " items\n";
+            return false;
+         }
+
+         // Straight copy when the file's items are already of the key-type.
+         src += sizeof(BIN_HEADER);
+         numbers.resize(nitems);
+         nelements = nitems;
+         if (HOST_IS_LITTLE_ENDIAN && (item_size == sizeof(T))) {
+            if (nitems) {
+               memcpy(numbers.data(), src, (nitems * sizeof(T)));
+            }
+            return true;
+         }
+         for (size_t ictr = 0; ictr < nitems; ictr++, src += item_size) {
+            int64_t v = ((item_size == sizeof(int32_t))
+                            ? le_decode<int32_t>(src) : le_decode<int64_t>(src));
+            if (!fitsKeyType(v)) {
+               cout << "Item [" << ictr << "]: " << v << " out of range"
+                    << " in input file: '" << filename << "'\n";
+               numbers.clear();
+               nelements = 0;
+               return false;
+            }
+            numbers[ictr] = (T) v;
+         }
+         return true;
+      }
+
+      // Load items from a mapped text file of white-space separated integers.
+      // Hand-rolled parser: digits are checked and converted 8 bytes at a time
+      // where possible, with no per-item stream or locale overheads.
+      bool
+      loadText(const char *data, size_t length, const char *filename)
+      {
+         const char *p   = data;
+         const char *end = (data + length);
+
+         numbers.clear();
+         numbers.reserve(length / 8);
+         while (p < end) {
+            while ((p < end) && is_space(*p)) {
+               p++;
+            }
+            if (p == end) {
+               break;
+            }
+            bool neg = (*p == '-');
+            if (neg || (*p == '+')) {
+               p++;
+            }
+
+            const char *digits = p;
+            uint64_t v = 0;
+#if HOST_IS_LITTLE_ENDIAN
+            uint64_t word;
+            while (((end - p) >= 8) && (memcpy(&word, p, 8), is_8_digits(word))) {
+               v = (v * 100000000) + parse_8_digits(word);
+               p += 8;
+            }
+#endif
+            while ((p < end) && is_digit(*p)) {
+               v = (v * 10) + (*p - '0');
+               p++;
+            }
+
+            // Stop at first malformed item, same as 'inpfile >> item' would.
+            auto ndigits = (p - digits);
+            if ((ndigits == 0) || ((p < end) && !is_space(*p))) {
+               cout << "Stopped at malformed item at offset " << (digits - data)
+                    << " in input file: '" << filename << "'\n";
+               break;
+            }
+            if ((ndigits > 18) || !fitsKeyType(neg ? -(int64_t) v : (int64_t) v)) {
+               cout << "Item [" << numbers.size() << "] out of range"
+                    << " in input file: '" << filename << "'\n";
+               break;
+            }
+            numbers.push_back((T) (neg ? -(int64_t) v : (int64_t) v));
+         }
+         nelements = numbers.size();
+         return true;
+      }
+
+      // Can value 'v', decoded from an input file, be held in key-type T?
+      static bool
+      fitsKeyType(const int64_t v)
+      {
+         if (is_signed<T>::value || (sizeof(T) < sizeof(int64_t))) {
+            return (   (v >= (int64_t) numeric_limits<T>::min())
+                    && (v <= (int64_t) numeric_limits<T>::max()));
+         }
+         return (v >= 0);
+      }
 
       // Given a [sub-]array of 'n' items, implement merge-sort to count # of
       // inversions in this set starting at index 'start', with 'nitems' in the
-      // set. Input data will be sorted upon return.
-      int
-      numInvSort(int start, int nitems)
+      // set. Input data will be sorted upon return. 'tmp' is scratch space
+      // for at least (nitems / 2) items, reused by all merges in this set.
+      ninv_t
+      numInvSort(size_t start, size_t nitems, T *tmp)
       {
          if (nitems <= 1) {
             return 0;
@@ -155,14 +594,43 @@ class Inversions
          }
 
          // cout << __func__ << ": start=" << start << ", nitems=" << nitems << endl;
-         int rv = 0;
-         int nitems_lo = (nitems / 2);    // Same as # items in low-list, nitems_lo
-         rv += numInvSort(start, nitems_lo);
+         ninv_t rv = 0;
+         size_t nitems_lo = (nitems / 2);    // Same as # items in low-list, nitems_lo
+         rv += numInvSort(start, nitems_lo, tmp);
 
          auto nitems_hi = (nitems - nitems_lo);
-         rv += numInvSort((start + nitems_lo), nitems_hi);
+         rv += numInvSort((start + nitems_lo), nitems_hi, tmp);
 
-         rv += numInvMerge(start, (start + nitems_lo), nitems_lo, nitems_hi);
+         rv += numInvMerge(start, (start + nitems_lo), nitems_lo, nitems_hi, tmp);
+         return rv;
+      }
+
+      // Fork-join version of numInvSort(). Lower sub-list is sorted on a new
+      // thread, higher sub-list on this thread, with 'nthreads' split between
+      // the two. Uses the region of scratch starting at index 'start'.
+      ninv_t
+      numInvSortParallel(size_t start, size_t nitems, unsigned nthreads,
+                         size_t cutoff)
+      {
+         if ((nthreads <= 1) || (nitems <= cutoff)) {
+            return numInvSort(start, nitems, &scratch[start]);
+         }
+
+         size_t   nitems_lo = (nitems / 2);
+         size_t   nitems_hi = (nitems - nitems_lo);
+         unsigned nthreads_lo = (nthreads / 2);
+
+         ninv_t rv_lo = 0;
+         thread tlo([&]() {
+            rv_lo = numInvSortParallel(start, nitems_lo, nthreads_lo, cutoff);
+         });
+         ninv_t rv = numInvSortParallel((start + nitems_lo), nitems_hi,
+                                        (nthreads - nthreads_lo), cutoff);
+         tlo.join();
+         rv += rv_lo;
+
+         rv += parallelMerge(start, (start + nitems_lo), nitems_lo, nitems_hi,
+                             nthreads, cutoff);
          return rv;
       }
 
@@ -172,11 +640,16 @@ class Inversions
       // 'lo', 'hi' are start indexes of lower / higher sub-list
       // 'nitems_lo' is # of items in lower  'lo' sub-list.
       // 'nitems_hi' is # of items in higher 'hi' sub-list.
-      int
-      numInvMerge(const int lo, const int hi, const int nitems_lo,
-                  const int nitems_hi)
+      //
+      // Only the lower sub-list is copied out to the scratch buffer. The
+      // merged output is written from index 'lo' onwards, which can never
+      // overrun the yet-to-be-merged items of the higher sub-list.
+      ninv_t
+      numInvMerge(const size_t lo, const size_t hi, const size_t nitems_lo,
+                  const size_t nitems_hi, T *tmp)
       {
          assert((lo + nitems_lo) == hi);
+
          // [l0, l1, l2, ..., li]  [h0, h1, h2, ..., hj]
          // Deal with simple case when lower-list is <= higher-list
          // Case: li <= h0
@@ -184,45 +657,36 @@ class Inversions
             return 0;
          }
 
-         // Deal with reverse case when all items in sorted upper-half are <= all
+         // Deal with reverse case when all items in sorted upper-half are < all
          // items in sorted lower-half
-         // Case: hj <= l0
+         // Case: hj < l0
          if (   (nitems_lo == nitems_hi)
-             && (numbers[hi + nitems_lo - 1] <= numbers[lo])) {
+             && (numbers[hi + nitems_lo - 1] < numbers[lo])) {
             // cout << __func__ << ":" << __LINE__ << ": do swapChunk()" << endl;
 
             // Flip both sub-halves as a chunk using memory move
             swapChunk(lo, hi, nitems_lo);
-            return (nitems_lo * nitems_lo);
+            return ((ninv_t) nitems_lo * nitems_lo);
          }
 
-         // Process all items in lower-half. When this loop terminates, lop will
-         // be pointing to 1st element -after- end of lower-half; I.e., it will
-         // be positioned exactly at the 1st element of the upper-half.
-         auto nlower_half_items = nitems_lo;
-
-         // Merge the two sub-lists, counting # inversions along the way
-         int *lop = &numbers[lo];
-         int *hip = &numbers[hi];
-
-         // Create 2-source sub-lists; 'lo', 'hi' is just for our understanding
-         int src_lo[nitems_lo];
-         int src_hi[nitems_hi];
-         memmove(src_lo, lop, (nitems_lo * sizeof(*lop)));
-         memmove(src_hi, hip, (nitems_hi * sizeof(*hip)));
+         // Copy out lower sub-list to scratch; merge it with the higher
+         // sub-list, which stays in-place, counting # inversions along the way.
+         T *lop = tmp;
+         T *hip = &numbers[hi];
+         memmove(lop, &numbers[lo], (nitems_lo * sizeof(*lop)));
 
          // Establish terminating pointers
-         int *loend = (lop + nitems_lo);
-         int *hiend = (hip + nitems_hi);
+         T *loend = (lop + nitems_lo);
+         T *hiend = (hip + nitems_hi);
 
-         auto rv = 0;
-         auto curr = lo;
+         ninv_t rv = 0;
+         T *curr = &numbers[lo];
          while ((lop < loend) && (hip < hiend)) {
             if (*lop <= *hip) {
-                numbers[curr] = *lop;
+                *curr = *lop;
                 lop++;
             } else {
-                numbers[curr] = *hip;
+                *curr = *hip;
                 hip++;
                 rv += (loend - lop);
             }
@@ -231,26 +695,118 @@ class Inversions
 
          // If any items left over from 'lo' list, copy them over as a chunk.
          // No need to check for left-over items from 'hi' list as those are
-         // already in the output 'numbers' array.
+         // already in the output 'numbers' array. Inversions for the left-over
+         // 'lo' items were already counted as each 'hi' item was merged.
          if (lop < loend) {
-
             auto leftover_lo_items = (loend - lop);
-            memmove(&numbers[curr], lop, (leftover_lo_items * sizeof(*lop)));
+            memmove(curr, lop, (leftover_lo_items * sizeof(*lop)));
+         }
+         return rv;
+      }
+
+      // -----------------------------------------------------------------------
+      // Parallel version of numInvMerge(), splitting the merge into 'nthreads'
+      // segments of the output by co-ranking. Both sorted sub-lists are first
+      // copied out to the region of scratch starting at index 'lo', as the
+      // output segments of one thread can overlap the input of another.
+      //
+      // Each higher sub-list item merged ahead of lower sub-list item 'i'
+      // contributes (nitems_lo - i) inversions, irrespective of which segment
+      // it was merged in, so each thread counts its own segment's share.
+      ninv_t
+      parallelMerge(const size_t lo, const size_t hi, const size_t nitems_lo,
+                    const size_t nitems_hi, unsigned nthreads, size_t cutoff)
+      {
+         assert((lo + nitems_lo) == hi);
+
+         size_t nitems = (nitems_lo + nitems_hi);
+         if ((nthreads <= 1) || (nitems <= cutoff)) {
+            return numInvMerge(lo, hi, nitems_lo, nitems_hi, &scratch[lo]);
+         }
+         // Sub-lists are already in order; nothing to merge.
+         if (numbers[lo + nitems_lo - 1] <= numbers[hi]) {
+            return 0;
+         }
+
+         const T *srclo = &scratch[lo];
+         const T *srchi = &scratch[hi];
+         memmove(&scratch[lo], &numbers[lo], (nitems * sizeof(*srclo)));
+
+         vector<ninv_t> rv_seg(nthreads, 0);
+         auto merge_seg = [&](unsigned seg) {
+            size_t k0 = ((nitems * seg) / nthreads);
+            size_t k1 = ((nitems * (seg + 1)) / nthreads);
+            size_t i  = coRank(k0, srclo, nitems_lo, srchi, nitems_hi);
+            size_t j  = (k0 - i);
+            size_t i1 = coRank(k1, srclo, nitems_lo, srchi, nitems_hi);
+            size_t j1 = (k1 - i1);
+
+            T *curr = &numbers[lo + k0];
+            ninv_t rv = 0;
+            while ((i < i1) && (j < j1)) {
+               if (srclo[i] <= srchi[j]) {
+                  *curr++ = srclo[i++];
+               } else {
+                  *curr++ = srchi[j++];
+                  rv += (nitems_lo - i);
+               }
+            }
+            while (i < i1) {
+               *curr++ = srclo[i++];
+            }
+            rv += ((j1 - j) * (nitems_lo - i));
+            while (j < j1) {
+               *curr++ = srchi[j++];
+            }
+            rv_seg[seg] = rv;
+         };
+
+         vector<thread> workers;
+         for (unsigned seg = 1; seg < nthreads; seg++) {
+            workers.emplace_back(merge_seg, seg);
+         }
+         merge_seg(0);
+         for (auto& w : workers) {
+            w.join();
+         }
 
-            // These many left-over items from 'lo' list were all > each item
-            // of the initial 'hi' list. Account for that many # of inversions.
-            rv += (leftover_lo_items * nitems_hi);
+         ninv_t rv = 0;
+         for (auto r : rv_seg) {
+            rv += r;
          }
          return rv;
       }
 
+      // Co-rank: Find # of items, i, from sorted list 'a' (of 'na' items) that
+      // are among the first 'k' items of the merged output of lists 'a' and
+      // 'b'. The remaining (k - i) items come from 'b'. On ties, items from
+      // 'a' come first, same as in numInvMerge(). Binary search, O(log(k)).
+      static size_t
+      coRank(const size_t k, const T *a, const size_t na,
+             const T *b, const size_t nb)
+      {
+         size_t ilo = ((k > nb) ? (k - nb) : 0);
+         size_t ihi = min(k, na);
+
+         // Find smallest i, such that b[k - i - 1] < a[i]
+         while (ilo < ihi) {
+            size_t i = (ilo + (ihi - ilo) / 2);
+            if (b[k - i - 1] >= a[i]) {
+               ilo = (i + 1);
+            } else {
+               ihi = i;
+            }
+         }
+         return ilo;
+      }
+
       // Implement the base case: Assert(n==2);
-      int
-      numInvBase(int start, int nitems)
+      ninv_t
+      numInvBase(size_t start, size_t nitems)
       {
          assert(nitems == 2);
 
-         int rv = 0;
+         ninv_t rv = 0;
          // Flip the pair if needed, and count 1 inversion.
          if (numbers[start] > numbers[start + 1]) {
             swap(start, start + 1);
@@ -261,7 +817,7 @@ class Inversions
 
       // Swap i'th item with j'th item in numbers[] array
       void
-      swap(const int i, const int j) {
+      swap(const size_t i, const size_t j) {
         assert(i < nelements);
         assert(j < nelements);
 
@@ -271,30 +827,453 @@ class Inversions
       }
 
       // Swap chunk of 'nitems' from i'th and j'th index in numbers[] array
+      // Swaps item-by-item, so no temporary copy of the chunk is needed.
       void
-      swapChunk(const int i, const int j, const int nitems) {
+      swapChunk(const size_t i, const size_t j, const size_t nitems) {
         assert((i + nitems) <= nelements);
         assert((j + nitems) <= nelements);
-        int tmp[nitems];
-        memmove(tmp, &numbers[i], (nitems * sizeof(*tmp)));
-        memmove(&numbers[i], &numbers[j], (nitems * sizeof(*tmp)));
-        memmove(&numbers[j], tmp, (nitems * sizeof(*tmp)));
+        std::swap_ranges(&numbers[i], &numbers[i + nitems], &numbers[j]);
       }
 };
 
+// ----------------------------------------------------------------------------
+// Buffered writer / reader of spilled runs of sorted items. Run files hold raw
+// items of type T, in host order, as they are private to one counting job.
+// Both track the # of bytes moved, for per-pass I/O stats.
+// ----------------------------------------------------------------------------
+template <typename T>
+class RunWriter
+{
+  public:
+    bool
+    open(const string& filename) {
+        outfile.open(filename, ios::binary | ios::trunc);
+        buf.reserve(Ext_io_items);
+        return outfile.is_open();
+    }
+
+    void
+    put(const T item) {
+        buf.push_back(item);
+        if (buf.size() == Ext_io_items) {
+            flush();
+        }
+    }
+
+    bool
+    close(void) {
+        flush();
+        outfile.close();
+        return !outfile.fail();
+    }
+
+    uint64_t nbytes = 0;
+
+  private:
+    ofstream  outfile;
+    vector<T> buf;
+
+    void
+    flush(void) {
+        outfile.write((const char *) buf.data(), (buf.size() * sizeof(T)));
+        nbytes += (buf.size() * sizeof(T));
+        buf.clear();
+    }
+};
+
+template <typename T>
+class RunReader
+{
+  public:
+    bool
+    open(const string& filename, const uint64_t nitems) {
+        inpfile.open(filename, ios::binary);
+        nleft = nitems;
+        buf.resize(min((uint64_t) Ext_io_items, nitems));
+        fill();
+        return inpfile.is_open();
+    }
+
+    bool      empty(void) { return (curr == nbuf); }
+    const T&  peek(void)  { return buf[curr]; }
+
+    void
+    pop(void) {
+        if (++curr == nbuf) {
+            fill();
+        }
+    }
+
+    uint64_t nbytes = 0;
+
+  private:
+    ifstream  inpfile;
+    vector<T> buf;
+    size_t    curr = 0;
+    size_t    nbuf = 0;
+    uint64_t  nleft = 0;
+
+    void
+    fill(void) {
+        curr = 0;
+        nbuf = min((uint64_t) buf.size(), nleft);
+        inpfile.read((char *) buf.data(), (nbuf * sizeof(T)));
+        if ((size_t) inpfile.gcount() != (nbuf * sizeof(T))) {
+            nbuf = (inpfile.gcount() / sizeof(T));
+        }
+        nleft -= nbuf;
+        nbytes += (nbuf * sizeof(T));
+    }
+};
+
+// I/O and counting stats for one pass of the external-merge
+typedef struct ext_pass_stats
+{
+    unsigned    pass;           // 0 => run formation, 1.. => merge passes
+    uint64_t    nruns_in;
+    uint64_t    nruns_out;
+    uint64_t    bytes_read;
+    uint64_t    bytes_written;
+    ninv_t      ninv;           // # of inversions counted in this pass
+} EXT_PASS_STATS;
+
+// ----------------------------------------------------------------------------
+// External-memory inversions counter, for inputs larger than memory.
+//
+// - Pass 0: Read the (binary format) input in runs of 'run_items' items,
+//   count inversions within each run using Inversions::numInversions(),
+//   and spill each sorted run to a temp file.
+// - Pass 1..: k-way merge groups of up to 'fanin' consecutive runs, counting
+//   cross-run inversions, till a single run is left. The last merge only
+//   counts, and does not write its output.
+//
+// When item 'y' of run 'r' is merged out, all items left in runs [0, r) are
+// > 'y' (equal items from earlier runs are merged out first), so 'y' adds
+// that many inversions. Running counts of items left in each run are kept in
+// a Fenwick tree, for O(log(fanin)) lookups.
+//
+// Merged runs stay in order of their position in the input, so the pairs of
+// items counted in each pass are disjoint. Memory used is bounded by one run
+// (plus half a run of scratch), and 'fanin' I/O buffers.
+// ----------------------------------------------------------------------------
+template <typename T = int>
+class ExternalInversions
+{
+  public:
+    ExternalInversions(size_t nrun_items = Ext_run_items_default,
+                       unsigned max_fanin = Ext_fanin_default,
+                       const char *dir = nullptr)
+        : run_items(max(nrun_items, (size_t) 1))
+        , fanin(max(max_fanin, 2U))
+    {
+        if (!dir) {
+            dir = getenv("TMPDIR");
+        }
+        tmpdir = ((dir && *dir) ? dir : "/tmp");
+    }
+
+    // Count # of inversions in binary-format input file. Returns false on
+    // errors, after removing any spilled run files.
+    bool
+    numInversions(const char *filename, ninv_t& ninv)
+    {
+        stats.clear();
+        ninv = 0;
+
+        vector<RUN> runs;
+        bool rv = formRuns(filename, runs);
+        while (rv && (runs.size() > 1)) {
+            rv = mergePass(runs);
+        }
+        for (auto& run : runs) {
+            unlink(run.filename.c_str());
+        }
+        for (auto& st : stats) {
+            ninv += st.ninv;
+        }
+        return rv;
+    }
+
+    const vector<EXT_PASS_STATS>& passStats(void) { return stats; }
+
+    void
+    printStats(void)
+    {
+        for (auto& st : stats) {
+            cout << "Pass " << st.pass
+                 << ": runs in=" << st.nruns_in
+                 << ", runs out=" << st.nruns_out
+                 << ", bytes read=" << st.bytes_read
+                 << ", bytes written=" << st.bytes_written
+                 << ", # of inversions=" << st.ninv << endl;
+        }
+    }
+
+  private:
+    typedef struct run
+    {
+        string      filename;
+        uint64_t    nitems;
+    } RUN;
+
+    size_t                  run_items;
+    unsigned                fanin;
+    string                  tmpdir;
+    vector<EXT_PASS_STATS>  stats;
+
+    string
+    runFilename(unsigned pass, size_t runid) {
+        return (tmpdir + "/findInversions." + to_string(getpid()) + ".p"
+                + to_string(pass) + ".r" + to_string(runid));
+    }
+
+    // Pass 0: Stream input into sorted runs, counting inversions within each.
+    bool
+    formRuns(const char *filename, vector<RUN>& runs)
+    {
+        EXT_PASS_STATS st = { 0, 0, 0, 0, 0, 0 };
+
+        ifstream inpfile(filename, ios::binary);
+        if (!inpfile.is_open()) {
+            cout << "Unable to open input file: '" << filename << "'\n";
+            return false;
+        }
+        uint8_t hdr[sizeof(BIN_HEADER)];
+        inpfile.read((char *) hdr, sizeof(hdr));
+        if (   (inpfile.gcount() != sizeof(hdr))
+            || (memcmp(hdr, Bin_magic, sizeof(Bin_magic)) != 0)) {
+            cout << "External mode needs a binary format input file: '"
+                 << filename << "'. Use --convert to convert it.\n";
+            return false;
+        }
+        st.bytes_read += sizeof(hdr);
+
+        auto version   = le_decode<uint16_t>(hdr + offsetof(BIN_HEADER, version));
+        auto item_size = le_decode<uint16_t>(hdr + offsetof(BIN_HEADER, item_size));
+        auto nitems    = le_decode<uint64_t>(hdr + offsetof(BIN_HEADER, nitems));
+        if (   (version != Bin_version)
+            || ((item_size != sizeof(int32_t)) && (item_size != sizeof(int64_t)))) {
+            cout << "Unsupported binary file version " << version
+                 << ", item size " << item_size
+                 << " in input file: '" << filename << "'\n";
+            return false;
+        }
+
+        // Read each run in chunks of items, decoding them into the run.
+        Inversions<T>   data;
+        vector<uint8_t> buf(Ext_io_items * item_size);
+        for (uint64_t nread = 0; nread < nitems; ) {
+            size_t nrun = min((uint64_t) run_items, (nitems - nread));
+            T *items = data.resize(nrun);
+
+            for (size_t ictr = 0; ictr < nrun; ) {
+                size_t nchunk = min(Ext_io_items, (nrun - ictr));
+                inpfile.read((char *) buf.data(), (nchunk * item_size));
+                if ((size_t) inpfile.gcount() != (nchunk * item_size)) {
+                    cout << "Truncated input file: '" << filename
+                         << "', expected " << nitems << " items\n";
+                    return false;
+                }
+                st.bytes_read += (nchunk * item_size);
+
+                const uint8_t *src = buf.data();
+                for (size_t c = 0; c < nchunk; c++, src += item_size) {
+                    items[ictr++] = (T) ((item_size == sizeof(int32_t))
+                                            ? le_decode<int32_t>(src)
+                                            : le_decode<int64_t>(src));
+                }
+            }
+            nread += nrun;
+            st.ninv += data.numInversions();
+
+            // Single run is fully counted; no need to spill it.
+            if ((nread == nitems) && runs.empty()) {
+                break;
+            }
+
+            RUN r = { runFilename(0, runs.size()), nrun };
+            RunWriter<T> writer;
+            if (!writer.open(r.filename)) {
+                cout << "Unable to create run file: '" << r.filename << "'\n";
+                return false;
+            }
+            runs.push_back(r);
+            const T *sorted = data.data();
+            for (size_t ictr = 0; ictr < nrun; ictr++) {
+                writer.put(sorted[ictr]);
+            }
+            if (!writer.close()) {
+                cout << "Unable to write run file: '" << r.filename << "'\n";
+                return false;
+            }
+            st.bytes_written += writer.nbytes;
+        }
+        st.nruns_out = max(runs.size(), (size_t) 1);
+        stats.push_back(st);
+        return true;
+    }
+
+    // Merge passes: Merge each group of up to 'fanin' consecutive runs.
+    bool
+    mergePass(vector<RUN>& runs)
+    {
+        EXT_PASS_STATS st = { (unsigned) stats.size(), runs.size(), 0, 0, 0, 0 };
+        bool last_pass = (runs.size() <= fanin);
+
+        vector<RUN> outruns;
+        bool rv = true;
+        size_t first = 0;           // 1st run not yet merged
+        while (rv && (first < runs.size())) {
+            size_t nmerge = min((size_t) fanin, (runs.size() - first));
+            RUN outrun = { runFilename(st.pass, outruns.size()), 0 };
+
+            rv = mergeRuns(&runs[first], nmerge, (last_pass ? nullptr : &outrun), st);
+            for (size_t r = first; r < (first + nmerge); r++) {
+                unlink(runs[r].filename.c_str());
+            }
+            if (!last_pass) {
+                outruns.push_back(outrun);
+            }
+            first += nmerge;
+        }
+        // Remove unmerged runs left-over from a failed pass, and its output.
+        if (!rv) {
+            for (size_t r = first; r < runs.size(); r++) {
+                unlink(runs[r].filename.c_str());
+            }
+            for (auto& run : outruns) {
+                unlink(run.filename.c_str());
+            }
+            runs.clear();
+            return false;
+        }
+        runs = outruns;
+        st.nruns_out = max(runs.size(), (size_t) 1);
+        if (last_pass) {
+            runs.clear();
+        }
+        stats.push_back(st);
+        return true;
+    }
+
+    // k-way merge 'nruns' runs into 'outrun', counting inversions across them.
+    // If 'outrun' is null, merged items are only counted, and not written.
+    bool
+    mergeRuns(RUN *inruns, size_t nruns, RUN *outrun, EXT_PASS_STATS& st)
+    {
+        vector<RunReader<T>> readers(nruns);
+        vector<uint64_t>     fenwick(nruns + 1, 0);
+
+        // Min-heap of (item, run#); equal items are merged in run order.
+        typedef pair<T, size_t> HEAP_ENTRY;
+        priority_queue<HEAP_ENTRY, vector<HEAP_ENTRY>, greater<HEAP_ENTRY>> heap;
+
+        for (size_t r = 0; r < nruns; r++) {
+            if (!readers[r].open(inruns[r].filename, inruns[r].nitems)) {
+                cout << "Unable to open run file: '" << inruns[r].filename << "'\n";
+                return false;
+            }
+            fenwickAdd(fenwick, r, inruns[r].nitems);
+            if (!readers[r].empty()) {
+                heap.push({ readers[r].peek(), r });
+            }
+        }
+
+        RunWriter<T> writer;
+        if (outrun && !writer.open(outrun->filename)) {
+            cout << "Unable to create run file: '" << outrun->filename << "'\n";
+            return false;
+        }
+
+        uint64_t nmerged = 0;
+        while (!heap.empty()) {
+            auto [item, r] = heap.top();
+            heap.pop();
+
+            // # of items left in earlier runs are all > this item.
+            st.ninv += fenwickSum(fenwick, r);
+            fenwickAdd(fenwick, r, (uint64_t) -1);
+
+            if (outrun) {
+                writer.put(item);
+            }
+            nmerged++;
+
+            readers[r].pop();
+            if (!readers[r].empty()) {
+                heap.push({ readers[r].peek(), r });
+            }
+        }
+
+        uint64_t nexpected = 0;
+        for (size_t r = 0; r < nruns; r++) {
+            st.bytes_read += readers[r].nbytes;
+            nexpected += inruns[r].nitems;
+        }
+        if (nmerged != nexpected) {
+            cout << "Short read of run files; merged " << nmerged
+                 << " items, expected " << nexpected << "\n";
+            return false;
+        }
+        if (outrun) {
+            if (!writer.close()) {
+                cout << "Unable to write run file: '" << outrun->filename << "'\n";
+                return false;
+            }
+            outrun->nitems = nmerged;
+            st.bytes_written += writer.nbytes;
+        }
+        return true;
+    }
+
+    // Fenwick (binary indexed) tree of # of items left in each run.
+    static void
+    fenwickAdd(vector<uint64_t>& tree, size_t r, uint64_t delta) {
+        for (r++; r < tree.size(); r += (r & -r)) {
+            tree[r] += delta;
+        }
+    }
+
+    // Sum of # of items left in runs [0, r)
+    static uint64_t
+    fenwickSum(const vector<uint64_t>& tree, size_t r) {
+        uint64_t sum = 0;
+        for (; r > 0; r -= (r & -r)) {
+            sum += tree[r];
+        }
+        return sum;
+    }
+};
+
 int
 main(int argc, const char *argv[])
 {
    std::cout << "Hello World! argc=" << argc << "\n";
+   if ((argc == 4) && (strcmp(argv[1], "--convert") == 0)) {
+       return convert(argv[2], argv[3]);
+   }
+   if ((argc >= 3) && (argc <= 5) && (strcmp(argv[1], "--external") == 0)) {
+       size_t   run_items = ((argc >= 4) ? strtoull(argv[3], nullptr, 10)
+                                         : Ext_run_items_default);
+       unsigned fanin = ((argc == 5) ? atoi(argv[4]) : Ext_fanin_default);
+       return count_external(argv[2], run_items, fanin);
+   }
+
    // Load test-data from a file if it's provided.
-   if (argc == 2) {
-       Inversions data;
-       data.load(argv[1]);
-       data.dump();
+   if ((argc == 2) || (argc == 3)) {
+       Inversions<int> data;
+       if (!data.load(argv[1])) {
+           return 1;
+       }
+       if (data.size() <= One_K) {
+           data.dump();
+       }
 
-       int nInvFound = data.numInversions();
+       unsigned nthreads = ((argc == 3) ? atoi(argv[2]) : 1);
+       ninv_t nInvFound = ((nthreads > 1) ? data.numInversionsParallel(nthreads)
+                                          : data.numInversions());
        cout << "# of inversions found: " << nInvFound << endl;
-       auto error_at = 0;
+       size_t error_at = 0;
        if (!data.verify(error_at)) {
            cout << "Error! Output array is unsorted: " << endl;
            data.dump();
@@ -304,10 +1283,67 @@ main(int argc, const char *argv[])
     }
 
     int rc = run_random_tests();
+    rc += run_reversed_tests();
+    rc += run_parallel_tests();
+    rc += run_loader_tests();
+    rc += run_external_tests();
+    rc += run_rand_tests();
 
     return rc;
 }
 
+// ----------------------------------------------------------------------------
+// Convert input file from text to binary format, or from binary to text.
+// Text is converted to 4-byte items if all items fit, else to 8-byte items.
+int
+convert(const char *inpfile, const char *outfile) {
+    Inversions<int64_t> data;
+    if (!data.load(inpfile)) {
+        return 1;
+    }
+
+    MappedFile inp;
+    inp.open(inpfile);
+    bool is_binary = (   (inp.size() >= sizeof(BIN_HEADER))
+                      && (memcmp(inp.data(), Bin_magic, sizeof(Bin_magic)) == 0));
+    if (is_binary) {
+        if (!data.saveText(outfile)) {
+            return 1;
+        }
+        cout << "Converted " << data.size() << " ints to text file "
+             << outfile << endl;
+        return 0;
+    }
+
+    uint16_t item_size = sizeof(int32_t);
+    for (size_t ictr = 0; ictr < data.size(); ictr++) {
+        if ((data[ictr] < INT32_MIN) || (data[ictr] > INT32_MAX)) {
+            item_size = sizeof(int64_t);
+            break;
+        }
+    }
+    if (!data.saveBinary(outfile, item_size)) {
+        return 1;
+    }
+    cout << "Converted " << data.size() << " ints to binary file " << outfile
+         << " (" << item_size << " bytes per int)" << endl;
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Count inversions in binary input file using external merge-sort.
+int
+count_external(const char *inpfile, size_t run_items, unsigned fanin) {
+    ExternalInversions<int64_t> ext(run_items, fanin);
+    ninv_t nInvFound = 0;
+    if (!ext.numInversions(inpfile, nInvFound)) {
+        return 1;
+    }
+    ext.printStats();
+    cout << "# of inversions found: " << nInvFound << endl;
+    return 0;
+}
+
 // ----------------------------------------------------------------------------
 int
 run_random_tests(void) {
@@ -330,21 +1366,409 @@ run_random_tests(void) {
 // ----------------------------------------------------------------------------
 // Returns index (>0) at which sortedness was first found to be broken.
 // 0 return => output is sorted correctly. Non-zero => failure in sorting.
+// For small data sets, # of inversions found is also cross-checked against
+// the brute-force count; a mismatch is reported as a failure at index 'nitems'.
 int
 run_test(int nitems = 10) {
 
-    Inversions data;
+    Inversions<int> data;
     data.loadRand(nitems);
     // if (nitems <= 20) { data.dump(); }
 
-    int nInvFound = data.numInversions();
+    ninv_t nInvExpected = 0;
+    bool   check_count  = (nitems <= One_K);
+    if (check_count) {
+        nInvExpected = data.numInversionsBruteForce();
+    }
+
+    ninv_t nInvFound = data.numInversions();
     // cout << "# of inversions found: " << nInvFound << endl;
-    auto error_at = 0;
+    size_t error_at = 0;
     if (!data.verify(error_at)) {
         cout << "Error! Output array of " << nitems
              << " items is unsorted at index=" << error_at << endl;
         data.dump();
+        return (int) error_at;
+    }
+    if (check_count && (nInvFound != nInvExpected)) {
+        cout << "Error! Found " << nInvFound << " inversions in "
+             << nitems << " items, expected " << nInvExpected << endl;
+        return (nitems ? nitems : 1);
     }
 
     return 0;
 }
+
+// ----------------------------------------------------------------------------
+// Fully-reversed inputs have n*(n-1)/2 inversions. For n >= ~65K items this
+// count no longer fits in an 'int'. Exercise this for different key-types.
+template <typename T>
+int
+run_reversed_test(size_t nitems) {
+    Inversions<T> data;
+    data.loadReversed(nitems);
+
+    ninv_t nInvExpected = ((ninv_t) nitems * (nitems - 1)) / 2;
+    ninv_t nInvFound = data.numInversions();
+
+    size_t error_at = 0;
+    if (!data.verify(error_at)) {
+        cout << "Error! Reversed array of " << nitems
+             << " items is unsorted at index=" << error_at << endl;
+        return 1;
+    }
+    if (nInvFound != nInvExpected) {
+        cout << "Error! Found " << nInvFound << " inversions in reversed "
+             << nitems << " items, expected " << nInvExpected << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int
+run_reversed_tests(void) {
+    cout << __func__ << ": Running reversed data tests for finding inversions."
+         << endl;
+
+    auto nfailed = 0;
+    for (size_t nitems : { 0, 1, 2, 3, 7, 64, 1001, 65536, 100000, One_M }) {
+        nfailed += run_reversed_test<int>(nitems);
+        nfailed += run_reversed_test<int64_t>(nitems);
+    }
+    nfailed += run_reversed_test<uint32_t>(One_M);
+    nfailed += run_reversed_test<int16_t>(30000);
+    return nfailed;
+}
+
+// ----------------------------------------------------------------------------
+// Verify that the parallel count matches the serial count, for random and
+// reversed data, across a range of thread-counts and serial cut-offs. Small
+// cut-offs force deep fork-join trees and parallel merges on small inputs.
+int
+run_parallel_test(size_t nitems, unsigned nthreads, size_t cutoff,
+                  bool reversed = false) {
+    Inversions<int> serial;
+    Inversions<int> parallel;
+    if (reversed) {
+        serial.loadReversed(nitems);
+        parallel.loadReversed(nitems);
+    } else {
+        // Both get the same random data, of the default seed.
+        serial.loadRand(nitems);
+        parallel.loadRand(nitems);
+    }
+
+    ninv_t nInvExpected = serial.numInversions();
+    ninv_t nInvFound    = parallel.numInversionsParallel(nthreads, cutoff);
+
+    size_t error_at = 0;
+    if (!parallel.verify(error_at)) {
+        cout << "Error! Parallel sort of " << nitems << " items, nthreads="
+             << nthreads << ", cutoff=" << cutoff
+             << " is unsorted at index=" << error_at << endl;
+        return 1;
+    }
+    if (nInvFound != nInvExpected) {
+        cout << "Error! Parallel count found " << nInvFound << " inversions in "
+             << nitems << " items, nthreads=" << nthreads << ", cutoff="
+             << cutoff << ", expected " << nInvExpected << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int
+run_parallel_tests(void) {
+    cout << __func__ << ": Running parallel tests for finding inversions."
+         << endl;
+
+    auto nfailed = 0;
+    for (unsigned nthreads : { 1, 2, 3, 4, 7, 8 }) {
+        for (size_t cutoff : { (size_t) 2, (size_t) 5, (size_t) 64 }) {
+            for (size_t nitems : { 0, 1, 2, 3, 10, 17, 100, 1001, 4096 }) {
+                nfailed += run_parallel_test(nitems, nthreads, cutoff);
+                nfailed += run_parallel_test(nitems, nthreads, cutoff, true);
+            }
+        }
+    }
+
+    // Time serial v/s parallel on a larger data set.
+    size_t   nitems = (10 * One_M);
+    unsigned nthreads = thread::hardware_concurrency();
+    Inversions<int> data;
+
+    data.loadRand(nitems);
+    auto start = chrono::steady_clock::now();
+    ninv_t nInvSerial = data.numInversions();
+    auto serial_ms = chrono::duration_cast<chrono::milliseconds>(
+                        chrono::steady_clock::now() - start).count();
+
+    data.loadRand(nitems);
+    start = chrono::steady_clock::now();
+    ninv_t nInvParallel = data.numInversionsParallel(nthreads);
+    auto parallel_ms = chrono::duration_cast<chrono::milliseconds>(
+                        chrono::steady_clock::now() - start).count();
+
+    cout << nitems << " items: serial=" << serial_ms << " ms, parallel("
+         << nthreads << " threads)=" << parallel_ms << " ms" << endl;
+    if (nInvSerial != nInvParallel) {
+        cout << "Error! Parallel count found " << nInvParallel
+             << " inversions, expected " << nInvSerial << endl;
+        nfailed++;
+    }
+    return nfailed;
+}
+
+// ----------------------------------------------------------------------------
+// Exercise the text and binary loaders: write random data to a text file,
+// convert it to binary and back, and check that all forms load identically.
+// Scaled-up negative items need 8-byte binary items; others fit in 4-bytes.
+int
+run_loader_test(const char *txtfile, size_t nitems, int64_t scale) {
+    string binfile  = string(txtfile) + ".bin";
+    string txtfile2 = string(txtfile) + ".txt";
+
+    Inversions<int64_t> orig;
+    orig.loadRand(nitems);
+    vector<int64_t> expected(nitems);
+    ofstream out(txtfile, ios::trunc);
+    for (size_t ictr = 0; ictr < nitems; ictr++) {
+        int64_t v = orig[ictr];
+        expected[ictr] = ((ictr % 3) ? v : -(v * scale));
+        out << expected[ictr] << '\n';
+    }
+    out.close();
+
+    Inversions<int64_t> fromtxt;
+    Inversions<int64_t> frombin;
+    Inversions<int32_t> frombin32;
+    Inversions<int64_t> fromtxt2;
+    bool fits32 = (scale == 1);
+    bool ok = (   fromtxt.load(txtfile)
+               && (convert(txtfile, binfile.c_str()) == 0)
+               && frombin.load(binfile.c_str())
+               && (!fits32 || frombin32.load(binfile.c_str()))
+               && (convert(binfile.c_str(), txtfile2.c_str()) == 0)
+               && fromtxt2.load(txtfile2.c_str()));
+    ok = (   ok && (fromtxt.size() == nitems) && (frombin.size() == nitems)
+          && (!fits32 || (frombin32.size() == nitems))
+          && (fromtxt2.size() == nitems));
+
+    for (size_t ictr = 0; ok && (ictr < nitems); ictr++) {
+        ok = (   (fromtxt[ictr] == expected[ictr])
+              && (frombin[ictr] == expected[ictr])
+              && (!fits32 || (frombin32[ictr] == expected[ictr]))
+              && (fromtxt2[ictr] == expected[ictr]));
+    }
+    // Loaded data should produce the same counts.
+    ok = (ok && (fromtxt.numInversions() == frombin.numInversions()));
+
+    unlink(binfile.c_str());
+    unlink(txtfile2.c_str());
+    if (!ok) {
+        cout << "Error! Loader round-trip failed for " << nitems
+             << " items, scale=" << scale << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int
+run_loader_tests(void) {
+    cout << __func__ << ": Running text / binary loader tests." << endl;
+
+    char txtfile[] = "/tmp/findInversions.XXXXXX";
+    int  fd = mkstemp(txtfile);
+    if (fd < 0) {
+        cout << "Unable to create temp file: '" << txtfile << "'" << endl;
+        return 1;
+    }
+    close(fd);
+
+    auto nfailed = 0;
+    for (size_t nitems : { 0, 1, 9, 1001, 100000 }) {
+        nfailed += run_loader_test(txtfile, nitems, 1);
+        nfailed += run_loader_test(txtfile, nitems, 12345);
+    }
+    unlink(txtfile);
+    return nfailed;
+}
+
+// ----------------------------------------------------------------------------
+// Verify that the external-merge count matches the in-memory count, for run
+// sizes and fan-ins that need zero, one or several merge passes.
+int
+run_external_tests(void) {
+    cout << __func__ << ": Running external-merge tests." << endl;
+
+    char binfile[] = "/tmp/findInversions.XXXXXX";
+    int  fd = mkstemp(binfile);
+    if (fd < 0) {
+        cout << "Unable to create temp file: '" << binfile << "'" << endl;
+        return 1;
+    }
+    close(fd);
+
+    auto nfailed = 0;
+    for (size_t nitems : { 0, 1, 2, 1000, 100000 }) {
+        for (bool reversed : { false, true }) {
+            Inversions<int> data;
+            if (reversed) {
+                data.loadReversed(nitems);
+            } else {
+                data.loadRand(nitems);
+            }
+            data.saveBinary(binfile);
+            ninv_t nInvExpected = data.numInversions();
+
+            // Tiny runs only for small inputs, to limit # of run files.
+            for (size_t run_items : { (size_t) 1, (size_t) 7, (size_t) 1000,
+                                      (size_t) 30000, nitems }) {
+                if ((run_items < 1000) && (nitems > 1000)) {
+                    continue;
+                }
+                for (unsigned fanin : { 2, 3, 16 }) {
+                    ExternalInversions<int> ext(run_items, fanin);
+                    ninv_t nInvFound = 0;
+                    if (   !ext.numInversions(binfile, nInvFound)
+                        || (nInvFound != nInvExpected)) {
+                        cout << "Error! External count found " << nInvFound
+                             << " inversions in " << nitems << " items, run_items="
+                             << run_items << ", fanin=" << fanin << ", expected "
+                             << nInvExpected << endl;
+                        nfailed++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Show per-pass I/O for a multi-pass run.
+    ExternalInversions<int> ext(1000, 8);
+    ninv_t nInvFound = 0;
+    ext.numInversions(binfile, nInvFound);
+    ext.printStats();
+
+    unlink(binfile);
+    return nfailed;
+}
+
+// ----------------------------------------------------------------------------
+// Exercise the random data generator of rand_gen.h: Value ranges, the same
+// stream via fill() and via operator(), and parallel fills independent of the
+// # of threads. Then time it against per-call default_random_engine.
+int
+run_rand_tests(void) {
+    cout << __func__ << ": Running random data generator tests." << endl;
+
+    auto nfailed = 0;
+
+    // Small range: All values in range, and all of them seen.
+    Rand_int small{-5, 5};
+    vector<int> seen(11);
+    for (int ictr = 0; ictr < 10000; ictr++) {
+        int v = small();
+        if ((v < -5) || (v > 5)) {
+            cout << "Error! Rand_int{-5, 5} returned " << v << endl;
+            return 1;
+        }
+        seen[v + 5]++;
+    }
+    nfailed += (count(seen.begin(), seen.end(), 0) != 0);
+
+    // Wide ranges, of 64-bit values.
+    RandInt<int64_t> wide{0, (1LL << 40)};
+    RandInt<int64_t> full{numeric_limits<int64_t>::min(), numeric_limits<int64_t>::max()};
+    bool negative = false;
+    for (int ictr = 0; ictr < 10000; ictr++) {
+        int64_t v = wide();
+        nfailed += ((v < 0) || (v > (1LL << 40)));
+        negative |= (full() < 0);
+    }
+    nfailed += !negative;
+
+    // fill() and operator(), mixed, in odd-sized pieces, are one sequence.
+    for (int64_t high : { (int64_t) One_M, (int64_t) (1LL << 40) }) {
+        RandInt<int64_t> mixed{0, high, 42};
+        RandInt<int64_t> bycall{0, high, 42};
+        vector<int64_t> got(2000);
+        size_t pos = 0;
+        for (size_t piece = 1; (pos + piece + 1) <= got.size(); piece += 3) {
+            mixed.fill(&got[pos], piece);
+            pos += piece;
+            got[pos++] = mixed();
+        }
+        for (size_t ictr = 0; ictr < pos; ictr++) {
+            if (got[ictr] != bycall()) {
+                cout << "Error! fill() and operator() differ at " << ictr
+                     << ", high=" << high << endl;
+                nfailed++;
+                break;
+            }
+        }
+    }
+
+    // Streams of a seed differ; a stream is the same each time.
+    RandInt<int> stream0{0, One_M, 7, 0};
+    RandInt<int> stream1{0, One_M, 7, 1};
+    RandInt<int> stream1again{0, One_M, 7, 1};
+    int ndiffs = 0;
+    for (int ictr = 0; ictr < 100; ictr++) {
+        int v1 = stream1();
+        ndiffs += (stream0() != v1);
+        nfailed += (stream1again() != v1);
+    }
+    nfailed += (ndiffs < 90);
+
+    // Parallel fills: Same data for any # of threads; block b is stream b.
+    size_t nitems = ((3 * Rand_fill_block_items) + 12345);
+    vector<int> serial(nitems);
+    vector<int> parallel(nitems);
+    randFillParallel(serial.data(), nitems, 0, One_M, 99, 1);
+    for (unsigned nthreads : { 2, 4, 7 }) {
+        randFillParallel(parallel.data(), nitems, 0, One_M, 99, nthreads);
+        nfailed += (parallel != serial);
+    }
+    RandInt<int> block3{0, One_M, 99, 3};
+    vector<int> expected(nitems - (3 * Rand_fill_block_items));
+    block3.fill(expected.data(), expected.size());
+    nfailed += !equal(expected.begin(), expected.end(),
+                      (serial.begin() + (3 * Rand_fill_block_items)));
+
+    // Time 10M items: Per-call default_random_engine, v/s fill(), v/s parallel.
+    nitems = (10 * One_M);
+    vector<int> data(nitems);
+    auto elapsed_ns = [](chrono::steady_clock::time_point start) {
+        return (double) chrono::duration_cast<chrono::nanoseconds>(
+                            chrono::steady_clock::now() - start).count();
+    };
+
+    default_random_engine engine;
+    uniform_int_distribution<> dist{0, One_M};
+    auto start = chrono::steady_clock::now();
+    for (size_t ictr = 0; ictr < nitems; ictr++) {
+        data[ictr] = dist(engine);
+    }
+    double percall_ns = (elapsed_ns(start) / nitems);
+
+    Rand_int rnd{0, One_M};
+    start = chrono::steady_clock::now();
+    rnd.fill(data.data(), nitems);
+    double fill_ns = (elapsed_ns(start) / nitems);
+
+    unsigned nthreads = thread::hardware_concurrency();
+    start = chrono::steady_clock::now();
+    randFillParallel(data.data(), nitems, 0, One_M);
+    double parallel_ns = (elapsed_ns(start) / nitems);
+
+    cout << nitems << " random items: default_random_engine="
+         << percall_ns << " ns/item, fill()=" << fill_ns
+         << " ns/item, randFillParallel(" << nthreads << " threads)="
+         << parallel_ns << " ns/item" << endl;
+
+    if (nfailed) {
+        cout << "Error! " << nfailed << " random data generator checks failed"
+             << endl;
+    }
+    return nfailed;
+}
@@ -5,30 +5,1296 @@
  *
  * Cloned from: https://drawar.github.io/karatsuba-cpp/
  *
+ * The string-based multiply(), add() and subtract() are from the above ref.
+ * They are retained to cross-check the limb-based BigInt implementation,
+ * which is what is used to multiply numbers given on the command-line.
+ *
+ * Operands are multiplied by an algorithm picked by their sizes: schoolbook,
+ * Karatsuba, Toom-3 and then NTT (number-theoretic transform). Karatsuba's
+ * sub-products of large operands are computed concurrently on a thread-pool.
+ *
+ * Usage: g++ -O2 -pthread -o karatsuba-mult karatsuba-mult.cpp
+ *        ./karatsuba-mult <num1> <num2>
+ *        ./karatsuba-mult --bench [ --csv | --json ] [ <max-digits> ]
+ *        ./karatsuba-mult [ --help | test_<fn-name> | test_<prefix> ]
+ *
  * History:
  * 21.Jan.2022 - Started.
  */
 #include <iostream>
+#include <iomanip>
 #include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+
+#if __linux__
+#include <cstring>
+#include <cassert>
+#endif // __linux__
 
 #define max(a,b) ((a) > (b) ? (a) : (b))
 
 using namespace std;
 
+string Usage = " [ <num1> <num2> | --help | test_<fn-name> ]\n"
+               "        [ --bench [ --csv | --json ] [ <max-digits> ] ]\n";
+
+#define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
+
 string multiply(string lhs, string rhs);
 string add(string lhs, string rhs);
 string subtract(string lhs, string rhs);
 
+// Benchmark output formats
+typedef enum bench_fmt
+{
+    BENCH_TABLE = 0,
+    BENCH_CSV,
+    BENCH_JSON
+} BENCH_FMT;
+
+int run_benchmark(size_t max_digits, BENCH_FMT fmt);
+
+// Test Function Prototypes
+void test_string_multiply(void);
+void test_bigint_parse(void);
+void test_bigint_add_subtract(void);
+void test_bigint_multiply_basic(void);
+void test_bigint_multiply_vs_string(void);
+void test_bigint_multiply_large(void);
+void test_bigint_multiply_algos(void);
+void test_bigint_multiply_parallel(void);
+void test_bigint_multiply_million(void);
+
+// -----------------------------------------------------------------------------
+// List of test functions one can invoke from the command-line
+typedef struct test_fns
+{
+    const char *    tfn_name;
+    void            (*tfn)(void);
+} TEST_FNS;
+
+TEST_FNS Test_fns[] = {
+                          { "test_string_multiply"          , test_string_multiply }
+                        , { "test_bigint_parse"             , test_bigint_parse }
+                        , { "test_bigint_add_subtract"      , test_bigint_add_subtract }
+                        , { "test_bigint_multiply_basic"    , test_bigint_multiply_basic }
+                        , { "test_bigint_multiply_vs_string", test_bigint_multiply_vs_string }
+                        , { "test_bigint_multiply_large"    , test_bigint_multiply_large }
+                        , { "test_bigint_multiply_algos"    , test_bigint_multiply_algos }
+                        , { "test_bigint_multiply_parallel" , test_bigint_multiply_parallel }
+                        , { "test_bigint_multiply_million"  , test_bigint_multiply_million }
+                      };
+
+// Test start / end info-msg macros
+#define TEST_START()  cout << __func__ << "() "
+#define TEST_END()    cout << " ...OK" << endl
+
+// -----------------------------------------------------------------------------
+// Limbs: Each limb holds one base-10^9 "digit", i.e. 9 decimal digits, in a
+// 32-bit word. Products of two limbs and their carries fit in 64-bits.
+// As inputs and outputs are decimal strings, using a decimal base keeps the
+// conversions to / from strings linear in the # of digits.
+//
+// Limbs of a number are stored least-significant limb first.
+// -----------------------------------------------------------------------------
+typedef uint32_t limb_t;
+typedef uint64_t dlimb_t;
+
+const limb_t Limb_base   = 1000000000;
+const int    Limb_digits = 9;
+
+// Operands with fewer limbs than this are multiplied by schoolbook method.
+// Needs to be >= 4, so that the (m + 1)-limb middle product in the Karatsuba
+// recursion is always smaller than its n-limb inputs.
+const size_t Karatsuba_threshold = 32;
+
+static_assert(Karatsuba_threshold >= 4, "Karatsuba recursion would not terminate");
+
+// **** Low-level limb-array arithmetic ****
+
+// r[0..n) = a[0..n) + b[0..n). Returns carry (0 or 1). 'r' may alias 'a', 'b'.
+static limb_t
+limbs_add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        limb_t s = (a[i] + b[i] + carry);
+        carry = (s >= Limb_base);
+        r[i] = (s - (carry * Limb_base));
+    }
+    return carry;
+}
+
+// r[0..na) = a[0..na) + b[0..nb), where na >= nb. Returns carry.
+static limb_t
+limbs_add(limb_t *r, const limb_t *a, size_t na, const limb_t *b, size_t nb)
+{
+    assert(na >= nb);
+    limb_t carry = limbs_add_n(r, a, b, nb);
+    size_t i = nb;
+    for (; carry && (i < na); i++) {
+        limb_t s = (a[i] + carry);
+        carry = (s >= Limb_base);
+        r[i] = (s - (carry * Limb_base));
+    }
+    if (r != a) {
+        for (; i < na; i++) {
+            r[i] = a[i];
+        }
+    }
+    return carry;
+}
+
+// r[0..na) = a[0..na) - b[0..nb), where na >= nb. Returns borrow.
+static limb_t
+limbs_sub(limb_t *r, const limb_t *a, size_t na, const limb_t *b, size_t nb)
+{
+    assert(na >= nb);
+    limb_t borrow = 0;
+    size_t i = 0;
+    for (; i < nb; i++) {
+        limb_t d = (a[i] - b[i] - borrow);
+        borrow = (a[i] < (b[i] + borrow));
+        r[i] = (d + (borrow * Limb_base));
+    }
+    for (; borrow && (i < na); i++) {
+        borrow = (a[i] == 0);
+        r[i] = (borrow ? (Limb_base - 1) : (a[i] - 1));
+    }
+    if (r != a) {
+        for (; i < na; i++) {
+            r[i] = a[i];
+        }
+    }
+    return borrow;
+}
+
+// r[0..na+nb) = a[0..na) * b[0..nb), by schoolbook method, for any sizes.
+// 'r' must not overlap 'a', 'b'. Used as the reference to verify results.
+static void
+limbs_mul_schoolbook(limb_t *r, const limb_t *a, size_t na,
+                     const limb_t *b, size_t nb)
+{
+    memset(r, 0, ((na + nb) * sizeof(*r)));
+    for (size_t j = 0; j < nb; j++) {
+        dlimb_t bj = b[j];
+        dlimb_t carry = 0;
+        for (size_t i = 0; i < na; i++) {
+            dlimb_t t = ((a[i] * bj) + r[i + j] + carry);
+            carry = (t / Limb_base);
+            r[i + j] = (limb_t) (t - (carry * Limb_base));
+        }
+        r[j + na] = (limb_t) carry;
+    }
+}
+
+// Products of limb-pairs are < 10^18, so 16 of them can be accumulated in a
+// 64-bit column before carries need to be propagated.
+const size_t Basecase_rows_per_carry = 16;
+
+// Propagate carries across 64-bit column accumulators acc[0..n), leaving
+// each column < Limb_base. Returns carry-out of top column.
+static dlimb_t
+limbs_carry_columns(dlimb_t *acc, size_t n)
+{
+    dlimb_t carry = 0;
+    for (size_t k = 0; k < n; k++) {
+        dlimb_t t = (acc[k] + carry);
+        carry = (t / Limb_base);
+        acc[k] = (t - (carry * Limb_base));
+    }
+    return carry;
+}
+
+// r[0..na+nb) = a[0..na) * b[0..nb), for operands of at most
+// Karatsuba_threshold limbs. Like limbs_mul_schoolbook(), but limb products
+// are summed in 64-bit column accumulators with carries deferred, so the
+// inner loop is just a multiply-add.
+static void
+limbs_mul_basecase(limb_t *r, const limb_t *a, size_t na,
+                   const limb_t *b, size_t nb)
+{
+    assert((na <= Karatsuba_threshold) && (nb <= Karatsuba_threshold));
+
+    dlimb_t acc[2 * Karatsuba_threshold];
+    size_t  nr = (na + nb);
+    memset(acc, 0, (nr * sizeof(*acc)));
+    for (size_t j = 0; j < nb; j++) {
+        dlimb_t  bj = b[j];
+        dlimb_t *accj = (acc + j);
+        for (size_t i = 0; i < na; i++) {
+            accj[i] += (a[i] * bj);
+        }
+        if ((j % Basecase_rows_per_carry) == (Basecase_rows_per_carry - 1)) {
+            limbs_carry_columns(acc, nr);
+        }
+    }
+    dlimb_t carry = limbs_carry_columns(acc, nr);
+    assert(carry == 0);
+    (void) carry;
+    for (size_t k = 0; k < nr; k++) {
+        r[k] = (limb_t) acc[k];
+    }
+}
+
+// # of scratch limbs needed by limbs_mul_karatsuba() for n-limb operands.
+static size_t
+limbs_karatsuba_scratch(size_t n)
+{
+    size_t nscratch = 0;
+    while (n >= Karatsuba_threshold) {
+        size_t m = (n - (n / 2));
+        nscratch += (4 * (m + 1));
+        n = (m + 1);
+    }
+    return nscratch;
+}
+
+// Karatsuba's final step: Given z0 in r[0..2h), z2 in r[2h..2n) and
+// (a0 + a1) * (b0 + b1) in z1[0..2(m + 1)), compute z1 and add it into r[h..2n).
+static void
+limbs_karatsuba_combine(limb_t *r, limb_t *z1, size_t h, size_t m)
+{
+    size_t nz1 = (2 * (m + 1));
+    limbs_sub(z1, z1, nz1, r, (2 * h));
+    limbs_sub(z1, z1, nz1, (r + 2 * h), (2 * m));
+
+    // z1 < B^(n + 1), so its top limbs are 0 and it fits in r[h..2n).
+    while (nz1 && (z1[nz1 - 1] == 0)) {
+        nz1--;
+    }
+    limb_t carry = limbs_add((r + h), (r + h), (h + 2 * m), z1, nz1);
+    assert(carry == 0);
+    (void) carry;
+}
+
+// r[0..2n) = a[0..n) * b[0..n), using Karatsuba's method.
+// With a = a1.B^h + a0 and b = b1.B^h + b0, where B is the limb-base:
+//
+//      a * b = z2.B^2h + z1.B^h + z0, where
+//          z0 = a0 * b0, z2 = a1 * b1, and
+//          z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+//
+// z0 and z2 are computed in-place in the output; (a0 + a1), (b0 + b1) and
+// z1 are in 'scratch', which needs limbs_karatsuba_scratch(n) limbs.
+static void
+limbs_mul_karatsuba(limb_t *r, const limb_t *a, const limb_t *b, size_t n,
+                    limb_t *scratch)
+{
+    if (n < Karatsuba_threshold) {
+        limbs_mul_basecase(r, a, n, b, n);
+        return;
+    }
+
+    size_t h = (n / 2);             // # of limbs in a0, b0
+    size_t m = (n - h);             // # of limbs in a1, b1; m >= h
+    const limb_t *a0 = a;
+    const limb_t *a1 = (a + h);
+    const limb_t *b0 = b;
+    const limb_t *b1 = (b + h);
+
+    limbs_mul_karatsuba(r, a0, b0, h, scratch);
+    limbs_mul_karatsuba((r + 2 * h), a1, b1, m, scratch);
+
+    limb_t *sa = scratch;                   // (a0 + a1): m + 1 limbs
+    limb_t *sb = (sa + m + 1);              // (b0 + b1): m + 1 limbs
+    limb_t *z1 = (sb + m + 1);              // z1: 2 * (m + 1) limbs
+    limb_t *next = (z1 + 2 * (m + 1));
+    sa[m] = limbs_add(sa, a1, m, a0, h);
+    sb[m] = limbs_add(sb, b1, m, b0, h);
+
+    limbs_mul_karatsuba(z1, sa, sb, (m + 1), next);
+    limbs_karatsuba_combine(r, z1, h, m);
+}
+
+// -----------------------------------------------------------------------------
+// Multiplication algorithm ladder: Each algorithm is used for operands from
+// its threshold-size up to the next algorithm's threshold.
+// -----------------------------------------------------------------------------
+typedef enum mul_algo
+{
+    MUL_SCHOOLBOOK = 0,
+    MUL_KARATSUBA,
+    MUL_TOOM3,
+    MUL_NTT,
+    MUL_AUTO            // Pick by operand sizes; same as up to MUL_NTT.
+} MUL_ALGO;
+
+const char *Mul_algo_names[] = { "schoolbook", "karatsuba", "toom3", "ntt", "auto" };
+
+// Thresholds, in # of limbs of the shorter operand. See Karatsuba_threshold.
+// Tuned by timing each algorithm forced, on balanced operands of 300 to
+// 600K digits.
+const size_t Toom3_threshold = 400;
+const size_t Ntt_threshold   = 8192;
+
+// Smallest operands for which Toom-3 can be forced; its 3-way split needs a
+// non-empty top part, and (k + 1)-limb sub-products smaller than n-limbs.
+const size_t Toom3_min_limbs = 9;
+
+// NTT: Convolution modulo the prime p = 2^64 - 2^32 + 1, over coefficients
+// of 6 decimal digits; 2 limbs (18 digits) map to 3 coefficients.
+// Each coefficient of the product is a sum of, at most, 'n' products of
+// pairs of input coefficients, for n input coefficients of the shorter
+// operand. For the result to be exact, this sum has to be < p. It is kept
+// < p/2, so that carries can be added to it without overflowing 64-bits.
+const uint64_t Ntt_prime  = 0xFFFFFFFF00000001ULL;
+const uint64_t Ntt_root   = 7;          // Generator of (Z/pZ)*
+const dlimb_t  Ntt_base   = 1000000;
+const size_t   Ntt_max_coeffs = ((Ntt_prime / 2) / ((Ntt_base - 1) * (Ntt_base - 1)));
+const size_t   Ntt_max_limbs  = (2 * (Ntt_max_coeffs / 3));
+
+// # of limbs in each of the lower two parts of an n-limb Toom-3 operand.
+static size_t
+toom3_split(size_t n)
+{
+    return ((n + 2) / 3);
+}
+
+// Pick algorithm to multiply na-, nb-limb operands, na >= nb, using no
+// algorithm beyond 'max_algo'. If 'forced', use 'max_algo' itself for this
+// multiply if it can handle these sizes; sub-products then pick by size.
+static MUL_ALGO
+limbs_mul_pick(size_t na, size_t nb, MUL_ALGO max_algo, bool forced)
+{
+    assert(na >= nb);
+    if (max_algo == MUL_AUTO) {
+        max_algo = MUL_NTT;
+    }
+    bool ntt_fits = (nb <= Ntt_max_limbs);
+    if (forced) {
+        if ((max_algo == MUL_NTT) && ntt_fits) {
+            return MUL_NTT;
+        }
+        if ((max_algo == MUL_TOOM3) && (nb >= Toom3_min_limbs)) {
+            return MUL_TOOM3;
+        }
+        if ((max_algo == MUL_KARATSUBA) || (max_algo == MUL_SCHOOLBOOK)) {
+            return max_algo;
+        }
+    }
+    if ((max_algo >= MUL_NTT) && (nb >= Ntt_threshold) && ntt_fits) {
+        return MUL_NTT;
+    }
+    if ((max_algo >= MUL_TOOM3) && (nb >= Toom3_threshold)) {
+        return MUL_TOOM3;
+    }
+    if ((max_algo >= MUL_KARATSUBA) && (nb >= Karatsuba_threshold)) {
+        return MUL_KARATSUBA;
+    }
+    return MUL_SCHOOLBOOK;
+}
+
+// # of scratch limbs needed by limbs_mul() for na-, nb-limb operands.
+// Mirrors the choices made by limbs_mul().
+static size_t
+limbs_mul_scratch(size_t na, size_t nb, MUL_ALGO max_algo = MUL_AUTO,
+                  bool forced = false)
+{
+    if (na < nb) {
+        std::swap(na, nb);
+    }
+    MUL_ALGO algo = limbs_mul_pick(na, nb, max_algo, forced);
+    if ((algo == MUL_SCHOOLBOOK) || (algo == MUL_NTT)) {
+        return 0;
+    }
+    if (na == nb) {
+        if (algo == MUL_KARATSUBA) {
+            return limbs_karatsuba_scratch(na);
+        }
+        // Toom-3 sub-products are of (k + 1)-limb operands.
+        size_t kk = (toom3_split(na) + 1);
+        return limbs_mul_scratch(kk, kk, max_algo, false);
+    }
+    // a is multiplied by b in chunks of nb-limbs; see limbs_mul().
+    size_t nlast = (na % nb);
+    size_t nscratch = limbs_mul_scratch(nb, nb, max_algo, forced);
+    if (nlast) {
+        nscratch = max(nscratch, limbs_mul_scratch(nb, nlast, max_algo, forced));
+    }
+    return ((2 * nb) + nscratch);
+}
+
+static void
+limbs_mul(limb_t *r, const limb_t *a, size_t na, const limb_t *b, size_t nb,
+          limb_t *scratch, MUL_ALGO max_algo = MUL_AUTO, bool forced = false);
+
+// -----------------------------------------------------------------------------
+// Toom-3: Signed limb-array values, for the evaluation and interpolation
+// steps, where intermediate values can be negative.
+// -----------------------------------------------------------------------------
+typedef struct slimbs
+{
+    vector<limb_t>  mag;        // Magnitude, with no leading 0-limbs
+    bool            neg = false;
+} SLIMBS;
+
+static void
+slimbs_normalize(SLIMBS& x)
+{
+    while (!x.mag.empty() && (x.mag.back() == 0)) {
+        x.mag.pop_back();
+    }
+    if (x.mag.empty()) {
+        x.neg = false;
+    }
+}
+
+static SLIMBS
+slimbs_from(const limb_t *a, size_t n)
+{
+    SLIMBS x;
+    x.mag.assign(a, (a + n));
+    slimbs_normalize(x);
+    return x;
+}
+
+static int
+slimbs_compare_mag(const SLIMBS& x, const SLIMBS& y)
+{
+    if (x.mag.size() != y.mag.size()) {
+        return ((x.mag.size() < y.mag.size()) ? -1 : 1);
+    }
+    for (size_t l = x.mag.size(); l-- > 0; ) {
+        if (x.mag[l] != y.mag[l]) {
+            return ((x.mag[l] < y.mag[l]) ? -1 : 1);
+        }
+    }
+    return 0;
+}
+
+// Returns x + y, or x - y if 'subtract'.
+static SLIMBS
+slimbs_add(const SLIMBS& x, const SLIMBS& y, bool subtract = false)
+{
+    bool   yneg = (y.neg != subtract);
+    SLIMBS r;
+    if (x.neg == yneg) {
+        const SLIMBS& big   = ((x.mag.size() >= y.mag.size()) ? x : y);
+        const SLIMBS& small = ((x.mag.size() >= y.mag.size()) ? y : x);
+        r.mag.resize(big.mag.size() + 1);
+        r.mag[big.mag.size()] = limbs_add(r.mag.data(), big.mag.data(), big.mag.size(),
+                                          small.mag.data(), small.mag.size());
+        r.neg = x.neg;
+    } else {
+        bool x_is_big = (slimbs_compare_mag(x, y) >= 0);
+        const SLIMBS& big   = (x_is_big ? x : y);
+        const SLIMBS& small = (x_is_big ? y : x);
+        r.mag.resize(big.mag.size());
+        limbs_sub(r.mag.data(), big.mag.data(), big.mag.size(),
+                  small.mag.data(), small.mag.size());
+        r.neg = (x_is_big ? x.neg : yneg);
+    }
+    slimbs_normalize(r);
+    return r;
+}
+
+static SLIMBS
+slimbs_sub(const SLIMBS& x, const SLIMBS& y)
+{
+    return slimbs_add(x, y, true);
+}
+
+// Returns x * k, for small k
+static SLIMBS
+slimbs_mul_small(const SLIMBS& x, limb_t k)
+{
+    SLIMBS r;
+    r.mag.resize(x.mag.size() + 1);
+    dlimb_t carry = 0;
+    for (size_t l = 0; l < x.mag.size(); l++) {
+        dlimb_t t = (((dlimb_t) x.mag[l] * k) + carry);
+        carry = (t / Limb_base);
+        r.mag[l] = (limb_t) (t - (carry * Limb_base));
+    }
+    r.mag[x.mag.size()] = (limb_t) carry;
+    r.neg = x.neg;
+    slimbs_normalize(r);
+    return r;
+}
+
+// x /= k, for small k that exactly divides x
+static void
+slimbs_divexact_small(SLIMBS& x, limb_t k)
+{
+    dlimb_t rem = 0;
+    for (size_t l = x.mag.size(); l-- > 0; ) {
+        dlimb_t t = ((rem * Limb_base) + x.mag[l]);
+        x.mag[l] = (limb_t) (t / k);
+        rem = (t % k);
+    }
+    assert(rem == 0);
+    slimbs_normalize(x);
+}
+
+// Returns x * y, for operands of at most kk limbs. Operands are zero-padded
+// to kk limbs, so the balanced sub-product fits the scratch sized for it.
+static SLIMBS
+slimbs_mul(const SLIMBS& x, const SLIMBS& y, size_t kk, limb_t *scratch,
+           MUL_ALGO max_algo)
+{
+    SLIMBS r;
+    if (x.mag.empty() || y.mag.empty()) {
+        return r;
+    }
+    assert((x.mag.size() <= kk) && (y.mag.size() <= kk));
+    vector<limb_t> xp(x.mag);
+    vector<limb_t> yp(y.mag);
+    xp.resize(kk, 0);
+    yp.resize(kk, 0);
+
+    r.mag.resize(2 * kk);
+    limbs_mul(r.mag.data(), xp.data(), kk, yp.data(), kk, scratch, max_algo);
+    r.neg = (x.neg != y.neg);
+    slimbs_normalize(r);
+    return r;
+}
+
+// r[0..2n) = a[0..n) * b[0..n), using Toom-3 (Toom-Cook, 3-way split).
+// With a = a2.x^2 + a1.x + a0, b likewise, and x = B^k, the product
+// polynomial of degree 4 is evaluated at 0, 1, -1, -2 and infinity with
+// 5 sub-products of (k + 1)-limbs, and interpolated using Bodrato's sequence.
+// Ref: https://en.wikipedia.org/wiki/Toom%E2%80%93Cook_multiplication
+static void
+limbs_mul_toom3(limb_t *r, const limb_t *a, const limb_t *b, size_t n,
+                limb_t *scratch, MUL_ALGO max_algo)
+{
+    size_t k  = toom3_split(n);
+    size_t kk = (k + 1);
+    assert(n > (2 * k));
+
+    SLIMBS a0 = slimbs_from(a, k);
+    SLIMBS a1 = slimbs_from((a + k), k);
+    SLIMBS a2 = slimbs_from((a + 2 * k), (n - 2 * k));
+    SLIMBS b0 = slimbs_from(b, k);
+    SLIMBS b1 = slimbs_from((b + k), k);
+    SLIMBS b2 = slimbs_from((b + 2 * k), (n - 2 * k));
+
+    // Evaluate: p(1) = a0 + a1 + a2, p(-1) = a0 - a1 + a2,
+    //           p(-2) = (p(-1) + a2) * 2 - a0
+    SLIMBS pa   = slimbs_add(a0, a2);
+    SLIMBS pa1  = slimbs_add(pa, a1);
+    SLIMBS pam1 = slimbs_sub(pa, a1);
+    SLIMBS pam2 = slimbs_sub(slimbs_mul_small(slimbs_add(pam1, a2), 2), a0);
+    SLIMBS pb   = slimbs_add(b0, b2);
+    SLIMBS pb1  = slimbs_add(pb, b1);
+    SLIMBS pbm1 = slimbs_sub(pb, b1);
+    SLIMBS pbm2 = slimbs_sub(slimbs_mul_small(slimbs_add(pbm1, b2), 2), b0);
+
+    // Pointwise sub-products
+    SLIMBS r0   = slimbs_mul(a0, b0, kk, scratch, max_algo);
+    SLIMBS r1   = slimbs_mul(pa1, pb1, kk, scratch, max_algo);
+    SLIMBS rm1  = slimbs_mul(pam1, pbm1, kk, scratch, max_algo);
+    SLIMBS rm2  = slimbs_mul(pam2, pbm2, kk, scratch, max_algo);
+    SLIMBS rinf = slimbs_mul(a2, b2, kk, scratch, max_algo);
+
+    // Interpolate coefficients c1, c2, c3; c0 = r0, c4 = rinf
+    SLIMBS c3 = slimbs_sub(rm2, r1);
+    slimbs_divexact_small(c3, 3);
+    SLIMBS c1 = slimbs_sub(r1, rm1);
+    slimbs_divexact_small(c1, 2);
+    SLIMBS c2 = slimbs_sub(rm1, r0);
+    c3 = slimbs_sub(c2, c3);
+    slimbs_divexact_small(c3, 2);
+    c3 = slimbs_add(c3, slimbs_mul_small(rinf, 2));
+    c2 = slimbs_sub(slimbs_add(c2, c1), rinf);
+    c1 = slimbs_sub(c1, c3);
+
+    // Recompose: r = c0 + c1.x + c2.x^2 + c3.x^3 + c4.x^4
+    memset(r, 0, ((2 * n) * sizeof(*r)));
+    const SLIMBS *coeffs[] = { &r0, &c1, &c2, &c3, &rinf };
+    for (int i = 0; i < ARRAYSIZE(coeffs); i++) {
+        const SLIMBS& c = *coeffs[i];
+        size_t off = (i * k);
+        assert(!c.neg);
+        assert((off + c.mag.size()) <= (2 * n));
+        limb_t carry = limbs_add((r + off), (r + off), ((2 * n) - off),
+                                 c.mag.data(), c.mag.size());
+        assert(carry == 0);
+        (void) carry;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// NTT: Number-theoretic transform multiply, modulo p = 2^64 - 2^32 + 1.
+// -----------------------------------------------------------------------------
+
+// Returns (a * b) mod p. Uses 2^64 = 2^32 - 1 (mod p) and 2^96 = -1 (mod p)
+// to reduce the 128-bit product, without a 128-bit division.
+static inline uint64_t
+ntt_mulmod(uint64_t a, uint64_t b)
+{
+    const uint64_t eps = 0xFFFFFFFFULL;     // 2^64 mod p
+
+    unsigned __int128 x = ((unsigned __int128) a * b);
+    uint64_t lo    = (uint64_t) x;
+    uint64_t hi    = (uint64_t) (x >> 64);
+    uint64_t hi_hi = (hi >> 32);
+    uint64_t hi_lo = (hi & eps);
+
+    uint64_t t0 = (lo - hi_hi);
+    if (lo < hi_hi) {
+        t0 -= eps;
+    }
+    uint64_t t1  = (hi_lo * eps);
+    uint64_t res = (t0 + t1);
+    if (res < t1) {
+        res += eps;
+    }
+    return ((res >= Ntt_prime) ? (res - Ntt_prime) : res);
+}
+
+static inline uint64_t
+ntt_addmod(uint64_t a, uint64_t b)
+{
+    uint64_t s = (a + b);
+    if (s < a) {
+        s += 0xFFFFFFFFULL;
+    }
+    return ((s >= Ntt_prime) ? (s - Ntt_prime) : s);
+}
+
+static inline uint64_t
+ntt_submod(uint64_t a, uint64_t b)
+{
+    return ((a >= b) ? (a - b) : (a - b + Ntt_prime));
+}
+
+static uint64_t
+ntt_powmod(uint64_t base, uint64_t exp)
+{
+    uint64_t result = 1;
+    for (; exp; exp >>= 1) {
+        if (exp & 1) {
+            result = ntt_mulmod(result, base);
+        }
+        base = ntt_mulmod(base, base);
+    }
+    return result;
+}
+
+// In-place iterative radix-2 transform; size of 'a' is a power of 2.
+static void
+ntt_transform(vector<uint64_t>& a, bool inverse)
+{
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = (n >> 1);
+        for (; (j & bit); bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(a[i], a[j]);
+        }
+    }
+
+    vector<uint64_t> w(max(n / 2, (size_t) 1));
+    for (size_t len = 2; len <= n; len <<= 1) {
+        uint64_t wlen = ntt_powmod(Ntt_root, ((Ntt_prime - 1) / len));
+        if (inverse) {
+            wlen = ntt_powmod(wlen, (Ntt_prime - 2));
+        }
+        size_t half = (len / 2);
+        w[0] = 1;
+        for (size_t j = 1; j < half; j++) {
+            w[j] = ntt_mulmod(w[j - 1], wlen);
+        }
+        for (size_t i = 0; i < n; i += len) {
+            uint64_t *lo = &a[i];
+            uint64_t *hi = &a[i + half];
+            for (size_t j = 0; j < half; j++) {
+                uint64_t u = lo[j];
+                uint64_t v = ntt_mulmod(hi[j], w[j]);
+                lo[j] = ntt_addmod(u, v);
+                hi[j] = ntt_submod(u, v);
+            }
+        }
+    }
+    if (inverse) {
+        uint64_t ninv = ntt_powmod(n, (Ntt_prime - 2));
+        for (auto& x : a) {
+            x = ntt_mulmod(x, ninv);
+        }
+    }
+}
+
+// # of base-10^6 coefficients for n limbs
+static size_t
+ntt_ncoeffs(size_t n)
+{
+    return (3 * ((n + 1) / 2));
+}
+
+// Split limbs a[0..n) into base-10^6 coefficients, 3 per pair of limbs.
+static void
+ntt_to_coeffs(vector<uint64_t>& c, const limb_t *a, size_t n)
+{
+    for (size_t l = 0, ci = 0; l < n; l += 2, ci += 3) {
+        dlimb_t v = (a[l] + (((l + 1) < n) ? ((dlimb_t) a[l + 1] * Limb_base) : 0));
+        c[ci]     = (v % Ntt_base);
+        c[ci + 1] = ((v / Ntt_base) % Ntt_base);
+        c[ci + 2] = (v / (Ntt_base * Ntt_base));
+    }
+}
+
+// r[0..na+nb) = a[0..na) * b[0..nb), as a cyclic convolution of their
+// coefficients, with length >= the # of product coefficients.
+static void
+limbs_mul_ntt(limb_t *r, const limb_t *a, size_t na, const limb_t *b, size_t nb)
+{
+    assert(min(na, nb) <= Ntt_max_limbs);
+    size_t nca = ntt_ncoeffs(na);
+    size_t ncb = ntt_ncoeffs(nb);
+    size_t len = 1;
+    while (len < (nca + ncb - 1)) {
+        len <<= 1;
+    }
+    // Root of unity of this order has to exist; p - 1 = 2^32 * (2^32 - 1)
+    assert(len <= (1ULL << 32));
+
+    vector<uint64_t> fa(len, 0);
+    vector<uint64_t> fb(len, 0);
+    ntt_to_coeffs(fa, a, na);
+    ntt_to_coeffs(fb, b, nb);
+
+    ntt_transform(fa, false);
+    ntt_transform(fb, false);
+    for (size_t i = 0; i < len; i++) {
+        fa[i] = ntt_mulmod(fa[i], fb[i]);
+    }
+    ntt_transform(fa, true);
+
+    // Propagate carries across coefficients, and pack each 3 of them
+    // back into 2 limbs.
+    size_t  nr = (na + nb);
+    dlimb_t carry = 0;
+    for (size_t l = 0, ci = 0; l < nr; l += 2, ci += 3) {
+        dlimb_t v = 0;
+        dlimb_t scale = 1;
+        for (size_t q = 0; q < 3; q++, scale *= Ntt_base) {
+            dlimb_t t = ((((ci + q) < len) ? fa[ci + q] : 0) + carry);
+            carry = (t / Ntt_base);
+            v += ((t - (carry * Ntt_base)) * scale);
+        }
+        r[l] = (limb_t) (v % Limb_base);
+        if ((l + 1) < nr) {
+            r[l + 1] = (limb_t) (v / Limb_base);
+        } else {
+            assert((v / Limb_base) == 0);
+        }
+    }
+    assert(carry == 0);
+}
+
+// r[0..na+nb) = a[0..na) * b[0..nb), picking the algorithm by operand sizes,
+// up to 'max_algo'; see limbs_mul_pick(). Unbalanced operands are multiplied
+// in chunks of the shorter operand's size, except by NTT.
+// 'scratch' needs limbs_mul_scratch(na, nb, max_algo, forced) limbs.
+static void
+limbs_mul(limb_t *r, const limb_t *a, size_t na, const limb_t *b, size_t nb,
+          limb_t *scratch, MUL_ALGO max_algo, bool forced)
+{
+    if (na < nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    MUL_ALGO algo = limbs_mul_pick(na, nb, max_algo, forced);
+    if (algo == MUL_SCHOOLBOOK) {
+        if (nb >= Karatsuba_threshold) {
+            limbs_mul_schoolbook(r, a, na, b, nb);
+            return;
+        }
+        // Basecase multiply a by b in chunks of up-to threshold limbs.
+        limb_t prod[2 * Karatsuba_threshold];
+        memset(r, 0, ((na + nb) * sizeof(*r)));
+        for (size_t off = 0; off < na; off += Karatsuba_threshold) {
+            size_t nchunk = min(Karatsuba_threshold, (na - off));
+            limbs_mul_basecase(prod, (a + off), nchunk, b, nb);
+            limbs_add((r + off), (r + off), (na + nb - off), prod, (nchunk + nb));
+        }
+        return;
+    }
+    if (algo == MUL_NTT) {
+        limbs_mul_ntt(r, a, na, b, nb);
+        return;
+    }
+    if (na == nb) {
+        if (algo == MUL_KARATSUBA) {
+            limbs_mul_karatsuba(r, a, b, na, scratch);
+        } else {
+            limbs_mul_toom3(r, a, b, na, scratch, max_algo);
+        }
+        return;
+    }
+
+    limb_t *prod = scratch;
+    limb_t *next = (scratch + 2 * nb);
+    memset(r, 0, ((na + nb) * sizeof(*r)));
+    for (size_t off = 0; off < na; off += nb) {
+        size_t nchunk = min(nb, (na - off));
+        limbs_mul(prod, (a + off), nchunk, b, nb, next, max_algo, forced);
+        limb_t carry = limbs_add((r + off), (r + off), (na + nb - off),
+                                 prod, (nchunk + nb));
+        assert(carry == 0);
+        (void) carry;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Scratch arena for multiplication: One per thread, grown as needed and
+// reused across multiplies, so the Karatsuba recursion never allocates.
+// -----------------------------------------------------------------------------
+class LimbArena
+{
+  public:
+    limb_t *
+    reserve(size_t nlimbs) {
+        if (buf.size() < nlimbs) {
+            buf.resize(nlimbs);
+        }
+        return buf.data();
+    }
+
+  private:
+    vector<limb_t> buf;
+};
+
+static thread_local LimbArena Scratch_arena;
+
+// -----------------------------------------------------------------------------
+// Fixed-size thread-pool, to run independent sub-products concurrently.
+// Threads waiting for a task's result run queued tasks in the meantime, so
+// tasks can wait on tasks they submit without exhausting the pool.
+// -----------------------------------------------------------------------------
+class ThreadPool
+{
+  public:
+    ThreadPool(unsigned nworkers) {
+        for (unsigned w = 0; w < nworkers; w++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    unsigned size(void) { return workers.size(); }
+
+    future<void>
+    submit(function<void()> fn) {
+        packaged_task<void()> task(std::move(fn));
+        future<void> fut = task.get_future();
+        {
+            lock_guard<mutex> lock(mtx);
+            tasks.push(std::move(task));
+        }
+        cv.notify_one();
+        return fut;
+    }
+
+    // Wait for task to complete, running other queued tasks till then.
+    void
+    wait(future<void>& fut) {
+        while (fut.wait_for(chrono::seconds(0)) != future_status::ready) {
+            if (!runPending()) {
+                fut.wait();
+            }
+        }
+        fut.get();
+    }
+
+  private:
+    vector<thread>                  workers;
+    queue<packaged_task<void()>>    tasks;
+    mutex                           mtx;
+    condition_variable              cv;
+    bool                            stopping = false;
+
+    // Run one queued task, if any, on this thread.
+    bool
+    runPending(void) {
+        packaged_task<void()> task;
+        {
+            lock_guard<mutex> lock(mtx);
+            if (tasks.empty()) {
+                return false;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+        return true;
+    }
+
+    void
+    workerLoop(void) {
+        for (;;) {
+            packaged_task<void()> task;
+            {
+                unique_lock<mutex> lock(mtx);
+                cv.wait(lock, [this]() { return (stopping || !tasks.empty()); });
+                if (stopping && tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+
+// Process-wide pool used by operator*(); the calling thread is the extra
+// worker, so a 1-CPU machine gets an empty pool and multiplies serially.
+static ThreadPool&
+mul_pool(void)
+{
+    static ThreadPool pool(max(thread::hardware_concurrency(), 1U) - 1);
+    return pool;
+}
+
+// Operands of at least these many limbs have their Karatsuba sub-products
+// computed concurrently.
+const size_t Par_threshold = 4096;
+
+// r[0..2n) = a[0..n) * b[0..n), with the top 'nlevels' of the Karatsuba
+// recursion run in parallel: z0 and z2 are submitted to the pool, while this
+// thread computes the middle product. Below that, or below Par_threshold,
+// sub-products are computed serially by limbs_mul(), so each can still use
+// Toom-3 / NTT. Parallel levels allocate their own buffers; serial ones use
+// the arena of the thread they run on.
+static void
+limbs_mul_karatsuba_par(limb_t *r, const limb_t *a, const limb_t *b, size_t n,
+                        unsigned nlevels, ThreadPool& pool)
+{
+    if ((nlevels == 0) || (n < Par_threshold)) {
+        limb_t *scratch = Scratch_arena.reserve(limbs_mul_scratch(n, n));
+        limbs_mul(r, a, n, b, n, scratch);
+        return;
+    }
+
+    size_t h = (n / 2);
+    size_t m = (n - h);
+    const limb_t *a0 = a;
+    const limb_t *a1 = (a + h);
+    const limb_t *b0 = b;
+    const limb_t *b1 = (b + h);
+
+    vector<limb_t> tmp(4 * (m + 1));
+    limb_t *sa = tmp.data();
+    limb_t *sb = (sa + m + 1);
+    limb_t *z1 = (sb + m + 1);
+    sa[m] = limbs_add(sa, a1, m, a0, h);
+    sb[m] = limbs_add(sb, b1, m, b0, h);
+
+    future<void> fz0 = pool.submit([=, &pool]() {
+        limbs_mul_karatsuba_par(r, a0, b0, h, (nlevels - 1), pool);
+    });
+    future<void> fz2 = pool.submit([=, &pool]() {
+        limbs_mul_karatsuba_par((r + 2 * h), a1, b1, m, (nlevels - 1), pool);
+    });
+    limbs_mul_karatsuba_par(z1, sa, sb, (m + 1), (nlevels - 1), pool);
+    pool.wait(fz0);
+    pool.wait(fz2);
+
+    limbs_karatsuba_combine(r, z1, h, m);
+}
+
+// -----------------------------------------------------------------------------
+// BigInt: Arbitrary-precision non-negative integer.
+// -----------------------------------------------------------------------------
+class BigInt
+{
+  public:
+    BigInt() { }
+    BigInt(uint64_t v) {
+        while (v) {
+            limbs.push_back(v % Limb_base);
+            v /= Limb_base;
+        }
+    }
+
+    // Parse from decimal string of digits. Returns false if the string is
+    // empty or has non-digit characters.
+    bool
+    parse(const string& str) {
+        limbs.clear();
+        if (str.empty()) {
+            return false;
+        }
+        for (auto c : str) {
+            if ((c < '0') || (c > '9')) {
+                return false;
+            }
+        }
+
+        // Each limb, from the least-significant end, is 9 digits.
+        limbs.reserve((str.size() / Limb_digits) + 1);
+        for (size_t end = str.size(); end > 0; ) {
+            size_t start = ((end > Limb_digits) ? (end - Limb_digits) : 0);
+            limb_t limb = 0;
+            for (size_t i = start; i < end; i++) {
+                limb = ((limb * 10) + (str[i] - '0'));
+            }
+            limbs.push_back(limb);
+            end = start;
+        }
+        normalize();
+        return true;
+    }
+
+    string
+    toString(void) const {
+        if (limbs.empty()) {
+            return "0";
+        }
+        string str = to_string(limbs.back());
+        size_t off = str.size();
+        str.resize(off + ((limbs.size() - 1) * Limb_digits));
+
+        // Lower limbs are zero-padded to 9 digits.
+        for (size_t l = (limbs.size() - 1); l-- > 0; off += Limb_digits) {
+            limb_t limb = limbs[l];
+            for (int d = (Limb_digits - 1); d >= 0; d--) {
+                str[off + d] = ('0' + (limb % 10));
+                limb /= 10;
+            }
+        }
+        return str;
+    }
+
+    size_t nlimbs(void) const { return limbs.size(); }
+    bool   isZero(void) const { return limbs.empty(); }
+
+    // Returns < 0, 0, > 0 if this is <, ==, > than 'rhs'
+    int
+    compare(const BigInt& rhs) const {
+        if (limbs.size() != rhs.limbs.size()) {
+            return ((limbs.size() < rhs.limbs.size()) ? -1 : 1);
+        }
+        for (size_t l = limbs.size(); l-- > 0; ) {
+            if (limbs[l] != rhs.limbs[l]) {
+                return ((limbs[l] < rhs.limbs[l]) ? -1 : 1);
+            }
+        }
+        return 0;
+    }
+
+    bool operator==(const BigInt& rhs) const { return (compare(rhs) == 0); }
+    bool operator!=(const BigInt& rhs) const { return (compare(rhs) != 0); }
+
+    // In-place add
+    BigInt&
+    operator+=(const BigInt& rhs) {
+        if (limbs.size() < rhs.limbs.size()) {
+            limbs.resize(rhs.limbs.size(), 0);
+        }
+        limb_t carry = limbs_add(limbs.data(), limbs.data(), limbs.size(),
+                                 rhs.limbs.data(), rhs.limbs.size());
+        if (carry) {
+            limbs.push_back(carry);
+        }
+        return *this;
+    }
+
+    // In-place subtract. Requires: *this >= rhs
+    BigInt&
+    operator-=(const BigInt& rhs) {
+        assert(compare(rhs) >= 0);
+        limb_t borrow = limbs_sub(limbs.data(), limbs.data(), limbs.size(),
+                                  rhs.limbs.data(), rhs.limbs.size());
+        assert(borrow == 0);
+        (void) borrow;
+        normalize();
+        return *this;
+    }
+
+    friend BigInt operator*(const BigInt& lhs, const BigInt& rhs);
+
+    // Serial multiply. MUL_AUTO picks the algorithm by operand sizes. Any
+    // other 'algo' is used for the top-level multiply, with sub-products
+    // picking by size, up to that algorithm.
+    static BigInt
+    multiply(const BigInt& lhs, const BigInt& rhs, MUL_ALGO algo = MUL_AUTO) {
+        BigInt result;
+        if (lhs.isZero() || rhs.isZero()) {
+            return result;
+        }
+        size_t na = lhs.nlimbs();
+        size_t nb = rhs.nlimbs();
+        bool   forced = (algo != MUL_AUTO);
+        limb_t *scratch = Scratch_arena.reserve(limbs_mul_scratch(na, nb, algo, forced));
+
+        result.limbs.resize(na + nb);
+        limbs_mul(result.limbs.data(), lhs.limbs.data(), na, rhs.limbs.data(), nb,
+                  scratch, algo, forced);
+        result.normalize();
+        return result;
+    }
+
+    // Schoolbook multiply, for all operand sizes. Used to verify results.
+    static BigInt
+    mulSchoolbook(const BigInt& lhs, const BigInt& rhs) {
+        return multiply(lhs, rhs, MUL_SCHOOLBOOK);
+    }
+
+    // Multiply with Karatsuba's sub-products computed concurrently on 'pool'.
+    // Operands are zero-padded to the same size; if their sizes differ by
+    // more than 2x, this multiplies serially instead.
+    static BigInt
+    mulParallel(const BigInt& lhs, const BigInt& rhs, ThreadPool& pool) {
+        size_t na = lhs.nlimbs();
+        size_t nb = rhs.nlimbs();
+        size_t n  = max(na, nb);
+        if (!pool.size() || (n < Par_threshold) || (n > (2 * min(na, nb)))) {
+            return multiply(lhs, rhs);
+        }
+
+        vector<limb_t> a(lhs.limbs);
+        vector<limb_t> b(rhs.limbs);
+        a.resize(n, 0);
+        b.resize(n, 0);
+
+        // Enough levels for ~2 tasks per thread; each level makes 3 tasks.
+        unsigned nlevels = 1;
+        for (size_t ntasks = 3; ntasks < (2 * (pool.size() + 1)); ntasks *= 3) {
+            nlevels++;
+        }
+
+        BigInt result;
+        result.limbs.resize(2 * n);
+        limbs_mul_karatsuba_par(result.limbs.data(), a.data(), b.data(), n,
+                                nlevels, pool);
+        result.normalize();
+        return result;
+    }
+
+  private:
+    vector<limb_t> limbs;
+
+    // Drop leading 0-limbs; zero has no limbs.
+    void
+    normalize(void) {
+        while (!limbs.empty() && (limbs.back() == 0)) {
+            limbs.pop_back();
+        }
+    }
+};
+
+// Multiply, picking the algorithm by operand sizes: schoolbook, Karatsuba,
+// Toom-3, then NTT. Large operands are multiplied in parallel.
+BigInt
+operator*(const BigInt& lhs, const BigInt& rhs)
+{
+    if (min(lhs.nlimbs(), rhs.nlimbs()) >= Par_threshold) {
+        return BigInt::mulParallel(lhs, rhs, mul_pool());
+    }
+    return BigInt::multiply(lhs, rhs);
+}
+
+// -----------------------------------------------------------------------------
+// Benchmark: Operand sizes run from 10 digits up to max-digits, in steps of
+// ~sqrt(10). Each algorithm is timed, forced at the top-level, up to its own
+// size cap beyond which it is too slow to be of interest; "auto" is the
+// operator*() ladder, including its parallel multiply.
+// -----------------------------------------------------------------------------
+const size_t Bench_max_digits_default = (10 * 1000 * 1000);
+
+// Indexed by MUL_ALGO
+const size_t Bench_algo_max_digits[] = {   100 * 1000           // schoolbook
+                                       , 1000 * 1000            // karatsuba
+                                       , 3 * 1000 * 1000        // toom3
+                                       , 100 * 1000 * 1000      // ntt
+                                       , 100 * 1000 * 1000      // auto
+                                       };
+
+static_assert((sizeof(Bench_algo_max_digits) / sizeof(*Bench_algo_max_digits))
+                == (MUL_AUTO + 1), "Need a size cap for each MUL_ALGO");
+
+// Each measurement repeats a multiply till it has run for at least this long.
+const uint64_t Bench_min_ns = (50 * 1000 * 1000);
+
+/*
+ * *****************************************************************************
+ * main()
+ * *****************************************************************************
+ */
 int
 main(int argc, char *argv[])
 {
-    if (argc == 1) {
-      cout << "Usage: " << argv[0] << " <num1> <num2>" << endl;
+    if ((argc == 1) || (strncmp("--help", argv[1], strlen("--help")) == 0)) {
+      cout << "Usage: " << argv[0] << Usage << endl;
       return 0;
     }
-    string s1 = argv[1];
-    string s2 = argv[2];
-    cout << multiply(s1,s2) << endl;
+
+    // Execute the named test-function(s), if they are supported test-functions
+    if (strncmp("test_", argv[1], strlen("test_")) == 0) {
+        int ntests = 0;
+        for (int tctr = 0; tctr < ARRAYSIZE(Test_fns); tctr++) {
+            if (!strncmp(Test_fns[tctr].tfn_name, argv[1], strlen(argv[1]))) {
+                Test_fns[tctr].tfn();
+                ntests++;
+            }
+        }
+        if (!ntests) {
+            cout << "Warning: Named test-function '"
+                 << argv[1] << "' not found." << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (strcmp("--bench", argv[1]) == 0) {
+        BENCH_FMT fmt = BENCH_TABLE;
+        int argi = 2;
+        if ((argi < argc) && (strcmp("--csv", argv[argi]) == 0)) {
+            fmt = BENCH_CSV;
+            argi++;
+        } else if ((argi < argc) && (strcmp("--json", argv[argi]) == 0)) {
+            fmt = BENCH_JSON;
+            argi++;
+        }
+        size_t max_digits = Bench_max_digits_default;
+        if (argi < argc) {
+            max_digits = strtoull(argv[argi], nullptr, 10);
+            if (!max_digits) {
+                cout << "Error: Invalid max-digits '" << argv[argi] << "'" << endl;
+                return 1;
+            }
+        }
+        return run_benchmark(max_digits, fmt);
+    }
+
+    if (argc != 3) {
+      cout << "Usage: " << argv[0] << Usage << endl;
+      return 1;
+    }
+    BigInt n1;
+    BigInt n2;
+    if (!n1.parse(argv[1]) || !n2.parse(argv[2])) {
+      cout << "Error: Arguments must be non-negative decimal integers." << endl;
+      return 1;
+    }
+    cout << (n1 * n2).toString() << endl;
     return 0;
 }
 
@@ -140,3 +1406,367 @@ add(string lhs, string rhs)
     return result.erase(0, min(result.find_first_not_of('0'),
                                result.size() - 1));
 }
+
+// **** Test helper methods ****
+
+// Generate a random decimal string of 'ndigits' digits, with no leading 0.
+string
+random_digits(size_t ndigits, mt19937_64& rng)
+{
+    uniform_int_distribution<int> digit(0, 9);
+    uniform_int_distribution<int> lead(1, 9);
+    string str(ndigits, '0');
+    for (size_t i = 0; i < ndigits; i++) {
+        str[i] = ('0' + (i ? digit(rng) : lead(rng)));
+    }
+    return str;
+}
+
+BigInt
+random_bigint(size_t ndigits, mt19937_64& rng)
+{
+    BigInt n;
+    n.parse(random_digits(ndigits, rng));
+    return n;
+}
+
+// **** Benchmark ****
+
+/**
+ * run_benchmark() - Time each multiply algorithm over a range of sizes.
+ *
+ * Both operands have 'ndigits' random digits. The products of all algorithms
+ * timed at a size are cross-checked against each other; a mismatch fails the
+ * run. Reports ns/op and digits/sec, where digits are those of one operand,
+ * as a table, CSV or JSON records.
+ *
+ * Returns 0 on success, 1 if any algorithms disagree.
+ */
+int
+run_benchmark(size_t max_digits, BENCH_FMT fmt)
+{
+    mt19937_64 rng(42);
+    int    rv = 0;
+    bool   first = true;
+
+    switch (fmt) {
+      case BENCH_CSV:
+        cout << "digits,algo,reps,ns_per_op,digits_per_sec" << endl;
+        break;
+      case BENCH_JSON:
+        cout << "[" << endl;
+        break;
+      default:
+        cout << "  digits        algo     reps        ns/op     digits/sec" << endl;
+        break;
+    }
+
+    // Sizes: 10, 31, 100, 316, 1000, ...
+    for (size_t decade = 10; decade <= max_digits; decade *= 10) {
+        for (size_t ndigits : { decade, (size_t) (decade * 3.16227766) }) {
+            if (ndigits > max_digits) {
+                break;
+            }
+            BigInt n1 = random_bigint(ndigits, rng);
+            BigInt n2 = random_bigint(ndigits, rng);
+            BigInt expected;
+            bool   have_expected = false;
+
+            for (int algo = MUL_SCHOOLBOOK; algo <= MUL_AUTO; algo++) {
+                if (ndigits > Bench_algo_max_digits[algo]) {
+                    continue;
+                }
+                BigInt   prod;
+                uint64_t nreps = 0;
+                uint64_t elapsed_ns = 0;
+                auto start = chrono::steady_clock::now();
+                do {
+                    prod = ((algo == MUL_AUTO) ? (n1 * n2)
+                                    : BigInt::multiply(n1, n2, (MUL_ALGO) algo));
+                    nreps++;
+                    elapsed_ns = chrono::duration_cast<chrono::nanoseconds>(
+                                    chrono::steady_clock::now() - start).count();
+                } while (elapsed_ns < Bench_min_ns);
+
+                if (!have_expected) {
+                    expected = prod;
+                    have_expected = true;
+                } else if (!(prod == expected)) {
+                    cerr << "Error: " << Mul_algo_names[algo]
+                         << " product mismatch for " << ndigits
+                         << "-digit operands" << endl;
+                    rv = 1;
+                }
+
+                double ns_per_op = ((double) elapsed_ns / nreps);
+                double digits_per_sec = (ndigits * 1e9 / ns_per_op);
+                switch (fmt) {
+                  case BENCH_CSV:
+                    cout << ndigits << "," << Mul_algo_names[algo] << ","
+                         << nreps << "," << (uint64_t) ns_per_op << ","
+                         << (uint64_t) digits_per_sec << endl;
+                    break;
+                  case BENCH_JSON:
+                    cout << (first ? "" : ",\n")
+                         << "  { \"digits\": " << ndigits
+                         << ", \"algo\": \"" << Mul_algo_names[algo] << "\""
+                         << ", \"reps\": " << nreps
+                         << ", \"ns_per_op\": " << (uint64_t) ns_per_op
+                         << ", \"digits_per_sec\": " << (uint64_t) digits_per_sec
+                         << " }";
+                    break;
+                  default:
+                    cout << setw(8) << ndigits << "  "
+                         << setw(10) << Mul_algo_names[algo] << "  "
+                         << setw(7) << nreps << "  "
+                         << setw(11) << (uint64_t) ns_per_op << "  "
+                         << setw(13) << (uint64_t) digits_per_sec << endl;
+                    break;
+                }
+                first = false;
+            }
+        }
+    }
+    if (fmt == BENCH_JSON) {
+        cout << "\n]" << endl;
+    }
+    return rv;
+}
+
+// **** Test cases ****
+
+// Known result, from the Coursera course's programming assignment.
+const char *Pi_64  = "3141592653589793238462643383279502884197169399375105820974944592";
+const char *E_64   = "2718281828459045235360287471352662497757247093699959574966967627";
+const char *PiE_64 = "8539734222673567065463550869546574495034888535765114961879601127"
+                     "067743044893204848617875072216249073013374895871952806582723184";
+
+void
+test_string_multiply(void)
+{
+    TEST_START();
+
+    assert(multiply("0", "0") == "0");
+    assert(multiply("12", "34") == "408");
+    assert(multiply("1234", "5678") == "7006652");
+    assert(multiply(Pi_64, E_64) == PiE_64);
+    TEST_END();
+}
+
+void
+test_bigint_parse(void)
+{
+    TEST_START();
+
+    BigInt n;
+    assert(!n.parse(""));
+    assert(!n.parse("12a3"));
+    assert(!n.parse("-1"));
+
+    assert(n.parse("0") && n.isZero() && (n.toString() == "0"));
+    assert(n.parse("0000") && n.isZero() && (n.toString() == "0"));
+    assert(n.parse("007") && (n.toString() == "7"));
+    assert(n.parse("999999999") && (n.nlimbs() == 1));
+    assert(n.parse("1000000000") && (n.nlimbs() == 2));
+    assert(n.toString() == "1000000000");
+    assert(n.parse("1000000000000000001") && (n.toString() == "1000000000000000001"));
+    assert(n.parse(Pi_64) && (n.toString() == Pi_64));
+    assert(BigInt(1234567890123456789ULL).toString() == "1234567890123456789");
+    assert(BigInt(0).isZero());
+    TEST_END();
+}
+
+void
+test_bigint_add_subtract(void)
+{
+    TEST_START();
+
+    mt19937_64 rng(5);
+    for (size_t ndigits = 1; ndigits <= 200; ndigits += 7) {
+        string s1 = random_digits(ndigits, rng);
+        string s2 = random_digits((1 + (rng() % ndigits)), rng);
+        BigInt n1;
+        BigInt n2;
+        n1.parse(s1);
+        n2.parse(s2);
+
+        BigInt sum = n1;
+        sum += n2;
+        assert(sum.toString() == add(s1, s2));
+
+        BigInt diff = n1;
+        diff -= n2;
+        assert(diff.toString() == subtract(s1, s2));
+
+        // Round-trip back to original value
+        diff += n2;
+        assert(diff == n1);
+        sum -= n1;
+        assert(sum == n2);
+        sum -= n2;
+        assert(sum.isZero());
+    }
+
+    // Carry / borrow propagation across all limbs
+    BigInt n;
+    n.parse("999999999999999999999999999");
+    n += BigInt(1);
+    assert(n.toString() == "1000000000000000000000000000");
+    n -= BigInt(1);
+    assert(n.toString() == "999999999999999999999999999");
+    TEST_END();
+}
+
+void
+test_bigint_multiply_basic(void)
+{
+    TEST_START();
+
+    BigInt n1;
+    BigInt n2;
+    n1.parse(Pi_64);
+    n2.parse(E_64);
+    assert((n1 * n2).toString() == PiE_64);
+    assert((n1 * BigInt(0)).isZero());
+    assert((BigInt(0) * n2).isZero());
+    assert((n1 * BigInt(1)) == n1);
+    assert((BigInt(999999999) * BigInt(999999999)).toString() == "999999998000000001");
+    TEST_END();
+}
+
+// Cross-check BigInt multiply against string multiply, for balanced and
+// unbalanced operands around and above the Karatsuba threshold.
+void
+test_bigint_multiply_vs_string(void)
+{
+    TEST_START();
+
+    mt19937_64 rng(7);
+    for (size_t ndigits = 1; ndigits <= 1200; ndigits += 37) {
+        for (size_t ndigits2 : { ndigits, (1 + (ndigits / 3)), (ndigits + 500) }) {
+            string s1 = random_digits(ndigits, rng);
+            string s2 = random_digits(ndigits2, rng);
+            BigInt n1;
+            BigInt n2;
+            n1.parse(s1);
+            n2.parse(s2);
+            assert((n1 * n2).toString() == multiply(s1, s2));
+        }
+    }
+    TEST_END();
+}
+
+// Multiply 100K-digit operands; verify the operator*() result against the
+// schoolbook result, and n1 * n2 == n2 * n1, and report times.
+void
+test_bigint_multiply_large(void)
+{
+    TEST_START();
+
+    mt19937_64 rng(11);
+    size_t ndigits = (100 * 1000);
+    BigInt n1 = random_bigint(ndigits, rng);
+    BigInt n2 = random_bigint(ndigits, rng);
+
+    auto start = chrono::steady_clock::now();
+    BigInt prod = (n1 * n2);
+    auto fast_us = chrono::duration_cast<chrono::microseconds>(
+                            chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    BigInt expected = BigInt::mulSchoolbook(n1, n2);
+    auto schoolbook_us = chrono::duration_cast<chrono::microseconds>(
+                            chrono::steady_clock::now() - start).count();
+
+    assert(prod == expected);
+    assert((n2 * n1) == prod);
+    assert(prod.toString().size() >= ((2 * ndigits) - 1));
+
+    // Unbalanced operands
+    BigInt n3 = random_bigint((ndigits / 7), rng);
+    assert((n1 * n3) == BigInt::mulSchoolbook(n1, n3));
+
+    cout << ndigits << "-digit operands: operator*=" << fast_us
+         << " us, schoolbook=" << schoolbook_us << " us";
+    TEST_END();
+}
+
+// Cross-check each algorithm, forced at the top-level, against schoolbook,
+// for balanced and unbalanced operands, including ones just past limb
+// boundaries and all-9s operands, which maximize carries.
+void
+test_bigint_multiply_algos(void)
+{
+    TEST_START();
+
+    mt19937_64 rng(13);
+    for (size_t ndigits : { 1, 9, 10, 80, 81, 82, 300, 1000, 4000, 9001 }) {
+        for (size_t ndigits2 : { ndigits, (1 + (ndigits / 3)), (ndigits + 77) }) {
+            BigInt n1 = random_bigint(ndigits, rng);
+            BigInt n2 = random_bigint(ndigits2, rng);
+            BigInt expected = BigInt::mulSchoolbook(n1, n2);
+            for (MUL_ALGO algo : { MUL_KARATSUBA, MUL_TOOM3, MUL_NTT, MUL_AUTO }) {
+                assert(BigInt::multiply(n1, n2, algo) == expected);
+            }
+        }
+
+        BigInt nines;
+        nines.parse(string(ndigits, '9'));
+        BigInt expected = BigInt::mulSchoolbook(nines, nines);
+        for (MUL_ALGO algo : { MUL_KARATSUBA, MUL_TOOM3, MUL_NTT, MUL_AUTO }) {
+            assert(BigInt::multiply(nines, nines, algo) == expected);
+        }
+    }
+    TEST_END();
+}
+
+// Parallel Karatsuba on a private pool must match the serial result,
+// for any # of pool threads, including none.
+void
+test_bigint_multiply_parallel(void)
+{
+    TEST_START();
+
+    mt19937_64 rng(17);
+    size_t ndigits = (Par_threshold * Limb_digits * 5);
+    BigInt n1 = random_bigint(ndigits, rng);
+    BigInt n2 = random_bigint(ndigits, rng);
+    BigInt n3 = random_bigint(((ndigits * 2) / 3), rng);
+    BigInt expected   = BigInt::multiply(n1, n2);
+    BigInt expected13 = BigInt::multiply(n1, n3);
+
+    for (unsigned nworkers : { 0, 1, 3, 8 }) {
+        ThreadPool pool(nworkers);
+        assert(BigInt::mulParallel(n1, n2, pool) == expected);
+        assert(BigInt::mulParallel(n1, n3, pool) == expected13);
+    }
+    assert((n1 * n2) == expected);
+    TEST_END();
+}
+
+// Multiply 1M-digit operands; NTT and Toom-3 results must agree.
+void
+test_bigint_multiply_million(void)
+{
+    TEST_START();
+
+    mt19937_64 rng(19);
+    size_t ndigits = (1000 * 1000);
+    BigInt n1 = random_bigint(ndigits, rng);
+    BigInt n2 = random_bigint(ndigits, rng);
+
+    auto start = chrono::steady_clock::now();
+    BigInt prod = BigInt::multiply(n1, n2, MUL_NTT);
+    auto ntt_us = chrono::duration_cast<chrono::microseconds>(
+                        chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    BigInt expected = BigInt::multiply(n1, n2, MUL_TOOM3);
+    auto toom3_us = chrono::duration_cast<chrono::microseconds>(
+                        chrono::steady_clock::now() - start).count();
+
+    assert(prod == expected);
+    cout << ndigits << "-digit operands: ntt=" << ntt_us
+         << " us, toom3=" << toom3_us << " us";
+    TEST_END();
+}
@@ -4,18 +4,40 @@
  * from any string over an alphabet. (Say 'a-zZ-Z0-9') Return start of
  * the longest such sub-string if it exists. NULL otherwise.
  *
+ * longest_substr_k_buf() works on arbitrary byte buffers, of an explicit
+ * length, in one O(n) pass; longest_substr_k() is its null-terminated string
+ * version. longest_substr_k_parallel() splits a buffer into chunks scanned
+ * concurrently; --file runs it over a mmap()'ed file.
+ *
  * Ref:
  *
- * Usage: gcc -o ch1.unique-k-substrings ch1.unique-k-substrings.c
+ * Usage: gcc -O2 -pthread -o ch1.unique-k-substrings ch1.unique-k-substrings.c
+ *        ./ch1.unique-k-substrings --file <file> <k> [ <nthreads> ]
+ *        ./ch1.unique-k-substrings bench_<fn-name> [ <bench-options> ]
+ *
+ * bench_* runs the benchmarks in Bench_fns[], by the runner of
+ * ../Tools/bench_fns.h; see there for <bench-options>.
  *
  * History:
  * -----------------------------------------------------------------------------
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-const char *Usage = "%s [ --help | test_<fn-name> ]\n";
+#include "../Tools/bench_fns.h"
+
+const char *Usage = "%s [ --help | test_<fn-name> | --file <file> <k> [ <nthreads> ]"
+                    " | bench_<fn-name> [ <bench-options> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -30,15 +52,38 @@ typedef int             bool;
 #define FALSE    0
 #endif  // FALSE
 
+// Sliding-window state, over a byte buffer, for longest_substr_k_buf().
+typedef struct kuniq_scan
+{
+    size_t  last_seen[256];     // Last index of each byte in window; or
+                                // KUNIQ_NOT_SEEN, if it's not in the window.
+    size_t  start;              // Start index of current window
+    uint32  nunique;            // # of distinct bytes in current window
+    uint32  k;
+    size_t  best_start;         // Longest window with k distinct bytes ...
+    size_t  best_len;           // ... so far; best_len == 0 if none found.
+} KUNIQ_SCAN;
+
+#define KUNIQ_NOT_SEEN  ((size_t) -1)
+
 // String Function Prototypes
-bool
-char_in_unique_k_set(const char *sp, char ch, int *unique_k, int found_k);
+const unsigned char *
+longest_substr_k_buf(const unsigned char *buf, size_t len, uint32 k,
+                     size_t *substr_len);
 
-void
-update_curr_char_in_unique_k(const char *sp, char *ch, int *unique_k, int found_k);
+char *
+longest_substr_k(const char *sp, const uint32 k, uint32 *substr_len);
 
-void
-replace_curr_char_in_unique_k(const char *sp, char *ch, int *unique_k, int found_k);
+void kuniq_scan_init(KUNIQ_SCAN *scan, uint32 k);
+void kuniq_scan_bytes(KUNIQ_SCAN *scan, const unsigned char *buf,
+                      size_t from, size_t to);
+
+const unsigned char *
+longest_substr_k_parallel(const unsigned char *buf, size_t len, uint32 k,
+                          int nthreads, size_t *substr_len);
+
+int  scan_file(const char *path, uint32 k, int nthreads);
+double now_secs(void);
 
 // Test Function Prototypes
 void test_this(void);
@@ -50,6 +95,18 @@ void test_k_gt_strlen(void);
 
 void test_nchars_in_alphabet(void);
 
+void test_k_eq_1(void);
+void test_basic_substrings(void);
+void test_fewer_than_k_unique(void);
+void test_binary_buffer(void);
+void test_vs_brute_force(void);
+void test_large_buffer(void);
+void test_parallel_vs_serial(void);
+void test_parallel_large_buffer(void);
+
+// Bench Function Prototypes
+void bench_kuniq_scan(uint64_t nops);
+
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
 typedef struct test_fns
@@ -64,6 +121,19 @@ TEST_FNS Test_fns[] = {
                     , { "test_nchars_in_alphabet"   , test_nchars_in_alphabet }
                     , { "test_null_input"           , test_null_input }
                     , { "test_k_gt_strlen"          , test_k_gt_strlen }
+                    , { "test_k_eq_1"               , test_k_eq_1 }
+                    , { "test_basic_substrings"     , test_basic_substrings }
+                    , { "test_fewer_than_k_unique"  , test_fewer_than_k_unique }
+                    , { "test_binary_buffer"        , test_binary_buffer }
+                    , { "test_vs_brute_force"       , test_vs_brute_force }
+                    , { "test_large_buffer"         , test_large_buffer }
+                    , { "test_parallel_vs_serial"   , test_parallel_vs_serial }
+                    , { "test_parallel_large_buffer", test_parallel_large_buffer }
+    };
+
+// List of bench functions one can invoke from the command-line
+BENCH_FNS Bench_fns[] = {
+                          { "bench_kuniq_scan"          , bench_kuniq_scan, 0 }
     };
 
 // Test start / end info-msg macros
@@ -78,126 +148,332 @@ TEST_FNS Test_fns[] = {
                                  + ('9' - '0' + 1) )
 
 /*
- * Find and return the start of the longest sub-string with 'k' unique
- * characters occurring in input string 'sp'.
+ * Find and return the start of the longest sub-string with exactly 'k' unique
+ * bytes occurring in the byte buffer 'buf' of 'len' bytes. Returns NULL if
+ * there is no such sub-string, i.e. 'buf' has fewer than k unique bytes.
+ * The length of the sub-string found is returned in 'substr_len', if it's
+ * non-NULL. If there are several longest sub-strings, the 1st one is returned.
  *
- * Algorithm:
- *  - Walk the string from its head, one char @ a time.
+ * Algorithm: Slide a window [start, i] over the buffer in a single pass,
+ * extending it by one byte at a time.
  *
- *  - Track the 'most recently seen' k-unique chars, but rather than
- *    tracking the char itself, track the highest index of the char
- *    as seen while traversing the string. Call this k_indexes[].
+ *  - Track, in last_seen[], the index where each byte of the window was last
+ *    seen, instead of the set of unique bytes; so checking whether a byte is
+ *    in the window is a table lookup and not a search of the set.
  *
- *  - Maintain int found_k which will "count" the # of unique chars
- *    we've seen so far.
+ *  - When a new byte makes the window have (k + 1) unique bytes, shrink it
+ *    from the start till one byte drops out: That is the byte at the first
+ *    index 'j' of the window with last_seen[buf[j]] == j, i.e. which does not
+ *    recur in the window. The new window starts at (j + 1). As 'start' only
+ *    moves forwards, this is O(n) overall.
  *
- *  - If (found_k == k); i.e. we have found our 'unique set of chars for this
- *    run', then if we find another char, we have to replace the char with
- *    the smallest index. The start of the run will be reset to the index of
- *    next unique char.
- *      (Assert: index-of-char-being-replaced + 1) == index-of-next=unique-char)
- *
- *  - Before replacing a unique-char that is being 'aged-out of the sliding
- *    window', track the longest-length-of-substring-so-far, and its start
- *    offset. Keep track of the potential longest-length in case the new
- *    run of unique-chars sub-string is shorter than previously found run.
+ *  - Whenever the window has exactly k unique bytes, it's a candidate for the
+ *    longest sub-string.
  */
-char *
-longest_substr_k(const char *sp, const uint32 k, uint32 *substr_len)
+const unsigned char *
+longest_substr_k_buf(const unsigned char *buf, size_t len, uint32 k,
+                     size_t *substr_len)
 {
-    // Handle lapsed cases ...
-    if (!sp || (k == 0) || (k > strlen(sp))) {
-        return (char *) NULL;
+    if (substr_len) {
+        *substr_len = 0;
     }
-
-    if (k == 1) {
-        // Handle this special-case differently; To be implemented.
-        return (char *) sp;
+    // Handle lapsed cases ...
+    if (!buf || (k == 0) || (k > len) || (k > 256)) {
+        return NULL;
     }
 
-    // Declare tracker items
-    int    unique_k[k];
-    uint32 found_k = 0;
+    KUNIQ_SCAN scan;
+    kuniq_scan_init(&scan, k);
+    kuniq_scan_bytes(&scan, buf, 0, len);
 
-    // Initialize to -1 as 0 is a valid index in the string.
-    memset(unique_k, -1, sizeof(unique_k));
+    if (scan.best_len == 0) {
+        return NULL;
+    }
+    if (substr_len) {
+        *substr_len = scan.best_len;
+    }
+    return (buf + scan.best_start);
+}
 
-    const char *endp = (sp + strlen(sp));
+/*
+ * Find and return the start of the longest sub-string with 'k' unique
+ * characters occurring in null-terminated input string 'sp'.
+ * See longest_substr_k_buf().
+ */
+char *
+longest_substr_k(const char *sp, const uint32 k, uint32 *substr_len)
+{
+    if (!sp) {
+        return (char *) NULL;
+    }
+    size_t len = 0;
+    const unsigned char *rv = longest_substr_k_buf((const unsigned char *) sp,
+                                                   strlen(sp), k, &len);
+    if (substr_len) {
+        *substr_len = (uint32) len;
+    }
+    return (char *) rv;
+}
 
-    char *start_substr = (char *)sp;  // Start of potentially longest substr-so-far
-    int   longest = 0;
+/*
+ * kuniq_scan_init(): Initialize an empty window, to find k unique bytes.
+ */
+void
+kuniq_scan_init(KUNIQ_SCAN *scan, uint32 k)
+{
+    for (int bctr = 0; bctr < ARRAYSIZE(scan->last_seen); bctr++) {
+        scan->last_seen[bctr] = KUNIQ_NOT_SEEN;
+    }
+    scan->start      = 0;
+    scan->nunique    = 0;
+    scan->k          = k;
+    scan->best_start = 0;
+    scan->best_len   = 0;
+}
 
-    // Process each char in the string, maintaining results-so-far as we find them.
-    char *curr = (char *) sp;
-    while (curr < endp) {
+/*
+ * kuniq_scan_bytes(): Extend the window over bytes buf[from .. to), where
+ * 'from' is where the previous call, if any, stopped. Indexes are relative
+ * to 'buf', so a scan can be continued over a later part of the same buffer.
+ */
+void
+kuniq_scan_bytes(KUNIQ_SCAN *scan, const unsigned char *buf,
+                 size_t from, size_t to)
+{
+    size_t *last_seen  = scan->last_seen;
+    size_t  start      = scan->start;
+    uint32  nunique    = scan->nunique;
+    uint32  k          = scan->k;
+    size_t  best_start = scan->best_start;
+    size_t  best_len   = scan->best_len;
+
+    for (size_t i = from; i < to; i++) {
+        unsigned char ch = buf[i];
+        if (last_seen[ch] == KUNIQ_NOT_SEEN) {
+            if (nunique == k) {
+                // Drop bytes from the start till one byte leaves the window.
+                while (last_seen[buf[start]] != start) {
+                    start++;
+                }
+                last_seen[buf[start]] = KUNIQ_NOT_SEEN;
+                start++;
+            } else {
+                nunique++;
+            }
+        }
+        last_seen[ch] = i;
 
-        if (!char_in_unique_k_set(sp, *curr, unique_k, found_k)) {
-            if (found_k < k) {
-                unique_k[found_k] = (curr - sp);
-                found_k++;
-                longest++;
+        if ((nunique == k) && ((i - start + 1) > best_len)) {
+            best_len   = (i - start + 1);
+            best_start = start;
+        }
+    }
+    scan->start      = start;
+    scan->nunique    = nunique;
+    scan->best_start = best_start;
+    scan->best_len   = best_len;
+}
 
-            } else {
-                // Implement replacement algorithm ... Come back to it.
-                replace_curr_char_in_unique_k(sp, curr, unique_k, found_k);
+/*
+ * -----------------------------------------------------------------------------
+ * Parallel scan: Split the buffer into one chunk per thread. Each thread finds
+ * the longest sub-string *ending* in its chunk; the longest of those, the
+ * 1st one on ties, is the serial result.
+ *
+ * A thread cannot start its scan with an empty window at its chunk's start,
+ * as windows ending in the chunk may start in earlier chunks. Instead, it
+ * rebuilds the boundary state: The serial scan's window ending at the byte
+ * before the chunk is the longest one with at most k unique bytes, so it's
+ * found by a backward scan till a (k + 1)'th unique byte is seen. A forward
+ * scan over that window then sets up last_seen[] exactly as the serial scan
+ * would have it, and the chunk is scanned from there. The extra work is the
+ * length of the boundary window, which is short unless the input has long
+ * runs with few unique bytes.
+ * -----------------------------------------------------------------------------
+ */
+typedef struct kuniq_chunk
+{
+    const unsigned char *buf;
+    size_t      from;           // Chunk is buf[from .. to)
+    size_t      to;
+    uint32      k;
+    size_t      best_start;     // Results for windows ending in this chunk
+    size_t      best_len;
+} KUNIQ_CHUNK;
+
+// Start of the serial scan's window that ends at buf[end - 1].
+static size_t
+kuniq_window_start(const unsigned char *buf, size_t end, uint32 k)
+{
+    unsigned char seen[256] = { 0 };
+    uint32 nunique = 0;
+    size_t start = end;
+    while (start > 0) {
+        unsigned char ch = buf[start - 1];
+        if (!seen[ch]) {
+            if (nunique == k) {
+                break;
             }
-        } else {
-            update_curr_char_in_unique_k(sp, curr, unique_k, found_k);
+            seen[ch] = 1;
+            nunique++;
         }
-        curr++;
+        start--;
     }
+    return start;
+}
 
-    return (char *) NULL;
+static void *
+kuniq_scan_chunk(void *arg)
+{
+    KUNIQ_CHUNK *chunk = (KUNIQ_CHUNK *) arg;
+    KUNIQ_SCAN   scan;
+
+    kuniq_scan_init(&scan, chunk->k);
+    if (chunk->from) {
+        // Replay the boundary window, which has <= k unique bytes, so the
+        // scan's start stays put; discard its candidates.
+        scan.start = kuniq_window_start(chunk->buf, chunk->from, chunk->k);
+        kuniq_scan_bytes(&scan, chunk->buf, scan.start, chunk->from);
+        scan.best_start = 0;
+        scan.best_len   = 0;
+    }
+    kuniq_scan_bytes(&scan, chunk->buf, chunk->from, chunk->to);
+    chunk->best_start = scan.best_start;
+    chunk->best_len   = scan.best_len;
+    return NULL;
 }
 
 /*
- * char_in_unique_k_set(): Is the newly found character 'ch' already in the current
- * set of up-to-k-unique chars found so far?
+ * Same result as longest_substr_k_buf(), scanning 'nthreads' chunks of the
+ * buffer concurrently.
  */
-bool
-char_in_unique_k_set(const char *sp, char ch, int *unique_k, int found_k)
+const unsigned char *
+longest_substr_k_parallel(const unsigned char *buf, size_t len, uint32 k,
+                          int nthreads, size_t *substr_len)
 {
-    if (!found_k || !unique_k) {
-        return FALSE;
+    if (substr_len) {
+        *substr_len = 0;
+    }
+    if (!buf || (k == 0) || (k > len) || (k > 256)) {
+        return NULL;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if ((size_t) nthreads > len) {
+        nthreads = (int) len;
     }
-    for (int ictr = 0 ; ictr < found_k; ictr++) {
-        if (*(sp + unique_k[ictr]) == ch) {
-            return TRUE;
+
+    KUNIQ_CHUNK chunks[nthreads];
+    pthread_t   threads[nthreads];
+    size_t      chunk_size = (len / nthreads);
+    for (int tctr = 0; tctr < nthreads; tctr++) {
+        chunks[tctr].buf  = buf;
+        chunks[tctr].from = (tctr * chunk_size);
+        chunks[tctr].to   = ((tctr == (nthreads - 1)) ? len : ((tctr + 1) * chunk_size));
+        chunks[tctr].k    = k;
+    }
+    // 1st chunk is scanned by this thread.
+    for (int tctr = 1; tctr < nthreads; tctr++) {
+        int rv = pthread_create(&threads[tctr], NULL, kuniq_scan_chunk, &chunks[tctr]);
+        assert(rv == 0);
+        (void) rv;
+    }
+    kuniq_scan_chunk(&chunks[0]);
+
+    size_t best_start = 0;
+    size_t best_len   = 0;
+    for (int tctr = 0; tctr < nthreads; tctr++) {
+        if (tctr) {
+            pthread_join(threads[tctr], NULL);
+        }
+        // Chunks are in order, so strictly-longer keeps the 1st on ties.
+        if (chunks[tctr].best_len > best_len) {
+            best_len   = chunks[tctr].best_len;
+            best_start = chunks[tctr].best_start;
         }
     }
-    return FALSE;
+    if (best_len == 0) {
+        return NULL;
+    }
+    if (substr_len) {
+        *substr_len = best_len;
+    }
+    return (buf + best_start);
 }
 
 /*
- * update_curr_char_in_unique_k():
- *
- * Search has previously found current-character to "be in the set of unique-k"
- * characters. Replace that character's previously-found-index to the index of the
- * current character. Shuffle this set of indexes so that they are always in
- * increasing order. In other words, the most-recently-found char in this unique-set
- * will always appear "last" in this set, which is tracking the char's index.
+ * scan_file(): mmap() a file, and find its longest sub-string with k unique
+ * bytes, serially and in parallel. Report both results, which must match, and
+ * the throughput of each, in GB/s.
  */
-void
-update_curr_char_in_unique_k(const char *sp, char *ch, int *unique_k, int found_k)
+int
+scan_file(const char *path, uint32 k, int nthreads)
 {
-    int cctr = 0;
-    while (sp[unique_k[cctr]] != *ch) {
-        cctr++;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+    size_t len = st.st_size;
+    if (len == 0) {
+        printf("%s: Empty file.\n", path);
+        close(fd);
+        return 1;
     }
+    const unsigned char *buf = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+    madvise((void *) buf, len, MADV_SEQUENTIAL);
+
+    double start = now_secs();
+    size_t par_len = 0;
+    const unsigned char *par = longest_substr_k_parallel(buf, len, k, nthreads, &par_len);
+    double par_secs = (now_secs() - start);
+
+    start = now_secs();
+    size_t ser_len = 0;
+    const unsigned char *ser = longest_substr_k_buf(buf, len, k, &ser_len);
+    double ser_secs = (now_secs() - start);
 
-    // 'ch' is the most-recently-seen character, So shuffle all previously-seen
-    // characters' indexes up, and move this char to the end of the unique set.
-    while (cctr < (found_k - 1)) {
-        unique_k[cctr] = unique_k[cctr + 1];
+    int rv = 0;
+    if ((par != ser) || (par_len != ser_len)) {
+        printf("Error: Parallel result (offset=%zd, len=%zu) != serial result"
+               " (offset=%zd, len=%zu)\n",
+               (par ? (par - buf) : -1), par_len,
+               (ser ? (ser - buf) : -1), ser_len);
+        rv = 1;
+    }
+    if (ser) {
+        printf("%s: k=%u, longest sub-string at offset=%zu, len=%zu\n",
+               path, k, (size_t) (ser - buf), ser_len);
+    } else {
+        printf("%s: k=%u, no sub-string with k unique bytes\n", path, k);
     }
+    printf("%zu bytes: serial=%.3f GB/s, parallel (%d threads)=%.3f GB/s\n",
+           len, (len / (ser_secs ? ser_secs : 1e-9) / 1e9),
+           nthreads, (len / (par_secs ? par_secs : 1e-9) / 1e9));
 
-    // Stash-away the index for the most-recently-instance of this unique char
-    unique_k[cctr] = (ch - sp);
+    munmap((void *) buf, len);
+    return rv;
 }
 
-void
-replace_curr_char_in_unique_k(const char *sp, char *ch, int *unique_k, int found_k)
+// Wall-clock time, in seconds.
+double
+now_secs(void)
 {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + (ts.tv_nsec / 1e9));
 }
 
 // -----------------------------------------------------------------------------
@@ -205,7 +481,9 @@ int
 main(int argc, char *argv[])
 {
     const char *hello_msg = "Hello World";
-    printf("%s: %s. (argc=%d)\n", argv[0], hello_msg, argc);
+    // To stderr when benchmarking, so stdout holds only the results.
+    fprintf((BENCH_ARGV(argc, argv) ? stderr : stdout), "%s: %s. (argc=%d)\n",
+            argv[0], hello_msg, argc);
 
     int rv = 0;
     // Run all test cases if no args are provided.
@@ -216,6 +494,17 @@ main(int argc, char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         printf(Usage, argv[0]);
         return rv;
+    } else if (strcmp("--file", argv[1]) == 0) {
+        if (argc < 4) {
+            printf(Usage, argv[0]);
+            return 1;
+        }
+        int nthreads = ((argc > 4) ? atoi(argv[4])
+                                   : (int) sysconf(_SC_NPROCESSORS_ONLN));
+        rv = scan_file(argv[2], (uint32) atoi(argv[3]), nthreads);
+    } else if (BENCH_ARGV(argc, argv)) {
+        rv = bench_main(Bench_fns, ARRAYSIZE(Bench_fns), (argc - 1),
+                        (const char **) &argv[1]);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
 
         // Execute the named test-function, if it's a supported test-function
@@ -296,3 +585,284 @@ test_nchars_in_alphabet()
     assert(NUM_CHARS_IN_ALPHABET == (26 + 26 + 10));
     TEST_END();
 }
+
+void
+test_k_eq_1()
+{
+    TEST_START();
+
+    uint32 len = 0;
+    const char *s = "abbbcc";
+    char *rv = longest_substr_k(s, 1, &len);
+    assert(rv == (s + 1));
+    assert(len == 3);
+
+    s = "a";
+    rv = longest_substr_k(s, 1, &len);
+    assert((rv == s) && (len == 1));
+    TEST_END();
+}
+
+void
+test_basic_substrings()
+{
+    TEST_START();
+
+    uint32 len = 0;
+    const char *s = "aabbcc";
+    char *rv = longest_substr_k(s, 2, &len);
+    assert((rv == s) && (len == 4));
+
+    rv = longest_substr_k(s, 3, &len);
+    assert((rv == s) && (len == 6));
+
+    s = "eceba";
+    rv = longest_substr_k(s, 2, &len);
+    assert((rv == s) && (len == 3));
+
+    s = "abcadcacacaca";
+    rv = longest_substr_k(s, 3, &len);
+    assert((rv == (s + 2)) && (len == 11));
+
+    // Substring length is optional
+    rv = longest_substr_k(s, 2, (uint32 *) NULL);
+    assert(rv == (s + 5));
+    TEST_END();
+}
+
+void
+test_fewer_than_k_unique()
+{
+    TEST_START();
+
+    uint32 len = 42;
+    const char *s = "aaaa";
+    char *rv = longest_substr_k(s, 2, &len);
+    assert((rv == NULL) && (len == 0));
+
+    rv = longest_substr_k("", 1, &len);
+    assert(rv == NULL);
+    TEST_END();
+}
+
+// Buffers may have any byte, including NULs and bytes >= 0x80.
+void
+test_binary_buffer()
+{
+    TEST_START();
+
+    const unsigned char buf[] = { 0xff, 0, 0, 0xff, 0x80, 0, 0x80, 0x80, 7 };
+    size_t len = 0;
+    const unsigned char *rv = longest_substr_k_buf(buf, sizeof(buf), 2, &len);
+    assert((rv == (buf + 0)) && (len == 4));
+
+    rv = longest_substr_k_buf(buf, sizeof(buf), 3, &len);
+    assert((rv == buf) && (len == 8));
+
+    // All 256 distinct bytes
+    unsigned char all[512];
+    for (int i = 0; i < ARRAYSIZE(all); i++) {
+        all[i] = (unsigned char) i;
+    }
+    rv = longest_substr_k_buf(all, sizeof(all), 256, &len);
+    assert((rv == all) && (len == sizeof(all)));
+    rv = longest_substr_k_buf(all, sizeof(all), 255, &len);
+    assert((rv == all) && (len == 255));
+    assert(longest_substr_k_buf(all, sizeof(all), 257, &len) == NULL);
+    TEST_END();
+}
+
+/*
+ * Reference O(n^2) implementation: For each start, extend the sub-string
+ * till it has more than k unique bytes.
+ */
+static const unsigned char *
+longest_substr_k_brute_force(const unsigned char *buf, size_t len, uint32 k,
+                             size_t *substr_len)
+{
+    const unsigned char *best = NULL;
+    *substr_len = 0;
+    for (size_t start = 0; start < len; start++) {
+        int    seen[256] = { 0 };
+        uint32 nunique = 0;
+        for (size_t end = start; end < len; end++) {
+            if (!seen[buf[end]]++) {
+                nunique++;
+            }
+            if (nunique > k) {
+                break;
+            }
+            if ((nunique == k) && ((end - start + 1) > *substr_len)) {
+                *substr_len = (end - start + 1);
+                best = (buf + start);
+            }
+        }
+    }
+    return best;
+}
+
+void
+test_vs_brute_force()
+{
+    TEST_START();
+
+    unsigned char buf[300];
+    srand(16);
+    for (int iter = 0; iter < 2000; iter++) {
+        size_t len = (rand() % ARRAYSIZE(buf));
+        int nalpha = (1 + (rand() % 8));
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = ('a' + (rand() % nalpha));
+        }
+        for (uint32 k = 1; k <= 9; k++) {
+            size_t exp_len = 0;
+            size_t len_found = 0;
+            const unsigned char *exp = longest_substr_k_brute_force(buf, len, k, &exp_len);
+            const unsigned char *rv  = longest_substr_k_buf(buf, len, k, &len_found);
+            assert(rv == exp);
+            assert(len_found == exp_len);
+        }
+    }
+    TEST_END();
+}
+
+// Scan a multi-MB "log line", and report the throughput.
+void
+test_large_buffer()
+{
+    TEST_START();
+
+    const size_t len = (16 * 1024 * 1024);
+    unsigned char *buf = malloc(len);
+    assert(buf);
+    srand(17);
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = ('a' + (rand() % 26));
+    }
+    // Plant a long run of 3 unique chars in the middle.
+    const size_t run_start = (len / 2);
+    const size_t run_len = 100000;
+    for (size_t i = 0; i < run_len; i++) {
+        buf[run_start + i] = ("xyz")[i % 3];
+    }
+
+    double start = now_secs();
+    size_t len_found = 0;
+    const unsigned char *rv = longest_substr_k_buf(buf, len, 3, &len_found);
+    double secs = (now_secs() - start);
+
+    // The run may extend by a few bytes, if its neighbours are x, y or z.
+    assert((rv <= (buf + run_start)) && (rv > (buf + run_start - 10)));
+    assert((len_found >= run_len) && (len_found < (run_len + 20)));
+    printf("%zu MB, %.1f MB/s", (len >> 20), ((len >> 20) / (secs ? secs : 1e-9)));
+    free(buf);
+    TEST_END();
+}
+
+/*
+ * Parallel results must match serial ones exactly, for any # of chunks,
+ * including chunks shorter than the windows that straddle them, and ties.
+ */
+void
+test_parallel_vs_serial()
+{
+    TEST_START();
+
+    unsigned char buf[1000];
+    srand(17);
+    for (int iter = 0; iter < 300; iter++) {
+        size_t len = (1 + (rand() % ARRAYSIZE(buf)));
+        int nalpha = (1 + (rand() % 6));
+        int runlen = (1 + (rand() % 50));   // Long runs of few bytes
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = ('a' + (((i / runlen) + (rand() % nalpha)) % 26));
+        }
+        for (uint32 k = 1; k <= 7; k++) {
+            size_t exp_len = 0;
+            const unsigned char *exp = longest_substr_k_buf(buf, len, k, &exp_len);
+            for (int nthreads = 1; nthreads <= 9; nthreads += 2) {
+                size_t len_found = 0;
+                const unsigned char *rv = longest_substr_k_parallel(buf, len, k,
+                                                                    nthreads, &len_found);
+                assert(rv == exp);
+                assert(len_found == exp_len);
+            }
+        }
+    }
+
+    // Many equal-length candidates, across chunks: 1st one must win.
+    const char *s = "abababcdcdcdefefef";
+    size_t len_found = 0;
+    const unsigned char *rv = longest_substr_k_parallel((const unsigned char *) s,
+                                                        strlen(s), 2, 5, &len_found);
+    assert((rv == (const unsigned char *) s) && (len_found == 6));
+    TEST_END();
+}
+
+// Parallel scan of a 64 MB buffer, via a temp-file and scan_file().
+void
+test_parallel_large_buffer()
+{
+    TEST_START();
+
+    const size_t len = (64 * 1024 * 1024);
+    unsigned char *buf = malloc(len);
+    assert(buf);
+    srand(18);
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = ('a' + (rand() % 26));
+    }
+    const size_t run_start = ((len / 4) - 500);     // Straddles 1st chunk
+    const size_t run_len = 100000;
+    for (size_t i = 0; i < run_len; i++) {
+        buf[run_start + i] = ("xyz")[i % 3];
+    }
+
+    char path[] = "/tmp/ch1.unique-k-substrings.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    ssize_t nwritten = write(fd, buf, len);
+    assert(nwritten == (ssize_t) len);
+    (void) nwritten;
+    close(fd);
+
+    printf("\n");
+    int rv = scan_file(path, 3, 4);
+    assert(rv == 0);
+    (void) rv;
+
+    unlink(path);
+    free(buf);
+    TEST_END();
+}
+
+// **** Benchmarks ****
+
+#define BENCH_KUNIQ_BUF_SIZE    (1024 * 1024)
+
+/*
+ * One op is one byte of the serial k-unique scan, k = 3, over a 1 MB buffer
+ * of random lower-case letters; so the result is ns / byte. The windows of 3
+ * unique bytes are short, so the scan shrinks its window, the slow path,
+ * every few bytes.
+ */
+void
+bench_kuniq_scan(uint64_t nops)
+{
+    static unsigned char *buf = NULL;
+    if (!buf) {
+        buf = malloc(BENCH_KUNIQ_BUF_SIZE);
+        assert(buf);
+        srand(17);
+        for (size_t i = 0; i < BENCH_KUNIQ_BUF_SIZE; i++) {
+            buf[i] = ('a' + (rand() % 26));
+        }
+    }
+    while (nops > 0) {
+        size_t len = ((nops < BENCH_KUNIQ_BUF_SIZE) ? nops : BENCH_KUNIQ_BUF_SIZE);
+        size_t len_found = 0;
+        BENCH_KEEP(longest_substr_k_buf(buf, len, 3, &len_found));
+        BENCH_KEEP(len_found);
+        nops -= len;
+    }
+}
@@ -4,6 +4,9 @@
  * Detect a loop in a singly linked-list (caused by list corruption)
  *
  * Ref: Chap 2, Linked Lists. Prob 2.8
+ *      R. P. Brent, "An improved Monte Carlo factorization algorithm", 1980
+ *
+ * Usage: g++ -std=c++17 -O2 -pthread -o ch2.ll.detect-loop ch2.ll.detect-loop.cpp
  *
  * History:
  *  Feb-2024    Started
@@ -11,29 +14,22 @@
 
 #include <iostream>
 #include <set>
-#include <random>
-
-using namespace std;
-
-const int One_M     = (1000 * 1000);
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 
-// ----------------------------------------------------------------------------
-// Random-generator class.
-// Ref: Stroustrup's C++ book, 2nd Ed., Sec. 14.5, Pgs. 191.
-// ----------------------------------------------------------------------------
-class Rand_int
-{
-  public:
-    Rand_int(int low, int high): dist{low, high} { }
+#if __linux__
+#include <cassert>
+#endif // __linux__
 
-    int operator()() { return dist(rand_gen); }
+#include "ch2.ll.node-pool.h"
+#include "../Tools/rand_gen.h"     // Rand_int, Xoshiro256ss
 
-    void seed(int s) { rand_gen.seed(s); }
+using namespace std;
 
-  private:
-    default_random_engine rand_gen;
-    uniform_int_distribution<> dist;
-};
+const int One_M     = (1000 * 1000);
 
 // ----------------------------------------------------------------------------
 // Definition of node in a singly-linked list
@@ -68,6 +64,17 @@ class Node
 
 };
 
+// ----------------------------------------------------------------------------
+// Description of a loop found in a list: The node where the loop starts, the
+// # of nodes before it (mu), and the # of nodes in the loop (lambda).
+// ----------------------------------------------------------------------------
+typedef struct loop_info
+{
+    Node *  start;      // NULL if there is no loop
+    size_t  mu;
+    size_t  length;
+} LOOP_INFO;
+
 // ----------------------------------------------------------------------------
 // Definition of a singly linked-list class
 // ----------------------------------------------------------------------------
@@ -79,6 +86,10 @@ class LinkedList
     // Default constructor
     LinkedList() { head = NULL; }
 
+    // Nodes are owned by the list's pool; the list cannot be copied.
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
     // Append new item to the end of the list.
     Node * appendToTail(const int d);
 
@@ -89,27 +100,45 @@ class LinkedList
     // node to which some other node is pointing to, causing the loop
     Node * findLoop();
 
+    // Find a loop with Brent's algorithm, in O(1) memory. Returns the node
+    // where the loop starts, as findLoop() does, and describes it in 'info'.
+    Node * findLoopBrent(LOOP_INFO *info);
+
+    // # of items appended to list. Counted only on appends: A loop, made by
+    // poking a next-pointer, does not change it.
+    int capacity() { return nitems; }
+
     // Print the linked list.
     void printList();
+
+  private:
+    Node *          tail = NULL;    // Last node; appends are O(1)
+    int             nitems = 0;
+    NodePool<Node>  pool;           // Nodes of this list; freed with the list
+
+    // appendRandomToTail()'s values: One buffered stream, for all appends.
+    // Include -ve #s also in random range.
+    Rand_int        rnd{-One_M, One_M};
 };
 
 // ----------------------------------------------------
 Node *
 LinkedList::appendToTail(const int d) {
-    Node *newNode = new Node(d);
-    Node **nextp = &this->head;
+    Node *newNode = pool.alloc(d);
 
-    while (*nextp) {
-        nextp = &((*nextp)->next);
+    if (this->tail) {
+        this->tail->next = newNode;
+    } else {
+        this->head = newNode;
     }
-    *nextp = newNode;
+    this->tail = newNode;
+    nitems++;
     return newNode;
 }
 
 // ----------------------------------------------------
 Node *
 LinkedList::appendRandomToTail() {
-    Rand_int rnd{-One_M, One_M};    // Include -ve #s also in random range
     return appendToTail(rnd());
 }
 
@@ -145,6 +174,68 @@ LinkedList::findLoop() {
     return rnode;
 }
 
+// ----------------------------------------------------
+/*
+ * Brent's algorithm to detect a loop in a singly linked-list:
+ *
+ * The 'hare' walks ahead one node at a time; the 'tortoise' teleports to the
+ * hare's node whenever the # of steps since its last move reaches a power
+ * of 2. Once the loop is entered and the power of 2 exceeds the loop length,
+ * the hare meets the tortoise, after exactly 'lambda' steps. Unlike Floyd's
+ * algorithm, the tortoise never walks, so each step is one pointer move.
+ *
+ * The loop start is then found by starting two pointers, lambda nodes apart,
+ * from the head, and walking them in step till they meet; that takes mu steps.
+ */
+static void
+brentFindLoop(Node *head, LOOP_INFO *info)
+{
+    info->start  = NULL;
+    info->mu     = 0;
+    info->length = 0;
+    if (head == NULL) {
+        return;
+    }
+
+    size_t power  = 1;
+    size_t lambda = 1;
+    Node  *tortoise = head;
+    Node  *hare     = head->next;
+    while (hare != tortoise) {
+        if (hare == NULL) {
+            return;
+        }
+        if (power == lambda) {
+            tortoise = hare;
+            power *= 2;
+            lambda = 0;
+        }
+        hare = hare->next;
+        lambda++;
+    }
+
+    tortoise = hare = head;
+    for (size_t i = 0; i < lambda; i++) {
+        hare = hare->next;
+    }
+    size_t mu = 0;
+    while (tortoise != hare) {
+        tortoise = tortoise->next;
+        hare = hare->next;
+        mu++;
+    }
+    info->start  = hare;
+    info->mu     = mu;
+    info->length = lambda;
+}
+
+// ----------------------------------------------------
+Node *
+LinkedList::findLoopBrent(LOOP_INFO *info) {
+    brentFindLoop(this->head, info);
+    return info->start;
+}
+
 // ----------------------------------------------------
 void
 LinkedList::printList() {
@@ -164,6 +255,183 @@ LinkedList::printList() {
     }
 }
 
+// ----------------------------------------------------------------------------
+// Batch loop detection: Check many lists, given their head nodes, for loops,
+// on a pool of worker threads.
+//
+// Each list's walk is a chain of dependent loads, mostly cache-misses for
+// large lists, so a single walk leaves the core idle. Each thread runs
+// Batch_interleave walks at once, round-robin, one step per walk per round,
+// and prefetches the node each walk will load next. With several misses in
+// flight, their latencies overlap.
+// ----------------------------------------------------------------------------
+const int    Batch_interleave = 8;
+const size_t Batch_chunk_lists = 64;       // # of lists a worker claims at once
+
+// State of one Brent walk, as steps of the serial brentFindLoop()'s loops.
+typedef struct brent_walk
+{
+    size_t      listidx;
+    Node       *head;
+    Node       *tortoise;
+    Node       *hare;
+    size_t      power;
+    size_t      lambda;
+    size_t      nsteps;     // Advancing hare: # of steps left, of lambda
+    size_t      mu;
+    int         phase;      // See enum below
+} BRENT_WALK;
+
+enum { BRENT_FIND_LAMBDA, BRENT_ADVANCE_HARE, BRENT_FIND_MU, BRENT_DONE };
+
+// Start a walk of list at 'head'; may be done right away, for short lists.
+static void
+brentWalkStart(BRENT_WALK *walk, size_t listidx, Node *head, LOOP_INFO *info)
+{
+    walk->listidx = listidx;
+    walk->head    = head;
+    walk->phase   = BRENT_DONE;
+    info->start   = NULL;
+    info->mu      = 0;
+    info->length  = 0;
+    if ((head == NULL) || (head->next == NULL)) {
+        return;
+    }
+    walk->power    = 1;
+    walk->lambda   = 1;
+    walk->tortoise = head;
+    walk->hare     = head->next;
+    walk->phase    = BRENT_FIND_LAMBDA;
+    __builtin_prefetch(walk->hare);
+}
+
+// Advance a walk by one step; on finding a loop, fill in 'info'.
+static inline void
+brentWalkStep(BRENT_WALK *walk, LOOP_INFO *info)
+{
+    switch (walk->phase) {
+      case BRENT_FIND_LAMBDA:
+        if (walk->hare == walk->tortoise) {
+            walk->tortoise = walk->hare = walk->head;
+            walk->nsteps = walk->lambda;
+            walk->phase = BRENT_ADVANCE_HARE;
+            return;
+        }
+        if (walk->power == walk->lambda) {
+            walk->tortoise = walk->hare;
+            walk->power *= 2;
+            walk->lambda = 0;
+        }
+        walk->hare = walk->hare->next;
+        walk->lambda++;
+        if (walk->hare == NULL) {
+            walk->phase = BRENT_DONE;
+            return;
+        }
+        __builtin_prefetch(walk->hare);
+        return;
+
+      case BRENT_ADVANCE_HARE:
+        walk->hare = walk->hare->next;
+        __builtin_prefetch(walk->hare);
+        if (--walk->nsteps == 0) {
+            walk->mu = 0;
+            walk->phase = BRENT_FIND_MU;
+        }
+        return;
+
+      case BRENT_FIND_MU:
+        if (walk->tortoise == walk->hare) {
+            info->start  = walk->hare;
+            info->mu     = walk->mu;
+            info->length = walk->lambda;
+            walk->phase  = BRENT_DONE;
+            return;
+        }
+        walk->tortoise = walk->tortoise->next;
+        walk->hare = walk->hare->next;
+        __builtin_prefetch(walk->tortoise);
+        __builtin_prefetch(walk->hare);
+        walk->mu++;
+        return;
+
+      default:
+        return;
+    }
+}
+
+// Worker: Claim chunks of lists, keeping up to 'ninterleave' walks going.
+static void
+findLoopsWorker(const vector<Node *>& heads, vector<LOOP_INFO>& results,
+                atomic<size_t>& next_list, int ninterleave)
+{
+    vector<BRENT_WALK> walks(ninterleave);
+    int    nactive = 0;
+    size_t chunk_next = 0;
+    size_t chunk_end = 0;
+
+    while (true) {
+        // Refill idle walks with lists from this worker's chunk.
+        while (nactive < ninterleave) {
+            if (chunk_next == chunk_end) {
+                chunk_next = next_list.fetch_add(Batch_chunk_lists);
+                chunk_end = min((chunk_next + Batch_chunk_lists), heads.size());
+                if (chunk_next >= chunk_end) {
+                    chunk_next = chunk_end;
+                    break;
+                }
+            }
+            size_t listidx = chunk_next++;
+            BRENT_WALK *walk = &walks[nactive];
+            brentWalkStart(walk, listidx, heads[listidx], &results[listidx]);
+            if (walk->phase != BRENT_DONE) {
+                nactive++;
+            }
+        }
+        if (nactive == 0) {
+            return;
+        }
+
+        // One step of each walk; move finished walks out of the active set.
+        for (int w = 0; w < nactive; ) {
+            BRENT_WALK *walk = &walks[w];
+            brentWalkStep(walk, &results[walk->listidx]);
+            if (walk->phase == BRENT_DONE) {
+                walks[w] = walks[--nactive];
+            } else {
+                w++;
+            }
+        }
+    }
+}
+
+/*
+ * findLoopsBatch(): Check each list, given by its head node, for a loop;
+ * results[i] describes the loop, if any, in list 'heads[i]'. Lists must not
+ * be modified while they are being checked.
+ */
+void
+findLoopsBatch(const vector<Node *>& heads, vector<LOOP_INFO>& results,
+               unsigned nthreads = thread::hardware_concurrency(),
+               int ninterleave = Batch_interleave)
+{
+    results.resize(heads.size());
+    nthreads = max(1U, min(nthreads,
+                           (unsigned) ((heads.size() / Batch_chunk_lists) + 1)));
+    ninterleave = max(1, ninterleave);
+
+    atomic<size_t> next_list{0};
+    vector<thread> workers;
+    for (unsigned t = 1; t < nthreads; t++) {
+        workers.emplace_back(findLoopsWorker, cref(heads), ref(results),
+                             ref(next_list), ninterleave);
+    }
+    findLoopsWorker(heads, results, next_list, ninterleave);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
 // Function prototypes
 
 void test_print_empty_list(void);
@@ -174,6 +442,10 @@ void test_findLoop_1node_corrupted(void);
 void test_findLoop_2nodes(void);
 void test_findLoop_2nodes_corrupted_n2(void);
 void test_findLoop_2nodes_corrupted_n2_points_to_n1(void);
+void test_findLoop_One_M_nodes_corrupted(void);
+void test_findLoopBrent_small_lists(void);
+void test_findLoopBrent_One_M_nodes_corrupted(void);
+void test_findLoopsBatch(const int nlists, const int max_nodes);
 
 /*
  * main() and test cases begin here ...
@@ -191,6 +463,13 @@ main(int argc, char *argv[])
     test_findLoop_2nodes();
     test_findLoop_2nodes_corrupted_n2();
     test_findLoop_2nodes_corrupted_n2_points_to_n1();
+    test_findLoop_One_M_nodes_corrupted();
+
+    test_findLoopBrent_small_lists();
+    test_findLoopBrent_One_M_nodes_corrupted();
+    test_findLoopsBatch(0, 0);
+    test_findLoopsBatch(100, 10);
+    test_findLoopsBatch(4000, 5000);
 }
 
 void
@@ -296,3 +575,146 @@ test_findLoop_2nodes_corrupted_n2_points_to_n1(void)
     assert(loopNode == n1);
     cout << " ... OK" << endl;
 }
+
+void
+test_findLoop_One_M_nodes_corrupted(void)
+{
+    cout << __func__;
+    LinkedList list;
+    Node *midNode = NULL;
+    Node *lastNode = NULL;
+    for (auto ictr = 0; ictr < One_M; ictr++) {
+        lastNode = list.appendToTail(ictr);
+        if (ictr == (One_M / 2)) {
+            midNode = lastNode;
+        }
+    }
+    assert(list.capacity() == One_M);
+    assert(list.findLoop() == NULL);
+
+    // cause loop corruption: last node points back to middle node.
+    lastNode->next = midNode;
+    assert(list.findLoop() == midNode);
+    cout << " ... OK" << endl;
+}
+
+// Lists of 0 to 40 nodes, with the last node pointing back to every possible
+// node, and with no loop, should agree with findLoop().
+void
+test_findLoopBrent_small_lists(void)
+{
+    cout << __func__;
+    for (int nnodes = 0; nnodes <= 40; nnodes++) {
+        for (int loopto = -1; loopto < nnodes; loopto++) {
+            LinkedList list;
+            vector<Node *> nodes;
+            for (auto ictr = 0; ictr < nnodes; ictr++) {
+                nodes.push_back(list.appendToTail(ictr));
+            }
+            if (loopto >= 0) {
+                nodes.back()->next = nodes[loopto];
+            }
+
+            LOOP_INFO info;
+            Node *loopNode = list.findLoopBrent(&info);
+            assert(loopNode == list.findLoop());
+            if (loopto < 0) {
+                assert((loopNode == NULL) && (info.length == 0));
+            } else {
+                assert(loopNode == nodes[loopto]);
+                assert(info.mu == (size_t) loopto);
+                assert(info.length == (size_t) (nnodes - loopto));
+            }
+        }
+    }
+    cout << " ... OK" << endl;
+}
+
+void
+test_findLoopBrent_One_M_nodes_corrupted(void)
+{
+    cout << __func__;
+    LinkedList list;
+    Node *midNode = NULL;
+    Node *lastNode = NULL;
+    for (auto ictr = 0; ictr < One_M; ictr++) {
+        lastNode = list.appendToTail(ictr);
+        if (ictr == (One_M / 3)) {
+            midNode = lastNode;
+        }
+    }
+    LOOP_INFO info;
+    assert(list.findLoopBrent(&info) == NULL);
+
+    // cause loop corruption: last node points back to a node 1/3rd way in.
+    lastNode->next = midNode;
+    assert(list.findLoopBrent(&info) == midNode);
+    assert(info.mu == (size_t) (One_M / 3));
+    assert(info.length == (size_t) (One_M - (One_M / 3)));
+    cout << " ... OK" << endl;
+}
+
+/*
+ * Build 'nlists' lists of random lengths up to max_nodes, about half with a
+ * loop back to a random node. Like other tests, this pokes next-pointers
+ * directly, so the lists' tails are stale after this. Verify batch results
+ * against serial Brent, and report the time for each.
+ */
+void
+test_findLoopsBatch(const int nlists, const int max_nodes)
+{
+    cout << __func__ << ": nlists=" << nlists << ", max_nodes=" << max_nodes;
+
+    Rand_int rnd{0, max(max_nodes, 1)};
+    vector<LinkedList> lists(nlists);
+    vector<Node *> heads;
+    for (auto& list : lists) {
+        int nnodes = (rnd() % (max_nodes + 1));
+        vector<Node *> nodes;
+        for (auto ictr = 0; ictr < nnodes; ictr++) {
+            nodes.push_back(list.appendToTail(ictr));
+        }
+
+        // Re-link nodes in random order, as in a list aged by inserts and
+        // deletes, so walks are not helped by nodes being adjacent.
+        shuffle(nodes.begin(), nodes.end(), Xoshiro256ss(nnodes));
+        for (auto ictr = 0; ictr < nnodes; ictr++) {
+            nodes[ictr]->next = (((ictr + 1) < nnodes)
+                                    ? nodes[ictr + 1] : (Node *) NULL);
+        }
+        list.head = (nnodes ? nodes[0] : (Node *) NULL);
+        if (nnodes && (rnd() % 2)) {
+            nodes.back()->next = nodes[rnd() % nnodes];
+        }
+        heads.push_back(list.head);
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<LOOP_INFO> expected(nlists);
+    for (auto i = 0; i < nlists; i++) {
+        lists[i].findLoopBrent(&expected[i]);
+    }
+    auto serial_us = chrono::duration_cast<chrono::microseconds>(
+                        chrono::steady_clock::now() - start).count();
+
+    for (unsigned nthreads : { 1U, 4U, thread::hardware_concurrency() }) {
+        vector<LOOP_INFO> results;
+        start = chrono::steady_clock::now();
+        findLoopsBatch(heads, results, nthreads);
+        auto batch_us = chrono::duration_cast<chrono::microseconds>(
+                            chrono::steady_clock::now() - start).count();
+
+        assert(results.size() == (size_t) nlists);
+        for (auto i = 0; i < nlists; i++) {
+            assert(results[i].start  == expected[i].start);
+            assert(results[i].mu     == expected[i].mu);
+            assert(results[i].length == expected[i].length);
+        }
+        if (nlists >= 1000) {
+            cout << endl << "  nthreads=" << nthreads
+                 << ": serial=" << serial_us << " us"
+                 << ", batch=" << batch_us << " us";
+        }
+    }
+    cout << " ... OK" << endl;
+}
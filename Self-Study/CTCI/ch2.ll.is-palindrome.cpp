@@ -10,29 +10,18 @@
  */
 
 #include <iostream>
-#include <random>
+#include <set>
 
-using namespace std;
-
-const int One_M     = (1000 * 1000);
-
-// ----------------------------------------------------------------------------
-// Random-generator class.
-// Ref: Stroustrup's C++ book, 2nd Ed., Sec. 14.5, Pgs. 191.
-// ----------------------------------------------------------------------------
-class Rand_int
-{
-  public:
-    Rand_int(int low, int high): dist{low, high} { }
+#if __linux__
+#include <cassert>
+#endif // __linux__
 
-    int operator()() { return dist(rand_gen); }
+#include "ch2.ll.node-pool.h"
+#include "../Tools/rand_gen.h"     // Rand_int
 
-    void seed(int s) { rand_gen.seed(s); }
+using namespace std;
 
-  private:
-    default_random_engine rand_gen;
-    uniform_int_distribution<> dist;
-};
+const int One_M     = (1000 * 1000);
 
 // ----------------------------------------------------------------------------
 // Definition of node in a singly-linked list
@@ -78,6 +67,10 @@ class LinkedList
     // Default constructor
     LinkedList() { head = NULL; }
 
+    // Nodes are owned by the list's pool; the list cannot be copied.
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
     // Append new item to the end of the list.
     Node * appendToTail(const int d);
 
@@ -87,6 +80,7 @@ class LinkedList
     // Is linked-list empty?
     bool isEmpty() { return (head == NULL); }
 
+    // # of items in list; only appends change it, as nothing is deleted.
     int capacity() { return nitems; }
 
     // Check if data in linked list is a palindrome.
@@ -95,23 +89,34 @@ class LinkedList
     // Check if data in linked list is a palindrome, without relying on 'nitems'.
     bool isPalindrome2();
 
+    // Check if data in linked list is a palindrome, using O(1) memory, by
+    // reversing the 2nd half of the list in-place.
+    bool isPalindromeInPlace();
+
     // Print the linked list.
     void printList();
 
   private:
-    int nitems = 0;
+    Node *          tail = NULL;    // Last node; appends are O(1)
+    int             nitems = 0;
+    NodePool<Node>  pool;           // Nodes of this list; freed with the list
+
+    // appendRandomToTail()'s values: One buffered stream, for all appends.
+    // Include -ve #s also in random range.
+    Rand_int        rnd{-One_M, One_M};
 };
 
 // ----------------------------------------------------
 Node *
 LinkedList::appendToTail(const int d) {
-    Node *newNode = new Node(d);
-    Node **nextp = &this->head;
+    Node *newNode = pool.alloc(d);
 
-    while (*nextp) {
-        nextp = &((*nextp)->next);
+    if (this->tail) {
+        this->tail->next = newNode;
+    } else {
+        this->head = newNode;
     }
-    *nextp = newNode;
+    this->tail = newNode;
     nitems++;
     return newNode;
 }
@@ -119,7 +124,6 @@ LinkedList::appendToTail(const int d) {
 // ----------------------------------------------------
 Node *
 LinkedList::appendRandomToTail() {
-    Rand_int rnd{-One_M, One_M};    // Include -ve #s also in random range
     return appendToTail(rnd());
 }
 
@@ -249,6 +253,65 @@ LinkedList::isPalindrome2() {
     return rv;
 }
 
+// ----------------------------------------------------
+// Reverse a chain of nodes, returning the new head of the chain.
+static Node *
+reverseChain(Node *nodep)
+{
+    Node *prevp = NULL;
+    while (nodep) {
+        Node *nextp = nodep->next;
+        nodep->next = prevp;
+        prevp = nodep;
+        nodep = nextp;
+    }
+    return prevp;
+}
+
+// ----------------------------------------------------
+/*
+ * Algorithm: Detect palindrome using a singly linked list, in O(1) memory.
+ *
+ * isPalindrome() and isPalindrome2() push the 1st half onto a stack, of
+ * (nitems / 2) ints, which overflows the thread's stack for large lists.
+ * Instead, reverse the 2nd half of the list, so it can be walked backwards.
+ *
+ *  - Find the middle of the list with the slow / fast pointer technique.
+ *    'slowp' stops at the last node of the 1st half; for odd # of items it's
+ *    the middle item, which need not be compared.
+ *  - Reverse the nodes after 'slowp', walk the 1st half and the reversed 2nd
+ *    half in step, comparing items.
+ *  - Reverse the 2nd half again, re-linking it after 'slowp', to restore the
+ *    list before returning.
+ */
+bool
+LinkedList::isPalindromeInPlace() {
+    if (this->isEmpty() || (this->head->next == NULL)) {
+        return true;
+    }
+    Node *slowp = this->head;
+    Node *fastp = this->head;
+    while (fastp->next && fastp->next->next) {
+        slowp = slowp->next;
+        fastp = fastp->next->next;
+    }
+
+    Node *revp = reverseChain(slowp->next);
+    bool rv = true;
+    Node *leftp  = this->head;
+    Node *rightp = revp;
+    while (rightp) {
+        if (leftp->data != rightp->data) {
+            rv = false;
+            break;
+        }
+        leftp  = leftp->next;
+        rightp = rightp->next;
+    }
+    slowp->next = reverseChain(revp);
+    return rv;
+}
+
 // ----------------------------------------------------
 void
 LinkedList::printList() {
@@ -292,6 +355,12 @@ void test_isPalindrome2_four_equal_items(void);
 void test_isPalindrome2_four_diff_items(void);
 void test_isPalindrome2_five_equal_items(void);
 void test_isPalindrome2_five_diff_items(void);
+void test_isPalindrome_One_M_items(void);
+
+// Re-test with in-place implementation of palindrome checks.
+void test_isPalindromeInPlace_small_lists(void);
+void test_isPalindromeInPlace_restores_list(void);
+void test_isPalindromeInPlace_large_list(const int nitems);
 
 /*
  * main() and test cases begin here ...
@@ -321,6 +390,15 @@ main(int argc, char *argv[])
     test_isPalindrome2_four_diff_items();
     test_isPalindrome2_five_equal_items();
     test_isPalindrome2_five_diff_items();
+
+    test_isPalindrome_One_M_items();
+
+    // Re-test with in-place implementation of palindrome checks.
+    test_isPalindromeInPlace_small_lists();
+    test_isPalindromeInPlace_restores_list();
+
+    // Large enough to overflow the stack for isPalindrome() / isPalindrome2()
+    test_isPalindromeInPlace_large_list(10 * One_M);
 }
 
 void
@@ -381,6 +459,13 @@ test_capacity_random5(void)
         list.appendRandomToTail();
     }
     assert(list.capacity() == nitems);
+
+    // Appends draw successive values of one stream, not the same value.
+    set<int> values;
+    for (Node *nodep = list.head; nodep; nodep = nodep->next) {
+        values.insert(nodep->data);
+    }
+    assert(values.size() > 1);
     cout << " ... OK" << endl;
 }
 
@@ -548,3 +633,83 @@ test_isPalindrome2_five_diff_items(void)
     assert(list.isPalindrome2() == false);
     cout << " ... OK" << endl;
 }
+
+void
+test_isPalindrome_One_M_items(void)
+{
+    cout << __func__;
+    LinkedList list;
+    const int nitems = One_M;
+    for (auto ictr = 0; ictr < nitems; ictr++) {
+        list.appendToTail(min(ictr, (nitems - 1 - ictr)));
+    }
+    assert(list.capacity() == nitems);
+    assert(list.isPalindrome());
+    assert(list.isPalindrome2());
+
+    // Break the palindrome with one item one past the middle.
+    list.appendToTail(-1);
+    assert(list.isPalindrome() == false);
+    assert(list.isPalindrome2() == false);
+    cout << " ... OK" << endl;
+}
+
+// Palindromes of 0 to 9 items, and the same lists with one item changed,
+// should agree with isPalindrome2().
+void
+test_isPalindromeInPlace_small_lists(void)
+{
+    cout << __func__;
+    for (int nitems = 0; nitems < 10; nitems++) {
+        for (int changed = -1; changed < nitems; changed++) {
+            LinkedList list;
+            for (auto ictr = 0; ictr < nitems; ictr++) {
+                int d = min(ictr, (nitems - 1 - ictr));
+                list.appendToTail((ictr == changed) ? (d + 100) : d);
+            }
+            bool expected = ((changed < 0) || ((nitems % 2) && (changed == (nitems / 2))));
+            assert(list.isPalindromeInPlace() == expected);
+            assert(list.isPalindromeInPlace() == list.isPalindrome2());
+        }
+    }
+    cout << " ... OK" << endl;
+}
+
+// After a check, with a match or a mismatch, the list should be unchanged.
+void
+test_isPalindromeInPlace_restores_list(void)
+{
+    cout << __func__;
+    LinkedList list;
+    const int vals[] = { 2, 42, 99, 7, 42, 2 };
+    for (auto v : vals) {
+        list.appendToTail(v);
+    }
+    assert(list.isPalindromeInPlace() == false);
+
+    int i = 0;
+    for (Node *nodep = list.head; nodep; nodep = nodep->next, i++) {
+        assert(nodep->data == vals[i]);
+    }
+    assert(i == (int) (sizeof(vals) / sizeof(*vals)));
+
+    // Appends should still link in after the tail.
+    list.appendToTail(3);
+    assert(list.capacity() == (i + 1));
+    cout << " ... OK" << endl;
+}
+
+void
+test_isPalindromeInPlace_large_list(const int nitems)
+{
+    cout << __func__ << ": nitems=" << nitems;
+    LinkedList list;
+    for (auto ictr = 0; ictr < nitems; ictr++) {
+        list.appendToTail(min(ictr, (nitems - 1 - ictr)));
+    }
+    assert(list.isPalindromeInPlace());
+
+    list.appendToTail(-1);
+    assert(list.isPalindromeInPlace() == false);
+    cout << " ... OK" << endl;
+}
@@ -0,0 +1,90 @@
+/*
+ * ch2.ll.node-pool.h
+ *
+ * Slab allocator for linked-list nodes, shared by the ch2.ll.*.cpp programs.
+ *
+ * Nodes are carved out of slabs of Pool_slab_nodes nodes each, so building
+ * an n-node list does n / Pool_slab_nodes mallocs, and successive nodes are
+ * adjacent in memory. Freed nodes go onto a free-list and are reused by the
+ * next alloc(). All slabs are released in one go when the pool is destroyed;
+ * nodes are not destructed, so they must be trivially destructible.
+ *
+ * Ref: Chap 2, Linked Lists
+ *
+ * History:
+ *  Feb-2024    Started
+ */
+#ifndef __CH2_LL_NODE_POOL_H__
+#define __CH2_LL_NODE_POOL_H__
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+const size_t Pool_slab_nodes = (4 * 1024);
+
+template <typename T>
+class NodePool
+{
+  public:
+    NodePool(const size_t slab_nodes = Pool_slab_nodes)
+        : slab_nodes{slab_nodes} { }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    // Construct a new node in the pool, reusing a freed node if there is one.
+    template <typename... Args>
+    T *
+    alloc(Args&&... args) {
+        Slot *slotp = free_list;
+        if (slotp) {
+            free_list = slotp->next_free;
+        } else {
+            if (slab_used == slab_nodes || slabs.empty()) {
+                slabs.emplace_back(new Slot[slab_nodes]);
+                slab_used = 0;
+            }
+            slotp = &slabs.back()[slab_used++];
+        }
+        nlive++;
+        return new (slotp->storage) T(std::forward<Args>(args)...);
+    }
+
+    // Return a node to the pool's free-list.
+    void
+    free(T *nodep) {
+        nodep->~T();
+        Slot *slotp = reinterpret_cast<Slot *>(nodep);
+        slotp->next_free = free_list;
+        free_list = slotp;
+        nlive--;
+    }
+
+    // # of nodes allocated and not freed.
+    size_t size() const { return nlive; }
+
+    // # of slabs allocated, each of slab_nodes nodes.
+    size_t nslabs() const { return slabs.size(); }
+
+  private:
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "Pool does not run destructors of nodes on release.");
+
+    union Slot
+    {
+        Slot *next_free;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    size_t  slab_nodes;
+    size_t  slab_used = 0;      // # of slots handed out from last slab
+    size_t  nlive = 0;
+    Slot   *free_list = NULL;
+};
+
+#endif // __CH2_LL_NODE_POOL_H__
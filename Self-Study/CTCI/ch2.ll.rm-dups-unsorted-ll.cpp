@@ -12,30 +12,23 @@
 
 #include <iostream>
 #include <set>
-#include <random>
+#include <vector>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 
-using namespace std;
-
-const int One_M     = (1000 * 1000);
+#if __linux__
+#include <cassert>
+#endif // __linux__
 
+#include "ch2.ll.node-pool.h"
+#include "../Tools/rand_gen.h"     // Rand_int
+#include "ch2.ll.seen-sets.h"
 
-// ----------------------------------------------------------------------------
-// Random-generator class.
-// Ref: Stroustrup's C++ book, 2nd Ed., Sec. 14.5, Pgs. 191.
-// ----------------------------------------------------------------------------
-class Rand_int
-{
-  public:
-    Rand_int(int low, int high): dist{low, high} { }
-
-    int operator()() { return dist(rand_gen); }
+using namespace std;
 
-    void seed(int s) { rand_gen.seed(s); }
+const int One_M     = (1000 * 1000);
 
-  private:
-    default_random_engine rand_gen;
-    uniform_int_distribution<> dist;
-};
 
 // ----------------------------------------------------------------------------
 // Definition of node in a singly-linked list
@@ -81,29 +74,54 @@ class LinkedList
     // Default constructor
     LinkedList() { head = NULL; }
 
+    // Nodes are owned by the list's pool; the list cannot be copied.
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
     // Append new item to the end of the list.
     Node * appendToTail(const int d);
 
     // Delete the 1st node found given its value.
     bool deleteNode(const int d);
 
-    // Eliminate duplicate items, return # of dup-items eliminated
+    // Eliminate duplicate items, return # of dup-items eliminated.
+    // Uses a bitmap if the range of values is small, else a hash set.
     int dupEliminate(void);
 
+    // Eliminate duplicate items, whose values are expected in [low, high].
+    // Uses a bitmap of the range; or, if some value is not in it, a hash set.
+    int dupEliminate(const int low, const int high);
+
+    // Eliminate duplicate items, tracking unique items in a std::set<>.
+    int dupEliminateTree(void);
+
+    // # of items in list, maintained on appends and deletes.
+    int capacity() { return nitems; }
+
     // Print the linked list.
     void printList();
+
+  private:
+    Node *          tail = NULL;    // Last node; appends are O(1)
+    int             nitems = 0;
+    NodePool<Node>  pool;           // Nodes of this list; freed with the list
+
+    int dupEliminateBitmap(const int low, const int high);
+    template <typename SeenSet> int dupEliminateWith(SeenSet& seen);
 };
 
 // ----------------------------------------------------
 Node *
 LinkedList::appendToTail(const int d) {
-    Node *newNode = new Node(d);
-    Node **nextp = &this->head;
+    Node *newNode = pool.alloc(d);
 
-    while (*nextp) {
-        nextp = &((*nextp)->next);
+    if (this->tail) {
+        this->tail->next = newNode;
+    } else {
+        this->head = newNode;
     }
-    *nextp = newNode;
+    this->tail = newNode;
+    nitems++;
     return newNode;
 }
 
@@ -111,19 +129,25 @@ LinkedList::appendToTail(const int d) {
 bool
 LinkedList::deleteNode(const int d) {
     Node **nextp = &this->head;
+    Node  *prevp = NULL;
 
     while (*nextp) {
         Node *nodep = *nextp;
         if (nodep->data == d) {
             // Relink past the node being deleted
             *nextp = nodep->next;
+            if (nodep == this->tail) {
+                this->tail = prevp;
+            }
 
             // Detach node from linked list
             nodep->next = NULL;
-            delete nodep;
+            pool.free(nodep);
+            nitems--;
             return true;
 
         } else {
+            prevp = nodep;
             nextp = &(nodep->next);
         }
     }
@@ -132,34 +156,89 @@ LinkedList::deleteNode(const int d) {
 }
 
 // ----------------------------------------------------
-// Eliminate duplicate values from linked list.
+// Eliminate duplicate values from linked list. Finds the range of values in
+// one pass; if a bitmap of that range is small enough, uses it, else uses a
+// hash set sized for all items.
 // Returns: The # of duplicates items eliminated.
 int
 LinkedList::dupEliminate() {
+    if (this->head == NULL) {
+        return 0;
+    }
+    int low  = this->head->data;
+    int high = low;
+    for (Node *nodep = this->head->next; nodep; nodep = nodep->next) {
+        low  = min(low, nodep->data);
+        high = max(high, nodep->data);
+    }
+    if ((((int64_t) high - low) + 1) <= (Bitmap_max_bits_per_item * nitems)) {
+        return dupEliminateBitmap(low, high);
+    }
+    HashSeenSet seen(nitems);
+    return dupEliminateWith(seen);
+}
+
+// ----------------------------------------------------
+int
+LinkedList::dupEliminate(const int low, const int high) {
+    for (Node *nodep = this->head; nodep; nodep = nodep->next) {
+        if ((nodep->data < low) || (nodep->data > high)) {
+            HashSeenSet seen(nitems);
+            return dupEliminateWith(seen);
+        }
+    }
+    return dupEliminateBitmap(low, high);
+}
+
+// ----------------------------------------------------
+// All values must be in [low, high].
+int
+LinkedList::dupEliminateBitmap(const int low, const int high) {
+    BitmapSeenSet seen(low, high);
+    return dupEliminateWith(seen);
+}
+
+// ----------------------------------------------------
+int
+LinkedList::dupEliminateTree() {
+    TreeSeenSet seen;
+    return dupEliminateWith(seen);
+}
+
+// ----------------------------------------------------
+// Eliminate duplicate values from linked list, keeping the 1st occurrence of
+// each value, using 'seen' to track values found so far.
+// Returns: The # of duplicates items eliminated.
+template <typename SeenSet>
+int
+LinkedList::dupEliminateWith(SeenSet& seen) {
 
     int neliminated = 0;
-    set<int> unique_items;
 
     Node **nextp = &this->head;
+    Node  *prevp = NULL;
 
     while (*nextp) {
         Node *nodep = *nextp;
 
         // Insert new item into set if it's not found
-        if (unique_items.find(nodep->data) == unique_items.end()) {
-            unique_items.insert(nodep->data);
-
+        if (seen.insert(nodep->data)) {
+            prevp = nodep;
             nextp = &nodep->next;
         } else {
             // Relink past the node being deleted
             *nextp = nodep->next;
+            if (nodep == this->tail) {
+                this->tail = prevp;
+            }
 
             // Detach node from linked list
             nodep->next = NULL;
-            delete nodep;
+            pool.free(nodep);
             neliminated++;
         }
     }
+    nitems -= neliminated;
     return neliminated;
 }
 
@@ -193,6 +272,8 @@ void test_eliminate_one_dup(void);
 void test_eliminate_all_but_one_dups(void);
 void test_random_inserts_eliminate_dups(const int nitems);
 void test_inserts_with_half_dups_eliminate_dups(const int nitems);
+void test_eliminate_dups_extreme_values(void);
+void test_eliminate_dups_vs_tree(const int nitems, const int low, const int high);
 
 /*
  * main() and test cases begin here ...
@@ -205,6 +286,7 @@ main(int argc, char *argv[])
     test_print_empty_list();
     test_append_n_entries();
     test_delete_inner_node();
+    test_delete_last_node();
 
     test_eliminate_one_dup();
     test_eliminate_all_but_one_dups();
@@ -216,6 +298,14 @@ main(int argc, char *argv[])
 
     // For very large # of inserts, generate half # of items as dups.
     test_inserts_with_half_dups_eliminate_dups(100 * 1000);
+    test_inserts_with_half_dups_eliminate_dups(One_M);
+    test_random_inserts_eliminate_dups(One_M);
+
+    // Bitmap and hash-set engines v/s std::set<>
+    test_eliminate_dups_extreme_values();
+    test_eliminate_dups_vs_tree((2 * One_M), -One_M, One_M);
+    test_eliminate_dups_vs_tree((2 * One_M), INT_MIN, INT_MAX);
+    test_eliminate_dups_vs_tree((2 * One_M), 0, (4 * One_M));
 }
 
 void
@@ -256,6 +346,34 @@ test_delete_inner_node(void)
     list.printList();
 }
 
+// Deleting the last node must move tail back, so appends still link in.
+void
+test_delete_last_node(void)
+{
+    cout << __func__ << endl;
+    LinkedList list;
+    list.appendToTail(1);
+    list.appendToTail(4);
+    list.appendToTail(5);
+
+    assert(list.deleteNode(5) == true);
+    assert(list.capacity() == 2);
+
+    list.appendToTail(6);
+    assert(list.capacity() == 3);
+    assert(list.head->next->next->data == 6);
+
+    assert(list.deleteNode(1) == true);
+    assert(list.deleteNode(4) == true);
+    assert(list.deleteNode(6) == true);
+    assert(list.capacity() == 0);
+    assert(list.head == NULL);
+
+    list.appendToTail(7);
+    assert(list.head->data == 7);
+    list.printList();
+}
+
 void
 test_eliminate_one_dup(void)
 {
@@ -315,6 +433,7 @@ test_random_inserts_eliminate_dups(const int nitems_to_insert)
 
     const int ndeleted = list.dupEliminate();
     assert(ndeleted == (nitems_to_insert - nunique_items));
+    assert(list.capacity() == nunique_items);
     cout << " ... Test deleted=" << ndeleted << " items." << endl;
 }
 
@@ -346,4 +465,91 @@ test_inserts_with_half_dups_eliminate_dups(const int nitems_to_insert)
     const int ndeleted = list.dupEliminate();
     cout << " ... Test deleted=" << ndeleted << " items." << endl;
     assert(ndeleted == (nitems_to_insert - nunique_items));
+    assert(list.capacity() == nunique_items);
+
+    // Last item was a dup, so tail should have moved back to a unique item.
+    list.appendToTail(-1);
+    assert(list.capacity() == (nunique_items + 1));
+}
+
+/*
+ * INT_MIN is the hash set's empty-slot marker, and a [INT_MIN, INT_MAX] range
+ * overflows 32-bit arithmetic; both must be handled.
+ */
+void
+test_eliminate_dups_extreme_values(void)
+{
+    cout << __func__ << endl;
+    LinkedList list;
+    const int values[] = { INT_MIN, 0, INT_MAX, INT_MIN, -1, INT_MAX, 0, INT_MIN };
+    for (auto v : values) {
+        list.appendToTail(v);
+    }
+    assert(list.dupEliminate() == 4);
+    assert(list.capacity() == 4);
+
+    Node *nodep = list.head;
+    for (auto v : { INT_MIN, 0, INT_MAX, -1 }) {
+        assert(nodep->data == v);
+        nodep = nodep->next;
+    }
+    assert(nodep == NULL);
+
+    LinkedList small;
+    small.appendToTail(INT_MAX);
+    small.appendToTail(INT_MAX);
+    assert(small.dupEliminate(INT_MAX, INT_MAX) == 1);
+
+    // Values outside the range given fall back to the hash set.
+    LinkedList outside;
+    for (auto v : { 5, 100, -7, 5, 100, INT_MIN }) {
+        outside.appendToTail(v);
+    }
+    assert(outside.dupEliminate(0, 10) == 2);
+    assert(outside.capacity() == 4);
+}
+
+/*
+ * Eliminate dups from two identical lists of random items in [low, high],
+ * one by dupEliminate() and one by dupEliminateTree(), verify that the same
+ * items survive in the same order, and report times.
+ */
+void
+test_eliminate_dups_vs_tree(const int nitems, const int low, const int high)
+{
+    cout << __func__ << ": nitems=" << nitems
+         << ", range=[" << low << ", " << high << "]";
+
+    LinkedList list;
+    LinkedList tree_list;
+    Rand_int rnd{low, high};
+    vector<int> newvals(nitems);
+    rnd.fill(newvals.data(), nitems);
+    for (const int newval : newvals) {
+        list.appendToTail(newval);
+        tree_list.appendToTail(newval);
+    }
+
+    auto start = chrono::steady_clock::now();
+    const int ndeleted = list.dupEliminate();
+    auto fast_ms = chrono::duration_cast<chrono::milliseconds>(
+                        chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    const int ndeleted_tree = tree_list.dupEliminateTree();
+    auto tree_ms = chrono::duration_cast<chrono::milliseconds>(
+                        chrono::steady_clock::now() - start).count();
+
+    assert(ndeleted == ndeleted_tree);
+    assert(list.capacity() == tree_list.capacity());
+    Node *nodep = list.head;
+    Node *tree_nodep = tree_list.head;
+    for (; nodep && tree_nodep; nodep = nodep->next, tree_nodep = tree_nodep->next) {
+        assert(nodep->data == tree_nodep->data);
+    }
+    assert((nodep == NULL) && (tree_nodep == NULL));
+
+    cout << ", deleted=" << ndeleted
+         << ": dupEliminate=" << fast_ms << " ms"
+         << ", tree=" << tree_ms << " ms" << endl;
 }
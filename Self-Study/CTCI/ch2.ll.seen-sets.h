@@ -0,0 +1,130 @@
+/*
+ * ch2.ll.seen-sets.h
+ *
+ * Sets of int values seen so far, used to eliminate duplicates from lists.
+ * insert() returns true if the value was not already in the set.
+ *
+ * Ref: Chap 2, Linked Lists
+ *
+ * History:
+ *  Feb-2024    Started
+ */
+#ifndef __CH2_LL_SEEN_SETS_H__
+#define __CH2_LL_SEEN_SETS_H__
+
+#include <set>
+#include <vector>
+#include <climits>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+// Red-black tree: One allocated node per unique value, O(log n) lookups.
+class TreeSeenSet
+{
+  public:
+    bool insert(const int d) { return items.insert(d).second; }
+
+  private:
+    std::set<int> items;
+};
+
+// Dense bitmap of the value range [low, high]; one bit per possible value.
+// Values inserted must be in the range.
+class BitmapSeenSet
+{
+  public:
+    BitmapSeenSet(const int low, const int high)
+        : low{low}, high{high}, bits(((((int64_t) high - low) + 64) / 64), 0) { }
+
+    bool
+    insert(const int d) {
+        assert((d >= low) && (d <= high));
+        uint64_t bit  = ((int64_t) d - low);
+        uint64_t mask = (1ULL << (bit % 64));
+        uint64_t& word = bits[bit / 64];
+        bool isnew = !(word & mask);
+        word |= mask;
+        return isnew;
+    }
+
+  private:
+    int              low;
+    int              high;
+    std::vector<uint64_t> bits;
+};
+
+// Flat open-addressing hash set with linear probing, kept at most half full.
+// Empty slots hold Empty_key; whether Empty_key itself is in the set is
+// tracked separately.
+class HashSeenSet
+{
+  public:
+    HashSeenSet(const size_t expected_items = 16) {
+        size_t nslots = 16;
+        while (nslots < (2 * expected_items)) {
+            nslots *= 2;
+        }
+        slots.assign(nslots, Empty_key);
+        shift = (64 - __builtin_ctzll(nslots));
+    }
+
+    bool
+    insert(const int d) {
+        if (d == Empty_key) {
+            bool isnew = !has_empty_key;
+            has_empty_key = true;
+            return isnew;
+        }
+        size_t mask = (slots.size() - 1);
+        for (size_t i = slot_of(d); ; i = ((i + 1) & mask)) {
+            if (slots[i] == d) {
+                return false;
+            }
+            if (slots[i] == Empty_key) {
+                slots[i] = d;
+                if (++nitems > (slots.size() / 2)) {
+                    grow();
+                }
+                return true;
+            }
+        }
+    }
+
+  private:
+    static constexpr int Empty_key = INT_MIN;
+
+    std::vector<int> slots;
+    size_t      nitems = 0;
+    unsigned    shift;              // Top bits of the hash index the slots
+    bool        has_empty_key = false;
+
+    // Fibonacci hashing: Multiply by 2^64 / golden-ratio, keep the top bits.
+    size_t
+    slot_of(const int d) const {
+        return (((uint64_t) (uint32_t) d * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+
+    void
+    grow(void) {
+        std::vector<int> old;
+        old.swap(slots);
+        slots.assign((2 * old.size()), Empty_key);
+        shift--;
+        size_t mask = (slots.size() - 1);
+        for (int d : old) {
+            if (d != Empty_key) {
+                size_t i = slot_of(d);
+                while (slots[i] != Empty_key) {
+                    i = ((i + 1) & mask);
+                }
+                slots[i] = d;
+            }
+        }
+    }
+};
+
+// Use a bitmap when it's no bigger than this, in bits per list item.
+const int64_t Bitmap_max_bits_per_item = 64;
+
+#endif // __CH2_LL_SEEN_SETS_H__
@@ -10,29 +10,17 @@
  */
 
 #include <iostream>
-#include <random>
 
-using namespace std;
-
-const int One_M     = (1000 * 1000);
-
-// ----------------------------------------------------------------------------
-// Random-generator class.
-// Ref: Stroustrup's C++ book, 2nd Ed., Sec. 14.5, Pgs. 191.
-// ----------------------------------------------------------------------------
-class Rand_int
-{
-  public:
-    Rand_int(int low, int high): dist{low, high} { }
+#if __linux__
+#include <cassert>
+#endif // __linux__
 
-    int operator()() { return dist(rand_gen); }
+#include "ch2.ll.node-pool.h"
+#include "../Tools/rand_gen.h"     // Rand_int
 
-    void seed(int s) { rand_gen.seed(s); }
+using namespace std;
 
-  private:
-    default_random_engine rand_gen;
-    uniform_int_distribution<> dist;
-};
+const int One_M     = (1000 * 1000);
 
 // ----------------------------------------------------------------------------
 // Definition of node in a singly-linked list
@@ -78,33 +66,50 @@ class LinkedList
     // Default constructor
     LinkedList() { head = NULL; }
 
+    // Nodes are owned by the list's pool; the list cannot be copied.
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
     // Append new item to the end of the list.
     Node * appendToTail(const int d);
 
     // Append new randomly generated item to the end of the list.
     Node * appendRandomToTail();
 
+    // # of items in list, counted on appends, as there is no delete.
+    int capacity() { return nitems; }
+
     // Print the linked list.
     void printList();
+
+  private:
+    Node *          tail = NULL;    // Last node; appends are O(1)
+    int             nitems = 0;
+    NodePool<Node>  pool;           // Nodes of this list; freed with the list
+
+    // appendRandomToTail()'s values: One buffered stream, for all appends.
+    // Include -ve #s also in random range.
+    Rand_int        rnd{-One_M, One_M};
 };
 
 // ----------------------------------------------------
 Node *
 LinkedList::appendToTail(const int d) {
-    Node *newNode = new Node(d);
-    Node **nextp = &this->head;
+    Node *newNode = pool.alloc(d);
 
-    while (*nextp) {
-        nextp = &((*nextp)->next);
+    if (this->tail) {
+        this->tail->next = newNode;
+    } else {
+        this->head = newNode;
     }
-    *nextp = newNode;
+    this->tail = newNode;
+    nitems++;
     return newNode;
 }
 
 // ----------------------------------------------------
 Node *
 LinkedList::appendRandomToTail() {
-    Rand_int rnd{-One_M, One_M};    // Include -ve #s also in random range
     return appendToTail(rnd());
 }
 
@@ -132,6 +137,7 @@ LinkedList::printList() {
 void test_print_empty_list(void);
 void test_appendToTail(void);
 void test_appendRandomToTail(void);
+void test_append_One_M(void);
 
 /*
  * main() and test cases begin here ...
@@ -144,6 +150,7 @@ main(int argc, char *argv[])
     test_print_empty_list();
     test_appendToTail();
     test_appendRandomToTail();
+    test_append_One_M();
 }
 
 void
@@ -174,3 +181,22 @@ test_appendRandomToTail(void)
     list.printList();
     cout << " ... OK" << endl;
 }
+
+void
+test_append_One_M(void)
+{
+    cout << __func__;
+    LinkedList list;
+    for (auto ictr = 0; ictr < One_M; ictr++) {
+        list.appendToTail(ictr);
+    }
+    assert(list.capacity() == One_M);
+
+    // Walk the list to verify order of items.
+    int nitems = 0;
+    for (Node *nodep = list.head; nodep; nodep = nodep->next, nitems++) {
+        assert(nodep->data == nitems);
+    }
+    assert(nitems == One_M);
+    cout << " ... OK" << endl;
+}
@@ -0,0 +1,857 @@
+/*
+ * ch2.ll.unrolled-list.cpp
+ *
+ * Unrolled singly-linked list: Each 64-byte, cache-line aligned, node holds
+ * several ints, so traversals touch one cache-line per Unrolled_node_items
+ * items instead of one 16-byte node, scattered on the heap, per item.
+ *
+ * UnrolledList supports the LinkedList operations of the other ch2.ll.*.cpp
+ * programs: appendToTail(), deleteNode(), dupEliminate(), isPalindrome() and
+ * findLoop(), the last one over the chain of nodes. A node-per-item
+ * LinkedList with the same operations, done by the same algorithms, is
+ * included to benchmark one layout against the other.
+ *
+ * Ref: Chap 2, Linked Lists
+ *      https://en.wikipedia.org/wiki/Unrolled_linked_list
+ *
+ * Usage: g++ -std=c++17 -O2 -o ch2.ll.unrolled-list ch2.ll.unrolled-list.cpp
+ *        ./ch2.ll.unrolled-list [ --bench [ <nitems> ] ]
+ *
+ * History:
+ *  Feb-2024    Started
+ */
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+#include <cstdlib>
+
+#if __linux__
+#include <cassert>
+#endif // __linux__
+
+#include "ch2.ll.node-pool.h"
+#include "../Tools/rand_gen.h"     // Rand_int, Xoshiro256ss
+#include "ch2.ll.seen-sets.h"
+
+using namespace std;
+
+const int One_M     = (1000 * 1000);
+
+// ----------------------------------------------------------------------------
+// Definition of node in a singly-linked list
+// ----------------------------------------------------------------------------
+class Node
+{
+  public:
+    Node *next = NULL;
+    int   data;
+
+    // Default constructor
+    Node() {
+        data = 0;
+        next = NULL;
+    }
+
+    // Constructor
+    Node(const int d) {
+        data = d;
+    }
+};
+
+// Reverse a chain of nodes, returning the new head. Works for Node and
+// UnrolledNode chains.
+template <typename NodeT>
+static NodeT *
+reverseChain(NodeT *nodep)
+{
+    NodeT *prevp = NULL;
+    while (nodep) {
+        NodeT *nextp = nodep->next;
+        nodep->next = prevp;
+        prevp = nodep;
+        nodep = nextp;
+    }
+    return prevp;
+}
+
+// Floyd's cycle detection over a chain of nodes. Returns the node where the
+// loop starts, or NULL if there is no loop. Works for Node and UnrolledNode.
+template <typename NodeT>
+static NodeT *
+findLoopStart(NodeT *head)
+{
+    NodeT *slowp = head;
+    NodeT *fastp = head;
+    while (fastp && fastp->next) {
+        slowp = slowp->next;
+        fastp = fastp->next->next;
+        if (slowp == fastp) {
+            // Distance head -> loop-start == meeting-point -> loop-start.
+            slowp = head;
+            while (slowp != fastp) {
+                slowp = slowp->next;
+                fastp = fastp->next;
+            }
+            return slowp;
+        }
+    }
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Definition of a singly linked-list class, one item per node.
+// ----------------------------------------------------------------------------
+class LinkedList
+{
+  public:
+    Node * head;
+
+    // Default constructor
+    LinkedList() { head = NULL; }
+
+    // Nodes are owned by the list's pool; the list cannot be copied.
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
+    // Append new item to the end of the list.
+    Node * appendToTail(const int d);
+
+    // Delete the 1st node found given its value.
+    bool deleteNode(const int d);
+
+    // Eliminate duplicate items, return # of dup-items eliminated
+    int dupEliminate(void);
+
+    // Check if data in linked list is a palindrome.
+    bool isPalindrome();
+
+    // Return the node where a loop in the list starts; NULL if no loop.
+    Node * findLoop() { return findLoopStart(this->head); }
+
+    // Re-link nodes in a random order of their addresses, keeping the order
+    // of items. Models a list whose nodes are scattered across the heap.
+    void scatterNodes(const int seed);
+
+    // Sum of all items; a plain traversal.
+    int64_t sum();
+
+    // # of items in list, maintained on appends and deletes.
+    int capacity() { return nitems; }
+
+  private:
+    Node *          tail = NULL;    // Last node; appends are O(1)
+    int             nitems = 0;
+    NodePool<Node>  pool;           // Nodes of this list; freed with the list
+};
+
+// ----------------------------------------------------
+Node *
+LinkedList::appendToTail(const int d) {
+    Node *newNode = pool.alloc(d);
+
+    if (this->tail) {
+        this->tail->next = newNode;
+    } else {
+        this->head = newNode;
+    }
+    this->tail = newNode;
+    nitems++;
+    return newNode;
+}
+
+// ----------------------------------------------------
+bool
+LinkedList::deleteNode(const int d) {
+    Node **nextp = &this->head;
+    Node  *prevp = NULL;
+
+    while (*nextp) {
+        Node *nodep = *nextp;
+        if (nodep->data == d) {
+            *nextp = nodep->next;
+            if (nodep == this->tail) {
+                this->tail = prevp;
+            }
+            pool.free(nodep);
+            nitems--;
+            return true;
+        }
+        prevp = nodep;
+        nextp = &(nodep->next);
+    }
+    return false;
+}
+
+// ----------------------------------------------------
+int
+LinkedList::dupEliminate() {
+    HashSeenSet seen(nitems);
+    int neliminated = 0;
+
+    Node **nextp = &this->head;
+    Node  *prevp = NULL;
+    while (*nextp) {
+        Node *nodep = *nextp;
+        if (seen.insert(nodep->data)) {
+            prevp = nodep;
+            nextp = &nodep->next;
+        } else {
+            *nextp = nodep->next;
+            if (nodep == this->tail) {
+                this->tail = prevp;
+            }
+            pool.free(nodep);
+            neliminated++;
+        }
+    }
+    nitems -= neliminated;
+    return neliminated;
+}
+
+// ----------------------------------------------------
+/*
+ * Algorithm: Reverse the 2nd half of the list, walk both halves comparing
+ * items, then reverse the 2nd half back. Uses no memory other than a few
+ * pointers.
+ */
+bool
+LinkedList::isPalindrome() {
+    if (nitems <= 1) {
+        return true;
+    }
+    // Last node of 1st half; the middle item, if any, stays in the 1st half.
+    Node *midp = this->head;
+    for (int i = 1; i < ((nitems + 1) / 2); i++) {
+        midp = midp->next;
+    }
+    Node *revp = reverseChain(midp->next);
+
+    bool rv = true;
+    Node *leftp  = this->head;
+    Node *rightp = revp;
+    for (; rightp; leftp = leftp->next, rightp = rightp->next) {
+        if (leftp->data != rightp->data) {
+            rv = false;
+            break;
+        }
+    }
+    midp->next = reverseChain(revp);
+    return rv;
+}
+
+// ----------------------------------------------------
+void
+LinkedList::scatterNodes(const int seed) {
+    vector<Node *> nodes;
+    vector<int>    items;
+    nodes.reserve(nitems);
+    items.reserve(nitems);
+    for (Node *nodep = this->head; nodep; nodep = nodep->next) {
+        nodes.push_back(nodep);
+        items.push_back(nodep->data);
+    }
+    if (nodes.empty()) {
+        return;
+    }
+    shuffle(nodes.begin(), nodes.end(), Xoshiro256ss(seed));
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i]->data = items[i];
+        nodes[i]->next = (((i + 1) < nodes.size()) ? nodes[i + 1] : (Node *) NULL);
+    }
+    this->head = nodes.front();
+    this->tail = nodes.back();
+}
+
+// ----------------------------------------------------
+int64_t
+LinkedList::sum() {
+    int64_t result = 0;
+    for (Node *nodep = this->head; nodep; nodep = nodep->next) {
+        result += nodep->data;
+    }
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Definition of node in an unrolled linked-list: One cache-line, holding up
+// to Unrolled_node_items items in data[0 .. count).
+// ----------------------------------------------------------------------------
+const int Cache_line_size     = 64;
+const int Unrolled_node_items = ((Cache_line_size - sizeof(void *) - sizeof(int))
+                                    / sizeof(int));
+
+class alignas(Cache_line_size) UnrolledNode
+{
+  public:
+    UnrolledNode *next = NULL;
+    int           count = 0;
+    int           data[Unrolled_node_items];
+};
+
+static_assert(sizeof(UnrolledNode) == Cache_line_size,
+              "UnrolledNode should fill exactly one cache-line.");
+
+// ----------------------------------------------------------------------------
+// Definition of an unrolled singly linked-list class
+// ----------------------------------------------------------------------------
+class UnrolledList
+{
+  public:
+    UnrolledNode * head = NULL;
+
+    // Default constructor
+    UnrolledList() { }
+
+    // Nodes are owned by the list's pool; the list cannot be copied.
+    UnrolledList(const UnrolledList&) = delete;
+    UnrolledList& operator=(const UnrolledList&) = delete;
+
+    // Append new item to the end of the list. Returns node holding the item.
+    UnrolledNode * appendToTail(const int d);
+
+    // Delete the 1st item found given its value.
+    bool deleteNode(const int d);
+
+    // Eliminate duplicate items, return # of dup-items eliminated
+    int dupEliminate(void);
+
+    // Check if data in linked list is a palindrome.
+    bool isPalindrome();
+
+    // Return the node where a loop in the chain of nodes starts; NULL if none.
+    UnrolledNode * findLoop() { return findLoopStart(this->head); }
+
+    // Sum of all items; a plain traversal.
+    int64_t sum();
+
+    // # of items in list, maintained on appends and deletes.
+    int capacity() { return nitems; }
+
+    // # of nodes in list.
+    size_t numNodes() { return pool.size(); }
+
+    // Print the linked list.
+    void printList();
+
+  private:
+    UnrolledNode *          tail = NULL;
+    int                     nitems = 0;
+    NodePool<UnrolledNode>  pool;
+};
+
+// ----------------------------------------------------
+// Items are appended to the tail node till it's full; nodes emptied by
+// deletes in the middle of the list are unlinked.
+UnrolledNode *
+UnrolledList::appendToTail(const int d) {
+    if (!this->tail || (this->tail->count == Unrolled_node_items)) {
+        UnrolledNode *newNode = pool.alloc();
+        if (this->tail) {
+            this->tail->next = newNode;
+        } else {
+            this->head = newNode;
+        }
+        this->tail = newNode;
+    }
+    this->tail->data[this->tail->count++] = d;
+    nitems++;
+    return this->tail;
+}
+
+// ----------------------------------------------------
+bool
+UnrolledList::deleteNode(const int d) {
+    UnrolledNode **nextp = &this->head;
+    UnrolledNode  *prevp = NULL;
+
+    while (*nextp) {
+        UnrolledNode *nodep = *nextp;
+        for (int i = 0; i < nodep->count; i++) {
+            if (nodep->data[i] != d) {
+                continue;
+            }
+            // Close the gap in this node's items.
+            memmove(&nodep->data[i], &nodep->data[i + 1],
+                    ((nodep->count - i - 1) * sizeof(int)));
+            nodep->count--;
+            nitems--;
+
+            if (nodep->count == 0) {
+                *nextp = nodep->next;
+                if (nodep == this->tail) {
+                    this->tail = prevp;
+                }
+                pool.free(nodep);
+            }
+            return true;
+        }
+        prevp = nodep;
+        nextp = &(nodep->next);
+    }
+    return false;
+}
+
+// ----------------------------------------------------
+/*
+ * Walk all items with a read cursor, copying the 1st occurrence of each value
+ * to a write cursor, which packs them into full nodes from the head. The
+ * write cursor never passes the read cursor. Nodes left over past the write
+ * cursor are freed.
+ */
+int
+UnrolledList::dupEliminate() {
+    if (this->head == NULL) {
+        return 0;
+    }
+    HashSeenSet seen(nitems);
+
+    UnrolledNode *wnodep = this->head;
+    UnrolledNode *wprevp = NULL;
+    int           wi = 0;
+    int           nunique = 0;
+
+    for (UnrolledNode *rnodep = this->head; rnodep; rnodep = rnodep->next) {
+        // Read count first; the write cursor may overwrite it, if it's in
+        // this node.
+        const int rcount = rnodep->count;
+        for (int i = 0; i < rcount; i++) {
+            const int d = rnodep->data[i];
+            if (!seen.insert(d)) {
+                continue;
+            }
+            wnodep->data[wi++] = d;
+            nunique++;
+            if (wi == Unrolled_node_items) {
+                wnodep->count = wi;
+                wprevp = wnodep;
+                wnodep = wnodep->next;
+                wi = 0;
+            }
+        }
+    }
+
+    // Free nodes past the last one written to.
+    UnrolledNode *freep = wnodep;
+    if (wi) {
+        wnodep->count = wi;
+        freep = wnodep->next;
+        wnodep->next = NULL;
+        this->tail = wnodep;
+    } else {
+        wprevp->next = NULL;
+        this->tail = wprevp;
+    }
+    while (freep) {
+        UnrolledNode *nextp = freep->next;
+        pool.free(freep);
+        freep = nextp;
+    }
+
+    int neliminated = (nitems - nunique);
+    nitems = nunique;
+    return neliminated;
+}
+
+// ----------------------------------------------------
+/*
+ * Algorithm: As for LinkedList::isPalindrome(), reverse the chain of nodes
+ * past the node holding the 1st item of the 2nd half. Walk items from the
+ * head forwards and from the tail backwards, comparing nitems/2 pairs. Then
+ * reverse the chain back. Uses no memory other than a few pointers.
+ */
+bool
+UnrolledList::isPalindrome() {
+    if (nitems <= 1) {
+        return true;
+    }
+    const int npairs = (nitems / 2);
+
+    // Find node, midp, and index in it, midi, of item # (nitems - npairs).
+    UnrolledNode *midp = this->head;
+    int midi = (nitems - npairs);
+    while (midi >= midp->count) {
+        midi -= midp->count;
+        midp = midp->next;
+    }
+    UnrolledNode *revp = reverseChain(midp->next);
+
+    bool rv = true;
+    UnrolledNode *leftp  = this->head;
+    int           lefti  = 0;
+    UnrolledNode *rightp = (revp ? revp : midp);
+    int           righti = (rightp->count - 1);
+    for (int pair = 0; pair < npairs; pair++) {
+        if (leftp->data[lefti] != rightp->data[righti]) {
+            rv = false;
+            break;
+        }
+        if (++lefti == leftp->count) {
+            leftp = leftp->next;
+            lefti = 0;
+        }
+        if (--righti < 0) {
+            // Reversed chain ends where the middle node would be next.
+            rightp = (rightp->next ? rightp->next : midp);
+            righti = (rightp->count - 1);
+        }
+    }
+    midp->next = reverseChain(revp);
+    return rv;
+}
+
+// ----------------------------------------------------
+int64_t
+UnrolledList::sum() {
+    int64_t result = 0;
+    for (UnrolledNode *nodep = this->head; nodep; nodep = nodep->next) {
+        for (int i = 0; i < nodep->count; i++) {
+            result += nodep->data[i];
+        }
+    }
+    return result;
+}
+
+// ----------------------------------------------------
+void
+UnrolledList::printList() {
+    if (this->head == NULL) {
+        return;
+    }
+    for (UnrolledNode *nodep = this->head; nodep; nodep = nodep->next) {
+        cout << "Node: " << nodep
+             << " { next=" << nodep->next
+             << ", count=" << nodep->count
+             << ", data=[";
+        for (int i = 0; i < nodep->count; i++) {
+            cout << (i ? " " : "") << nodep->data[i];
+        }
+        cout << "] }" << endl;
+    }
+}
+
+// Function prototypes
+
+void test_print_empty_list(void);
+void test_appendToTail(void);
+void test_deleteNode(void);
+void test_dupEliminate(void);
+void test_dupEliminate_vs_LinkedList(void);
+void test_isPalindrome(void);
+void test_isPalindrome_after_deletes(void);
+void test_findLoop(void);
+
+void bench_layouts(const int nitems);
+
+/*
+ * main() and test cases begin here ...
+ */
+int
+main(int argc, char *argv[])
+{
+    cout << argv[0] << ": Hello World." << endl;
+
+    if ((argc > 1) && (strcmp("--bench", argv[1]) == 0)) {
+        bench_layouts((argc > 2) ? atoi(argv[2]) : (10 * One_M));
+        return 0;
+    }
+
+    test_print_empty_list();
+    test_appendToTail();
+    test_deleteNode();
+    test_dupEliminate();
+    test_dupEliminate_vs_LinkedList();
+    test_isPalindrome();
+    test_isPalindrome_after_deletes();
+    test_findLoop();
+
+    bench_layouts(One_M);
+}
+
+void
+test_print_empty_list(void)
+{
+    cout << __func__;
+    UnrolledList list;
+    list.printList();
+    assert(list.sum() == 0);
+    cout << " ... OK" << endl;
+}
+
+void
+test_appendToTail(void)
+{
+    cout << __func__;
+    UnrolledList list;
+    const int nitems = ((3 * Unrolled_node_items) + 1);
+    for (auto ictr = 0; ictr < nitems; ictr++) {
+        list.appendToTail(ictr);
+    }
+    assert(list.capacity() == nitems);
+    assert(list.numNodes() == 4);
+    assert(list.sum() == (((int64_t) nitems * (nitems - 1)) / 2));
+    assert((((uintptr_t) list.head) % Cache_line_size) == 0);
+    cout << " ... OK" << endl;
+}
+
+void
+test_deleteNode(void)
+{
+    cout << __func__;
+    UnrolledList list;
+    const int nitems = (2 * Unrolled_node_items);
+    for (auto ictr = 0; ictr < nitems; ictr++) {
+        list.appendToTail(ictr);
+    }
+    assert(list.deleteNode(nitems) == false);
+
+    // Empty out the 1st node; it should be unlinked.
+    for (auto ictr = 0; ictr < Unrolled_node_items; ictr++) {
+        assert(list.deleteNode(ictr) == true);
+    }
+    assert(list.capacity() == Unrolled_node_items);
+    assert(list.numNodes() == 1);
+    assert(list.head->data[0] == Unrolled_node_items);
+
+    // Delete from the middle of the remaining node, then empty the list.
+    assert(list.deleteNode(Unrolled_node_items + 5) == true);
+    assert(list.head->data[5] == (Unrolled_node_items + 6));
+    for (auto ictr = Unrolled_node_items; ictr < nitems; ictr++) {
+        list.deleteNode(ictr);
+    }
+    assert(list.capacity() == 0);
+    assert(list.head == NULL);
+
+    // Tail should have been reset, for appends to work.
+    list.appendToTail(42);
+    assert(list.head && (list.head->data[0] == 42));
+    cout << " ... OK" << endl;
+}
+
+void
+test_dupEliminate(void)
+{
+    cout << __func__;
+    UnrolledList list;
+    const int nunique = ((2 * Unrolled_node_items) + 3);
+    for (auto ictr = 0; ictr < nunique; ictr++) {
+        list.appendToTail(ictr);
+        list.appendToTail(ictr);
+        list.appendToTail(ictr / 2);
+    }
+    assert(list.dupEliminate() == (2 * nunique));
+    assert(list.capacity() == nunique);
+    assert(list.numNodes() == 3);
+
+    int expected = 0;
+    for (UnrolledNode *nodep = list.head; nodep; nodep = nodep->next) {
+        for (int i = 0; i < nodep->count; i++) {
+            assert(nodep->data[i] == expected++);
+        }
+    }
+    assert(expected == nunique);
+
+    // Tail should be the last packed node, for appends to work.
+    list.appendToTail(-1);
+    assert(list.capacity() == (nunique + 1));
+    assert(list.sum() == ((((int64_t) nunique * (nunique - 1)) / 2) - 1));
+    cout << " ... OK" << endl;
+}
+
+// Survivors of dupEliminate() should match those from the node-per-item list,
+// including after deletes have left partially-filled nodes.
+void
+test_dupEliminate_vs_LinkedList(void)
+{
+    cout << __func__;
+    UnrolledList list;
+    LinkedList   ll;
+    Rand_int rnd{0, 5000};
+    for (auto ictr = 0; ictr < (100 * 1000); ictr++) {
+        const int newval = rnd();
+        list.appendToTail(newval);
+        ll.appendToTail(newval);
+    }
+    for (auto ictr = 0; ictr < 1000; ictr++) {
+        const int delval = rnd();
+        assert(list.deleteNode(delval) == ll.deleteNode(delval));
+    }
+    assert(list.dupEliminate() == ll.dupEliminate());
+    assert(list.capacity() == ll.capacity());
+
+    Node *llp = ll.head;
+    for (UnrolledNode *nodep = list.head; nodep; nodep = nodep->next) {
+        for (int i = 0; i < nodep->count; i++, llp = llp->next) {
+            assert(nodep->data[i] == llp->data);
+        }
+    }
+    assert(llp == NULL);
+    cout << " ... OK" << endl;
+}
+
+void
+test_isPalindrome(void)
+{
+    cout << __func__;
+    for (int nitems = 0; nitems < (4 * Unrolled_node_items); nitems++) {
+        UnrolledList list;
+        LinkedList   ll;
+        for (auto ictr = 0; ictr < nitems; ictr++) {
+            list.appendToTail(min(ictr, (nitems - 1 - ictr)));
+            ll.appendToTail(min(ictr, (nitems - 1 - ictr)));
+        }
+        assert(list.isPalindrome());
+        assert(ll.isPalindrome());
+
+        // List should be restored after the check.
+        assert(list.isPalindrome());
+        assert(list.sum() == ll.sum());
+
+        // Appending a new, non-zero, item breaks the palindrome.
+        list.appendToTail(-1);
+        ll.appendToTail(-1);
+        assert(list.isPalindrome() == (nitems == 0));
+        assert(ll.isPalindrome() == (nitems == 0));
+    }
+    cout << " ... OK" << endl;
+}
+
+// Deletes leave partially filled nodes, which the walk has to step across.
+void
+test_isPalindrome_after_deletes(void)
+{
+    cout << __func__;
+    UnrolledList list;
+    const int nitems = (5 * Unrolled_node_items);
+    for (auto ictr = 0; ictr < nitems; ictr++) {
+        list.appendToTail(ictr);
+    }
+    for (auto ictr = 0; ictr < nitems; ictr++) {
+        list.appendToTail(nitems - 1 - ictr);
+    }
+    assert(list.isPalindrome());
+
+    // Delete 1st occurrence of some values, and matching ones from the end.
+    for (int d : { 3, 20, 21, 22, 40 }) {
+        assert(list.deleteNode(d));
+    }
+    assert(list.isPalindrome() == false);
+    UnrolledList list2;
+    for (UnrolledNode *nodep = list.head; nodep; nodep = nodep->next) {
+        for (int i = 0; i < nodep->count; i++) {
+            list2.appendToTail(nodep->data[i]);
+        }
+    }
+    for (int d : { 3, 20, 21, 22, 40 }) {
+        assert(list.deleteNode(d));
+        assert(list2.deleteNode(d));
+    }
+    assert(list.isPalindrome());
+    assert(list2.isPalindrome());
+    assert(list.sum() == list2.sum());
+    cout << " ... OK" << endl;
+}
+
+void
+test_findLoop(void)
+{
+    cout << __func__;
+    UnrolledList list;
+    assert(list.findLoop() == NULL);
+
+    vector<UnrolledNode *> nodes;
+    for (auto ictr = 0; ictr < (10 * Unrolled_node_items); ictr++) {
+        UnrolledNode *nodep = list.appendToTail(ictr);
+        if (nodes.empty() || (nodes.back() != nodep)) {
+            nodes.push_back(nodep);
+        }
+    }
+    assert(list.findLoop() == NULL);
+
+    // cause loop corruption: last node points back to a middle node.
+    nodes.back()->next = nodes[4];
+    assert(list.findLoop() == nodes[4]);
+    nodes.back()->next = nodes.back();
+    assert(list.findLoop() == nodes.back());
+    nodes.back()->next = NULL;
+    cout << " ... OK" << endl;
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark: Time each operation on a list of 'nitems' items, in each layout.
+// Items are a palindrome of nitems / 2 unique values, so isPalindrome() walks
+// the whole list and dupEliminate() removes half the items. deleteNode() is
+// for a value not in the list, so it walks the whole list.
+// ----------------------------------------------------------------------------
+template <typename List>
+static void
+bench_one_layout(const char *layout, const int nitems, const bool scatter)
+{
+    auto elapsed_us = [](chrono::steady_clock::time_point start) {
+        return chrono::duration_cast<chrono::microseconds>(
+                    chrono::steady_clock::now() - start).count();
+    };
+
+    List list;
+    auto start = chrono::steady_clock::now();
+    for (auto ictr = 0; ictr < nitems; ictr++) {
+        list.appendToTail(min(ictr, (nitems - 1 - ictr)));
+    }
+    auto append_us = elapsed_us(start);
+    if (scatter) {
+        if constexpr (is_same<List, LinkedList>::value) {
+            list.scatterNodes(nitems);
+        }
+    }
+
+    start = chrono::steady_clock::now();
+    volatile int64_t sum = list.sum();
+    auto sum_us = elapsed_us(start);
+    (void) sum;
+
+    start = chrono::steady_clock::now();
+    bool ispal = list.isPalindrome();
+    auto pal_us = elapsed_us(start);
+    assert(ispal);
+    (void) ispal;
+
+    start = chrono::steady_clock::now();
+    void *loopp = list.findLoop();
+    auto loop_us = elapsed_us(start);
+    assert(loopp == NULL);
+    (void) loopp;
+
+    start = chrono::steady_clock::now();
+    bool deleted = list.deleteNode(-1);
+    auto delete_us = elapsed_us(start);
+    assert(!deleted);
+    (void) deleted;
+
+    start = chrono::steady_clock::now();
+    int ndups = list.dupEliminate();
+    auto dedup_us = elapsed_us(start);
+    assert(ndups == (nitems / 2));
+    (void) ndups;
+
+    cout << "  " << layout
+         << ": append=" << append_us << " us"
+         << ", traverse=" << sum_us << " us"
+         << ", isPalindrome=" << pal_us << " us"
+         << ", findLoop=" << loop_us << " us"
+         << ", deleteNode=" << delete_us << " us"
+         << ", dupEliminate=" << dedup_us << " us"
+         << endl;
+}
+
+void
+bench_layouts(const int nitems)
+{
+    cout << __func__ << ": nitems=" << nitems
+         << ", unrolled node items=" << Unrolled_node_items << endl;
+    bench_one_layout<LinkedList>("node-per-item, pooled   ", nitems, false);
+    bench_one_layout<LinkedList>("node-per-item, scattered", nitems, true);
+    bench_one_layout<UnrolledList>("unrolled, 64-byte nodes ", nitems, false);
+}
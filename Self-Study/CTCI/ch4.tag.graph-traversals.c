@@ -2,9 +2,37 @@
  * -----------------------------------------------------------------------------
  * Implement Graph building and traversals algorithms.
  *
+ * Two graph representations are provided:
+ *
+ *  - GRAPHNODE[]: An array of nodes, each with its own allocated tonodes[]
+ *    array. Simple, but capped at Max_Num_Nodes.
+ *
+ *  - CSR_GRAPH: Compressed Sparse Row layout, for graphs of millions of
+ *    nodes. Node IDs are dense, [0, numnodes). The edges of all nodes are in
+ *    a single edges[] array, with those of node 'n' at
+ *    edges[offsets[n] .. offsets[n + 1]). It's built in bulk from an edge
+ *    list in O(V + E), with two allocations, and traversals walk contiguous
+ *    memory instead of chasing per-node pointers.
+ *
+ * Implemented:
+ *  - buildCSRGraph(), transposeCSRGraph(), freeCSRGraph()
+ *  - bfsCSR(), dfsCSR(): Iterative BFS and (pre-order) DFS over a CSR_GRAPH.
+ *  - bfsCSRParallel(): Multi-threaded, direction-optimizing BFS.
+ *  - saveCSRGraph(), loadCSRGraph(): Binary snapshot of a CSR_GRAPH, which
+ *    is loaded by mmap()'ing it and using its arrays in place.
+ *
  * Ref:
+ *  - Beamer, Asanovic, Patterson: Direction-Optimizing Breadth-First Search,
+ *    SC'12.
  *
- * Usage: gcc -o ch4.tag.graph-traversals ch4.tag.graph-traversals.c
+ * Usage: gcc -O2 -pthread -o ch4.tag.graph-traversals ch4.tag.graph-traversals.c
+ *        ./ch4.tag.graph-traversals --bfs <numnodes> <avg-degree> [ <nthreads> ]
+ *        ./ch4.tag.graph-traversals --save-graph <file> <numnodes> <avg-degree>
+ *        ./ch4.tag.graph-traversals --load-graph <file> [ <nthreads> ]
+ *        ./ch4.tag.graph-traversals bench_<fn-name> [ <bench-options> ]
+ *
+ * bench_* runs the benchmarks in Bench_fns[], by the runner of
+ * ../Tools/bench_fns.h; see there for <bench-options>.
  *
  * History:
  * -----------------------------------------------------------------------------
@@ -13,14 +41,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../Tools/bench_fns.h"
 
-const char *Usage = "%s [ --help | test_<fn-name> ]\n";
+const char *Usage = "%s [ --help | test_<fn-name>"
+                    " | --bfs <numnodes> <avg-degree> [ <nthreads> ]"
+                    " | --save-graph <file> <numnodes> <avg-degree>"
+                    " | --load-graph <file> [ <nthreads> ]"
+                    " | bench_<fn-name> [ <bench-options> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
 // -----------------------------------------------------------------------------
 // Useful typedefines
 typedef unsigned int uint32;
+typedef uint64_t     uint64;
 
 // -----------------------------------------------------------------------------
 // Limits for this program
@@ -44,6 +88,85 @@ GRAPHNODE * mkNodesArray(uint32 numnodes);
 int *       mkToNodesArray(uint32 degree);
 void        freeGraph(GRAPHNODE **nodep, uint32 numnodes);
 
+// -----------------------------------------------------------------------------
+// Graph in Compressed Sparse Row (CSR) layout. Edges out of node 'n' are
+// edges[offsets[n] .. offsets[n + 1]), so offsets[] has numnodes + 1 entries.
+typedef struct csr_graph
+{
+    uint32      numnodes;
+    uint64      numedges;
+    uint64 *    offsets;    // Allocated memory; see freeCSRGraph().
+    uint32 *    edges;      // Allocated memory; see freeCSRGraph().
+    void *      map_addr;   // If loaded from a snapshot: offsets and edges
+    size_t      map_len;    // point into this read-only mapping.
+} CSR_GRAPH;
+
+/*
+ * Snapshot file format, version 1: A fixed header followed by the CSR
+ * arrays, as they are laid out in memory, so loading is mmap() only.
+ *
+ *   [ CSR_FILE_HDR ][ offsets[numnodes + 1] ][ edges[numedges] ]
+ *
+ * offsets[] start at hdr_size, which is a multiple of 8, and edges[] right
+ * after them. The byte-order mark is written in host order, so a snapshot
+ * from a machine of the other byte order is rejected, not misread.
+ */
+#define CSR_FILE_MAGIC      "CSRGRAPH"
+#define CSR_FILE_VERSION    1
+#define CSR_FILE_BOM        0x01020304
+
+typedef struct csr_file_hdr
+{
+    char    magic[8];
+    uint32  version;
+    uint32  bom;
+    uint32  hdr_size;       // Offset of offsets[] in the file
+    uint32  numnodes;
+    uint64  numedges;
+    uint64  reserved[4];
+} CSR_FILE_HDR;
+
+// Marks unreached nodes in depth[] arrays returned by traversals.
+#define CSR_UNREACHED   (-1)
+
+// CSR Graph Function Prototypes
+CSR_GRAPH * buildCSRGraph(uint32 numnodes, uint64 numedges,
+                          const uint32 *from, const uint32 *to);
+void        freeCSRGraph(CSR_GRAPH **graphp);
+int         saveCSRGraph(const CSR_GRAPH *graph, const char *path);
+CSR_GRAPH * loadCSRGraph(const char *path);
+int         validateCSRGraph(const CSR_GRAPH *graph);
+uint32      bfsCSR(const CSR_GRAPH *graph, uint32 src, int *depth,
+                   uint32 *order);
+uint32      dfsCSR(const CSR_GRAPH *graph, uint32 src, uint32 *order);
+CSR_GRAPH * transposeCSRGraph(const CSR_GRAPH *graph);
+
+// Statistics returned by bfsCSRParallel()
+typedef struct bfs_stats
+{
+    uint32  nreached;           // # of nodes reached, including source
+    uint32  nlevels;            // # of BFS levels (frontiers) expanded
+    uint32  ntopdown;           // # of levels expanded top-down
+    uint32  nbottomup;          // # of levels expanded bottom-up
+    uint64  edges_examined;     // # of edges actually looked at
+    uint64  edges_reached;      // # of out-edges of all reached nodes
+    double  secs;               // Elapsed wall-clock time
+} BFS_STATS;
+
+uint32      bfsCSRParallel(const CSR_GRAPH *graph, const CSR_GRAPH *rgraph,
+                           uint32 src, int *depth, int nthreads,
+                           BFS_STATS *stats);
+int         bfsBenchmark(uint32 numnodes, uint32 avg_degree, int nthreads);
+int         saveRandomGraph(const char *path, uint32 numnodes, uint32 avg_degree);
+int         loadGraphBenchmark(const char *path, int nthreads);
+double      now_secs(void);
+
+static inline uint32
+csrDegree(const CSR_GRAPH *graph, uint32 node)
+{
+    return (uint32) (graph->offsets[node + 1] - graph->offsets[node]);
+}
+
 // Test Function Prototypes
 void test_this(void);
 void test_that(void);
@@ -51,6 +174,23 @@ void test_msg(const char *msg);
 void test_prEmptyGraphNode(void);
 void test_prGraphNode(void);
 void test_buildGraph_1node(void);
+void test_buildCSRGraph(void);
+void test_bfsCSR(void);
+void test_dfsCSR(void);
+void test_CSR_large_graph(void);
+void test_transposeCSRGraph(void);
+void test_bfsCSRParallel(void);
+void test_bfsCSRParallel_large_graph(void);
+void test_CSR_snapshot(void);
+void test_CSR_snapshot_bad_files(void);
+void test_CSR_snapshot_large_graph(void);
+
+// Test helpers
+CSR_GRAPH * mkRandomCSRGraph(uint32 numnodes, uint64 numedges,
+                             unsigned int seed);
+
+// Bench Function Prototypes
+void bench_bfsCSR(uint64_t nops);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -66,6 +206,21 @@ TEST_FNS Test_fns[] = {
                         , { "test_prEmptyGraphNode"     , test_prEmptyGraphNode }
                         , { "test_prGraphNode"          , test_prGraphNode }
                         , { "test_buildGraph_1node"     , test_buildGraph_1node }
+                        , { "test_buildCSRGraph"        , test_buildCSRGraph }
+                        , { "test_bfsCSR"               , test_bfsCSR }
+                        , { "test_dfsCSR"               , test_dfsCSR }
+                        , { "test_CSR_large_graph"      , test_CSR_large_graph }
+                        , { "test_transposeCSRGraph"    , test_transposeCSRGraph }
+                        , { "test_bfsCSRParallel"       , test_bfsCSRParallel }
+                        , { "test_bfsCSRParallel_large_graph", test_bfsCSRParallel_large_graph }
+                        , { "test_CSR_snapshot"         , test_CSR_snapshot }
+                        , { "test_CSR_snapshot_bad_files", test_CSR_snapshot_bad_files }
+                        , { "test_CSR_snapshot_large_graph", test_CSR_snapshot_large_graph }
+                      };
+
+// List of bench functions one can invoke from the command-line
+BENCH_FNS Bench_fns[] = {
+                          { "bench_bfsCSR"              , bench_bfsCSR, 0 }
                       };
 
 // Test start / end info-msg macros
@@ -76,7 +231,9 @@ int
 main(int argc, char *argv[])
 {
     const char *hello_msg = "Hello World";
-    printf("%s: %s. (argc=%d)\n", argv[0], hello_msg, argc);
+    // To stderr when benchmarking, so stdout holds only the results.
+    fprintf((BENCH_ARGV(argc, argv) ? stderr : stdout), "%s: %s. (argc=%d)\n",
+            argv[0], hello_msg, argc);
 
     int rv = 0;
     // Run all test cases if no args are provided.
@@ -87,6 +244,31 @@ main(int argc, char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         printf(Usage, argv[0]);
         return rv;
+    } else if (strcmp("--bfs", argv[1]) == 0) {
+        if (argc < 4) {
+            printf(Usage, argv[0]);
+            return 1;
+        }
+        int nthreads = ((argc > 4) ? atoi(argv[4])
+                                   : (int) sysconf(_SC_NPROCESSORS_ONLN));
+        rv = bfsBenchmark((uint32) atol(argv[2]), (uint32) atoi(argv[3]), nthreads);
+    } else if (strcmp("--save-graph", argv[1]) == 0) {
+        if (argc < 5) {
+            printf(Usage, argv[0]);
+            return 1;
+        }
+        rv = saveRandomGraph(argv[2], (uint32) atol(argv[3]), (uint32) atoi(argv[4]));
+    } else if (strcmp("--load-graph", argv[1]) == 0) {
+        if (argc < 3) {
+            printf(Usage, argv[0]);
+            return 1;
+        }
+        int nthreads = ((argc > 3) ? atoi(argv[3])
+                                   : (int) sysconf(_SC_NPROCESSORS_ONLN));
+        rv = loadGraphBenchmark(argv[2], nthreads);
+    } else if (BENCH_ARGV(argc, argv)) {
+        rv = bench_main(Bench_fns, ARRAYSIZE(Bench_fns), (argc - 1),
+                        (const char **) &argv[1]);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
 
         // Execute the named test-function, if it's a supported test-function
@@ -241,6 +423,977 @@ prGRAPHNODE(GRAPHNODE *nodep)
     printf(" ]\n");
 }
 
+// **** CSR Graph Routines ****
+
+/*
+ * -----------------------------------------------------------------------------
+ * buildCSRGraph(): CSR Graph constructor.
+ *
+ * Build a graph of 'numnodes' nodes, IDs [0, numnodes), from a list of
+ * 'numedges' directed edges, from[e] -> to[e], in any order. This is a
+ * counting sort of the edges by their 'from' node:
+ *
+ *  - Count the out-degree of each node, in offsets[n + 1].
+ *  - Prefix-sum the degrees, so offsets[n] is where node n's edges start.
+ *  - Scatter each edge's 'to' node into its slot in edges[].
+ *
+ * Edges out of a node retain their relative order from the input list.
+ * Duplicate edges and self-loops are kept as given.
+ *
+ * Returns: Allocated graph, to be freed by freeCSRGraph(); NULL if out of
+ * memory or if an edge names a node >= numnodes.
+ * -----------------------------------------------------------------------------
+ */
+CSR_GRAPH *
+buildCSRGraph(uint32 numnodes, uint64 numedges, const uint32 *from,
+              const uint32 *to)
+{
+    assert(!numedges || (from && to));
+
+    CSR_GRAPH *graph = calloc(1, sizeof(*graph));
+    if (!graph) {
+        return graph;
+    }
+    graph->numnodes = numnodes;
+    graph->numedges = numedges;
+    graph->offsets = calloc(((size_t) numnodes + 1), sizeof(*graph->offsets));
+    graph->edges = malloc((numedges ? numedges : 1) * sizeof(*graph->edges));
+    if (!graph->offsets || !graph->edges) {
+        freeCSRGraph(&graph);
+        return graph;
+    }
+
+    uint64 *offsets = graph->offsets;
+    for (uint64 ectr = 0; ectr < numedges; ectr++) {
+        if ((from[ectr] >= numnodes) || (to[ectr] >= numnodes)) {
+            freeCSRGraph(&graph);
+            return graph;
+        }
+        offsets[from[ectr] + 1]++;
+    }
+    for (uint32 nctr = 0; nctr < numnodes; nctr++) {
+        offsets[nctr + 1] += offsets[nctr];
+    }
+
+    // Scatter using offsets[n] as node n's fill cursor; this leaves offsets[n]
+    // at the end of node n's edges, i.e. the start of node n+1's edges.
+    for (uint64 ectr = 0; ectr < numedges; ectr++) {
+        graph->edges[offsets[from[ectr]]++] = to[ectr];
+    }
+    // Shift back by one node, to restore each node's start offset.
+    for (uint32 nctr = numnodes; nctr > 0; nctr--) {
+        offsets[nctr] = offsets[nctr - 1];
+    }
+    offsets[0] = 0;
+
+    return graph;
+}
+
+void
+freeCSRGraph(CSR_GRAPH **graphp)
+{
+    CSR_GRAPH *graph = (graphp ? *graphp : (CSR_GRAPH *) NULL);
+    if (!graph) {
+        return;
+    }
+    if (graph->map_addr) {
+        munmap(graph->map_addr, graph->map_len);
+    } else {
+        free(graph->offsets);
+        free(graph->edges);
+    }
+    free(graph);
+    *graphp = (CSR_GRAPH *) NULL;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * bfsCSR(): Breadth-first search from node 'src'.
+ *
+ * Parameters:
+ *  depth   - Array of numnodes entries; returns the # of edges on a shortest
+ *            path from 'src' to each node, CSR_UNREACHED if there is none.
+ *  order   - Optional array of numnodes entries; returns reached nodes in the
+ *            order they were visited.
+ *
+ * The visit order doubles as the BFS queue, so no other memory is allocated.
+ *
+ * Returns: # of nodes reached, including 'src'.
+ * -----------------------------------------------------------------------------
+ */
+uint32
+bfsCSR(const CSR_GRAPH *graph, uint32 src, int *depth, uint32 *order)
+{
+    assert(graph && depth);
+    assert(src < graph->numnodes);
+
+    uint32 *queue = order;
+    if (!queue && ((queue = malloc(graph->numnodes * sizeof(*queue))) == NULL)) {
+        return 0;
+    }
+    for (uint32 nctr = 0; nctr < graph->numnodes; nctr++) {
+        depth[nctr] = CSR_UNREACHED;
+    }
+
+    const uint64 *offsets = graph->offsets;
+    const uint32 *edges = graph->edges;
+
+    uint32 head = 0;
+    uint32 tail = 0;
+    depth[src] = 0;
+    queue[tail++] = src;
+    while (head < tail) {
+        uint32 node = queue[head++];
+        int    next_depth = (depth[node] + 1);
+        for (uint64 ectr = offsets[node]; ectr < offsets[node + 1]; ectr++) {
+            uint32 tonode = edges[ectr];
+            if (depth[tonode] == CSR_UNREACHED) {
+                depth[tonode] = next_depth;
+                queue[tail++] = tonode;
+            }
+        }
+    }
+    if (!order) {
+        free(queue);
+    }
+    return tail;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * dfsCSR(): Depth-first search from node 'src'.
+ *
+ * Returns, in 'order' (numnodes entries), the reached nodes in pre-order,
+ * visiting each node's edges in their order in the graph; i.e. the same
+ * order as a recursive DFS. It's iterative, with an explicit stack of
+ * (node, next-edge) frames, so deep graphs cannot overflow the C stack.
+ *
+ * Returns: # of nodes reached, including 'src'; 0 if out of memory.
+ * -----------------------------------------------------------------------------
+ */
+uint32
+dfsCSR(const CSR_GRAPH *graph, uint32 src, uint32 *order)
+{
+    assert(graph && order);
+    assert(src < graph->numnodes);
+
+    typedef struct dfs_frame
+    {
+        uint32  node;
+        uint64  next_edge;      // Index in edges[] of next edge to follow
+    } DFS_FRAME;
+
+    uint32     numnodes = graph->numnodes;
+    DFS_FRAME *stack = malloc(numnodes * sizeof(*stack));
+    char      *visited = calloc(numnodes, sizeof(*visited));
+    if (!stack || !visited) {
+        free(stack);
+        free(visited);
+        return 0;
+    }
+
+    const uint64 *offsets = graph->offsets;
+    const uint32 *edges = graph->edges;
+
+    uint32 nvisited = 0;
+    uint32 top = 0;     // # of frames on stack
+
+    visited[src] = 1;
+    order[nvisited++] = src;
+    stack[top++] = (DFS_FRAME) { src, offsets[src] };
+    while (top) {
+        DFS_FRAME *frame = &stack[top - 1];
+        uint64     end = offsets[frame->node + 1];
+
+        // Skip over edges to already visited nodes.
+        while ((frame->next_edge < end) && visited[edges[frame->next_edge]]) {
+            frame->next_edge++;
+        }
+        if (frame->next_edge == end) {
+            top--;
+            continue;
+        }
+        uint32 tonode = edges[frame->next_edge++];
+        visited[tonode] = 1;
+        order[nvisited++] = tonode;
+        stack[top++] = (DFS_FRAME) { tonode, offsets[tonode] };
+    }
+    free(stack);
+    free(visited);
+    return nvisited;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * transposeCSRGraph(): Graph with all edges of 'graph' reversed, i.e. the
+ * in-edges of each node, as needed by bottom-up BFS. Graph is built directly
+ * from 'graph's CSR arrays, by the same counting sort as buildCSRGraph().
+ *
+ * Returns: Allocated graph, to be freed by freeCSRGraph(); NULL if out of
+ * memory.
+ * -----------------------------------------------------------------------------
+ */
+CSR_GRAPH *
+transposeCSRGraph(const CSR_GRAPH *graph)
+{
+    assert(graph);
+
+    CSR_GRAPH *rgraph = buildCSRGraph(graph->numnodes, 0, NULL, NULL);
+    if (!rgraph) {
+        return rgraph;
+    }
+    uint32 *edges = malloc((graph->numedges ? graph->numedges : 1) * sizeof(*edges));
+    if (!edges) {
+        freeCSRGraph(&rgraph);
+        return rgraph;
+    }
+    free(rgraph->edges);
+    rgraph->edges = edges;
+    rgraph->numedges = graph->numedges;
+
+    uint32  numnodes = graph->numnodes;
+    uint64 *offsets = rgraph->offsets;
+    for (uint64 ectr = 0; ectr < graph->numedges; ectr++) {
+        offsets[graph->edges[ectr] + 1]++;
+    }
+    for (uint32 nctr = 0; nctr < numnodes; nctr++) {
+        offsets[nctr + 1] += offsets[nctr];
+    }
+    for (uint32 nctr = 0; nctr < numnodes; nctr++) {
+        for (uint64 ectr = graph->offsets[nctr]; ectr < graph->offsets[nctr + 1]; ectr++) {
+            edges[offsets[graph->edges[ectr]]++] = nctr;
+        }
+    }
+    for (uint32 nctr = numnodes; nctr > 0; nctr--) {
+        offsets[nctr] = offsets[nctr - 1];
+    }
+    offsets[0] = 0;
+
+    return rgraph;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * saveCSRGraph(): Write 'graph' to a snapshot file at 'path', in the
+ * CSR_FILE_HDR format. File is written to a temp-file which is fsync()'ed,
+ * then renamed to 'path', and the directory fsync()'ed: So a crash leaves
+ * either the old file, or all of the new one, at 'path'; never a partial
+ * snapshot, as an un-synced file renamed into place can be.
+ *
+ * Returns: 0 on success; errno, after printing an error, on failure.
+ * -----------------------------------------------------------------------------
+ */
+// fsync() the directory holding 'path', to make a rename() into it durable.
+static int
+fsyncParentDir(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    size_t      dir_len = (slash ? (size_t) ((slash == path) ? 1 : (slash - path)) : 1);
+    char       *dir = malloc(dir_len + 1);
+    if (!dir) {
+        return ENOMEM;
+    }
+    if (slash) {
+        memcpy(dir, path, dir_len);
+    } else {
+        dir[0] = '.';
+    }
+    dir[dir_len] = '\0';
+
+    int rv = 0;
+    int fd = open(dir, (O_RDONLY | O_DIRECTORY));
+    if ((fd < 0) || (fsync(fd) != 0)) {
+        rv = (errno ? errno : EIO);
+        perror(dir);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(dir);
+    return rv;
+}
+
+int
+saveCSRGraph(const CSR_GRAPH *graph, const char *path)
+{
+    assert(graph && path);
+
+    CSR_FILE_HDR hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CSR_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = CSR_FILE_VERSION;
+    hdr.bom = CSR_FILE_BOM;
+    hdr.hdr_size = sizeof(hdr);
+    hdr.numnodes = graph->numnodes;
+    hdr.numedges = graph->numedges;
+
+    size_t tmp_len = (strlen(path) + sizeof(".tmp"));
+    char  *tmp_path = malloc(tmp_len);
+    if (!tmp_path) {
+        return ENOMEM;
+    }
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+
+    int   rv = 0;
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        rv = errno;
+        perror(tmp_path);
+        free(tmp_path);
+        return rv;
+    }
+    // A short fwrite() need not set errno; nor an fsync() of a full disk, on
+    // some file-systems. So, errno is cleared first, and EIO is the default.
+    size_t noffsets = ((size_t) graph->numnodes + 1);
+    errno = 0;
+    if ((fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+        || (fwrite(graph->offsets, sizeof(*graph->offsets), noffsets, fp) != noffsets)
+        || (fwrite(graph->edges, sizeof(*graph->edges), graph->numedges, fp)
+                != graph->numedges)
+        || (fflush(fp) != 0)
+        || (fsync(fileno(fp)) != 0)) {
+        rv = (errno ? errno : EIO);
+    }
+    errno = 0;
+    if ((fclose(fp) != 0) && !rv) {
+        rv = (errno ? errno : EIO);
+    }
+    errno = 0;
+    if (!rv && (rename(tmp_path, path) != 0)) {
+        rv = (errno ? errno : EIO);
+    }
+    if (rv) {
+        errno = rv;
+        perror(path);
+        unlink(tmp_path);
+    } else {
+        // The new snapshot is in place; a failure here only means the rename
+        // may not survive a crash.
+        rv = fsyncParentDir(path);
+    }
+    free(tmp_path);
+    return rv;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * loadCSRGraph(): Load a snapshot written by saveCSRGraph().
+ *
+ * The file is mmap()'ed read-only, and the graph's offsets[] and edges[]
+ * point straight into the mapping: Nothing is parsed or copied, so the load
+ * is O(1), and pages are read in on demand as traversals touch them, and
+ * shared with other processes mapping the same snapshot.
+ *
+ * Only the header, the file's size and the ends of offsets[] are checked,
+ * which is O(1); use validateCSRGraph() to check all of a graph from an
+ * untrusted source. The graph must not be modified; freeCSRGraph() unmaps it.
+ *
+ * Returns: Graph, or NULL after printing an error.
+ * -----------------------------------------------------------------------------
+ */
+CSR_GRAPH *
+loadCSRGraph(const char *path)
+{
+    assert(path);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+    size_t len = st.st_size;
+    if (len < sizeof(CSR_FILE_HDR)) {
+        printf("%s: Too short, %zu bytes, for a graph snapshot.\n", path, len);
+        close(fd);
+        return NULL;
+    }
+    void *addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror(path);
+        return NULL;
+    }
+
+    const CSR_FILE_HDR *hdr = (const CSR_FILE_HDR *) addr;
+    const char *errmsg = NULL;
+    uint64 offsets_len = (((uint64) hdr->numnodes + 1) * sizeof(uint64));
+    if (memcmp(hdr->magic, CSR_FILE_MAGIC, sizeof(hdr->magic))) {
+        errmsg = "Not a graph snapshot";
+    } else if (hdr->bom != CSR_FILE_BOM) {
+        errmsg = "Snapshot is in a different byte order";
+    } else if (hdr->version != CSR_FILE_VERSION) {
+        errmsg = "Unsupported snapshot version";
+    } else if ((hdr->hdr_size < sizeof(*hdr)) || (hdr->hdr_size % sizeof(uint64))) {
+        errmsg = "Bad header size";
+    } else if ((hdr->numedges > (len / sizeof(uint32)))
+               || (len != (hdr->hdr_size + offsets_len
+                           + (hdr->numedges * sizeof(uint32))))) {
+        errmsg = "File size does not match graph size";
+    }
+
+    CSR_GRAPH *graph = NULL;
+    if (!errmsg) {
+        graph = calloc(1, sizeof(*graph));
+        if (!graph) {
+            errmsg = "Out of memory";
+        }
+    }
+    if (graph) {
+        graph->numnodes = hdr->numnodes;
+        graph->numedges = hdr->numedges;
+        graph->offsets = (uint64 *) ((char *) addr + hdr->hdr_size);
+        graph->edges = (uint32 *) ((char *) graph->offsets + offsets_len);
+        graph->map_addr = addr;
+        graph->map_len = len;
+        if ((graph->offsets[0] != 0)
+            || (graph->offsets[graph->numnodes] != graph->numedges)) {
+            errmsg = "Corrupt offsets[]";
+            graph->map_addr = NULL;
+            free(graph);
+            graph = NULL;
+        }
+    }
+    if (errmsg) {
+        printf("%s: %s.\n", path, errmsg);
+        munmap(addr, len);
+    }
+    return graph;
+}
+
+/*
+ * validateCSRGraph(): O(V + E) check that offsets[] are non-decreasing and
+ * all edges are to nodes in the graph, so traversals stay in bounds.
+ *
+ * Returns: 1 if graph is valid, 0 otherwise.
+ */
+int
+validateCSRGraph(const CSR_GRAPH *graph)
+{
+    if (!graph || (graph->offsets[0] != 0)
+        || (graph->offsets[graph->numnodes] != graph->numedges)) {
+        return 0;
+    }
+    for (uint32 nctr = 0; nctr < graph->numnodes; nctr++) {
+        if (graph->offsets[nctr] > graph->offsets[nctr + 1]) {
+            return 0;
+        }
+    }
+    for (uint64 ectr = 0; ectr < graph->numedges; ectr++) {
+        if (graph->edges[ectr] >= graph->numnodes) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * Parallel, direction-optimizing BFS.
+ *
+ * Each level expands the current frontier into the next, in one of two ways:
+ *
+ *  - Top-down: Threads claim chunks of the frontier queue, and claim each
+ *    unvisited node at the end of an out-edge with an atomic test-and-set of
+ *    its bit in the visited bitmap. Cost is the # of out-edges of frontier.
+ *
+ *  - Bottom-up: Threads claim chunks of nodes; each unvisited node looks at
+ *    its in-edges for a parent in the frontier, tested in a frontier bitmap,
+ *    stopping at the 1st one found. Cost is, at most, the # of in-edges of
+ *    unvisited nodes, but is much less when the frontier is large, as most
+ *    nodes then find a parent within their first few in-edges.
+ *
+ * The BFS starts top-down and switches to bottom-up when the frontier's
+ * out-edges, m_f, exceed those of unvisited nodes, m_u, by Bfs_alpha; it
+ * switches back once the frontier is shrinking and smaller than
+ * numnodes / Bfs_beta. These are the heuristics, and constants, of Beamer
+ * et al.
+ *
+ * Either way, newly visited nodes are metered into small per-thread buffers,
+ * which are appended to the shared next-frontier queue with a single atomic
+ * add each, so threads rarely contend on the queue.
+ *
+ * Threads are started once per BFS, and step from level to level at
+ * barriers; thread 0 is the caller, which also sets up each level.
+ * -----------------------------------------------------------------------------
+ */
+#define BFS_WORD(node)  ((node) >> 6)
+#define BFS_BIT(node)   (1ULL << ((node) & 63))
+
+const uint64 Bfs_alpha        = 14;
+const uint32 Bfs_beta         = 24;
+const uint32 Bfs_td_chunk     = 64;        // Frontier nodes claimed at a time
+const uint32 Bfs_bu_chunk     = 4096;      // Nodes claimed at a time; % 64 == 0
+#define      BFS_LOCAL_BUF      1024       // Per-thread next-frontier buffer
+
+typedef struct bfs_shared
+{
+    const CSR_GRAPH *   graph;
+    const CSR_GRAPH *   rgraph;         // In-edges; NULL for top-down only
+    int *               depth;
+    _Atomic uint64 *    visited;        // Bitmap of numnodes bits
+    _Atomic uint64 *    front_bm;       // Bitmap of frontier[], in bottom-up
+
+    uint32 *            frontier;       // Nodes at depth == level
+    uint32              nfrontier;
+    uint32 *            next;           // Nodes at depth == (level + 1)
+    _Atomic uint32      nnext;
+
+    _Atomic uint64      step_cursor;    // Work claimed by threads in each phase
+    _Atomic uint64      set_cursor;
+    _Atomic uint64      clear_cursor;
+
+    _Atomic uint64      next_edges;     // m_f: Out-edges of next[]
+    _Atomic uint64      edges_examined;
+    uint64              unvisited_edges;// m_u: Out-edges of unvisited nodes
+
+    int                 level;
+    int                 bottom_up;
+    int                 done;
+    BFS_STATS           stats;
+    pthread_barrier_t   barrier;
+} BFS_SHARED;
+
+typedef struct bfs_thread
+{
+    BFS_SHARED *    shared;
+    int             tid;
+    uint32          nbuf;
+    uint64          next_edges;
+    uint64          edges_examined;
+    uint32          buf[BFS_LOCAL_BUF];
+} BFS_THREAD;
+
+static void
+bfsFlush(BFS_THREAD *thread)
+{
+    BFS_SHARED *shared = thread->shared;
+    if (thread->nbuf) {
+        uint32 pos = atomic_fetch_add_explicit(&shared->nnext, thread->nbuf,
+                                               memory_order_relaxed);
+        memcpy(&shared->next[pos], thread->buf, (thread->nbuf * sizeof(*thread->buf)));
+        thread->nbuf = 0;
+    }
+}
+
+// Node was claimed by this thread: Record its depth, add it to next frontier.
+static inline void
+bfsVisit(BFS_THREAD *thread, uint32 node)
+{
+    BFS_SHARED *shared = thread->shared;
+    shared->depth[node] = (shared->level + 1);
+    thread->next_edges += csrDegree(shared->graph, node);
+    thread->buf[thread->nbuf++] = node;
+    if (thread->nbuf == BFS_LOCAL_BUF) {
+        bfsFlush(thread);
+    }
+}
+
+static void
+bfsTopDownStep(BFS_THREAD *thread)
+{
+    BFS_SHARED     *shared = thread->shared;
+    const uint64   *offsets = shared->graph->offsets;
+    const uint32   *edges = shared->graph->edges;
+    _Atomic uint64 *visited = shared->visited;
+
+    for (;;) {
+        uint64 begin = atomic_fetch_add_explicit(&shared->step_cursor, Bfs_td_chunk,
+                                                 memory_order_relaxed);
+        if (begin >= shared->nfrontier) {
+            break;
+        }
+        uint64 end = (begin + Bfs_td_chunk);
+        if (end > shared->nfrontier) {
+            end = shared->nfrontier;
+        }
+        for (uint64 fctr = begin; fctr < end; fctr++) {
+            uint32 node = shared->frontier[fctr];
+            thread->edges_examined += (offsets[node + 1] - offsets[node]);
+            for (uint64 ectr = offsets[node]; ectr < offsets[node + 1]; ectr++) {
+                uint32 tonode = edges[ectr];
+                _Atomic uint64 *word = &visited[BFS_WORD(tonode)];
+                uint64 bit = BFS_BIT(tonode);
+
+                // Cheap load first; most edges lead to visited nodes.
+                if (atomic_load_explicit(word, memory_order_relaxed) & bit) {
+                    continue;
+                }
+                if (atomic_fetch_or_explicit(word, bit, memory_order_relaxed) & bit) {
+                    continue;
+                }
+                bfsVisit(thread, tonode);
+            }
+        }
+    }
+}
+
+static void
+bfsBottomUpStep(BFS_THREAD *thread)
+{
+    BFS_SHARED     *shared = thread->shared;
+    const uint64   *roffsets = shared->rgraph->offsets;
+    const uint32   *redges = shared->rgraph->edges;
+    _Atomic uint64 *visited = shared->visited;
+    _Atomic uint64 *front_bm = shared->front_bm;
+    uint32          numnodes = shared->graph->numnodes;
+
+    for (;;) {
+        uint64 begin = atomic_fetch_add_explicit(&shared->step_cursor, Bfs_bu_chunk,
+                                                 memory_order_relaxed);
+        if (begin >= numnodes) {
+            break;
+        }
+        uint64 end = (begin + Bfs_bu_chunk);
+        if (end > numnodes) {
+            end = numnodes;
+        }
+        // Chunks are whole words of visited[], so only this thread sets
+        // these bits in this step.
+        for (uint32 node = begin; node < end; node++) {
+            _Atomic uint64 *word = &visited[BFS_WORD(node)];
+            if (atomic_load_explicit(word, memory_order_relaxed) & BFS_BIT(node)) {
+                continue;
+            }
+            for (uint64 ectr = roffsets[node]; ectr < roffsets[node + 1]; ectr++) {
+                uint32 parent = redges[ectr];
+                thread->edges_examined++;
+                if (atomic_load_explicit(&front_bm[BFS_WORD(parent)], memory_order_relaxed)
+                        & BFS_BIT(parent)) {
+                    atomic_fetch_or_explicit(word, BFS_BIT(node), memory_order_relaxed);
+                    bfsVisit(thread, node);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Set, or clear, the bits of frontier[] nodes in front_bm.
+static void
+bfsFrontierBits(BFS_SHARED *shared, _Atomic uint64 *cursor, int set)
+{
+    for (;;) {
+        uint64 begin = atomic_fetch_add_explicit(cursor, Bfs_bu_chunk,
+                                                 memory_order_relaxed);
+        if (begin >= shared->nfrontier) {
+            break;
+        }
+        uint64 end = (begin + Bfs_bu_chunk);
+        if (end > shared->nfrontier) {
+            end = shared->nfrontier;
+        }
+        for (uint64 fctr = begin; fctr < end; fctr++) {
+            uint32 node = shared->frontier[fctr];
+            _Atomic uint64 *word = &shared->front_bm[BFS_WORD(node)];
+            if (set) {
+                atomic_fetch_or_explicit(word, BFS_BIT(node), memory_order_relaxed);
+            } else {
+                atomic_fetch_and_explicit(word, ~BFS_BIT(node), memory_order_relaxed);
+            }
+        }
+    }
+}
+
+// Run by thread 0, between levels: Advance to the next frontier, and pick the
+// direction to expand it in.
+static void
+bfsNextLevel(BFS_SHARED *shared)
+{
+    uint32 prev_nfrontier = shared->nfrontier;
+    uint64 next_edges = atomic_load(&shared->next_edges);
+
+    shared->stats.nlevels++;
+    if (shared->bottom_up) {
+        shared->stats.nbottomup++;
+    } else {
+        shared->stats.ntopdown++;
+    }
+
+    uint32 *tmp = shared->frontier;
+    shared->frontier = shared->next;
+    shared->next = tmp;
+    shared->nfrontier = atomic_load(&shared->nnext);
+    shared->stats.nreached += shared->nfrontier;
+    shared->stats.edges_reached += next_edges;
+    shared->unvisited_edges -= next_edges;
+    shared->level++;
+
+    if (!shared->rgraph) {
+        shared->bottom_up = 0;
+    } else if (!shared->bottom_up) {
+        shared->bottom_up = (next_edges > (shared->unvisited_edges / Bfs_alpha));
+    } else if ((shared->nfrontier < prev_nfrontier)
+               && (shared->nfrontier < (shared->graph->numnodes / Bfs_beta))) {
+        shared->bottom_up = 0;
+    }
+
+    atomic_store(&shared->nnext, 0);
+    atomic_store(&shared->next_edges, 0);
+    atomic_store(&shared->step_cursor, 0);
+    atomic_store(&shared->set_cursor, 0);
+    atomic_store(&shared->clear_cursor, 0);
+    shared->done = (shared->nfrontier == 0);
+}
+
+static void *
+bfsWorker(void *arg)
+{
+    BFS_THREAD *thread = (BFS_THREAD *) arg;
+    BFS_SHARED *shared = thread->shared;
+
+    for (;;) {
+        pthread_barrier_wait(&shared->barrier);     // Level is set up
+        if (shared->done) {
+            break;
+        }
+        if (shared->bottom_up) {
+            bfsFrontierBits(shared, &shared->set_cursor, 1);
+            pthread_barrier_wait(&shared->barrier);
+            bfsBottomUpStep(thread);
+            pthread_barrier_wait(&shared->barrier);
+            bfsFrontierBits(shared, &shared->clear_cursor, 0);
+        } else {
+            bfsTopDownStep(thread);
+        }
+        bfsFlush(thread);
+        atomic_fetch_add_explicit(&shared->next_edges, thread->next_edges,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&shared->edges_examined, thread->edges_examined,
+                                  memory_order_relaxed);
+        thread->next_edges = 0;
+        thread->edges_examined = 0;
+
+        pthread_barrier_wait(&shared->barrier);     // Level is done
+        if (thread->tid == 0) {
+            bfsNextLevel(shared);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * bfsCSRParallel(): BFS from node 'src', using 'nthreads' threads.
+ *
+ * Parameters:
+ *  rgraph  - Transpose of 'graph', from transposeCSRGraph(), for bottom-up
+ *            steps; pass 'graph' itself if it is undirected, or NULL to only
+ *            expand top-down.
+ *  depth   - Array of numnodes entries; returns same depths as bfsCSR().
+ *  stats   - Optional; returns counts and timing of the BFS. TEPS is
+ *            (stats->edges_reached / stats->secs).
+ *
+ * Returns: # of nodes reached, including 'src'; 0 if out of memory.
+ * -----------------------------------------------------------------------------
+ */
+uint32
+bfsCSRParallel(const CSR_GRAPH *graph, const CSR_GRAPH *rgraph, uint32 src,
+               int *depth, int nthreads, BFS_STATS *stats)
+{
+    assert(graph && depth);
+    assert(src < graph->numnodes);
+    assert(!rgraph || (rgraph->numnodes == graph->numnodes));
+
+    double start = now_secs();
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    uint32 numnodes = graph->numnodes;
+    size_t nwords = ((numnodes + 63) / 64);
+
+    BFS_SHARED  shared = { 0 };
+    BFS_THREAD *threads = calloc(nthreads, sizeof(*threads));
+    pthread_t  *tids = calloc(nthreads, sizeof(*tids));
+    shared.visited = calloc(nwords, sizeof(*shared.visited));
+    shared.front_bm = calloc(nwords, sizeof(*shared.front_bm));
+    shared.frontier = malloc(numnodes * sizeof(*shared.frontier));
+    shared.next = malloc(numnodes * sizeof(*shared.next));
+
+    uint32 nreached = 0;
+    if (!threads || !tids || !shared.visited || !shared.front_bm
+        || !shared.frontier || !shared.next) {
+        goto done;
+    }
+
+    for (uint32 nctr = 0; nctr < numnodes; nctr++) {
+        depth[nctr] = CSR_UNREACHED;
+    }
+    shared.graph = graph;
+    shared.rgraph = rgraph;
+    shared.depth = depth;
+
+    depth[src] = 0;
+    shared.visited[BFS_WORD(src)] = BFS_BIT(src);
+    shared.frontier[0] = src;
+    shared.nfrontier = 1;
+    shared.stats.nreached = 1;
+    shared.stats.edges_reached = csrDegree(graph, src);
+    shared.unvisited_edges = (graph->numedges - csrDegree(graph, src));
+
+    pthread_barrier_init(&shared.barrier, NULL, nthreads);
+    for (int tctr = 0; tctr < nthreads; tctr++) {
+        threads[tctr].shared = &shared;
+        threads[tctr].tid = tctr;
+    }
+    for (int tctr = 1; tctr < nthreads; tctr++) {
+        int rv = pthread_create(&tids[tctr], NULL, bfsWorker, &threads[tctr]);
+        assert(rv == 0);
+        (void) rv;
+    }
+    bfsWorker(&threads[0]);
+    for (int tctr = 1; tctr < nthreads; tctr++) {
+        pthread_join(tids[tctr], NULL);
+    }
+    pthread_barrier_destroy(&shared.barrier);
+
+    nreached = shared.stats.nreached;
+    shared.stats.edges_examined = atomic_load(&shared.edges_examined);
+    shared.stats.secs = (now_secs() - start);
+    if (stats) {
+        *stats = shared.stats;
+    }
+
+done:
+    free(shared.next);
+    free(shared.frontier);
+    free((void *) shared.front_bm);
+    free((void *) shared.visited);
+    free(tids);
+    free(threads);
+    return nreached;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * bfsBenchmark(): Build a random graph, and report TEPS (traversed edges per
+ * second) of serial BFS, parallel top-down BFS and parallel
+ * direction-optimizing BFS from node 0. Depths from all three must match.
+ * -----------------------------------------------------------------------------
+ */
+int
+bfsBenchmark(uint32 numnodes, uint32 avg_degree, int nthreads)
+{
+    if ((numnodes < 2) || (avg_degree < 1)) {
+        printf("Error: Need numnodes >= 2 and avg-degree >= 1.\n");
+        return 1;
+    }
+    uint64 numedges = ((uint64) numnodes * avg_degree);
+
+    double     start = now_secs();
+    CSR_GRAPH *graph = mkRandomCSRGraph(numnodes, numedges, 20);
+    CSR_GRAPH *rgraph = (graph ? transposeCSRGraph(graph) : NULL);
+    int       *exp_depth = malloc(numnodes * sizeof(*exp_depth));
+    int       *depth = malloc(numnodes * sizeof(*depth));
+    if (!graph || !rgraph || !exp_depth || !depth) {
+        printf("Error: Out of memory for %u nodes, %lu edges.\n",
+               numnodes, (unsigned long) numedges);
+        return 1;
+    }
+    printf("%u nodes, %lu edges, %d threads: Built graph in %.3fs\n",
+           numnodes, (unsigned long) numedges, nthreads, (now_secs() - start));
+
+    start = now_secs();
+    uint32 nreached = bfsCSR(graph, 0, exp_depth, NULL);
+    double secs = (now_secs() - start);
+    uint64 edges_reached = 0;
+    for (uint32 nctr = 0; nctr < numnodes; nctr++) {
+        if (exp_depth[nctr] != CSR_UNREACHED) {
+            edges_reached += csrDegree(graph, nctr);
+        }
+    }
+    printf("%-20s: %.3fs, %.1f M TEPS, reached=%u\n", "Serial",
+           secs, (edges_reached / secs / 1e6), nreached);
+
+    int rv = 0;
+    for (int direction_opt = 0; direction_opt <= 1; direction_opt++) {
+        BFS_STATS stats;
+        bfsCSRParallel(graph, (direction_opt ? rgraph : NULL), 0, depth,
+                       nthreads, &stats);
+        if (memcmp(depth, exp_depth, (numnodes * sizeof(*depth)))) {
+            printf("Error: Parallel BFS depths differ from serial BFS.\n");
+            rv = 1;
+        }
+        printf("%-20s: %.3fs, %.1f M TEPS, reached=%u, levels=%u"
+               " (top-down=%u, bottom-up=%u), edges examined=%lu\n",
+               (direction_opt ? "Direction-optimizing" : "Top-down"),
+               stats.secs, (stats.edges_reached / stats.secs / 1e6),
+               stats.nreached, stats.nlevels, stats.ntopdown, stats.nbottomup,
+               (unsigned long) stats.edges_examined);
+    }
+    free(depth);
+    free(exp_depth);
+    freeCSRGraph(&rgraph);
+    freeCSRGraph(&graph);
+    return rv;
+}
+
+// Build a random graph as bfsBenchmark() does, and save a snapshot of it.
+int
+saveRandomGraph(const char *path, uint32 numnodes, uint32 avg_degree)
+{
+    if ((numnodes < 2) || (avg_degree < 1)) {
+        printf("Error: Need numnodes >= 2 and avg-degree >= 1.\n");
+        return 1;
+    }
+    double     start = now_secs();
+    CSR_GRAPH *graph = mkRandomCSRGraph(numnodes, ((uint64) numnodes * avg_degree), 20);
+    if (!graph) {
+        printf("Error: Out of memory for %u nodes.\n", numnodes);
+        return 1;
+    }
+    double build_secs = (now_secs() - start);
+
+    start = now_secs();
+    int rv = saveCSRGraph(graph, path);
+    printf("%s: %u nodes, %lu edges: Built in %.3fs, saved in %.3fs\n",
+           path, graph->numnodes, (unsigned long) graph->numedges,
+           build_secs, (now_secs() - start));
+    freeCSRGraph(&graph);
+    return (rv ? 1 : 0);
+}
+
+// Load a snapshot, and report the load time and a parallel BFS from node 0.
+int
+loadGraphBenchmark(const char *path, int nthreads)
+{
+    double     start = now_secs();
+    CSR_GRAPH *graph = loadCSRGraph(path);
+    if (!graph) {
+        return 1;
+    }
+    double load_secs = (now_secs() - start);
+
+    int *depth = malloc(graph->numnodes * sizeof(*depth));
+    if (!depth) {
+        freeCSRGraph(&graph);
+        return 1;
+    }
+    BFS_STATS stats;
+    bfsCSRParallel(graph, NULL, 0, depth, nthreads, &stats);
+    printf("%s: %u nodes, %lu edges: Loaded in %.6fs;"
+           " top-down BFS in %.3fs, %.1f M TEPS, reached=%u\n",
+           path, graph->numnodes, (unsigned long) graph->numedges, load_secs,
+           stats.secs, (stats.edges_reached / stats.secs / 1e6), stats.nreached);
+    free(depth);
+    freeCSRGraph(&graph);
+    return 0;
+}
+
+// Wall-clock time, in seconds.
+double
+now_secs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
 // **** Test cases ****
 
 void
@@ -310,7 +1463,527 @@ test_buildGraph_1node(void)
     int    *to_nodes[1];
 
     // Initialize the array of to[] nodes that each node is pointing to.
-    to_nodes[0] = {1, 2};
+    int    to_nodes0[] = {1, 2};
+    to_nodes[0] = to_nodes0;
 
+    GRAPHNODE *nodes = buildGraph(numnodes, nodeids, nto_nodes, to_nodes);
+    assert(nodes);
+    assert(nodes[0].id == 1);
+    assert(nodes[0].degree == 2);
+    assert((nodes[0].tonodes[0] == 1) && (nodes[0].tonodes[1] == 2));
+
+    freeGraph(&nodes, numnodes);
+    assert(nodes == NULL);
     TEST_END();
 }
+
+/*
+ * Small graph shared by CSR tests; edges listed out of 'from' order:
+ *
+ *    0 -> 1, 2     1 -> 3     2 -> 3, 4     3 -> 5     4 -> 5
+ *    5 -> 0        6 -> 5     7: No edges
+ */
+static const uint32 Csr_from[] = { 2, 0, 1, 6, 0, 2, 3, 4, 5 };
+static const uint32 Csr_to[]   = { 3, 1, 3, 5, 2, 4, 5, 5, 0 };
+static const uint32 Csr_numnodes = 8;
+
+void
+test_buildCSRGraph(void)
+{
+    TEST_START();
+
+    CSR_GRAPH *graph = buildCSRGraph(Csr_numnodes, ARRAYSIZE(Csr_from),
+                                     Csr_from, Csr_to);
+    assert(graph);
+    assert(graph->numnodes == Csr_numnodes);
+    assert(graph->numedges == ARRAYSIZE(Csr_from));
+
+    uint64 exp_offsets[] = { 0, 2, 3, 5, 6, 7, 8, 9, 9 };
+    uint32 exp_edges[]   = { 1, 2, 3, 3, 4, 5, 5, 0, 5 };
+    for (int nctr = 0; nctr < ARRAYSIZE(exp_offsets); nctr++) {
+        assert(graph->offsets[nctr] == exp_offsets[nctr]);
+    }
+    for (int ectr = 0; ectr < ARRAYSIZE(exp_edges); ectr++) {
+        assert(graph->edges[ectr] == exp_edges[ectr]);
+    }
+    assert(csrDegree(graph, 0) == 2);
+    assert(csrDegree(graph, 7) == 0);
+    freeCSRGraph(&graph);
+    assert(graph == NULL);
+
+    // Edge to a node out of range is rejected.
+    uint32 from[] = { 0 };
+    uint32 to[]   = { 8 };
+    assert(buildCSRGraph(Csr_numnodes, 1, from, to) == NULL);
+
+    // Graph with no edges.
+    graph = buildCSRGraph(3, 0, NULL, NULL);
+    assert(graph && (graph->offsets[3] == 0));
+    freeCSRGraph(&graph);
+
+    TEST_END();
+}
+
+void
+test_bfsCSR(void)
+{
+    TEST_START();
+
+    CSR_GRAPH *graph = buildCSRGraph(Csr_numnodes, ARRAYSIZE(Csr_from),
+                                     Csr_from, Csr_to);
+    assert(graph);
+
+    int    depth[Csr_numnodes];
+    uint32 order[Csr_numnodes];
+    uint32 nreached = bfsCSR(graph, 0, depth, order);
+    assert(nreached == 6);
+
+    uint32 exp_order[] = { 0, 1, 2, 3, 4, 5 };
+    int    exp_depth[] = { 0, 1, 1, 2, 2, 3, CSR_UNREACHED, CSR_UNREACHED };
+    for (int nctr = 0; nctr < ARRAYSIZE(exp_order); nctr++) {
+        assert(order[nctr] == exp_order[nctr]);
+    }
+    for (int nctr = 0; nctr < ARRAYSIZE(exp_depth); nctr++) {
+        assert(depth[nctr] == exp_depth[nctr]);
+    }
+
+    // From 6, via 5 -> 0, everything except 7 is reachable.
+    nreached = bfsCSR(graph, 6, depth, NULL);
+    assert(nreached == 7);
+    assert((depth[6] == 0) && (depth[5] == 1) && (depth[0] == 2));
+    assert(depth[7] == CSR_UNREACHED);
+
+    // Isolated node reaches only itself.
+    assert(bfsCSR(graph, 7, depth, order) == 1);
+    assert(order[0] == 7);
+
+    freeCSRGraph(&graph);
+    TEST_END();
+}
+
+void
+test_dfsCSR(void)
+{
+    TEST_START();
+
+    CSR_GRAPH *graph = buildCSRGraph(Csr_numnodes, ARRAYSIZE(Csr_from),
+                                     Csr_from, Csr_to);
+    assert(graph);
+
+    uint32 order[Csr_numnodes];
+    uint32 nreached = dfsCSR(graph, 0, order);
+    assert(nreached == 6);
+
+    // 0 -> 1 -> 3 -> 5 (-> 0 visited), back up to 0 -> 2 -> (3 visited) 4.
+    uint32 exp_order[] = { 0, 1, 3, 5, 2, 4 };
+    for (int nctr = 0; nctr < ARRAYSIZE(exp_order); nctr++) {
+        assert(order[nctr] == exp_order[nctr]);
+    }
+
+    nreached = dfsCSR(graph, 6, order);
+    assert(nreached == 7);
+    uint32 exp_order6[] = { 6, 5, 0, 1, 3, 2, 4 };
+    for (int nctr = 0; nctr < ARRAYSIZE(exp_order6); nctr++) {
+        assert(order[nctr] == exp_order6[nctr]);
+    }
+
+    // A 1M-node chain: Too deep for a recursive DFS on a default stack.
+    uint32  numnodes = (1024 * 1024);
+    uint32 *from = malloc((numnodes - 1) * sizeof(*from));
+    uint32 *to = malloc((numnodes - 1) * sizeof(*to));
+    uint32 *chain_order = malloc(numnodes * sizeof(*chain_order));
+    assert(from && to && chain_order);
+    for (uint32 nctr = 0; nctr < (numnodes - 1); nctr++) {
+        from[nctr] = nctr;
+        to[nctr] = (nctr + 1);
+    }
+    CSR_GRAPH *chain = buildCSRGraph(numnodes, (numnodes - 1), from, to);
+    assert(chain);
+    assert(dfsCSR(chain, 0, chain_order) == numnodes);
+    assert(chain_order[numnodes - 1] == (numnodes - 1));
+
+    freeCSRGraph(&chain);
+    free(chain_order);
+    free(to);
+    free(from);
+    freeCSRGraph(&graph);
+    TEST_END();
+}
+
+/*
+ * Build a random graph with 'numedges' edges, a ring 0 -> 1 -> ... -> 0
+ * among them so all nodes are reachable, and the rest random.
+ */
+CSR_GRAPH *
+mkRandomCSRGraph(uint32 numnodes, uint64 numedges, unsigned int seed)
+{
+    assert(numedges >= numnodes);
+
+    uint32 *from = malloc(numedges * sizeof(*from));
+    uint32 *to = malloc(numedges * sizeof(*to));
+    assert(from && to);
+
+    srand(seed);
+    for (uint64 ectr = 0; ectr < numedges; ectr++) {
+        if (ectr < numnodes) {
+            from[ectr] = (uint32) ectr;
+            to[ectr] = (uint32) ((ectr + 1) % numnodes);
+        } else {
+            from[ectr] = (rand() % numnodes);
+            to[ectr] = (rand() % numnodes);
+        }
+    }
+    CSR_GRAPH *graph = buildCSRGraph(numnodes, numedges, from, to);
+    free(to);
+    free(from);
+    return graph;
+}
+
+// Build and traverse a 2M-node, 16M-edge graph; report the times taken.
+void
+test_CSR_large_graph(void)
+{
+    TEST_START();
+
+    uint32 numnodes = (2 * 1024 * 1024);
+    uint64 numedges = (8ULL * numnodes);
+
+    clock_t    start = clock();
+    CSR_GRAPH *graph = mkRandomCSRGraph(numnodes, numedges, 19);
+    double     build_secs = ((double) (clock() - start) / CLOCKS_PER_SEC);
+    assert(graph);
+
+    int    *depth = malloc(numnodes * sizeof(*depth));
+    uint32 *order = malloc(numnodes * sizeof(*order));
+    assert(depth && order);
+
+    start = clock();
+    uint32 nreached = bfsCSR(graph, 0, depth, order);
+    double bfs_secs = ((double) (clock() - start) / CLOCKS_PER_SEC);
+    assert(nreached == numnodes);
+
+    // Each edge can shorten a path by at most 1, and order is by depth.
+    for (uint32 nctr = 0; nctr < numnodes; nctr++) {
+        for (uint64 ectr = graph->offsets[nctr]; ectr < graph->offsets[nctr + 1]; ectr++) {
+            assert(depth[graph->edges[ectr]] <= (depth[nctr] + 1));
+        }
+        if (nctr) {
+            assert(depth[order[nctr - 1]] <= depth[order[nctr]]);
+        }
+    }
+
+    start = clock();
+    nreached = dfsCSR(graph, 0, order);
+    double dfs_secs = ((double) (clock() - start) / CLOCKS_PER_SEC);
+    assert(nreached == numnodes);
+
+    printf("\n%u nodes, %lu edges: build=%.3fs, BFS=%.3fs, DFS=%.3fs",
+           numnodes, (unsigned long) numedges, build_secs, bfs_secs, dfs_secs);
+
+    free(order);
+    free(depth);
+    freeCSRGraph(&graph);
+    TEST_END();
+}
+
+void
+test_transposeCSRGraph(void)
+{
+    TEST_START();
+
+    CSR_GRAPH *graph = buildCSRGraph(Csr_numnodes, ARRAYSIZE(Csr_from),
+                                     Csr_from, Csr_to);
+    CSR_GRAPH *rgraph = transposeCSRGraph(graph);
+    assert(graph && rgraph);
+    assert(rgraph->numedges == graph->numedges);
+
+    // In-edges: 0 <- 5; 1 <- 0; 2 <- 0; 3 <- 1, 2; 4 <- 2; 5 <- 3, 4, 6
+    uint64 exp_offsets[] = { 0, 1, 2, 3, 5, 6, 9, 9, 9 };
+    uint32 exp_edges[]   = { 5, 0, 0, 1, 2, 2, 3, 4, 6 };
+    for (int nctr = 0; nctr < ARRAYSIZE(exp_offsets); nctr++) {
+        assert(rgraph->offsets[nctr] == exp_offsets[nctr]);
+    }
+    for (int ectr = 0; ectr < ARRAYSIZE(exp_edges); ectr++) {
+        assert(rgraph->edges[ectr] == exp_edges[ectr]);
+    }
+
+    // Transpose of transpose is the original, as edges are kept sorted by
+    // 'from' node in the transpose.
+    CSR_GRAPH *graph2 = transposeCSRGraph(rgraph);
+    assert(graph2);
+    assert(!memcmp(graph2->offsets, graph->offsets,
+                   ((Csr_numnodes + 1) * sizeof(*graph->offsets))));
+
+    freeCSRGraph(&graph2);
+    freeCSRGraph(&rgraph);
+    freeCSRGraph(&graph);
+    TEST_END();
+}
+
+// Parallel BFS depths must match serial BFS, in either direction, for
+// sparse and dense graphs, and any # of threads.
+void
+test_bfsCSRParallel(void)
+{
+    TEST_START();
+
+    CSR_GRAPH *graph = buildCSRGraph(Csr_numnodes, ARRAYSIZE(Csr_from),
+                                     Csr_from, Csr_to);
+    CSR_GRAPH *rgraph = transposeCSRGraph(graph);
+    assert(graph && rgraph);
+
+    int exp_depth[Csr_numnodes];
+    int depth[Csr_numnodes];
+    for (uint32 src = 0; src < Csr_numnodes; src++) {
+        uint32 exp_nreached = bfsCSR(graph, src, exp_depth, NULL);
+        for (int nthreads = 1; nthreads <= 4; nthreads++) {
+            assert(bfsCSRParallel(graph, rgraph, src, depth, nthreads, NULL)
+                   == exp_nreached);
+            assert(!memcmp(depth, exp_depth, sizeof(depth)));
+        }
+    }
+    freeCSRGraph(&rgraph);
+    freeCSRGraph(&graph);
+
+    struct { uint32 numnodes; uint32 degree; } cases[] = {
+          { 1000, 1 }           // Ring plus nothing: Top-down only
+        , { 5000, 2 }
+        , { 20000, 8 }
+        , { 50000, 16 }         // Dense: Some bottom-up levels
+    };
+    for (int cctr = 0; cctr < ARRAYSIZE(cases); cctr++) {
+        uint32 numnodes = cases[cctr].numnodes;
+        graph = mkRandomCSRGraph(numnodes, ((uint64) numnodes * cases[cctr].degree),
+                                 (21 + cctr));
+        rgraph = transposeCSRGraph(graph);
+        assert(graph && rgraph);
+
+        int *exp_depths = malloc(numnodes * sizeof(*exp_depths));
+        int *depths = malloc(numnodes * sizeof(*depths));
+        assert(exp_depths && depths);
+
+        uint32 src = (cctr * 7);
+        uint32 exp_nreached = bfsCSR(graph, src, exp_depths, NULL);
+        for (int nthreads = 1; nthreads <= 5; nthreads += 2) {
+            BFS_STATS stats;
+            assert(bfsCSRParallel(graph, rgraph, src, depths, nthreads, &stats)
+                   == exp_nreached);
+            assert(!memcmp(depths, exp_depths, (numnodes * sizeof(*depths))));
+            assert(stats.nlevels == (stats.ntopdown + stats.nbottomup));
+            if (cases[cctr].degree >= 16) {
+                assert(stats.nbottomup > 0);
+            }
+
+            assert(bfsCSRParallel(graph, NULL, src, depths, nthreads, &stats)
+                   == exp_nreached);
+            assert(!memcmp(depths, exp_depths, (numnodes * sizeof(*depths))));
+            assert(stats.nbottomup == 0);
+            assert(stats.edges_examined == graph->numedges);
+        }
+        free(depths);
+        free(exp_depths);
+        freeCSRGraph(&rgraph);
+        freeCSRGraph(&graph);
+    }
+    TEST_END();
+}
+
+// 2M nodes, 32M edges; report TEPS.
+void
+test_bfsCSRParallel_large_graph(void)
+{
+    TEST_START();
+    printf("\n");
+    int rv = bfsBenchmark((2 * 1024 * 1024), 16, 4);
+    assert(rv == 0);
+    (void) rv;
+    TEST_END();
+}
+
+// Snapshot round-trip: Loaded graph has the same arrays, in the mapping.
+void
+test_CSR_snapshot(void)
+{
+    TEST_START();
+
+    char path[] = "/tmp/ch4.graph-snapshot.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    CSR_GRAPH *graph = buildCSRGraph(Csr_numnodes, ARRAYSIZE(Csr_from),
+                                     Csr_from, Csr_to);
+    assert(graph);
+    assert(saveCSRGraph(graph, path) == 0);
+
+    CSR_GRAPH *loaded = loadCSRGraph(path);
+    assert(loaded);
+    assert(loaded->map_addr);
+    assert(loaded->numnodes == graph->numnodes);
+    assert(loaded->numedges == graph->numedges);
+    assert(loaded->offsets == (uint64 *) ((char *) loaded->map_addr + sizeof(CSR_FILE_HDR)));
+    assert(!memcmp(loaded->offsets, graph->offsets,
+                   ((Csr_numnodes + 1) * sizeof(*graph->offsets))));
+    assert(!memcmp(loaded->edges, graph->edges,
+                   (graph->numedges * sizeof(*graph->edges))));
+    assert(validateCSRGraph(loaded));
+
+    int    exp_depth[Csr_numnodes];
+    int    depth[Csr_numnodes];
+    assert(bfsCSR(graph, 0, exp_depth, NULL) == bfsCSR(loaded, 0, depth, NULL));
+    assert(!memcmp(depth, exp_depth, sizeof(depth)));
+
+    freeCSRGraph(&loaded);
+    assert(loaded == NULL);
+    freeCSRGraph(&graph);
+
+    // Graph with no edges.
+    graph = buildCSRGraph(3, 0, NULL, NULL);
+    assert(graph && (saveCSRGraph(graph, path) == 0));
+    loaded = loadCSRGraph(path);
+    assert(loaded && (loaded->numnodes == 3) && (loaded->numedges == 0));
+    freeCSRGraph(&loaded);
+    freeCSRGraph(&graph);
+
+    unlink(path);
+    TEST_END();
+}
+
+// Write 'len' bytes of 'data' to 'path'.
+static void
+writeTestFile(const char *path, const void *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+    assert(fp);
+    size_t nwritten = fwrite(data, 1, len, fp);
+    assert(nwritten == len);
+    (void) nwritten;
+    fclose(fp);
+}
+
+// Damaged, truncated or foreign snapshots must be rejected at load.
+void
+test_CSR_snapshot_bad_files(void)
+{
+    TEST_START();
+    printf("\n");
+
+    char path[] = "/tmp/ch4.graph-snapshot.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    assert(loadCSRGraph("/tmp/no-such-dir/no-such-file") == NULL);
+
+    CSR_GRAPH *graph = buildCSRGraph(Csr_numnodes, ARRAYSIZE(Csr_from),
+                                     Csr_from, Csr_to);
+    assert(graph && (saveCSRGraph(graph, path) == 0));
+
+    // Read back a good image, to damage copies of it.
+    struct stat st;
+    stat(path, &st);
+    size_t len = st.st_size;
+    char  *image = malloc(len);
+    char  *bad = malloc(len);
+    assert(image && bad);
+    FILE  *fp = fopen(path, "rb");
+    assert(fp && (fread(image, 1, len, fp) == len));
+    fclose(fp);
+    CSR_FILE_HDR *hdr = (CSR_FILE_HDR *) bad;
+
+    writeTestFile(path, image, (sizeof(CSR_FILE_HDR) - 1));    // Short
+    assert(loadCSRGraph(path) == NULL);
+
+    writeTestFile(path, image, (len - 1));                      // Truncated
+    assert(loadCSRGraph(path) == NULL);
+
+    memcpy(bad, image, len);
+    bad[0] = 'X';                                                // Magic
+    writeTestFile(path, bad, len);
+    assert(loadCSRGraph(path) == NULL);
+
+    memcpy(bad, image, len);
+    hdr->bom = 0x04030201;                                      // Byte order
+    writeTestFile(path, bad, len);
+    assert(loadCSRGraph(path) == NULL);
+
+    memcpy(bad, image, len);
+    hdr->version = (CSR_FILE_VERSION + 1);                      // Version
+    writeTestFile(path, bad, len);
+    assert(loadCSRGraph(path) == NULL);
+
+    memcpy(bad, image, len);
+    hdr->numedges++;                                            // Size
+    writeTestFile(path, bad, len);
+    assert(loadCSRGraph(path) == NULL);
+
+    memcpy(bad, image, len);
+    uint64 *offsets = (uint64 *) (bad + sizeof(CSR_FILE_HDR));
+    offsets[Csr_numnodes]--;                                    // offsets[]
+    writeTestFile(path, bad, len);
+    assert(loadCSRGraph(path) == NULL);
+
+    // Damage beyond O(1) checks loads, but fails validation.
+    memcpy(bad, image, len);
+    uint32 *edges = (uint32 *) (offsets + Csr_numnodes + 1);
+    edges[3] = Csr_numnodes;
+    writeTestFile(path, bad, len);
+    CSR_GRAPH *loaded = loadCSRGraph(path);
+    assert(loaded && !validateCSRGraph(loaded));
+    freeCSRGraph(&loaded);
+
+    free(bad);
+    free(image);
+    freeCSRGraph(&graph);
+    unlink(path);
+    TEST_END();
+}
+
+// Snapshot of a 2M-node, 16M-edge graph: Report save and load times.
+void
+test_CSR_snapshot_large_graph(void)
+{
+    TEST_START();
+    printf("\n");
+
+    char path[] = "/tmp/ch4.graph-snapshot.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    int rv = saveRandomGraph(path, (2 * 1024 * 1024), 8);
+    assert(rv == 0);
+    rv = loadGraphBenchmark(path, 4);
+    assert(rv == 0);
+    (void) rv;
+
+    unlink(path);
+    TEST_END();
+}
+
+// **** Benchmarks ****
+
+#define BENCH_BFS_NUMNODES      (256 * 1024)
+#define BENCH_BFS_AVG_DEGREE    8
+
+/*
+ * One op is one serial BFS, over all of a random CSR graph of 256K nodes and
+ * 2M edges, of 8 MB of edges[]; so ns / op, per 2M, is ns / edge traversed.
+ * The graph is built on the first call, which calibration does not time.
+ */
+void
+bench_bfsCSR(uint64_t nops)
+{
+    static CSR_GRAPH *graph = NULL;
+    static int *depth = NULL;
+    if (!graph) {
+        graph = mkRandomCSRGraph(BENCH_BFS_NUMNODES,
+                                 ((uint64) BENCH_BFS_NUMNODES * BENCH_BFS_AVG_DEGREE),
+                                 20);
+        depth = malloc(BENCH_BFS_NUMNODES * sizeof(*depth));
+        assert(graph && depth);
+    }
+    for (uint64_t i = 0; i < nops; i++) {
+        BENCH_KEEP(bfsCSR(graph, (uint32) (i % BENCH_BFS_NUMNODES), depth, NULL));
+    }
+}
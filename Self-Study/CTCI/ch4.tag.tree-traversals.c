@@ -5,13 +5,23 @@
  * Ref:
  * - https://www.geeksforgeeks.org/generating-random-number-range-c/
  *
- * Usage: $ gcc -o ch4.tag.tree-traversals ch4.tag.tree-traversals.c
+ * Usage: $ gcc -O2 -o ch4.tag.tree-traversals ch4.tag.tree-traversals.c -lm
  *        $ leaks -atExit -- ./ch4.tag.tree-traversals
+ *        $ ./ch4.tag.tree-traversals --bench [ <numnodes> ]
+ *        $ ./ch4.tag.tree-traversals bench_<fn-name> [ <bench-options> ]
  *
  * Implemented:
  *  - Tree construction using BFS 'search' construction
- *  - Preorder, Inorder, Postorder and Level Order traversal to print nodes
+ *  - Preorder, Inorder, Postorder and Level Order traversal to print nodes.
+ *    Traversals are iterative, over an explicit, growable stack or queue, so
+ *    any tree depth fits, and call a visitor per node. Printing formats into
+ *    an OutBuf, which is written out in 64 KB batches.
  *  - Qs 4.2 Build a minimal tree
+ *  - ArrayTree: Implicit tree in one array, in Eytzinger (BFS) order, with
+ *    the same builders, traversals and validity check as the Node tree, and
+ *    a branch-free, prefetching search. --bench compares it to a Node tree.
+ *  - bench_* runs the benchmarks in Bench_fns[], by the runner of
+ *    ../Tools/bench_fns.h; see there for <bench-options>.
  *
  * History:
  * -----------------------------------------------------------------------------
@@ -22,8 +32,14 @@
 #include <assert.h>
 #include <time.h>
 #include <math.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <stdint.h>
 
-const char *Usage = "%s [ --help | test_<fn-name> ]\n";
+#include "../Tools/bench_fns.h"
+
+const char *Usage = "%s [ --help | test_<fn-name> | --bench [ <numnodes> ]"
+                    " | bench_<fn-name> [ <bench-options> ] ]\n";
 
 typedef unsigned int uint32;
 
@@ -61,6 +77,25 @@ typedef struct node {
 #define K_KILO  1024
 #define MILLION (1000 * 1000)
 
+/*
+ * Implicit binary tree: Nodes are values[0 .. nitems), in level-order, i.e.
+ * Eytzinger layout. Children of values[i] are values[2i + 1] and
+ * values[2i + 2]; its parent is values[(i - 1) / 2]. The tree is complete,
+ * so it needs no pointers, and is a single allocation.
+ */
+typedef struct array_tree {
+    int *   values;     // 1 int past a cache line; see mkArrayTree()
+    int     nitems;
+} ArrayTree;
+
+// Cache line size, in bytes.
+#define ATREE_LINE_SIZE     64
+
+#define ATREE_LEFT(i)       ((2 * (i)) + 1)
+#define ATREE_RIGHT(i)      ((2 * (i)) + 2)
+#define ATREE_PARENT(i)     (((i) - 1) / 2)
+#define ATREE_LEVEL(i)      (31 - __builtin_clz((uint32) (i) + 1))
+
 // Tree-printing traversal orders
 typedef enum {
       PR_TREE_INORDER
@@ -68,6 +103,45 @@ typedef enum {
     , PR_TREE_POSTORDER
     , PR_TREE_LEVELORDER } traversal_t;
 
+/*
+ * Visitor called by treeTraverse() for each node, with its level (root is 0)
+ * and type: 'R'oot, 'l'eft or 'r'ight child.
+ */
+typedef void (*node_visitor_t)(const Node *nodep, uint32 level, char nodeType,
+                               void *arg);
+
+/*
+ * Explicit stack, or queue, for iterative traversals. It's allocated once,
+ * by treeWalkInit(), and can be reused across traversals; it doubles in size
+ * if a traversal needs more frames, instead of overflowing like recursion.
+ */
+typedef struct walk_frame {
+    Node *  nodep;
+    uint32  level;
+    char    nodeType;
+    char    expanded;       // Post-order: Children already pushed?
+} WalkFrame;
+
+typedef struct tree_walk {
+    WalkFrame * frames;
+    int         capacity;
+} TreeWalk;
+
+const int Tree_walk_init_frames = 1024;
+
+/*
+ * Output buffer: Formatted output is appended to buf[], and written to the
+ * file in one write() when the buffer fills up, or on outBufFlush().
+ */
+typedef struct out_buf {
+    FILE *  fp;
+    char *  buf;
+    size_t  size;
+    size_t  len;
+} OutBuf;
+
+#define OUTBUF_SIZE     (64 * K_KILO)
+
 // Function Prototypes
 Node *mkNode(const int val);
 void freeNode(Node **np);
@@ -90,9 +164,36 @@ void prTreeInorder(Node *rootp, uint32 level, char nodeType);
 void prTreePreorder(Node *rootp, uint32 level, char nodeType);
 void prTreePostorder(Node *rootp, uint32 level, char nodeType);
 void prTreeLevelorder(Node *rootp, uint32 level, char nodeType);
-int  prTree_bfs_Levelorder(Node *qNodes[], int qsize);
 void prNodeLevel(Node *rootp, uint32 level, char nodeType);
+
+bool treeWalkInit(TreeWalk *walk, int capacity);
+void treeWalkFree(TreeWalk *walk);
+int  treeTraverse(TreeWalk *walk, Node *rootp, traversal_t traverse,
+                  node_visitor_t visit, void *arg);
+int  treeTraverseFrom(TreeWalk *walk, Node *rootp, uint32 level, char nodeType,
+                      traversal_t traverse, node_visitor_t visit, void *arg);
+
+void outBufInit(OutBuf *out, FILE *fp, char *buf, size_t size);
+void outBufPrintf(OutBuf *out, const char *fmt, ...)
+                  __attribute__((format(printf, 2, 3)));
+void outBufFlush(OutBuf *out);
+void prNodeVisitor(const Node *nodep, uint32 level, char nodeType, void *arg);
 int  numLevels(Node *rootp);
+Node *bstSearch(Node *rootp, int key);
+
+ArrayTree * mkArrayTree(int *values, int nitems);
+ArrayTree * mkMinimalArrayTree(int *values, int nitems);
+void        freeArrayTree(ArrayTree **treep);
+bool        isValidArrayBinTree(const ArrayTree *tree);
+int         numLevelsArrayTree(const ArrayTree *tree);
+int         arrayTreeFirst(const ArrayTree *tree, traversal_t traverse);
+int         arrayTreeNext(const ArrayTree *tree, traversal_t traverse, int idx);
+int         arrayTreeTraverse(const ArrayTree *tree, traversal_t traverse,
+                              int *values);
+void        prArrayTree(const ArrayTree *tree, traversal_t traverse);
+int         arrayTreeLowerBound(const ArrayTree *tree, int key);
+int         arrayTreeSearch(const ArrayTree *tree, int key);
+void        benchTreeLayouts(int numnodes);
 
 void prArray(int *arr, int size);
 void test_this(void);
@@ -124,6 +225,20 @@ void test_mkMinimalBinaryTree_4nodes(void);
 void test_mkMinimalBinaryTree_5nodes(void);
 void test_mkMinBinaryTree_random_20_nodes(void);
 
+void test_mkArrayTree(void);
+void test_arrayTree_traversals(void);
+void test_mkMinimalArrayTree(void);
+void test_isValidArrayBinTree(void);
+void test_arrayTreeSearch(void);
+void test_arrayTree_1M_nodes(void);
+
+void test_treeTraverse_9nodes(void);
+void test_treeTraverse_vs_arrayTree(void);
+void test_treeTraverse_degenerate_1M_deep(void);
+void test_outBuf_batched_output(void);
+
+void bench_arrayTreeLowerBound(uint64_t nops);
+
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
 typedef struct test_fns
@@ -158,10 +273,27 @@ TEST_FNS Test_fns[] = {
                 , { "test_mkMinimalBinaryTree_4nodes"   , test_mkMinimalBinaryTree_4nodes }
                 , { "test_mkMinimalBinaryTree_5nodes"   , test_mkMinimalBinaryTree_5nodes }
                 , { "test_mkMinBinaryTree_random_20_nodes"   , test_mkMinBinaryTree_random_20_nodes }
+
+                , { "test_mkArrayTree"                  , test_mkArrayTree }
+                , { "test_arrayTree_traversals"         , test_arrayTree_traversals }
+                , { "test_mkMinimalArrayTree"           , test_mkMinimalArrayTree }
+                , { "test_isValidArrayBinTree"          , test_isValidArrayBinTree }
+                , { "test_arrayTreeSearch"              , test_arrayTreeSearch }
+                , { "test_arrayTree_1M_nodes"           , test_arrayTree_1M_nodes }
+
+                , { "test_treeTraverse_9nodes"          , test_treeTraverse_9nodes }
+                , { "test_treeTraverse_vs_arrayTree"    , test_treeTraverse_vs_arrayTree }
+                , { "test_treeTraverse_degenerate_1M_deep", test_treeTraverse_degenerate_1M_deep }
+                , { "test_outBuf_batched_output"        , test_outBuf_batched_output }
 };
 
 const int Num_Test_fns = ARRAYSIZE(Test_fns);
 
+// List of bench functions one can invoke from the command-line
+BENCH_FNS Bench_fns[] = {
+                  { "bench_arrayTreeLowerBound"         , bench_arrayTreeLowerBound, 0 }
+};
+
 // Test start / end info-msg macros
 #define TEST_START()  printf("%s ", __func__)
 #define TEST_END()    printf(" ...OK\n")
@@ -173,7 +305,9 @@ int
 main(int argc, char *argv[])
 {
     const char *hello_msg = "Hello World";
-    printf("%s: %s. (argc=%d)\n", argv[0], hello_msg, argc);
+    // To stderr when benchmarking, so stdout holds only the results.
+    fprintf((BENCH_ARGV(argc, argv) ? stderr : stdout), "%s: %s. (argc=%d)\n",
+            argv[0], hello_msg, argc);
 
     int rv = 0;
     // Run all test cases if no args are provided.
@@ -188,6 +322,11 @@ main(int argc, char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         printf(Usage, argv[0]);
         return rv;
+    } else if (strcmp("--bench", argv[1]) == 0) {
+        benchTreeLayouts((argc > 2) ? atoi(argv[2]) : (10 * MILLION));
+    } else if (BENCH_ARGV(argc, argv)) {
+        rv = bench_main(Bench_fns, ARRAYSIZE(Bench_fns), (argc - 1),
+                        (const char **) &argv[1]);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
 
         // Execute the named test-function, if it's a supported test-function
@@ -314,25 +453,30 @@ mkTree(Node *qNodes[], int qsize, int *values, int nitems)
  * -----------------------------------------------------------------------------
  * freeTree() - Routine to free allocated for all nodes in a tree.
  *
- * Implement a post-order traversal of all nodes in the tree, so that we free
- * the memory for all nodes in the left sub-tree, then the right sub-tree
- * -AND THEN- free the memory for the input 'nodep'.
+ * Freeing needs no traversal order, so rather than recursing, which would
+ * overflow the stack on deep trees, rotate the tree in place: While the
+ * root has a left child, rotate right, which moves that child up to the
+ * root; once the root has no left child, free it and continue with its
+ * right child. This takes O(n) time and O(1) extra memory.
  * -----------------------------------------------------------------------------
  */
 void
 freeTree(Node **nodep)
 {
     Node *node = *nodep;
-    if (node == NULL) {
-        return;
-    }
-    if (node->left) {
-        freeTree(&node->left);
-    }
-    if (node->right) {
-        freeTree(&node->right);
+    while (node) {
+        Node *left = node->left;
+        if (left) {
+            node->left = left->right;
+            left->right = node;
+            node = left;
+        } else {
+            Node *right = node->right;
+            free(node);
+            node = right;
+        }
     }
-    freeNode(nodep);
+    *nodep = NULL;
 }
 
 /*
@@ -487,120 +631,340 @@ prTreeTraverse(Node *rootp, traversal_t traverse)
     }
 }
 
-// -----------------------------------------------------------------------------
-void
-prTreeInorder(Node *nodep, uint32 level, char nodeType)
+/*
+ * -----------------------------------------------------------------------------
+ * prTreeInorder(), prTreePreorder(), prTreePostorder(), prTreeLevelorder():
+ * Print the tree rooted at 'nodep', in that order, with 'nodep' at 'level' and
+ * of 'nodeType'. All are iterative, via treeTraverseFrom(), and print through
+ * an OutBuf.
+ * -----------------------------------------------------------------------------
+ */
+static void
+prTreeOrder(Node *nodep, uint32 level, char nodeType, traversal_t traverse)
 {
     assert(nodep != NULL);
 
-    if (nodep->left) {
-        prTreeInorder(nodep->left, (level + 1), 'l');
+    TreeWalk walk;
+    if (!treeWalkInit(&walk, Tree_walk_init_frames)) {
+        return;
     }
-    prNodeLevel(nodep, level, nodeType);
-
-    if (nodep->right) {
-        prTreeInorder(nodep->right, (level + 1), 'r');
+    char   buf[OUTBUF_SIZE];
+    OutBuf out;
+    outBufInit(&out, stdout, buf, sizeof(buf));
+
+    int nvisited = treeTraverseFrom(&walk, nodep, level, nodeType, traverse,
+                                    prNodeVisitor, &out);
+    outBufFlush(&out);
+    if (nvisited < 0) {
+        printf("Error: Out of memory traversing tree at %p\n", nodep);
     }
+    treeWalkFree(&walk);
 }
 
-// -----------------------------------------------------------------------------
 void
-prTreePreorder(Node *nodep, uint32 level, char nodeType)
+prTreeInorder(Node *nodep, uint32 level, char nodeType)
 {
-    assert(nodep != NULL);
+    prTreeOrder(nodep, level, nodeType, PR_TREE_INORDER);
+}
 
-    prNodeLevel(nodep, level, nodeType);
-    if (nodep->left) {
-        prTreePreorder(nodep->left, (level + 1), 'l');
-    }
-    if (nodep->right) {
-        prTreePreorder(nodep->right, (level + 1), 'r');
-    }
+void
+prTreePreorder(Node *nodep, uint32 level, char nodeType)
+{
+    prTreeOrder(nodep, level, nodeType, PR_TREE_PREORDER);
 }
 
-// -----------------------------------------------------------------------------
 void
 prTreePostorder(Node *nodep, uint32 level, char nodeType)
+{
+    prTreeOrder(nodep, level, nodeType, PR_TREE_POSTORDER);
+}
+
+void
+prTreeLevelorder(Node *rootp, uint32 level, char nodeType)
+{
+    prTreeOrder(rootp, level, nodeType, PR_TREE_LEVELORDER);
+}
+
+// Format of each node's line printed by tree traversals.
+#define PR_NODE_LEVEL_FMT   "[%p lvl=%d:%s:val=%d [lc=%p, rc=%p]\n"
+#define PR_NODE_TYPE(nodeType)                  \
+            (((nodeType) == 'R') ? "R " :       \
+             ((nodeType) == 'l') ? "<-" :       \
+             ((nodeType) == 'r') ? "->"         \
+                                 : "  ")
+
+void
+prNodeLevel(Node *nodep, uint32 level, char nodeType)
 {
     assert(nodep != NULL);
+    printf(PR_NODE_LEVEL_FMT, (void *) nodep, level, PR_NODE_TYPE(nodeType),
+           nodep->data, (void *) nodep->left, (void *) nodep->right);
+}
 
-    if (nodep->left) {
-        prTreePostorder(nodep->left, (level + 1), 'l');
+// Visitor to print a node, as prNodeLevel() does, into OutBuf 'arg'.
+void
+prNodeVisitor(const Node *nodep, uint32 level, char nodeType, void *arg)
+{
+    outBufPrintf((OutBuf *) arg, PR_NODE_LEVEL_FMT, (void *) nodep, level,
+                 PR_NODE_TYPE(nodeType), nodep->data,
+                 (void *) nodep->left, (void *) nodep->right);
+}
+
+// **** Iterative traversal routines ****
+
+bool
+treeWalkInit(TreeWalk *walk, int capacity)
+{
+    walk->capacity = ((capacity > 0) ? capacity : Tree_walk_init_frames);
+    walk->frames = malloc(walk->capacity * sizeof(*walk->frames));
+    return (walk->frames != NULL);
+}
+
+void
+treeWalkFree(TreeWalk *walk)
+{
+    free(walk->frames);
+    walk->frames = NULL;
+    walk->capacity = 0;
+}
+
+/*
+ * Double the walk's frames. Live frames are the 'nframes' from 'head',
+ * wrapping around the end as for a queue; they are moved to the start of
+ * the new frames. For a stack, 'head' is 0.
+ */
+static bool
+treeWalkGrow(TreeWalk *walk, int head, int nframes)
+{
+    int        capacity = (2 * walk->capacity);
+    WalkFrame *frames = malloc(capacity * sizeof(*frames));
+    if (!frames) {
+        return FALSE;
     }
-    if (nodep->right) {
-        prTreePostorder(nodep->right, (level + 1), 'r');
+    int ntail = (walk->capacity - head);
+    if (ntail > nframes) {
+        ntail = nframes;
+    }
+    memcpy(frames, (walk->frames + head), (ntail * sizeof(*frames)));
+    memcpy((frames + ntail), walk->frames, ((nframes - ntail) * sizeof(*frames)));
+    free(walk->frames);
+    walk->frames = frames;
+    walk->capacity = capacity;
+    return TRUE;
+}
+
+// Push a frame onto the walk's stack of 'top' frames.
+static inline bool
+treeWalkPush(TreeWalk *walk, int *top, Node *nodep, uint32 level, char nodeType)
+{
+    if ((*top == walk->capacity) && !treeWalkGrow(walk, 0, *top)) {
+        return FALSE;
     }
-    prNodeLevel(nodep, level, nodeType);
+    walk->frames[(*top)++] = (WalkFrame) { nodep, level, nodeType, 0 };
+    return TRUE;
 }
 
 /*
  * -----------------------------------------------------------------------------
- * Driver routine to recurse through tree and print nodes in level-order.
- * At each level, we have to maintain a queue of nodes as found at that level.
- * As we don't know the depth of the tree, do a quick traversal to find # of levels.
+ * treeTraverse(): Visit all nodes of the tree at 'rootp', in 'traverse' order,
+ * calling visit(node, level, nodeType, arg) for each. treeTraverseFrom() does
+ * the same for a sub-tree, whose root is at 'level' and of 'nodeType'.
+ *
+ * Nothing recurses: Depth-first orders run off a stack of frames in 'walk',
+ * and level-order off a circular queue in it, so the C stack usage is fixed
+ * whatever the shape of the tree. 'walk' grows if frames run out, which
+ * needs at most (depth + 1) frames for depth-first orders, and the width of
+ * the widest level for level-order.
+ *
+ * Returns: # of nodes visited; -1 if out of memory growing 'walk'.
  * -----------------------------------------------------------------------------
  */
-void
-prTreeLevelorder(Node *rootp, uint32 level, char nodeType)
+int
+treeTraverse(TreeWalk *walk, Node *rootp, traversal_t traverse,
+             node_visitor_t visit, void *arg)
 {
-    assert(rootp != NULL);
-    int nlevels = numLevels(rootp);
-    int numnodes = (exp2(nlevels + 1) - 1);
+    return treeTraverseFrom(walk, rootp, 0, 'R', traverse, visit, arg);
+}
 
-    // Declare an on-stack 'queue' of nodes
-    Node *qNodes[numnodes];
-    memset(qNodes, 0, sizeof(qNodes));
+int
+treeTraverseFrom(TreeWalk *walk, Node *rootp, uint32 level, char nodeType,
+                 traversal_t traverse, node_visitor_t visit, void *arg)
+{
+    int nvisited = 0;
+    int top = 0;
+    if (!rootp) {
+        return nvisited;
+    }
+    switch (traverse)
+    {
+      case PR_TREE_INORDER: {
+        // Push the left spine of a sub-tree; visit its nodes as they pop, and
+        // then do the same for the right sub-tree of each.
+        Node *nodep = rootp;
+        while (nodep || top) {
+            for (; nodep; nodep = nodep->left, level++, nodeType = 'l') {
+                if (!treeWalkPush(walk, &top, nodep, level, nodeType)) {
+                    return -1;
+                }
+            }
+            WalkFrame frame = walk->frames[--top];
+            visit(frame.nodep, frame.level, frame.nodeType, arg);
+            nvisited++;
+            nodep = frame.nodep->right;
+            level = (frame.level + 1);
+            nodeType = 'r';
+        }
+        break;
+      }
 
-    // Initialize BFS traversal of tree using this queue, starting from root.
-    int head = 0;
-    qNodes[head] = rootp;
-    int qsize = 1;
-    while (qsize > 0) {
-        qsize = prTree_bfs_Levelorder(&qNodes[head], qsize);
+      case PR_TREE_PREORDER:
+        if (!treeWalkPush(walk, &top, rootp, level, nodeType)) {
+            return -1;
+        }
+        while (top) {
+            WalkFrame frame = walk->frames[--top];
+            visit(frame.nodep, frame.level, frame.nodeType, arg);
+            nvisited++;
+
+            // Right pushed first, so left sub-tree is visited first.
+            Node *nodep = frame.nodep;
+            if (   (nodep->right
+                    && !treeWalkPush(walk, &top, nodep->right, (frame.level + 1), 'r'))
+                || (nodep->left
+                    && !treeWalkPush(walk, &top, nodep->left, (frame.level + 1), 'l'))) {
+                return -1;
+            }
+        }
+        break;
 
-        // We processed one node at the head of the queue. So qsize decreases by 1.
-        head++;
-        qsize--;
+      case PR_TREE_POSTORDER:
+        // A node stays on the stack till its children, pushed above it on
+        // its 1st pop, have been visited.
+        if (!treeWalkPush(walk, &top, rootp, level, nodeType)) {
+            return -1;
+        }
+        while (top) {
+            WalkFrame *framep = &walk->frames[top - 1];
+            if (framep->expanded) {
+                visit(framep->nodep, framep->level, framep->nodeType, arg);
+                nvisited++;
+                top--;
+                continue;
+            }
+            framep->expanded = 1;
+
+            // Copy out, as pushing may move the frames.
+            Node  *nodep = framep->nodep;
+            uint32 child_level = (framep->level + 1);
+            if (   (nodep->right
+                    && !treeWalkPush(walk, &top, nodep->right, child_level, 'r'))
+                || (nodep->left
+                    && !treeWalkPush(walk, &top, nodep->left, child_level, 'l'))) {
+                return -1;
+            }
+        }
+        break;
+
+      case PR_TREE_LEVELORDER: {
+        int head = 0;
+        int nqueued = 1;
+        walk->frames[0] = (WalkFrame) { rootp, level, nodeType, 0 };
+        while (nqueued) {
+            WalkFrame frame = walk->frames[head];
+            if (++head == walk->capacity) {
+                head = 0;
+            }
+            nqueued--;
+            visit(frame.nodep, frame.level, frame.nodeType, arg);
+            nvisited++;
+
+            Node *children[2] = { frame.nodep->left, frame.nodep->right };
+            for (int cctr = 0; cctr < 2; cctr++) {
+                if (!children[cctr]) {
+                    continue;
+                }
+                if (nqueued == walk->capacity) {
+                    if (!treeWalkGrow(walk, head, nqueued)) {
+                        return -1;
+                    }
+                    head = 0;
+                }
+                int tail = ((head + nqueued) % walk->capacity);
+                walk->frames[tail] = (WalkFrame) { children[cctr], (frame.level + 1),
+                                                   (cctr ? 'r' : 'l'), 0 };
+                nqueued++;
+            }
+        }
+        break;
+      }
     }
+    return nvisited;
+}
+
+// **** Batched output routines ****
+
+void
+outBufInit(OutBuf *out, FILE *fp, char *buf, size_t size)
+{
+    out->fp = fp;
+    out->buf = buf;
+    out->size = size;
+    out->len = 0;
 }
 
 /*
- * -----------------------------------------------------------------------------
- * Process the node at the head of qNodes queue.
- * 'qsize' is # of elements in the queue including this one.
+ * Append formatted output to the buffer, flushing it first if the output
+ * doesn't fit. Output longer than the whole buffer is written directly.
  */
-int
-prTree_bfs_Levelorder(Node *qNodes[], int qsize)
+void
+outBufPrintf(OutBuf *out, const char *fmt, ...)
 {
-    if (qsize == 0) {
-        return qsize;
+    va_list args;
+    va_start(args, fmt);
+    size_t room = (out->size - out->len);
+    int    nbytes = vsnprintf((out->buf + out->len), room, fmt, args);
+    va_end(args);
+    if (nbytes < 0) {
+        return;
     }
-    Node *nodep = qNodes[0];
-    prNodeLevel(nodep, 0, '?');
-
-    // Add this nodes children to the queue
-    if (nodep->left) {
-        qNodes[qsize++] = nodep->left;
+    if ((size_t) nbytes < room) {
+        out->len += nbytes;
+        return;
     }
-    if (nodep->right) {
-        qNodes[qsize++] = nodep->right;
+    // Didn't fit: Drop the partial output, flush, and format again.
+    outBufFlush(out);
+    va_start(args, fmt);
+    if ((size_t) nbytes < out->size) {
+        out->len = vsnprintf(out->buf, out->size, fmt, args);
+    } else {
+        vfprintf(out->fp, fmt, args);
+        fflush(out->fp);
     }
-    return qsize;
+    va_end(args);
 }
 
-
+/*
+ * Write out buffered output. The FILE is flushed first, so output printed
+ * through it before stays in order, and the buffer is then written with
+ * write(), by-passing stdio's own, smaller, buffering.
+ */
 void
-prNodeLevel(Node *nodep, uint32 level, char nodeType)
+outBufFlush(OutBuf *out)
 {
-    assert(nodep != NULL);
-    printf("[%p lvl=%d:%s:val=%d [lc=%p, rc=%p]\n",
-            nodep, level,
-            ((nodeType) == 'R' ? "R " :
-             (nodeType) == 'l' ? "<-" :
-             (nodeType) == 'r' ? "->"
-                               : "  "),
-              nodep->data,
-              nodep->left, nodep->right);
+    if (!out->len) {
+        return;
+    }
+    fflush(out->fp);
+    int    fd = fileno(out->fp);
+    size_t written = 0;
+    while (written < out->len) {
+        ssize_t nbytes = write(fd, (out->buf + written), (out->len - written));
+        if (nbytes <= 0) {
+            break;
+        }
+        written += nbytes;
+    }
+    out->len = 0;
 }
 
 /*
@@ -623,6 +987,394 @@ numLevels(Node *rootp)
     return rv;
 }
 
+/*
+ * Binary search tree lookup: Node with 'key', or NULL. Left sub-tree has
+ * values < node's; right sub-tree has values >= node's.
+ */
+Node *
+bstSearch(Node *rootp, int key)
+{
+    while (rootp && (rootp->data != key)) {
+        rootp = ((key < rootp->data) ? rootp->left : rootp->right);
+    }
+    return rootp;
+}
+
+// **** Array (implicit) tree routines ****
+
+/*
+ * -----------------------------------------------------------------------------
+ * mkArrayTree(): Array tree 'constructor', the counterpart of makeTree().
+ *
+ * makeTree() fills in nodes in BFS order, which is exactly the Eytzinger
+ * layout, so this is just a copy of 'values'.
+ *
+ * The 16 great-grandchildren that arrayTreeLowerBound() prefetches are
+ * values[16k - 1 .. 16k + 14], so the copy starts 1 int past a cache line:
+ * Each such block then fills exactly one line.
+ * -----------------------------------------------------------------------------
+ */
+ArrayTree *
+mkArrayTree(int *values, int nitems)
+{
+    if (!values || (nitems <= 0)) {
+        return (ArrayTree *) NULL;
+    }
+    ArrayTree *tree = malloc(sizeof(*tree));
+    if (!tree) {
+        return tree;
+    }
+    // aligned_alloc() needs a size that is a multiple of the alignment.
+    size_t nbytes = ((nitems + 1) * sizeof(*tree->values));
+    nbytes = ((nbytes + ATREE_LINE_SIZE - 1) & ~((size_t) ATREE_LINE_SIZE - 1));
+    int *mem = aligned_alloc(ATREE_LINE_SIZE, nbytes);
+    if (!mem) {
+        free(tree);
+        return (ArrayTree *) NULL;
+    }
+    tree->values = (mem + 1);
+    memcpy(tree->values, values, (nitems * sizeof(*values)));
+    tree->nitems = nitems;
+    return tree;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * mkMinimalArrayTree(): Prob 4.2, for an array tree. Given a sorted
+ * (increasing order) array, build a binary search tree of minimal height.
+ *
+ * An array tree is complete, so its height is always minimal. Placing the
+ * sorted values in in-order position order makes it a search tree.
+ * -----------------------------------------------------------------------------
+ */
+ArrayTree *
+mkMinimalArrayTree(int *values, int nitems)
+{
+    ArrayTree *tree = mkArrayTree(values, nitems);
+    if (!tree) {
+        return tree;
+    }
+    int vctr = 0;
+    for (int idx = arrayTreeFirst(tree, PR_TREE_INORDER); idx >= 0;
+         idx = arrayTreeNext(tree, PR_TREE_INORDER, idx)) {
+        tree->values[idx] = values[vctr++];
+    }
+    assert(vctr == nitems);
+    return tree;
+}
+
+void
+freeArrayTree(ArrayTree **treep)
+{
+    if (*treep) {
+        free((*treep)->values - 1);     // As allocated by mkArrayTree()
+        free(*treep);
+        *treep = NULL;
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * Check if array tree is a valid binary search tree: All nodes to the left of
+ * a node should be < its value; all nodes to its right should be >= it.
+ *
+ * Unlike isValidBinTree(), which compares nodes only to their parents, this
+ * checks each node against all of its ancestors, in one in-order pass: The
+ * in-order sequence must be non-decreasing, and strictly increasing from the
+ * in-order predecessor of a node that has a left sub-tree, which is the
+ * largest value in that sub-tree.
+ * -----------------------------------------------------------------------------
+ */
+bool
+isValidArrayBinTree(const ArrayTree *tree)
+{
+    if (!tree) {
+        return TRUE;
+    }
+    const int *values = tree->values;
+    int prev = arrayTreeFirst(tree, PR_TREE_INORDER);
+    for (int idx = arrayTreeNext(tree, PR_TREE_INORDER, prev); idx >= 0;
+         prev = idx, idx = arrayTreeNext(tree, PR_TREE_INORDER, idx)) {
+        if (values[prev] > values[idx]) {
+            return FALSE;
+        }
+        if ((ATREE_LEFT(idx) < tree->nitems) && (values[prev] == values[idx])) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// Same as numLevels(): # of levels below root; -1 for an empty tree.
+int
+numLevelsArrayTree(const ArrayTree *tree)
+{
+    if (!tree || !tree->nitems) {
+        return -1;
+    }
+    return ATREE_LEVEL(tree->nitems - 1);
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * Stack-less traversals of an array tree: arrayTreeFirst() returns the index
+ * of the 1st node in a traversal order, and arrayTreeNext() that of the node
+ * after node 'idx'; both return -1 past the end. Moves are index arithmetic,
+ * so need no stack, and level-order is a sequential walk of the array.
+ * -----------------------------------------------------------------------------
+ */
+int
+arrayTreeFirst(const ArrayTree *tree, traversal_t traverse)
+{
+    if (!tree || !tree->nitems) {
+        return -1;
+    }
+    int idx = 0;
+    if ((traverse == PR_TREE_INORDER) || (traverse == PR_TREE_POSTORDER)) {
+        // Left-most node. In a complete tree, nodes without a left child
+        // have no right child either, so this is the 1st post-order node too.
+        while (ATREE_LEFT(idx) < tree->nitems) {
+            idx = ATREE_LEFT(idx);
+        }
+    }
+    return idx;
+}
+
+int
+arrayTreeNext(const ArrayTree *tree, traversal_t traverse, int idx)
+{
+    const int nitems = tree->nitems;
+    if ((idx < 0) || (idx >= nitems)) {
+        return -1;
+    }
+    switch (traverse)
+    {
+      case PR_TREE_INORDER:
+        if (ATREE_RIGHT(idx) < nitems) {
+            // Left-most node of right sub-tree
+            idx = ATREE_RIGHT(idx);
+            while (ATREE_LEFT(idx) < nitems) {
+                idx = ATREE_LEFT(idx);
+            }
+            return idx;
+        }
+        // Climb out of right sub-trees; parent of a left child is next.
+        while (idx && !(idx & 1)) {
+            idx = ATREE_PARENT(idx);
+        }
+        return (idx ? ATREE_PARENT(idx) : -1);
+
+      case PR_TREE_PREORDER:
+        if (ATREE_LEFT(idx) < nitems) {
+            return ATREE_LEFT(idx);
+        }
+        // Climb to the 1st left child with a right sibling; that's next.
+        while (idx) {
+            if ((idx & 1) && ((idx + 1) < nitems)) {
+                return (idx + 1);
+            }
+            idx = ATREE_PARENT(idx);
+        }
+        return -1;
+
+      case PR_TREE_POSTORDER:
+        if (idx == 0) {
+            return -1;
+        }
+        if (!(idx & 1) || ((idx + 1) >= nitems)) {
+            return ATREE_PARENT(idx);
+        }
+        // Left child: Next is the 1st post-order node of right sibling.
+        idx++;
+        while (ATREE_LEFT(idx) < nitems) {
+            idx = ATREE_LEFT(idx);
+        }
+        return idx;
+
+      case PR_TREE_LEVELORDER:
+        return (((idx + 1) < nitems) ? (idx + 1) : -1);
+    }
+    return -1;
+}
+
+// Collect the values of the tree, in 'traverse' order; returns # of values.
+int
+arrayTreeTraverse(const ArrayTree *tree, traversal_t traverse, int *values)
+{
+    int nvalues = 0;
+    if (tree && (traverse == PR_TREE_LEVELORDER)) {
+        memcpy(values, tree->values, (tree->nitems * sizeof(*values)));
+        return tree->nitems;
+    }
+    for (int idx = arrayTreeFirst(tree, traverse); idx >= 0;
+         idx = arrayTreeNext(tree, traverse, idx)) {
+        values[nvalues++] = tree->values[idx];
+    }
+    return nvalues;
+}
+
+// Print the tree in 'traverse' order, in the style of prTreeTraverse().
+void
+prArrayTree(const ArrayTree *tree, traversal_t traverse)
+{
+    if (!tree) {
+        return;
+    }
+    const char *traverse_type = ((traverse == PR_TREE_INORDER)   ? "Inorder" :
+                                 (traverse == PR_TREE_PREORDER)  ? "Preorder" :
+                                 (traverse == PR_TREE_POSTORDER) ? "Postorder"
+                                                                 : "Level-order");
+    printf("\nArray tree at %p, %d nodes, %s traversal\n",
+           tree->values, tree->nitems, traverse_type);
+    for (int idx = arrayTreeFirst(tree, traverse); idx >= 0;
+         idx = arrayTreeNext(tree, traverse, idx)) {
+        printf("[idx=%d lvl=%d:%s:val=%d]\n", idx, ATREE_LEVEL(idx),
+               ((idx == 0) ? "R " : (idx & 1) ? "<-" : "->"),
+               tree->values[idx]);
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * arrayTreeLowerBound(): Index of the 1st node, in in-order, with a value
+ * >= key; -1 if there is none. Tree must be a search tree.
+ *
+ * Descent is branch-free: The comparison picks the left or right child's
+ * index arithmetically, so there are no mispredicted branches, and the loop
+ * runs exactly (# of levels) times. The 16 great-grandchildren of a node,
+ * 4 levels down, are contiguous ints, which mkArrayTree() places on one
+ * cache line; it is prefetched so memory latency overlaps with the next 4
+ * steps.
+ *
+ * On exit, the bits of (k = idx + 1) record the path taken, a 1 for each right
+ * turn; the answer is the node of the last left turn, which is found by
+ * dropping the trailing right turns plus that left turn.
+ * -----------------------------------------------------------------------------
+ */
+int
+arrayTreeLowerBound(const ArrayTree *tree, int key)
+{
+    const int *values = tree->values;
+    const uint32 nitems = tree->nitems;
+
+    uint32 k = 1;   // 1-based index
+    while (k <= nitems) {
+        __builtin_prefetch(values + (16 * k) - 1);
+        k = ((2 * k) + (values[k - 1] < key));
+    }
+    k >>= __builtin_ffs(~k);
+    return ((int) k - 1);
+}
+
+// Index of a node with 'key' in search tree; -1 if not found.
+int
+arrayTreeSearch(const ArrayTree *tree, int key)
+{
+    int idx = arrayTreeLowerBound(tree, key);
+    return (((idx >= 0) && (tree->values[idx] == key)) ? idx : -1);
+}
+
+// Wall-clock time, in seconds.
+static double
+now_secs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * benchTreeLayouts(): Compare a Node tree and an array tree, each a search
+ * tree of 'numnodes' even values: Build time, random searches, half of them
+ * misses, and a level-order walk.
+ * -----------------------------------------------------------------------------
+ */
+void
+benchTreeLayouts(int numnodes)
+{
+    if (numnodes <= 0) {
+        printf("Error: Need numnodes > 0.\n");
+        return;
+    }
+    const int nsearches = numnodes;
+    int *values = malloc(numnodes * sizeof(*values));
+    int *keys = malloc(nsearches * sizeof(*keys));
+    Node **queue = malloc(numnodes * sizeof(*queue));
+    assert(values && keys && queue);
+    for (int ictr = 0; ictr < numnodes; ictr++) {
+        values[ictr] = (2 * ictr);
+    }
+    srand(21);
+    for (int ictr = 0; ictr < nsearches; ictr++) {
+        keys[ictr] = (((rand() % numnodes) * 2) + (rand() & 1));
+    }
+
+    double start = now_secs();
+    Node *rootp = mkMinimalBinaryTree(values, numnodes);
+    double node_build = (now_secs() - start);
+
+    start = now_secs();
+    ArrayTree *tree = mkMinimalArrayTree(values, numnodes);
+    double array_build = (now_secs() - start);
+    assert(rootp && tree);
+
+    start = now_secs();
+    int node_found = 0;
+    for (int ictr = 0; ictr < nsearches; ictr++) {
+        node_found += (bstSearch(rootp, keys[ictr]) != NULL);
+    }
+    double node_search = (now_secs() - start);
+
+    start = now_secs();
+    int array_found = 0;
+    for (int ictr = 0; ictr < nsearches; ictr++) {
+        array_found += (arrayTreeSearch(tree, keys[ictr]) >= 0);
+    }
+    double array_search = (now_secs() - start);
+    assert(node_found == array_found);
+
+    // Level-order walks, summing values, so the walks aren't optimized out.
+    start = now_secs();
+    long node_sum = 0;
+    int head = 0;
+    int tail = 0;
+    queue[tail++] = rootp;
+    while (head < tail) {
+        Node *nodep = queue[head++];
+        node_sum += nodep->data;
+        if (nodep->left) {
+            queue[tail++] = nodep->left;
+        }
+        if (nodep->right) {
+            queue[tail++] = nodep->right;
+        }
+    }
+    double node_walk = (now_secs() - start);
+
+    start = now_secs();
+    long array_sum = 0;
+    for (int idx = 0; idx < tree->nitems; idx++) {
+        array_sum += tree->values[idx];
+    }
+    double array_walk = (now_secs() - start);
+    assert(node_sum == array_sum);
+
+    printf("%d nodes, %d searches (%d found):\n", numnodes, nsearches, node_found);
+    printf("  %-12s build=%.3fs  search=%.3fs (%.0f ns/search)  level-order=%.3fs\n",
+           "Node tree:", node_build, node_search,
+           (node_search * 1e9 / nsearches), node_walk);
+    printf("  %-12s build=%.3fs  search=%.3fs (%.0f ns/search)  level-order=%.3fs\n",
+           "Array tree:", array_build, array_search,
+           (array_search * 1e9 / nsearches), array_walk);
+
+    freeArrayTree(&tree);
+    freeTree(&rootp);
+    free(queue);
+    free(keys);
+    free(values);
+}
+
 // **** Helper functions ****
 void
 prArray(int *arr, int size)
@@ -1034,3 +1786,494 @@ test_mkMinBinaryTree_random_20_nodes(void)
     freeTree(&rootp);
     TEST_END();
 }
+
+// Check that tree's values, in 'traverse' order, are exp[0 .. nexp).
+static int
+arrayTreeCheck(const ArrayTree *tree, traversal_t traverse, const int *exp,
+               int nexp)
+{
+    int values[nexp];
+    int nvalues = arrayTreeTraverse(tree, traverse, values);
+    return ((nvalues == nexp) && !memcmp(values, exp, sizeof(values)));
+}
+
+void
+test_mkArrayTree(void)
+{
+    TEST_START();
+
+    int values[] = {42, 22, 33, 99, 112, 4, 55, 66, 900};
+    ArrayTree *tree = mkArrayTree(values, ARRAYSIZE(values));
+    assert(tree);
+    assert(tree->nitems == ARRAYSIZE(values));
+    assert(!memcmp(tree->values, values, sizeof(values)));
+
+    // Great-grandchildren, values[16k - 1 ...], start on a cache line.
+    assert(((uintptr_t) (tree->values + 15) % ATREE_LINE_SIZE) == 0);
+
+    // Same # of levels as the Node tree from makeTree().
+    Node *rootp = makeTree(values, ARRAYSIZE(values));
+    assert(numLevelsArrayTree(tree) == numLevels(rootp));
+    assert(numLevelsArrayTree(tree) == 3);
+    freeTree(&rootp);
+    prArrayTree(tree, PR_TREE_PREORDER);
+
+    freeArrayTree(&tree);
+    assert(tree == NULL);
+    assert(mkArrayTree(values, 0) == NULL);
+    assert(numLevelsArrayTree(NULL) == -1);
+    TEST_END();
+}
+
+/*
+ *            42
+ *        22       33
+ *      99  112   4  55
+ *    66 900
+ */
+void
+test_arrayTree_traversals(void)
+{
+    TEST_START();
+
+    int values[] = {42, 22, 33, 99, 112, 4, 55, 66, 900};
+    ArrayTree *tree = mkArrayTree(values, ARRAYSIZE(values));
+    assert(tree);
+
+    int exp_in[]   = {66, 99, 900, 22, 112, 42, 4, 33, 55};
+    int exp_pre[]  = {42, 22, 99, 66, 900, 112, 33, 4, 55};
+    int exp_post[] = {66, 900, 99, 112, 22, 4, 55, 33, 42};
+    assert(arrayTreeCheck(tree, PR_TREE_INORDER, exp_in, ARRAYSIZE(exp_in)));
+    assert(arrayTreeCheck(tree, PR_TREE_PREORDER, exp_pre, ARRAYSIZE(exp_pre)));
+    assert(arrayTreeCheck(tree, PR_TREE_POSTORDER, exp_post, ARRAYSIZE(exp_post)));
+    assert(arrayTreeCheck(tree, PR_TREE_LEVELORDER, values, ARRAYSIZE(values)));
+    freeArrayTree(&tree);
+
+    // Incomplete last level, with a left child and no right child.
+    int values8[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    tree = mkArrayTree(values8, ARRAYSIZE(values8));
+    int exp_in8[]   = {8, 4, 2, 5, 1, 6, 3, 7};
+    int exp_pre8[]  = {1, 2, 4, 8, 5, 3, 6, 7};
+    int exp_post8[] = {8, 4, 5, 2, 6, 7, 3, 1};
+    assert(arrayTreeCheck(tree, PR_TREE_INORDER, exp_in8, ARRAYSIZE(exp_in8)));
+    assert(arrayTreeCheck(tree, PR_TREE_PREORDER, exp_pre8, ARRAYSIZE(exp_pre8)));
+    assert(arrayTreeCheck(tree, PR_TREE_POSTORDER, exp_post8, ARRAYSIZE(exp_post8)));
+    freeArrayTree(&tree);
+
+    int values1[] = {42};
+    tree = mkArrayTree(values1, 1);
+    for (int tctr = PR_TREE_INORDER; tctr <= PR_TREE_LEVELORDER; tctr++) {
+        assert(arrayTreeCheck(tree, (traversal_t) tctr, values1, 1));
+    }
+    freeArrayTree(&tree);
+    TEST_END();
+}
+
+void
+test_mkMinimalArrayTree(void)
+{
+    TEST_START();
+
+    for (int nitems = 1; nitems <= 64; nitems++) {
+        int values[nitems];
+        for (int ictr = 0; ictr < nitems; ictr++) {
+            values[ictr] = ((ictr * 3) + 1);
+        }
+        ArrayTree *tree = mkMinimalArrayTree(values, nitems);
+        assert(tree);
+        assert(isValidArrayBinTree(tree));
+        assert(arrayTreeCheck(tree, PR_TREE_INORDER, values, nitems));
+
+        // Minimal height: floor(log2(nitems)) levels below root.
+        assert(numLevelsArrayTree(tree) == (int) log2(nitems));
+        freeArrayTree(&tree);
+    }
+    int values[] = {2, 42, 83, 84, 90};
+    ArrayTree *tree = mkMinimalArrayTree(values, ARRAYSIZE(values));
+    prArrayTree(tree, PR_TREE_LEVELORDER);
+    freeArrayTree(&tree);
+    TEST_END();
+}
+
+void
+test_isValidArrayBinTree(void)
+{
+    TEST_START();
+
+    // Same illegal input as test_isValidBinTree().
+    int values[] = {42, 2, 83};
+    ArrayTree *tree = mkMinimalArrayTree(values, ARRAYSIZE(values));
+    assert(isValidArrayBinTree(tree) == FALSE);
+    freeArrayTree(&tree);
+
+    // 1 is a valid left child of 10, but is to the right of root 5.
+    //      5
+    //   2     10
+    //  ..    1  ..
+    int bad_ancestor[] = {5, 2, 10, 0, 3, 1, 11};
+    tree = mkArrayTree(bad_ancestor, ARRAYSIZE(bad_ancestor));
+    assert(isValidArrayBinTree(tree) == FALSE);
+    freeArrayTree(&tree);
+
+    // Duplicates are allowed only to the right.
+    int dup_right[] = {5, 2, 5};
+    tree = mkArrayTree(dup_right, ARRAYSIZE(dup_right));
+    assert(isValidArrayBinTree(tree));
+    freeArrayTree(&tree);
+
+    int dup_left[] = {5, 5, 6};
+    tree = mkArrayTree(dup_left, ARRAYSIZE(dup_left));
+    assert(isValidArrayBinTree(tree) == FALSE);
+    freeArrayTree(&tree);
+
+    assert(isValidArrayBinTree(NULL));
+    TEST_END();
+}
+
+// Search results must match a binary search over the sorted values.
+void
+test_arrayTreeSearch(void)
+{
+    TEST_START();
+
+    for (int nitems = 1; nitems <= 100; nitems++) {
+        int values[nitems];
+        for (int ictr = 0; ictr < nitems; ictr++) {
+            values[ictr] = (ictr * 2);      // Even values only
+        }
+        ArrayTree *tree = mkMinimalArrayTree(values, nitems);
+        assert(tree);
+        for (int key = -2; key <= (2 * nitems); key++) {
+            int idx = arrayTreeLowerBound(tree, key);
+            int exp = ((key <= 0) ? 0 : ((key + 1) / 2));   // Sorted position
+            if (exp >= nitems) {
+                assert(idx == -1);
+            } else {
+                assert(idx >= 0);
+                assert(tree->values[idx] == values[exp]);
+            }
+            int found = arrayTreeSearch(tree, key);
+            if ((key >= 0) && !(key & 1) && (key < (2 * nitems))) {
+                assert((found >= 0) && (tree->values[found] == key));
+            } else {
+                assert(found == -1);
+            }
+        }
+        freeArrayTree(&tree);
+    }
+    TEST_END();
+}
+
+// 1M-node search tree: Validate it, and time it against a Node tree.
+void
+test_arrayTree_1M_nodes(void)
+{
+    TEST_START();
+
+    int numnodes = MILLION;
+    int *values = malloc(numnodes * sizeof(*values));
+    int *inorder = malloc(numnodes * sizeof(*inorder));
+    assert(values && inorder);
+    for (int ictr = 0; ictr < numnodes; ictr++) {
+        values[ictr] = ictr;
+    }
+    ArrayTree *tree = mkMinimalArrayTree(values, numnodes);
+    assert(tree);
+    assert(isValidArrayBinTree(tree));
+    assert(arrayTreeTraverse(tree, PR_TREE_INORDER, inorder) == numnodes);
+    assert(!memcmp(values, inorder, (numnodes * sizeof(*values))));
+    assert(numLevelsArrayTree(tree) == 19);
+    freeArrayTree(&tree);
+    free(inorder);
+    free(values);
+
+    printf("\n");
+    benchTreeLayouts(numnodes);
+    TEST_END();
+}
+
+// Visitor to collect node values into an int array.
+typedef struct collect_values {
+    int *   values;
+    int     nvalues;
+    uint32  max_level;
+} CollectValues;
+
+static void
+collectVisitor(const Node *nodep, uint32 level, char nodeType, void *arg)
+{
+    CollectValues *collect = (CollectValues *) arg;
+    collect->values[collect->nvalues++] = nodep->data;
+    if (level > collect->max_level) {
+        collect->max_level = level;
+    }
+    (void) nodeType;
+}
+
+// Check that tree's values, in 'traverse' order, are exp[0 .. nexp).
+static int
+treeTraverseCheck(TreeWalk *walk, Node *rootp, traversal_t traverse,
+                  const int *exp, int nexp)
+{
+    int values[nexp];
+    CollectValues collect = { values, 0, 0 };
+    int nvisited = treeTraverse(walk, rootp, traverse, collectVisitor, &collect);
+    return ((nvisited == nexp) && (collect.nvalues == nexp)
+            && !memcmp(values, exp, sizeof(values)));
+}
+
+void
+test_treeTraverse_9nodes(void)
+{
+    TEST_START();
+
+    int values[] = {42, 22, 33, 99, 112, 4, 55, 66, 900};
+    Node *rootp = makeTree(values, ARRAYSIZE(values));
+    assert(rootp);
+
+    // Tiny walk, so traversals have to grow it.
+    TreeWalk walk;
+    assert(treeWalkInit(&walk, 1));
+
+    int exp_in[]   = {66, 99, 900, 22, 112, 42, 4, 33, 55};
+    int exp_pre[]  = {42, 22, 99, 66, 900, 112, 33, 4, 55};
+    int exp_post[] = {66, 900, 99, 112, 22, 4, 55, 33, 42};
+    assert(treeTraverseCheck(&walk, rootp, PR_TREE_INORDER, exp_in, ARRAYSIZE(exp_in)));
+    assert(treeTraverseCheck(&walk, rootp, PR_TREE_PREORDER, exp_pre, ARRAYSIZE(exp_pre)));
+    assert(treeTraverseCheck(&walk, rootp, PR_TREE_POSTORDER, exp_post, ARRAYSIZE(exp_post)));
+    assert(treeTraverseCheck(&walk, rootp, PR_TREE_LEVELORDER, values, ARRAYSIZE(values)));
+    assert(walk.capacity > 1);
+
+    assert(treeTraverse(&walk, NULL, PR_TREE_INORDER, collectVisitor, NULL) == 0);
+    treeWalkFree(&walk);
+
+    prTreeTraverse(rootp, PR_TREE_LEVELORDER);
+    freeTree(&rootp);
+    TEST_END();
+}
+
+// Node tree from makeTree() and array tree from mkArrayTree() have the same
+// shape, so must traverse the same, in all orders.
+void
+test_treeTraverse_vs_arrayTree(void)
+{
+    TEST_START();
+
+    TreeWalk walk;
+    assert(treeWalkInit(&walk, 2));
+    srand(22);
+    for (int nitems = 1; nitems <= 300; nitems++) {
+        int values[nitems];
+        int exp[nitems];
+        for (int ictr = 0; ictr < nitems; ictr++) {
+            values[ictr] = NEW_RAND();
+        }
+        Node      *rootp = makeTree(values, nitems);
+        ArrayTree *tree = mkArrayTree(values, nitems);
+        assert(rootp && tree);
+        for (int tctr = PR_TREE_INORDER; tctr <= PR_TREE_LEVELORDER; tctr++) {
+            int nexp = arrayTreeTraverse(tree, (traversal_t) tctr, exp);
+            assert(treeTraverseCheck(&walk, rootp, (traversal_t) tctr, exp, nexp));
+        }
+        freeArrayTree(&tree);
+        freeTree(&rootp);
+    }
+    treeWalkFree(&walk);
+    TEST_END();
+}
+
+/*
+ * Degenerate trees, chains of 1M nodes all to the left, all to the right,
+ * and zig-zagging: Far too deep for recursive traversals.
+ */
+void
+test_treeTraverse_degenerate_1M_deep(void)
+{
+    TEST_START();
+
+    const int numnodes = MILLION;
+    int *values = malloc(numnodes * sizeof(*values));
+    assert(values);
+
+    TreeWalk walk;
+    assert(treeWalkInit(&walk, Tree_walk_init_frames));
+    for (int shape = 0; shape < 3; shape++) {
+        // Node i's only child is node (i + 1).
+        Node *rootp = mkNode(0);
+        Node *nodep = rootp;
+        for (int ictr = 1; ictr < numnodes; ictr++) {
+            Node *child = mkNode(ictr);
+            assert(child);
+            bool go_left = ((shape == 0) || ((shape == 2) && (ictr & 1)));
+            if (go_left) {
+                nodep->left = child;
+            } else {
+                nodep->right = child;
+            }
+            nodep = child;
+        }
+
+        for (int tctr = PR_TREE_INORDER; tctr <= PR_TREE_LEVELORDER; tctr++) {
+            CollectValues collect = { values, 0, 0 };
+            int nvisited = treeTraverse(&walk, rootp, (traversal_t) tctr,
+                                        collectVisitor, &collect);
+            assert(nvisited == numnodes);
+            assert(collect.max_level == (uint32) (numnodes - 1));
+
+            // Pre-order and level-order go down the chain; post-order comes
+            // back up; in-order depends on which side each child is on.
+            if ((tctr == PR_TREE_PREORDER) || (tctr == PR_TREE_LEVELORDER)
+                || ((tctr == PR_TREE_INORDER) && (shape == 1))) {
+                assert((values[0] == 0) && (values[numnodes - 1] == (numnodes - 1)));
+            } else if ((tctr == PR_TREE_POSTORDER)
+                       || ((tctr == PR_TREE_INORDER) && (shape == 0))) {
+                assert((values[0] == (numnodes - 1)) && (values[numnodes - 1] == 0));
+            }
+        }
+        freeTree(&rootp);
+        assert(rootp == NULL);
+    }
+    printf(" walk capacity=%d frames", walk.capacity);
+    treeWalkFree(&walk);
+    free(values);
+    TEST_END();
+}
+
+/*
+ * Print a 1M-node tree to a temp-file, through an OutBuf and by printf() of
+ * each node; output must be identical. Report time taken by each.
+ */
+void
+test_outBuf_batched_output(void)
+{
+    TEST_START();
+
+    const int numnodes = MILLION;
+    int *values = malloc(numnodes * sizeof(*values));
+    assert(values);
+    for (int ictr = 0; ictr < numnodes; ictr++) {
+        values[ictr] = ictr;
+    }
+    Node *rootp = mkMinimalBinaryTree(values, numnodes);
+    assert(rootp);
+    free(values);
+
+    char batched_path[] = "/tmp/ch4.tree-batched.XXXXXX";
+    char printf_path[] = "/tmp/ch4.tree-printf.XXXXXX";
+    int batched_fd = mkstemp(batched_path);
+    int printf_fd = mkstemp(printf_path);
+    assert((batched_fd >= 0) && (printf_fd >= 0));
+    FILE *batched_fp = fdopen(batched_fd, "w");
+    FILE *printf_fp = fdopen(printf_fd, "w");
+    assert(batched_fp && printf_fp);
+
+    // Unbuffered FILE: Each fprintf() is a write(), like a terminal.
+    setvbuf(printf_fp, NULL, _IONBF, 0);
+
+    TreeWalk walk;
+    assert(treeWalkInit(&walk, Tree_walk_init_frames));
+    char   buf[OUTBUF_SIZE];
+    OutBuf out;
+    outBufInit(&out, batched_fp, buf, sizeof(buf));
+
+    clock_t start = clock();
+    assert(treeTraverse(&walk, rootp, PR_TREE_INORDER, prNodeVisitor, &out) == numnodes);
+    outBufFlush(&out);
+    double batched_secs = ((double) (clock() - start) / CLOCKS_PER_SEC);
+
+    // Same output, one fprintf() per node.
+    start = clock();
+    Node **stack = malloc(numnodes * sizeof(*stack));
+    uint32 *levels = malloc(numnodes * sizeof(*levels));
+    char *types = malloc(numnodes);
+    assert(stack && levels && types);
+    int    top = 0;
+    Node  *nodep = rootp;
+    uint32 level = 0;
+    char   nodeType = 'R';
+    while (nodep || top) {
+        for (; nodep; nodep = nodep->left, level++, nodeType = 'l') {
+            stack[top] = nodep;
+            levels[top] = level;
+            types[top++] = nodeType;
+        }
+        top--;
+        nodep = stack[top];
+        fprintf(printf_fp, PR_NODE_LEVEL_FMT, (void *) nodep, levels[top],
+                PR_NODE_TYPE(types[top]), nodep->data,
+                (void *) nodep->left, (void *) nodep->right);
+        level = (levels[top] + 1);
+        nodeType = 'r';
+        nodep = nodep->right;
+    }
+    double printf_secs = ((double) (clock() - start) / CLOCKS_PER_SEC);
+    free(types);
+    free(levels);
+    free(stack);
+    fclose(batched_fp);
+    fclose(printf_fp);
+
+    // Compare the two outputs.
+    FILE *fp1 = fopen(batched_path, "r");
+    FILE *fp2 = fopen(printf_path, "r");
+    assert(fp1 && fp2);
+    char rbuf1[4096];
+    char rbuf2[4096];
+    size_t total = 0;
+    size_t n1;
+    do {
+        n1 = fread(rbuf1, 1, sizeof(rbuf1), fp1);
+        size_t n2 = fread(rbuf2, 1, sizeof(rbuf2), fp2);
+        assert((n1 == n2) && !memcmp(rbuf1, rbuf2, n1));
+        (void) n2;
+        total += n1;
+    } while (n1);
+    fclose(fp1);
+    fclose(fp2);
+    assert(total > 0);
+
+    printf("\n%d nodes, %zu bytes: batched=%.3fs, printf-per-node=%.3fs",
+           numnodes, total, batched_secs, printf_secs);
+
+    unlink(batched_path);
+    unlink(printf_path);
+    treeWalkFree(&walk);
+    freeTree(&rootp);
+    TEST_END();
+}
+
+// **** Benchmarks ****
+
+#define BENCH_ATREE_NUMNODES    MILLION
+#define BENCH_ATREE_NKEYS       (64 * K_KILO)
+
+/*
+ * One op is one arrayTreeLowerBound() of a random key, half of them present,
+ * in a minimal ArrayTree of 1M even values, 4 MB; searches are independent,
+ * so this is their throughput, with misses overlapped. The tree is built on
+ * the first call, which calibration does not time.
+ */
+void
+bench_arrayTreeLowerBound(uint64_t nops)
+{
+    static ArrayTree *tree = NULL;
+    static int *keys = NULL;
+    if (!tree) {
+        int *values = malloc(BENCH_ATREE_NUMNODES * sizeof(*values));
+        keys = malloc(BENCH_ATREE_NKEYS * sizeof(*keys));
+        assert(values && keys);
+        for (int ictr = 0; ictr < BENCH_ATREE_NUMNODES; ictr++) {
+            values[ictr] = (2 * ictr);
+        }
+        srand(21);
+        for (int ictr = 0; ictr < BENCH_ATREE_NKEYS; ictr++) {
+            keys[ictr] = (((rand() % BENCH_ATREE_NUMNODES) * 2) + (rand() & 1));
+        }
+        tree = mkMinimalArrayTree(values, BENCH_ATREE_NUMNODES);
+        assert(tree);
+        free(values);
+    }
+    for (uint64_t i = 0; i < nops; i++) {
+        BENCH_KEEP(arrayTreeLowerBound(tree, keys[i % BENCH_ATREE_NKEYS]));
+    }
+}
@@ -86,6 +86,8 @@
 #include <algorithm>
 #include <numeric>          // std::accumulate()
 
+#include "fast-sort.h"      // fastSort()
+
 #if __linux__
 #include <ranges>           // Mac: Unsupported in g++ 13.1 version
 #include <cstring>
@@ -951,17 +953,27 @@ test_sort(void)
     TEST_START();
 
     vector<int> v{0, -93, 42, 22, 16, 2000};
+    vector<int> v_fast = v;
     std::sort(v.begin(), v.end());
 
     cout << endl << "Sorted vector<int>:";
     prContainer(v);
 
+    // Same order from fastSort(): Here, by its sorting network, as v is small.
+    fastSort(v_fast);
+    assert(v_fast == v);
+
     vector<string> strings{ "this", "that", "and", "the", "other", "items"};
+    vector<string> strings_fast = strings;
     std::sort(strings.begin(), strings.end());
 
     cout << endl << "Sorted vector<string>:";
     prContainer(strings);
 
+    // Not radix-sortable: fastSort() falls back to std::sort.
+    fastSort(strings_fast);
+    assert(strings_fast == strings);
+
     TEST_END();
 }
 
@@ -976,10 +988,15 @@ test_sort_range_basic(void)
 
     vector<int> v{0, -93, 42, 22, 16, 2000};
 
+    vector<int> v_fast = v;
+
     cout << "\nUnxorted vector<int> :"; prContainer(v);
     std::ranges::sort(v);
     cout << "Sorted vector<int>   :"; prContainer(v);
 
+    fastSort(v_fast.data(), v_fast.size());
+    assert(std::ranges::equal(v_fast, v));
+
     TEST_END();
 }
 #endif // __linux__
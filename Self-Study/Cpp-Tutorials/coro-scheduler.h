@@ -0,0 +1,632 @@
+/*
+ * -----------------------------------------------------------------------------
+ * coro-scheduler.h: Multi-threaded executor of coroutines, with a run-queue
+ * per worker thread and work stealing between workers.
+ *
+ *  CoroScheduler sched(nthreads);
+ *
+ *  Task
+ *  fn(CoroScheduler& sched) {
+ *      co_await sched.schedule();  // Hop onto a worker thread
+ *      ...
+ *      co_await sched.yield();     // Let other coroutines run
+ *  }
+ *
+ *  fn(sched); ...
+ *  sched.drain();                  // Wait till all scheduled work is done
+ *
+ * Run-queues hold coroutine_handle<>s, i.e. frame addresses, directly; there
+ * is no type-erased std::function, and no allocation, per resume.
+ *
+ * Each worker owns:
+ *
+ *  - A Chase-Lev work-stealing deque: The worker pushes and pops at the
+ *    bottom, LIFO, with no locked instruction in the common case; idle
+ *    workers steal from the top, FIFO, with a CAS.
+ *  - An inbox: A mutex-protected FIFO, for handles scheduled from outside
+ *    the pool, spread round-robin across workers, and for yield()s, which
+ *    go to the back of the line. A worker also checks its inbox every
+ *    Sched_inbox_check_every runs, so yield()ers are not starved by a
+ *    deque that keeps refilling.
+ *
+ * Idle workers spin briefly stealing, and then sleep on an eventcount, an
+ * atomic epoch that schedulers bump, only if some worker is idle.
+ *
+ * Timers: co_await sched.sleepFor(d) parks the coroutine's handle in a
+ * min-heap of deadlines, owned by a timer thread, which blocks in the OS,
+ * in a condition-variable timed wait, till the earliest deadline and then
+ * schedules the handles that are due. A sleeping coroutine costs no CPU
+ * till then, however many there are; adding a timer is O(log #timers), and
+ * wakes the timer thread only if the new deadline is the earliest.
+ *
+ * drain() returns once no handle is queued, running or sleeping. A coroutine
+ * that is suspended on something other than this scheduler is not counted.
+ * There is no shared count of active handles, which every schedule() and
+ * resume would have to write: Each worker counts the handles it queues and
+ * resumes on its own cache line, and drain() sums them. Shared state that
+ * the hot paths touch only reads, e.g. nidle, sits alone on its own line.
+ *
+ * Ref:
+ *  - Chase, Lev: Dynamic Circular Work-Stealing Deque, SPAA 2005.
+ *  - Le, Pop, Cohen, Zappa Nardelli: Correct and Efficient Work-Stealing for
+ *    Weak Memory Models, PPoPP 2013.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef __CORO_SCHEDULER_H__
+#define __CORO_SCHEDULER_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+namespace coro_std = std;
+#else
+#include <experimental/coroutine>
+namespace coro_std = std::experimental;
+#endif
+
+// Initial # of slots in a worker's deque; it grows by doubling.
+constexpr int64_t  Sched_deque_init_size = 1024;
+
+// Check the inbox after this many runs from the deque.
+constexpr unsigned Sched_inbox_check_every = 64;
+
+// Rounds of stealing attempts before an idle worker sleeps.
+constexpr int      Sched_idle_spins = 64;
+
+/*
+ * Chase-Lev deque of frame addresses. push() and pop() only by the owner;
+ * steal() by anyone. Arrays outgrown are kept till the deque is destroyed,
+ * as a thief may still be reading one.
+ */
+class WorkStealingDeque
+{
+  public:
+    WorkStealingDeque() {
+        arrays.emplace_back(new Array(Sched_deque_init_size));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    void
+    push(void *item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array *a = array.load(std::memory_order_relaxed);
+        if ((b - t) >= a->size) {
+            a = grow(a, t, b);
+        }
+        a->put(b, item);
+        bottom.store((b + 1), std::memory_order_release);
+    }
+
+    // Newest item, or NULL if empty.
+    void *
+    pop(void) {
+        int64_t b = (bottom.load(std::memory_order_relaxed) - 1);
+        Array *a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom.store((b + 1), std::memory_order_relaxed);
+            return nullptr;
+        }
+        void *item = a->get(b);
+        if (t == b) {
+            // Last item: Race thieves for it.
+            if (!top.compare_exchange_strong(t, (t + 1),
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store((b + 1), std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Oldest item, or NULL if empty or lost a race with another taker.
+    void *
+    steal(void) {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b) {
+            return nullptr;
+        }
+        Array *a = array.load(std::memory_order_acquire);
+        void *item = a->get(t);
+        if (!top.compare_exchange_strong(t, (t + 1), std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool
+    empty(void) const {
+        return (bottom.load(std::memory_order_relaxed)
+                    <= top.load(std::memory_order_relaxed));
+    }
+
+  private:
+    struct Array
+    {
+        explicit Array(int64_t size)
+            : size{size}, mask{size - 1}, slots{new std::atomic<void *>[size]} { }
+
+        void *get(int64_t i) { return slots[i & mask].load(std::memory_order_relaxed); }
+        void  put(int64_t i, void *item) { slots[i & mask].store(item, std::memory_order_relaxed); }
+
+        int64_t                               size;
+        int64_t                               mask;
+        std::unique_ptr<std::atomic<void *>[]> slots;
+    };
+
+    Array *
+    grow(Array *a, int64_t t, int64_t b) {
+        arrays.emplace_back(new Array(2 * a->size));
+        Array *bigger = arrays.back().get();
+        for (int64_t i = t; i < b; i++) {
+            bigger->put(i, a->get(i));
+        }
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t>  top{0};
+    alignas(64) std::atomic<int64_t>  bottom{0};
+    std::atomic<Array *>              array;
+    std::vector<std::unique_ptr<Array>> arrays;     // Owner only
+};
+
+class CoroScheduler
+{
+  public:
+    explicit CoroScheduler(unsigned nthreads = std::thread::hardware_concurrency())
+        : workers(nthreads ? nthreads : 1) {
+        for (unsigned id = 0; id < workers.size(); id++) {
+            workers[id].id = id;
+        }
+        for (unsigned id = 0; id < workers.size(); id++) {
+            workers[id].thread = std::thread(&CoroScheduler::workerLoop, this, id);
+        }
+        timer_thread = std::thread(&CoroScheduler::timerLoop, this);
+    }
+
+    ~CoroScheduler() {
+        drain();
+        {
+            std::lock_guard<std::mutex> guard(timer_mutex);
+            timer_stopping = true;
+        }
+        timer_cv.notify_one();
+        timer_thread.join();
+
+        stopping.store(true);
+        wakeAll();
+        for (Worker& worker : workers) {
+            worker.thread.join();
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    CoroScheduler(const CoroScheduler&) = delete;
+    CoroScheduler& operator=(const CoroScheduler&) = delete;
+
+    // Queue 'h' to run on a worker: On this worker's deque, if called on one,
+    // so it runs next, while its frame is in cache; else in an inbox.
+    void
+    schedule(coro_std::coroutine_handle<> h) {
+        Worker *self = countQueued();
+        if (self) {
+            self->deque.push(h.address());
+        } else {
+            unsigned id = (next_inbox.fetch_add(1, std::memory_order_relaxed)
+                                % workers.size());
+            workers[id].inboxPush(h.address());
+        }
+        wakeOne();
+    }
+
+    // Queue 'h' behind the work already queued on this worker.
+    void
+    scheduleYield(coro_std::coroutine_handle<> h) {
+        Worker *self = myWorker();
+        if (!self) {
+            schedule(h);
+            return;
+        }
+        countQueued();
+        self->inboxPush(h.address());
+        wakeOne();
+    }
+
+    // Awaitables: co_await schedule() resumes the coroutine on a worker;
+    // co_await yield() re-queues it at the back of its worker's line.
+    struct ScheduleAwaiter
+    {
+        CoroScheduler *sched;
+        bool           yield;
+
+        bool await_ready() const noexcept { return false; }
+
+        void
+        await_suspend(coro_std::coroutine_handle<> h) const {
+            if (yield) {
+                sched->scheduleYield(h);
+            } else {
+                sched->schedule(h);
+            }
+        }
+
+        void await_resume() const noexcept { }
+    };
+
+    ScheduleAwaiter schedule(void) { return {this, false}; }
+    ScheduleAwaiter yield(void)    { return {this, true}; }
+
+    // Run 'h' on a worker, once 'deadline' has passed.
+    void
+    scheduleAt(Clock::time_point deadline, coro_std::coroutine_handle<> h) {
+        countQueued();      // Uncounted by ntimers_fired, once it fires
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> guard(timer_mutex);
+            timers.push({deadline, timer_seq++, h.address()});
+            earliest = (timers.top().addr == h.address());
+        }
+        if (earliest) {
+            timer_cv.notify_one();
+        }
+    }
+
+    // Awaitable: co_await sleepFor(d) / sleepUntil(t) resumes the coroutine
+    // on a worker, once the time has come.
+    struct SleepAwaiter
+    {
+        CoroScheduler     *sched;
+        Clock::time_point  deadline;
+
+        bool await_ready() const noexcept { return (deadline <= Clock::now()); }
+
+        void
+        await_suspend(coro_std::coroutine_handle<> h) const {
+            sched->scheduleAt(deadline, h);
+        }
+
+        void await_resume() const noexcept { }
+    };
+
+    SleepAwaiter sleepUntil(Clock::time_point deadline) { return {this, deadline}; }
+    SleepAwaiter sleepFor(Clock::duration delay) { return {this, (Clock::now() + delay)}; }
+
+    // # of timers fired.
+    uint64_t ntimers(void) const { return ntimers_fired.load(std::memory_order_relaxed); }
+
+    // # of timers not yet fired, i.e. of coroutines in sleepFor() / sleepUntil().
+    size_t
+    ntimersPending(void) {
+        std::lock_guard<std::mutex> guard(timer_mutex);
+        return timers.size();
+    }
+
+    // # of workers idle, i.e. asleep, or about to, as they found no work.
+    unsigned nidleWorkers(void) const { return nidle.load(std::memory_order_relaxed); }
+
+    /*
+     * Wait till no handle is queued, running or sleeping.
+     *
+     * All counts only grow, and a handle is counted as queued before it can
+     * be counted as done. So, summing all the done counts first and then all
+     * the queued counts, equal sums mean that, at some instant between the
+     * two, every handle queued had been done, even though the sums are not
+     * one snapshot. Workers, and the timer thread, wake us whenever they run
+     * out of work, so we re-check only then.
+     */
+    void
+    drain(void) {
+        ndrainers.fetch_add(1, std::memory_order_seq_cst);
+        while (true) {
+            uint32_t seen = drain_epoch.load(std::memory_order_acquire);
+            // Pairs with notifyDrainers()' fence: Either we see the last
+            // count it published, or it sees our ndrainers++ and wakes us.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            uint64_t ndone = (sumStat(&Worker::nresumes, std::memory_order_acquire)
+                                + ntimers_fired.load(std::memory_order_acquire));
+            uint64_t nqueued = (sumStat(&Worker::nqueued, std::memory_order_acquire)
+                                + nqueued_outside.load(std::memory_order_acquire));
+            if (ndone == nqueued) {
+                break;
+            }
+            drain_epoch.wait(seen, std::memory_order_acquire);
+        }
+        ndrainers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    unsigned nthreads(void) const { return workers.size(); }
+
+    // Cumulative stats, summed over workers.
+    uint64_t nresumes(void) const { return sumStat(&Worker::nresumes); }
+    uint64_t nsteals(void)  const { return sumStat(&Worker::nsteals); }
+
+    // # of resumes by worker 'id', to see how evenly work spread.
+    uint64_t
+    nresumes(unsigned id) const {
+        return workers[id].nresumes.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct alignas(64) Worker
+    {
+        void
+        inboxPush(void *item) {
+            std::lock_guard<std::mutex> guard(inbox_mutex);
+            inbox.push_back(item);
+            ninbox.store(inbox.size(), std::memory_order_release);
+        }
+
+        void *
+        inboxPop(void) {
+            if (!ninbox.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            std::lock_guard<std::mutex> guard(inbox_mutex);
+            if (inbox.empty()) {
+                return nullptr;
+            }
+            void *item = inbox.front();
+            inbox.pop_front();
+            ninbox.store(inbox.size(), std::memory_order_release);
+            return item;
+        }
+
+        unsigned              id;
+        std::thread           thread;
+        WorkStealingDeque     deque;
+        std::mutex            inbox_mutex;
+        std::deque<void *>    inbox;
+        std::atomic<size_t>   ninbox{0};
+
+        // Written only by this worker; drain() counts resumes as done.
+        alignas(64) std::atomic<uint64_t> nqueued{0};
+        std::atomic<uint64_t> nresumes{0};
+        std::atomic<uint64_t> nsteals{0};
+    };
+
+    Worker *
+    myWorker(void) const {
+        return ((tl_sched == this) ? tl_worker : nullptr);
+    }
+
+    // Count one more handle as queued, on this worker's count, if called on
+    // one, else on the shared count for other threads. Returns the worker.
+    Worker *
+    countQueued(void) {
+        Worker *self = myWorker();
+        if (self) {
+            self->nqueued.store((self->nqueued.load(std::memory_order_relaxed) + 1),
+                                std::memory_order_relaxed);
+        } else {
+            nqueued_outside.fetch_add(1, std::memory_order_relaxed);
+        }
+        return self;
+    }
+
+    // Next handle for worker 'self' to run: Its own deque and inbox, and
+    // then, from a random victim, the other workers' deques and inboxes.
+    void *
+    findWork(Worker& self, unsigned nruns, std::minstd_rand& rand) {
+        void *item = nullptr;
+        if ((nruns % Sched_inbox_check_every) == 0) {
+            item = self.inboxPop();
+        }
+        if (item || (item = self.deque.pop()) || (item = self.inboxPop())) {
+            return item;
+        }
+        unsigned nworkers = workers.size();
+        unsigned start = (rand() % nworkers);
+        for (unsigned i = 0; i < nworkers; i++) {
+            Worker& victim = workers[(start + i) % nworkers];
+            if (&victim == &self) {
+                continue;
+            }
+            if ((item = victim.deque.steal()) || (item = victim.inboxPop())) {
+                self.nsteals.store((self.nsteals.load(std::memory_order_relaxed) + 1),
+                                   std::memory_order_relaxed);
+                return item;
+            }
+        }
+        return nullptr;
+    }
+
+    void
+    workerLoop(unsigned id) {
+        Worker& self = workers[id];
+        tl_sched = this;
+        tl_worker = &self;
+        std::minstd_rand rand(id + 1);
+        unsigned nruns = 0;
+        unsigned nruns_seen = 0;    // nruns when we last ran out of work
+        int nspins = 0;
+
+        while (true) {
+            void *item = findWork(self, nruns, rand);
+            if (item) {
+                nspins = 0;
+                run(self, item);
+                nruns++;
+                continue;
+            }
+            // Out of work: If all workers are, drain() may be done.
+            if (nruns != nruns_seen) {
+                nruns_seen = nruns;
+                notifyDrainers();
+            }
+            if (++nspins < Sched_idle_spins) {
+                std::this_thread::yield();
+                continue;
+            }
+            nspins = 0;
+
+            // Announce we're idle, then look once more, so a schedule() that
+            // missed our nidle++ pushed work we will find.
+            uint32_t seen = epoch.load(std::memory_order_acquire);
+            nidle.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if ((item = findWork(self, nruns, rand))) {
+                nidle.fetch_sub(1, std::memory_order_relaxed);
+                run(self, item);
+                nruns++;
+                continue;
+            }
+            if (stopping.load()) {
+                nidle.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            epoch.wait(seen, std::memory_order_acquire);
+            nidle.fetch_sub(1, std::memory_order_relaxed);
+        }
+        tl_sched = nullptr;
+        tl_worker = nullptr;
+    }
+
+    void
+    run(Worker& self, void *item) {
+        coro_std::coroutine_handle<>::from_address(item).resume();
+        // Release: Publishes the counts of handles queued while it ran.
+        self.nresumes.store((self.nresumes.load(std::memory_order_relaxed) + 1),
+                            std::memory_order_release);
+    }
+
+    // Wake a sleeping worker, if any is idle; cheap when all are busy.
+    void
+    wakeOne(void) {
+        // A fence, pairing with the one after an idle worker's nidle++:
+        // Either we see it, or it sees the work we just queued. A load, not
+        // an RMW, so busy workers keep nidle's line shared among them.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (nidle.load(std::memory_order_relaxed)) {
+            epoch.fetch_add(1, std::memory_order_release);
+            epoch.notify_one();
+        }
+    }
+
+    // Wake drain()ers, if any, to re-check the counts.
+    void
+    notifyDrainers(void) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ndrainers.load(std::memory_order_relaxed)) {
+            drain_epoch.fetch_add(1, std::memory_order_release);
+            drain_epoch.notify_all();
+        }
+    }
+
+    void
+    wakeAll(void) {
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_all();
+    }
+
+    /*
+     * Timer thread: Sleep till the earliest deadline, or till a new, earlier
+     * one is added, and schedule all handles that are due then.
+     */
+    void
+    timerLoop(void) {
+        std::vector<void *> due;
+        std::unique_lock<std::mutex> lock(timer_mutex);
+        while (!timer_stopping) {
+            if (timers.empty()) {
+                timer_cv.wait(lock);
+                continue;
+            }
+            // By value: The heap may be reallocated while we wait unlocked.
+            Clock::time_point next = timers.top().deadline;
+            Clock::time_point now = Clock::now();
+            if (next > now) {
+                timer_cv.wait_until(lock, next);
+                continue;
+            }
+            while (!timers.empty() && (timers.top().deadline <= now)) {
+                due.push_back(timers.top().addr);
+                timers.pop();
+            }
+            lock.unlock();
+
+            // Each schedule() counts its handle as queued before we count
+            // its timer as done, so drain() never sees a false match. The
+            // handles may all have run by then, so ours may be the count
+            // that matches.
+            for (void *addr : due) {
+                schedule(coro_std::coroutine_handle<>::from_address(addr));
+            }
+            ntimers_fired.fetch_add(due.size(), std::memory_order_release);
+            notifyDrainers();
+            due.clear();
+
+            lock.lock();
+        }
+    }
+
+    uint64_t
+    sumStat(std::atomic<uint64_t> Worker::*stat,
+            std::memory_order order = std::memory_order_relaxed) const {
+        uint64_t sum = 0;
+        for (const Worker& worker : workers) {
+            sum += (worker.*stat).load(order);
+        }
+        return sum;
+    }
+
+    std::vector<Worker>     workers;
+
+    // Each on its own cache line: The hot paths only read nidle, stopping and
+    // ndrainers, and the rest are written by idle workers, drain()ers or
+    // threads outside the pool, which would otherwise keep invalidating them.
+    alignas(64) std::atomic<unsigned>   next_inbox{0};
+    alignas(64) std::atomic<uint64_t>   nqueued_outside{0};     // By non-workers
+    alignas(64) std::atomic<uint32_t>   epoch{0};   // Eventcount of idle workers
+    alignas(64) std::atomic<unsigned>   nidle{0};
+    alignas(64) std::atomic<bool>       stopping{false};
+    alignas(64) std::atomic<unsigned>   ndrainers{0};
+    alignas(64) std::atomic<uint32_t>   drain_epoch{0}; // Eventcount of drain()ers
+
+    struct Timer
+    {
+        Clock::time_point   deadline;
+        uint64_t            seq;        // FIFO among equal deadlines
+        void               *addr;
+
+        bool
+        operator>(const Timer& other) const {
+            return ((deadline > other.deadline)
+                    || ((deadline == other.deadline) && (seq > other.seq)));
+        }
+    };
+
+    std::thread             timer_thread;
+    std::mutex              timer_mutex;
+    std::condition_variable timer_cv;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t                timer_seq = 0;
+    bool                    timer_stopping = false;
+    alignas(64) std::atomic<uint64_t>   ntimers_fired{0};  // Timers done
+
+    static inline thread_local CoroScheduler *tl_sched = nullptr;
+    static inline thread_local Worker        *tl_worker = nullptr;
+};
+
+#endif // __CORO_SCHEDULER_H__
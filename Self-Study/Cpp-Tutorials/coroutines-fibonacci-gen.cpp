@@ -5,32 +5,40 @@
  * Ref: Bjarne Stroutstrup's talk at CppCon 2021, Slide ~1:06:18
  * https://www.youtube.com/watch?v=15QF2q66NhU&list=PLHTh1InhhwT6vjwMy3RG5Tnahw0G9qIx6
  *
- * Usage: g++ -o coroutines-fibonacci-gen coroutines-fibonacci-gen.cpp
+ * Usage: g++ -std=c++20 -O2 -o coroutines-fibonacci-gen coroutines-fibonacci-gen.cpp
  *        ./coroutines-fibonacci-gen [test_*]
  *        ./coroutines-fibonacci-gen [--help | test_<something> | test_<prefix> ]
+ *        ./coroutines-fibonacci-gen --bench-gen [ <nvalues> ]
  *
- * RESOLVE: This does not compile both on Linux or Mac. The unresolved reference
- * is to generator<int> fibonacci() definition. This templated `generator` class
- * is supposed to be available as per https://en.cppreference.com/w/cpp/coroutine/generator
- * but I did not find the headers on:
- * Mac: /Library/Developer/CommandLineTools/SDKs/MacOSX12.1.sdk/usr/include/c++/v1/
- *      Or under .../c++/V1/experimental
+ * NOTE: This did not compile on Linux or Mac, as the templated `generator`
+ * class, https://en.cppreference.com/w/cpp/coroutine/generator, is C++23 and
+ * not in the headers, e.g. on Mac, under:
+ *      /Library/Developer/CommandLineTools/SDKs/MacOSX12.1.sdk/usr/include/c++/v1/
+ * generator.h provides a generator<T>, with pooled coroutine frames and
+ * chunked yields. --bench-gen compares the cost of streaming values through
+ * it, one or a chunk per resume, to that of a plain loop.
  *
  * History:
  * -----------------------------------------------------------------------------
  */
 #include <iostream>
 
+#include <chrono>
 #include <iterator>
-#include <coroutine>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <vector>
 #if __linux__
 #include <cstring>
 #include <cassert>
 #endif // __linux__
 
+#include "generator.h"
+
 using namespace std;
 
-string Usage = " [ --help | test_<fn-name> ]\n";
+string Usage = " [ --help | test_<fn-name> | --bench-gen [ <nvalues> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -39,6 +47,13 @@ void test_this(void);
 void test_that(void);
 void test_msg(string);
 void test_coro_fibonacci(void);
+void test_generator_range_for(void);
+void test_generator_ranges(void);
+void test_generator_chunked(void);
+void test_generator_frame_pool(void);
+void test_generator_exception(void);
+
+void benchGenerator(uint64_t nvalues);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -52,6 +67,11 @@ TEST_FNS Test_fns[] = {
           { "test_this"             , test_this }
         , { "test_that"             , test_that }
         , { "test_coro_fibonacci"   , test_coro_fibonacci }
+        , { "test_generator_range_for"  , test_generator_range_for }
+        , { "test_generator_ranges"     , test_generator_ranges }
+        , { "test_generator_chunked"    , test_generator_chunked }
+        , { "test_generator_frame_pool" , test_generator_frame_pool }
+        , { "test_generator_exception"  , test_generator_exception }
 };
 
 // Test start / end info-msg macros
@@ -84,6 +104,9 @@ main(const int argc, const char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         cout << argv[0] << Usage << endl;
         return 0;
+    } else if (strcmp("--bench-gen", argv[1]) == 0) {
+        uint64_t nvalues = ((argc > 2) ? atoll(argv[2]) : (100 * 1000 * 1000));
+        benchGenerator(nvalues);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
         // Execute the named test-function, if it's a supported test-function
         int tctr = 0;
@@ -120,6 +143,49 @@ generator<int> fibonacci()
     }
 }
 
+/*
+ * 0 .. n-1, one value per resume.
+ */
+generator<uint64_t>
+iota(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        co_yield i;
+    }
+}
+
+/*
+ * 0 .. n-1, in chunks of up to 'chunk_size' values per resume. Chunk sizes
+ * vary with 'empty_every', which also yields an empty chunk that often, to
+ * exercise the iterator's skipping of those.
+ */
+generator<uint64_t>
+iotaChunked(uint64_t n, size_t chunk_size = 256, uint64_t empty_every = 0)
+{
+    std::vector<uint64_t> buf(chunk_size);
+    uint64_t nchunks = 0;
+    for (uint64_t i = 0; i < n; ) {
+        size_t nbuf = 0;
+        while ((nbuf < chunk_size) && (i < n)) {
+            buf[nbuf++] = i++;
+        }
+        co_yield std::span<const uint64_t>(buf.data(), nbuf);
+        if (empty_every && ((++nchunks % empty_every) == 0)) {
+            co_yield std::span<const uint64_t>();
+        }
+    }
+}
+
+// Yields 'nvalues' values, then throws.
+generator<int>
+throwsAfter(int nvalues)
+{
+    for (int i = 0; i < nvalues; i++) {
+        co_yield i;
+    }
+    throw std::runtime_error("throwsAfter");
+}
+
 // **** Helper methods ****
 /**
  * ends_with() : Similar to Python's str.endswith(substr)
@@ -187,9 +253,222 @@ test_coro_fibonacci(void)
 {
     TEST_START();
 
-    for (auto v: fibonacci()) { // Use co-routine
+    // fibonacci() never ends; take() as many numbers as we want.
+    int expected[] = { 0, 1, 1, 2, 3, 5, 8, 13, 21, 34 };
+    int ictr = 0;
+    for (auto v: fibonacci() | std::views::take(ARRAYSIZE(expected))) { // Use co-routine
         cout << v << " ";
+        assert(v == expected[ictr++]);
+    }
+    assert(ictr == ARRAYSIZE(expected));
+
+    TEST_END();
+}
+
+void
+test_generator_range_for(void)
+{
+    TEST_START();
+
+    uint64_t n = 1000;
+    uint64_t sum = 0;
+    uint64_t count = 0;
+    for (uint64_t v : iota(n)) {
+        assert(v == count);
+        sum += v;
+        count++;
     }
+    assert(count == n);
+    assert(sum == ((n * (n - 1)) / 2));
+
+    // Generator that yields nothing.
+    count = 0;
+    for (uint64_t v : iota(0)) {
+        (void) v;
+        count++;
+    }
+    assert(count == 0);
+
+    // Generators with no coroutine, or a finished one, are empty.
+    generator<uint64_t> none;
+    assert(none.begin() == none.end());
+
+    generator<uint64_t> from = iota(3);
+    generator<uint64_t> to = std::move(from);
+    assert(from.begin() == from.end());
+
+    auto it = to.begin();
+    while (it != to.end()) {
+        ++it;
+    }
+    assert(to.begin() == to.end());
 
     TEST_END();
 }
+
+void
+test_generator_ranges(void)
+{
+    TEST_START();
+
+    static_assert(std::ranges::input_range<generator<int>>);
+    static_assert(std::ranges::view<generator<int>>);
+
+    // Even squares of the first integers, through a pipeline of views.
+    auto squares = iota(100)
+                    | std::views::filter([](uint64_t v) { return ((v % 2) == 0); })
+                    | std::views::transform([](uint64_t v) { return (v * v); })
+                    | std::views::take(5);
+    std::vector<uint64_t> got;
+    for (uint64_t v : squares) {
+        got.push_back(v);
+    }
+    assert((got == std::vector<uint64_t>{ 0, 4, 16, 36, 64 }));
+
+    // Algorithms on a named generator, and on its iterators.
+    generator<uint64_t> gen = iota(10);
+    auto found = std::ranges::find(gen.begin(), gen.end(), 7);
+    assert((found != gen.end()) && (*found == 7));
+
+    TEST_END();
+}
+
+void
+test_generator_chunked(void)
+{
+    TEST_START();
+
+    uint64_t n = 10 * 1000;
+    size_t chunk_sizes[] = { 1, 7, 256, 20000 };
+    for (size_t chunk_size : chunk_sizes) {
+        for (uint64_t empty_every : { 0, 1, 3 }) {
+            uint64_t count = 0;
+            for (uint64_t v : iotaChunked(n, chunk_size, empty_every)) {
+                assert(v == count);
+                count++;
+            }
+            assert(count == n);
+        }
+    }
+
+    // Same values as one-per-resume, through a view.
+    auto chunked = (iotaChunked(n) | std::views::take(300));
+    auto single = iota(300);
+    auto it = single.begin();
+    for (uint64_t v : chunked) {
+        assert(v == *it);
+        ++it;
+    }
+    assert(it == single.end());
+
+    TEST_END();
+}
+
+/*
+ * A generator's frame goes back to this thread's pool when it is destroyed,
+ * and the next generator reuses it: Making many, one after another, takes
+ * at most one frame from the heap.
+ */
+void
+test_generator_frame_pool(void)
+{
+    TEST_START();
+
+    uint64_t nallocs = FramePool::nallocs();
+    uint64_t sum = 0;
+    for (int i = 0; i < 1000; i++) {
+        for (uint64_t v : iota(10)) {
+            sum += v;
+        }
+    }
+    assert(sum == (1000 * 45));
+    assert((FramePool::nallocs() - nallocs) <= 1);
+
+    // Generators that are alive together each take a frame.
+    std::vector<generator<uint64_t>> gens;
+    for (int i = 0; i < 10; i++) {
+        gens.push_back(iota(i));
+    }
+    gens.clear();
+
+    nallocs = FramePool::nallocs();
+    for (int i = 0; i < 10; i++) {
+        gens.push_back(iota(i));
+    }
+    assert(FramePool::nallocs() == nallocs);
+
+    TEST_END();
+}
+
+void
+test_generator_exception(void)
+{
+    TEST_START();
+
+    int count = 0;
+    bool caught = false;
+    try {
+        for (int v : throwsAfter(5)) {
+            assert(v == count);
+            count++;
+        }
+    } catch (const std::runtime_error& ex) {
+        caught = (strcmp(ex.what(), "throwsAfter") == 0);
+    }
+    assert(caught);
+    assert(count == 5);
+
+    TEST_END();
+}
+
+/*
+ * Sum 'nvalues' values: Of a plain loop, and streamed through generators,
+ * one value per resume and a chunk per resume. Report ns / value of each.
+ */
+void
+benchGenerator(uint64_t nvalues)
+{
+    using bench_clock = std::chrono::steady_clock;
+
+    // The plain loop's bound, and the sum, go through volatiles, so the
+    // compiler cannot replace the loop with a closed-form.
+    volatile uint64_t vnvalues = nvalues;
+    volatile uint64_t vsum;
+
+    auto start = bench_clock::now();
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < vnvalues; i++) {
+        sum += i;
+    }
+    vsum = sum;
+    double loop_ns = (std::chrono::duration<double, std::nano>(bench_clock::now()
+                                                                - start).count()
+                        / nvalues);
+
+    start = bench_clock::now();
+    sum = 0;
+    for (uint64_t v : iota(vnvalues)) {
+        sum += v;
+    }
+    vsum = sum;
+    double single_ns = (std::chrono::duration<double, std::nano>(bench_clock::now()
+                                                                  - start).count()
+                        / nvalues);
+    assert(vsum == ((nvalues * (nvalues - 1)) / 2));
+
+    start = bench_clock::now();
+    sum = 0;
+    for (uint64_t v : iotaChunked(vnvalues)) {
+        sum += v;
+    }
+    vsum = sum;
+    double chunked_ns = (std::chrono::duration<double, std::nano>(bench_clock::now()
+                                                                   - start).count()
+                         / nvalues);
+    assert(vsum == ((nvalues * (nvalues - 1)) / 2));
+
+    printf("%lu values: loop %.3f ns/value, generator %.3f ns/value (%.1fx),"
+           " chunked generator %.3f ns/value (%.1fx)\n",
+           nvalues, loop_ns, single_ns, (single_ns / loop_ns),
+           chunked_ns, (chunked_ns / loop_ns));
+}
@@ -11,6 +11,14 @@
  *        ./coroutines-simplest-example [test_*]
  *        ./coroutines-simplest-example [--help | test_<something> | test_<prefix> ]
  *        ./coroutines-simplest-example test_coroutines
+ *        ./coroutines-simplest-example --bench-sched [ <ntasks> [ <nthreads> ] ]
+ *
+ * The test_scheduler* cases run Task coroutines on CoroScheduler, of
+ * coro-scheduler.h: A pool of worker threads, each with its own run-queue,
+ * stealing work from each other. --bench-sched measures its throughput of
+ * coroutine switches. Its sleepFor() awaitable is the non-polling version of
+ * co_sleep{} below: A timer heap, with the timer thread blocked in the OS
+ * till the next deadline.
  *
  * -----------------------------------------------------------------------------
  *          **** Description of coroutines workflow: ****
@@ -79,14 +87,19 @@
  * -----------------------------------------------------------------------------
  */
 #include <iostream>
-#include <experimental/coroutine>
 #include <thread>
 #include <queue>
 #include <functional>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cassert>
+
+#include "coro-scheduler.h"     // Also, coro_std:: for <[experimental/]coroutine>
 
 using namespace std;
 
-string Usage = " [ --help | test_<fn-name> ]\n";
+string Usage = " [ --help | test_<fn-name> | --bench-sched [ <ntasks> [ <nthreads> ] ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -96,6 +109,12 @@ void test_that(void);
 void test_msg(string);
 
 void test_coroutines(void);
+void test_scheduler_basic(void);
+void test_scheduler_100k_tasks(void);
+void test_scheduler_steals(void);
+void test_scheduler_sleepers(void);
+
+void benchScheduler(unsigned ntasks, unsigned nthreads);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -109,6 +128,12 @@ TEST_FNS Test_fns[] = {
                           { "test_this"         , test_this }
                         , { "test_that"         , test_that }
                         , { "test_coroutines"   , test_coroutines }
+                        , { "test_scheduler_basic"  , test_scheduler_basic }
+                        , { "test_scheduler_100k_tasks"
+                                                    , test_scheduler_100k_tasks }
+                        , { "test_scheduler_steals" , test_scheduler_steals }
+                        , { "test_scheduler_sleepers"
+                                                    , test_scheduler_sleepers }
                       };
 
 // Test start / end info-msg macros
@@ -154,31 +179,36 @@ std::queue<std::function<bool()>> Task_queue;
  * task queue (Task_queue), which will be executed asynchronously.
  * The lambda checks if the elapsed time exceeds a specified delay and resumes
  * the coroutine handle accordingly.
+ *
+ * NOTE: Every pass over the queue polls every sleeper, O(N) per pass, due or
+ * not. See CoroScheduler::sleepFor() for sleeping on a timer heap instead.
  * *****************************************************************************
  */
-struct sleep {
+struct co_sleep {
+    // (Named co_sleep, not sleep, which would clash with POSIX sleep(3) that
+    // <thread> pulls in with glibc.)
 
-    // Define a constructor for the sleep struct that takes an integer
+    // Define a constructor for the co_sleep struct that takes an integer
     // parameter n and initializes the member variable `delay` with the value
     // of n. The empty constructor body indicates that no additional operations
     // are performed during initialization.
     // However, we enhanced the interface to accept the calling fn's name,
     // which then gets printed in the body, for diagnostics.
-    sleep(int n, string callerfn) : delay{n} {
-        cout << "Constructor for sleep{} called from '"
+    co_sleep(int n, string callerfn) : delay{n} {
+        cout << "Constructor for co_sleep{} called from '"
              << callerfn << "', n=" << n << endl;
     }
 
     constexpr bool await_ready() const noexcept { return false; }
 
     // Mandatory to have a method named exactly 'await_suspend()' in this
-    // object. The call to "co_await sleep()" to instantiate one such object
+    // object. The call to "co_await co_sleep()" to instantiate one such object
     // will go through the STLibrary's coroutine interfaces, which will look
     // for a method named exactly like so.
     // (If you change the name, it will raise this error:
-    // error: no member named 'await_suspend' in 'sleep'.)
+    // error: no member named 'await_suspend' in 'co_sleep'.)
     void
-    await_suspend(std::experimental::coroutine_handle<> corhdl) noexcept
+    await_suspend(coro_std::coroutine_handle<> corhdl) noexcept
     {
         // Record the start time before the async operation begins.
         auto start = std::chrono::steady_clock::now();
@@ -207,9 +237,9 @@ struct sleep {
                                      << endl;
 
                                 // This jugglery is to workaround following g++
-                                // error: 'this' argument to member function 'resume' has type 'const std::experimental::coroutine_handle<>', but function is not marked const
+                                // error: 'this' argument to member function 'resume' has type 'const coroutine_handle<>', but function is not marked const
                                 //
-                                std::experimental::coroutine_handle<> resumehdl = corhdl;
+                                coro_std::coroutine_handle<> resumehdl = corhdl;
                                 resumehdl.resume();
 
                                 // Success: Asynchronous operation has completed
@@ -258,7 +288,7 @@ struct sleep {
 struct Task {
 
     // ------------------------------------------------------------------------
-    // NOTE: Mandatory part of the interface of std::experimental::coroutine_traits
+    // NOTE: Mandatory part of the interface of coroutine_traits
     //       It requires a member defined with exactly 'promise_type' name.
     //       Otherwise, you will get a compiler error.
     //
@@ -290,15 +320,17 @@ struct Task {
         Task get_return_object() { return {}; }
 
         // Specifies that the coroutine should be initially suspended.
-        // std::experimental::suspend_always initial_suspend() { return {}; }
+        // coro_std::suspend_always initial_suspend() { return {}; }
 
         // Specifies that the coroutine should not be suspended on startup.
         // (i.e. before returning to the caller / main() )
-        std::experimental::suspend_never initial_suspend() { return {}; }
+        coro_std::suspend_never initial_suspend() { return {}; }
 
         // Specifies what happens when the coroutine termintes. Always use
         // 'noexcept' as it's difficult to deal with exceptions when terminating.
-        std::experimental::suspend_always final_suspend() noexcept { return {}; }
+        // Task{} holds no handle to the coroutine, so nothing can destroy a
+        // frame suspended here; do not suspend, and let the frame be freed.
+        coro_std::suspend_never final_suspend() noexcept { return {}; }
 
         void unhandled_exception() {}
 
@@ -324,16 +356,16 @@ cor_fn1() noexcept {
     // cout << "[" << __func__ << ":" << __LINE__ << "]: Hello! "
     cout << endl << LOC() + "**** Hello! Starting co-routine 1 ..." << endl;
 
-    // Use diff ictrs, passed as delay param to sleep(), so we can see
+    // Use diff ictrs, passed as delay param to co_sleep(), so we can see
     // in trace outputs which function is being called.
     for (auto i = 0; i < NIters_coro_1; i++) {
         cout << endl << LOC() << "Hello ictr=" << i << "... Going to sleep\n";
 
         // NOTE: Compiler converts operant to `co_await` into an awaiter object,
         // which will tell it (the coroutine[?]) how to manage the suspension.
-        // The await_suspend() method defined in the sleep{} object dictates
+        // The await_suspend() method defined in the co_sleep{} object dictates
         // what action is tken when await is invoked.
-        co_await sleep{i, __func__};
+        co_await co_sleep{i, __func__};
     }
     co_return; // Returns nothing.
 }
@@ -342,11 +374,11 @@ Task
 cor_fn2() noexcept {
     cout << endl << LOC() << "**** Hello! Starting co-routine 2 ..." << endl;
 
-    // Use diff jctrs, passed as delay param to sleep(), so we can see
+    // Use diff jctrs, passed as delay param to co_sleep(), so we can see
     // in trace outputs which function is being called.
     for (int j = NIters_coro_1; j < (NIters_coro_1 + NIters_coro_2); j++) {
         cout << endl << LOC() << "Hello jctr=" << j << "... Going to sleep\n";
-        co_await sleep{j, __func__};
+        co_await co_sleep{j, __func__};
     }
     // As coroutine returns void, we can skip this stmt as well.
     // co_return; // Returns nothing.
@@ -408,6 +440,11 @@ main(const int argc, const char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         cout << argv[0] << Usage << endl;
         return 0;
+    } else if (strcmp("--bench-sched", argv[1]) == 0) {
+        unsigned ntasks = ((argc > 2) ? atoi(argv[2]) : (100 * 1000));
+        unsigned nthreads = ((argc > 3) ? atoi(argv[3])
+                                        : std::thread::hardware_concurrency());
+        benchScheduler(ntasks, nthreads);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
         // Execute the named test-function, if it's a supported test-function
         int tctr = 0;
@@ -453,3 +490,242 @@ test_msg(string msg)
     TEST_START();
     assert(msg == "Hello World.");
 }
+
+/*
+ * *****************************************************************************
+ * Task coroutines on the multi-threaded CoroScheduler.
+ * *****************************************************************************
+ */
+
+// Hop onto the scheduler and yield 'nyields' times, counting the resumes.
+Task
+cor_yielder(CoroScheduler& sched, int nyields, std::atomic<uint64_t>& nresumed,
+            std::atomic<unsigned>& ndone)
+{
+    co_await sched.schedule();
+    uint64_t nlocal = 1;
+    for (int i = 0; i < nyields; i++) {
+        co_await sched.yield();
+        nlocal++;
+    }
+    nresumed.fetch_add(nlocal, std::memory_order_relaxed);
+    ndone.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * A couple of Task coroutines, started from this thread, run to completion
+ * on the workers; the main thread's id is never seen inside them, after
+ * the first co_await.
+ */
+Task
+cor_on_worker(CoroScheduler& sched, std::thread::id main_id, bool& ran_on_worker)
+{
+    co_await sched.schedule();
+    ran_on_worker = (std::this_thread::get_id() != main_id);
+    co_await sched.yield();
+    ran_on_worker = (ran_on_worker && (std::this_thread::get_id() != main_id));
+}
+
+void
+test_scheduler_basic(void)
+{
+    TEST_START();
+
+    CoroScheduler sched(2);
+    bool ran_a = false;
+    bool ran_b = false;
+    cor_on_worker(sched, std::this_thread::get_id(), ran_a);
+    cor_on_worker(sched, std::this_thread::get_id(), ran_b);
+    sched.drain();
+    assert(ran_a && ran_b);
+    assert(sched.nresumes() == 4);
+
+    TEST_END();
+}
+
+/*
+ * 100K concurrent Task coroutines, each yielding 10 times: Each resume is
+ * counted exactly once, and every task completes.
+ */
+void
+test_scheduler_100k_tasks(void)
+{
+    TEST_START();
+
+    constexpr unsigned ntasks = (100 * 1000);
+    constexpr int      nyields = 10;
+
+    CoroScheduler sched(4);
+    std::atomic<uint64_t> nresumed{0};
+    std::atomic<unsigned> ndone{0};
+    for (unsigned i = 0; i < ntasks; i++) {
+        cor_yielder(sched, nyields, nresumed, ndone);
+    }
+    sched.drain();
+
+    assert(ndone.load() == ntasks);
+    assert(nresumed.load() == ((uint64_t) ntasks * (nyields + 1)));
+    assert(sched.nresumes() == nresumed.load());
+
+    uint64_t sum = 0;
+    for (unsigned id = 0; id < sched.nthreads(); id++) {
+        sum += sched.nresumes(id);
+    }
+    assert(sum == sched.nresumes());
+
+    TEST_END();
+}
+
+// Block the worker for a while, so the others must steal to make progress.
+Task
+cor_blocker(std::atomic<unsigned>& ndone)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    ndone.fetch_add(1, std::memory_order_relaxed);
+    co_return;
+}
+
+// Spawn tasks from one worker, onto its own deque: Others steal them.
+Task
+cor_spawner(CoroScheduler& sched, unsigned nchildren, std::atomic<unsigned>& ndone)
+{
+    co_await sched.schedule();
+    for (unsigned i = 0; i < nchildren; i++) {
+        [](CoroScheduler& sched, std::atomic<unsigned>& ndone) -> Task {
+            co_await sched.schedule();
+            cor_blocker(ndone);
+        }(sched, ndone);
+    }
+}
+
+void
+test_scheduler_steals(void)
+{
+    TEST_START();
+
+    constexpr unsigned nchildren = 200;
+
+    CoroScheduler sched(4);
+    std::atomic<unsigned> ndone{0};
+    cor_spawner(sched, nchildren, ndone);
+    sched.drain();
+
+    assert(ndone.load() == nchildren);
+    assert(sched.nsteals() > 0);
+
+    unsigned nbusy = 0;
+    for (unsigned id = 0; id < sched.nthreads(); id++) {
+        nbusy += (sched.nresumes(id) > 0);
+    }
+    assert(nbusy > 1);
+
+    TEST_END();
+}
+
+// Sleep 'delay', and check we are not woken before the deadline.
+Task
+cor_sleeper(CoroScheduler& sched, std::chrono::milliseconds delay,
+            std::atomic<unsigned>& nlate, std::atomic<unsigned>& nearly)
+{
+    co_await sched.schedule();
+    auto deadline = (CoroScheduler::Clock::now() + delay);
+    co_await sched.sleepUntil(deadline);
+    auto now = CoroScheduler::Clock::now();
+    if (now < deadline) {
+        nearly.fetch_add(1);
+    } else if ((now - deadline) > std::chrono::milliseconds(100)) {
+        nlate.fetch_add(1);
+    }
+}
+
+/*
+ * 10K coroutines sleeping 150-350 ms: None wakes early, and the process
+ * uses little CPU while they sleep, as nothing polls them. CPU is measured
+ * only once all are parked on timers and all workers are idle, before the
+ * first deadline; if that takes too long, e.g. under a sanitizer or on a
+ * loaded box, the figure is reported as n/a and not checked.
+ */
+void
+test_scheduler_sleepers(void)
+{
+    TEST_START();
+
+    constexpr unsigned nsleepers = (10 * 1000);
+    constexpr auto     first_delay = std::chrono::milliseconds(150);
+    constexpr auto     park_by = std::chrono::milliseconds(50);
+    constexpr auto     quiet = std::chrono::milliseconds(80);
+
+    std::atomic<unsigned> nlate{0};
+    std::atomic<unsigned> nearly{0};
+    bool   parked;
+    double quiet_cpu_secs = 0;
+    double secs;
+    {
+        CoroScheduler sched(4);
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < nsleepers; i++) {
+            cor_sleeper(sched, (first_delay + std::chrono::milliseconds(i % 200)),
+                        nlate, nearly);
+        }
+        // Wait till all are asleep; the quiet window then ends before the
+        // first deadline.
+        while (!(parked = ((sched.ntimersPending() == nsleepers)
+                           && (sched.nidleWorkers() == sched.nthreads())))
+               && ((std::chrono::steady_clock::now() - start) < park_by)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (parked) {
+            std::clock_t cpu_start = std::clock();
+            std::this_thread::sleep_for(quiet);
+            quiet_cpu_secs = ((double) (std::clock() - cpu_start) / CLOCKS_PER_SEC);
+        }
+
+        sched.drain();
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                - start).count();
+        assert(sched.ntimers() == nsleepers);
+        assert(sched.ntimersPending() == 0);
+    }
+
+    assert(nearly.load() == 0);
+    assert(secs >= 0.349);
+    if (parked) {
+        printf("(%.3f s, %.3f s CPU while asleep, %u late) ",
+               secs, quiet_cpu_secs, nlate.load());
+    } else {
+        printf("(%.3f s, CPU while asleep n/a: not parked in %d ms, %u late) ",
+               secs, (int) park_by.count(), nlate.load());
+    }
+    fflush(stdout);
+    assert(!parked
+           || (quiet_cpu_secs < (std::chrono::duration<double>(quiet).count() / 2)));
+
+    TEST_END();
+}
+
+/*
+ * Run 'ntasks' coroutines, each yielding 100 times, on 'nthreads' workers,
+ * and report coroutine switches / second.
+ */
+void
+benchScheduler(unsigned ntasks, unsigned nthreads)
+{
+    constexpr int nyields = 100;
+
+    CoroScheduler sched(nthreads);
+    std::atomic<uint64_t> nresumed{0};
+    std::atomic<unsigned> ndone{0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < ntasks; i++) {
+        cor_yielder(sched, nyields, nresumed, ndone);
+    }
+    sched.drain();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                    - start).count();
+    printf("%u tasks x %d yields on %u threads: %lu resumes in %.3f s,"
+           " %.2f M resumes/s, %lu steals\n",
+           ntasks, nyields, sched.nthreads(), nresumed.load(), secs,
+           (nresumed.load() / secs / 1e6), sched.nsteals());
+    assert(ndone.load() == ntasks);
+}
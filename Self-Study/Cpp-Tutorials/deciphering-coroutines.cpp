@@ -35,20 +35,29 @@
  *      CppCon 2022: Deciphering C++ Coroutines - A Diagrammatic Coroutine Cheat Sheet
         https://www.linkedin.com/in/andreas-weis-0459994b/
  *
- * Usage: g++ -o deciphering-coroutines deciphering-coroutines.cpp
+ * Usage: g++ -std=c++20 -o deciphering-coroutines deciphering-coroutines.cpp
  *        ./deciphering-coroutines [test_*]
  *        ./deciphering-coroutines [--help | test_<something> | test_<prefix> ]
  *
  * History:
  *  Thu 29.Feb.2024: Went for Chris Ramming's going-away lunch in Los Altos.
  *
+ * coro_FiboGenerator4() is coro_FiboGenerator3() without the hand-written
+ * return type: generator<T>, of generator.h, supplies the promise_type, and
+ * iterators, so the caller pulls numbers with a range-for.
+ *
  * RESOLVE: Come up with scaffolding and example of Symmetric Transfer between
  *          2 coroutines.
  * -----------------------------------------------------------------------------
  */
 #include <iostream>
+#include <cassert>
+#include <cstring>
+#include <ranges>
 #include <thread>
-#include <experimental/coroutine>
+#include <vector>
+
+#include "generator.h"      // generator<T>, and coro_std: <coroutine> or <experimental/coroutine>
 
 using namespace std;
 
@@ -69,6 +78,7 @@ void test_coro_hello_world_await_42(void);
 void test_coro_FiboGenerator(void);
 void test_coro_FiboGenerator2(void);
 void test_coro_FiboGenerator3(void);
+void test_coro_FiboGenerator4(void);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -88,6 +98,7 @@ TEST_FNS Test_fns[] = {
         , { "test_coro_FiboGenerator"         , test_coro_FiboGenerator }
         , { "test_coro_FiboGenerator2"        , test_coro_FiboGenerator2 }
         , { "test_coro_FiboGenerator3"        , test_coro_FiboGenerator3 }
+        , { "test_coro_FiboGenerator4"        , test_coro_FiboGenerator4 }
 };
 
 // Test start / end info-msg macros
@@ -135,18 +146,18 @@ struct AnyCoroReturnType {
         // return type.
         AnyCoroReturnType   get_return_object() {
             return AnyCoroReturnType {
-                std::experimental::coroutine_handle<promise_type>::from_promise(*this)
+                coro_std::coroutine_handle<promise_type>::from_promise(*this)
             };
         }
 
         // Specifies that the coroutine should always be initially suspended.
-        std::experimental::suspend_always initial_suspend() { return {}; }
+        coro_std::suspend_always initial_suspend() { return {}; }
 
         // Interface that gets invoked by use of co_yield in coroutine.
         // Rather than go through (a) Invoke constructor for Awaitable, and
         // (b) Poke the value into the promise_type{}'s value_, poke it here
         // directly. And then invoke suspend.
-        std::experimental::suspend_always yield_value(uint32 value) {
+        coro_std::suspend_always yield_value(uint32 value) {
             value_ = value;
 
             // Expected return from `co_await Awaitable` is expected to be
@@ -161,17 +172,17 @@ struct AnyCoroReturnType {
 
         // Specifies what happens when the coroutine termintes. Always use
         // 'noexcept' as it's difficult to deal with exceptions when terminating.
-        std::experimental::suspend_always final_suspend() noexcept { return {}; }
+        coro_std::suspend_always final_suspend() noexcept { return {}; }
     };
 
     // ------------------
     // Member fields
     // ------------------
-    std::experimental::coroutine_handle<promise_type> corhdl;
+    coro_std::coroutine_handle<promise_type> corhdl;
 
     // Constructor: Takes coroutine_handle<promise_type> as an arg in its
     // constructor and store it in member variable, `corhdl`.
-    AnyCoroReturnType(std::experimental::coroutine_handle<promise_type> h)
+    AnyCoroReturnType(coro_std::coroutine_handle<promise_type> h)
         : corhdl(h) { }
 
     // ------------------
@@ -219,7 +230,7 @@ struct Awaitable {
     // the coroutine goes to sleep (get suspended). This function takes as
     // its argument the coroutine_handle to the coroutine function that is
     // about to be suspended.
-    void    await_suspend(std::experimental::coroutine_handle<AnyCoroReturnType::promise_type> corhdl) {
+    void    await_suspend(coro_std::coroutine_handle<AnyCoroReturnType::promise_type> corhdl) {
 
         // Poke the value_ we are awaiting-ON back to the coroutine handle's promise
         corhdl.promise().value_ = value_;
@@ -412,6 +423,25 @@ coro_FiboGenerator3(void)
     co_return;
 }
 
+/*
+ * *****************************************************************************
+ * coro_FiboGenerator3() as a generator<uint32>: The same co_yield, but the
+ * promise_type, with its yield_value(), comes with generator<>. The frame of
+ * the coroutine is taken from a pool of freed frames, not malloc'ed anew.
+ * *****************************************************************************
+ */
+generator<uint32>
+coro_FiboGenerator4(void)
+{
+    uint32 i1 = 1;
+    uint32 i2 = 1;
+
+    while (true) {
+        co_yield i1;
+        i1 = std::exchange(i2, (i1 + i2));
+    }
+}
+
 /*
  * *****************************************************************************
  * main()
@@ -668,3 +698,33 @@ test_coro_FiboGenerator3(void)
     }
     TEST_END();
 }
+
+/*
+ * -----------------------------------------------------------------------------
+ * Pull numbers from coro_FiboGenerator4() with a range-for: begin() does the
+ * initial resume(), ++ the next ones, and views::take() stops the endless
+ * generator. Check them against coro_FiboGenerator3(), resumed by hand.
+ * -----------------------------------------------------------------------------
+ */
+void
+test_coro_FiboGenerator4(void)
+{
+    TEST_START();
+
+    cout << endl;
+    std::vector<uint32> nums;
+    for (uint32 next_num : coro_FiboGenerator4() | std::views::take(20)) {
+        printf("[%s():%d] Fibo[%2d] = %4u\n",
+               __func__, __LINE__, (int) nums.size(), next_num);
+        nums.push_back(next_num);
+    }
+    assert(nums.size() == 20);
+
+    AnyCoroReturnType cor = coro_FiboGenerator3();
+    for (uint32 num : nums) {
+        cor.resume();
+        assert(cor.getAnswer() == num);
+    }
+    cout << endl;
+    TEST_END();
+}
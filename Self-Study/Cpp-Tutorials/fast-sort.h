@@ -0,0 +1,391 @@
+/*
+ * -----------------------------------------------------------------------------
+ * fast-sort.h: fastSort(), a drop-in for std::sort() of a vector, or array,
+ * that picks the fastest of three sorts for the keys and their # :
+ *
+ *  fastSort(floats);                               // Ascending, all CPUs
+ *  fastSort(strings, std::greater<string>());      // Any comparator
+ *  fastSort(ints.data(), ints.size(), std::less<int>(), 1);   // 1 thread
+ *
+ *  - sortNetwork(): Up to Sort_network_max keys, padded to that many, by a
+ *    fixed bitonic network of compare-exchanges of their radix keys, below:
+ *    No branches on the data, so no mispredicts, and each stage's
+ *    compare-exchanges of contiguous half-blocks are a loop of unsigned
+ *    min / max the compiler vectorizes.
+ *  - radixSort(): LSD radix sort, 8-bit digits, for ints and floats sorted
+ *    by std::less: Each key maps to an unsigned of its size, in the same
+ *    order: ints flip the sign bit; floats flip the sign bit of positives,
+ *    and all bits of negatives, whose bit patterns count down. One read
+ *    counts all digits' histograms; then one scatter pass per digit, except
+ *    for digits that all keys share, e.g. the high bytes of small ints. O(n)
+ *    and no comparisons, for a buffer of n keys.
+ *  - parallelSort(): Sample sort, over 'nthreads' std::threads: Splitters
+ *    from a sorted, evenly spaced sample cut the keys into buckets of about
+ *    equal size; each thread counts, then scatters, its chunk of the keys
+ *    into the buckets; the threads then sort buckets, each one serially, by
+ *    radix sort if it applies, else std::sort.
+ *
+ * Other key types, and comparators, sort by std::sort, in parallel by the
+ * sample sort. Neither radix nor sample sort is stable; neither is std::sort.
+ *
+ * Ints and floats sorted by std::less compare by radix key, on all paths,
+ * which for floats is their IEEE total order: -0.0 before +0.0, which
+ * operator< holds equal, and NaNs, which it leaves unordered (and std::sort
+ * undefined), sorted to the ends by their sign.
+ *
+ * Sample sort buckets by splitter, so many copies of one key land in one
+ * bucket, sorted by one thread: Correct, but less parallel.
+ *
+ * Ref:
+ *  - Batcher: Sorting networks and their applications, 1968.
+ *  - Blelloch et al.: A Comparison of Sorting Algorithms for the Connection
+ *    Machine CM-2, 1991. (Sample sort; radix sort.)
+ *  - Herf: Radix Tricks, 2001. http://stereopsis.com/radix.html
+ * -----------------------------------------------------------------------------
+ */
+#ifndef __FAST_SORT_H__
+#define __FAST_SORT_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Up to this many keys sort by the sorting network; a power of 2.
+constexpr size_t   Sort_network_max = 16;
+
+// Radix sort from this many keys; below, its passes cost more than std::sort.
+constexpr size_t   Sort_radix_min = 64;
+
+// Sort in parallel from this many keys, and give each thread at least this
+// many.
+constexpr size_t   Sort_parallel_min = (256 * 1024);
+
+// Sample sort: # of buckets per thread, so that threads that finish their
+// buckets early take others; and samples per bucket, to choose splitters.
+constexpr unsigned Sort_buckets_per_thread = 4;
+constexpr unsigned Sort_oversample = 32;
+
+// Radix sort applies to ints, and floats, of up to 8 bytes, sorted ascending.
+template <typename T, typename Compare>
+constexpr bool Sort_is_radix_sortable =
+    ((std::is_integral<T>::value && !std::is_same<T, bool>::value)
+     || (std::is_floating_point<T>::value && ((sizeof(T) == 4) || (sizeof(T) == 8))))
+    && (std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value);
+
+/*
+ * Radix key of a T: An unsigned of T's size, whose order is that of T's by <.
+ */
+template <typename T>
+struct RadixKey
+{
+    using type = std::make_unsigned_t<std::conditional_t<std::is_floating_point<T>::value,
+                     std::conditional_t<(sizeof(T) == 4), int32_t, int64_t>, T>>;
+
+    static constexpr type Sign_bit = (type{1} << ((8 * sizeof(type)) - 1));
+
+    static type
+    key(T value) {
+        if constexpr (std::is_floating_point<T>::value) {
+            type bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            // Negative: Flip all bits; positive: Flip the sign bit.
+            return (bits ^ ((type) -(bits >> ((8 * sizeof(type)) - 1)) | Sign_bit));
+        } else if constexpr (std::is_signed<T>::value) {
+            return ((type) value ^ Sign_bit);
+        } else {
+            return (type) value;
+        }
+    }
+
+    // The T of a key(value).
+    static T
+    value(type key) {
+        if constexpr (std::is_floating_point<T>::value) {
+            type bits = ((key & Sign_bit) ? (key ^ Sign_bit) : ~key);
+            T value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        } else if constexpr (std::is_signed<T>::value) {
+            return (T) (key ^ Sign_bit);
+        } else {
+            return (T) key;
+        }
+    }
+
+    static bool less(T lhs, T rhs) { return (key(lhs) < key(rhs)); }
+};
+
+/*
+ * Bitonic network stages, unrolled at compile-time: Merge the runs of K keys
+ * in keys[0 .. Sort_network_max-1], compare-exchanging keys Half apart, in
+ * blocks of 2 * Half, up or down by the block's place in its run of 2 * K.
+ * Each half-block is a fixed-length loop of min / max, that vectorizes; as
+ * selects, not std::min(), which g++ turns into a branch per key, at -O2.
+ */
+template <size_t K, size_t Half, typename U>
+inline void
+sortNetworkStage(U *keys)
+{
+    for (size_t block = 0; block < Sort_network_max; block += (2 * Half)) {
+        U *lo = (keys + block);
+        U *hi = (lo + Half);
+        if ((block & K) == 0) {
+            for (size_t i = 0; i < Half; i++) {
+                U a = lo[i];
+                U b = hi[i];
+                lo[i] = ((b < a) ? b : a);
+                hi[i] = ((b < a) ? a : b);
+            }
+        } else {
+            for (size_t i = 0; i < Half; i++) {
+                U a = lo[i];
+                U b = hi[i];
+                lo[i] = ((b < a) ? a : b);
+                hi[i] = ((b < a) ? b : a);
+            }
+        }
+    }
+    if constexpr (Half > 1) {
+        sortNetworkStage<K, (Half / 2)>(keys);
+    }
+}
+
+template <size_t K, typename U>
+inline void
+sortNetworkMerge(U *keys)
+{
+    sortNetworkStage<K, (K / 2)>(keys);
+    if constexpr (K < Sort_network_max) {
+        sortNetworkMerge<(2 * K)>(keys);
+    }
+}
+
+/*
+ * Sort first[0 .. n-1], n <= Sort_network_max, ascending, by a bitonic
+ * network over Sort_network_max radix keys, padded with the max key.
+ */
+template <typename T>
+void
+sortNetwork(T *first, size_t n)
+{
+    using Key = RadixKey<T>;
+    using U = typename Key::type;
+    U keys[Sort_network_max];
+    for (size_t i = 0; i < Sort_network_max; i++) {
+        keys[i] = ((i < n) ? Key::key(first[i]) : std::numeric_limits<U>::max());
+    }
+    sortNetworkMerge<2>(keys);
+    for (size_t i = 0; i < n; i++) {
+        first[i] = Key::value(keys[i]);
+    }
+}
+
+/*
+ * LSD radix sort of first[0 .. n-1], ascending, using buf[0 .. n-1]; the
+ * sorted keys end up in first[].
+ */
+template <typename T>
+void
+radixSort(T *first, size_t n, T *buf)
+{
+    using Key = RadixKey<T>;
+    constexpr unsigned ndigits = sizeof(typename Key::type);
+
+    if (n < 2) {
+        return;
+    }
+    std::vector<size_t> counts(ndigits * 256);
+    for (size_t i = 0; i < n; i++) {
+        typename Key::type key = Key::key(first[i]);
+        for (unsigned d = 0; d < ndigits; d++) {
+            counts[(d * 256) + ((key >> (8 * d)) & 0xff)]++;
+        }
+    }
+
+    T *src = first;
+    T *dst = buf;
+    for (unsigned d = 0; d < ndigits; d++) {
+        size_t *count = &counts[d * 256];
+        if (count[(Key::key(src[0]) >> (8 * d)) & 0xff] == n) {
+            continue;                   // All keys have this digit
+        }
+        size_t offsets[256];
+        size_t offset = 0;
+        for (unsigned digit = 0; digit < 256; digit++) {
+            offsets[digit] = offset;
+            offset += count[digit];
+        }
+        for (size_t i = 0; i < n; i++) {
+            dst[offsets[(Key::key(src[i]) >> (8 * d)) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != first) {
+        std::copy(src, (src + n), first);
+    }
+}
+
+/*
+ * Sort first[0 .. n-1] on this thread, by the fastest sort that applies.
+ * 'buf', if not NULL, is n keys of scratch space for radix sort.
+ */
+template <typename T, typename Compare>
+void
+serialSort(T *first, size_t n, Compare comp, T *buf = nullptr)
+{
+    if constexpr (Sort_is_radix_sortable<T, Compare>) {
+        (void) comp;
+        if (n <= Sort_network_max) {
+            sortNetwork(first, n);
+        } else if (n < Sort_radix_min) {
+            std::sort(first, (first + n), [](T lhs, T rhs) { return RadixKey<T>::less(lhs, rhs); });
+        } else if (buf) {
+            radixSort(first, n, buf);
+        } else {
+            std::vector<T> scratch(n);
+            radixSort(first, n, scratch.data());
+        }
+    } else {
+        (void) buf;
+        std::sort(first, (first + n), comp);
+    }
+}
+
+// Run fn(tid) on 'nthreads' threads, this one being tid 0.
+template <typename Fn>
+void
+sortRunThreads(unsigned nthreads, Fn fn)
+{
+    std::vector<std::thread> threads;
+    for (unsigned tid = 1; tid < nthreads; tid++) {
+        threads.emplace_back(fn, tid);
+    }
+    fn(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * Sample sort of first[0 .. n-1] by 'comp', on 'nthreads' threads; 0 for all
+ * CPUs. Inputs too small to split sort serially.
+ */
+template <typename T, typename Compare = std::less<T>>
+void
+parallelSort(T *first, size_t n, Compare comp = Compare(), unsigned nthreads = 0)
+{
+    if (nthreads == 0) {
+        nthreads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    nthreads = (unsigned) std::min({ (size_t) nthreads, (n / Sort_parallel_min),
+                                     (size_t) (UINT16_MAX / Sort_buckets_per_thread) });
+    if (nthreads <= 1) {
+        serialSort(first, n, comp);
+        return;
+    }
+
+    // Split, and sort buckets, by the order serialSort() sorts them in.
+    auto less = [&comp](const T& lhs, const T& rhs) {
+        if constexpr (Sort_is_radix_sortable<T, Compare>) {
+            return RadixKey<T>::less(lhs, rhs);
+        } else {
+            return comp(lhs, rhs);
+        }
+    };
+
+    // Splitters: Every Sort_oversample'th of an evenly spaced sample.
+    const size_t nbuckets = (nthreads * Sort_buckets_per_thread);
+    const size_t nsamples = (nbuckets * Sort_oversample);
+    std::vector<T> samples;
+    samples.reserve(nsamples);
+    for (size_t sctr = 0; sctr < nsamples; sctr++) {
+        samples.push_back(first[((sctr * n) / nsamples) + ((n / nsamples) / 2)]);
+    }
+    std::sort(samples.begin(), samples.end(), less);
+    std::vector<T> splitters;
+    for (size_t bctr = 1; bctr < nbuckets; bctr++) {
+        splitters.push_back(samples[bctr * Sort_oversample]);
+    }
+    auto bucketOf = [&splitters, &less](const T& key) {
+        return (size_t) (std::upper_bound(splitters.begin(), splitters.end(), key, less)
+                         - splitters.begin());
+    };
+    auto chunkOf = [n, nthreads](unsigned tid, size_t& start, size_t& end) {
+        start = ((n * tid) / nthreads);
+        end = ((n * (tid + 1)) / nthreads);
+    };
+
+    // Count each thread's keys per bucket, noting each key's bucket for the
+    // scatter; lay out buckets, each holding its keys from thread 0, then
+    // thread 1, ...
+    std::vector<uint16_t> key_buckets(n);
+    std::vector<size_t> offsets(nthreads * nbuckets);
+    sortRunThreads(nthreads, [&](unsigned tid) {
+        size_t start, end;
+        chunkOf(tid, start, end);
+        size_t *counts = &offsets[tid * nbuckets];
+        for (size_t i = start; i < end; i++) {
+            key_buckets[i] = (uint16_t) bucketOf(first[i]);
+            counts[key_buckets[i]]++;
+        }
+    });
+    std::vector<size_t> bucket_starts(nbuckets + 1);
+    size_t offset = 0;
+    for (size_t bctr = 0; bctr < nbuckets; bctr++) {
+        bucket_starts[bctr] = offset;
+        for (unsigned tid = 0; tid < nthreads; tid++) {
+            size_t count = offsets[(tid * nbuckets) + bctr];
+            offsets[(tid * nbuckets) + bctr] = offset;
+            offset += count;
+        }
+    }
+    bucket_starts[nbuckets] = n;
+
+    std::vector<T> scratch(n);
+    sortRunThreads(nthreads, [&](unsigned tid) {
+        size_t start, end;
+        chunkOf(tid, start, end);
+        size_t *next = &offsets[tid * nbuckets];
+        for (size_t i = start; i < end; i++) {
+            scratch[next[key_buckets[i]]++] = std::move(first[i]);
+        }
+    });
+
+    // Sort buckets, taken in turn by whichever thread is free, and move them
+    // back; a bucket's own range of first[] is its radix sort buffer.
+    std::atomic<size_t> next_bucket{0};
+    sortRunThreads(nthreads, [&](unsigned) {
+        size_t bctr;
+        while ((bctr = next_bucket.fetch_add(1)) < nbuckets) {
+            size_t start = bucket_starts[bctr];
+            size_t nkeys = (bucket_starts[bctr + 1] - start);
+            T *bucket = (scratch.data() + start);
+            serialSort(bucket, nkeys, comp, (first + start));
+            std::move(bucket, (bucket + nkeys), (first + start));
+        }
+    });
+}
+
+/* Sort first[0 .. n-1] by 'comp', on up to 'nthreads' threads; 0: all CPUs. */
+template <typename T, typename Compare = std::less<T>>
+void
+fastSort(T *first, size_t n, Compare comp = Compare(), unsigned nthreads = 0)
+{
+    parallelSort(first, n, comp, nthreads);
+}
+
+template <typename T, typename Compare = std::less<T>>
+void
+fastSort(std::vector<T>& keys, Compare comp = Compare(), unsigned nthreads = 0)
+{
+    fastSort(keys.data(), keys.size(), comp, nthreads);
+}
+
+#endif // __FAST_SORT_H__
@@ -7,26 +7,41 @@
  *  [1] C++ Threading #7: Future, Promise and async(), Bo Qian
  *      https://www.youtube.com/watch?v=SZQ6-pf-5Us
  *
- * Usage: g++ -o future-promise-async-basic future-promise-async-basic.pp
+ * Usage: g++ -std=c++20 -o future-promise-async-basic future-promise-async-basic.cpp -lfmt -pthread
  *        ./future-promise-async-basic [test_*]
  *        ./future-promise-async-basic [--help | test_<something> | test_<prefix> ]
+ *        ./future-promise-async-basic --bench-pool [ <ntasks> ]
+ *
+ * The test_pool_* cases redo the std::async() ones on ThreadPool, of
+ * thread-pool.h: A fixed set of worker threads, with submit() returning a
+ * TaskFuture, then() continuations and when_all(), so that trees of tasks
+ * run without creating a thread per task. --bench-pool compares the
+ * throughput of std::async() and of ThreadPool::submit() for tiny tasks.
  *
  * History:
  * -----------------------------------------------------------------------------
  */
 #include <iostream>
 #include <fmt/core.h>
+#include <memory>
 #include <thread>
 #include <future>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
 
 #if __linux__
 #include <cstring>
 #include <cassert>
 #endif // __linux__
 
+#include "thread-pool.h"
+
 using namespace std;
 
-string Usage = " [ --help | test_<fn-name> ]\n";
+string Usage = " [ --help | test_<fn-name> | --bench-pool [ <ntasks> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -39,6 +54,13 @@ void test_factorial_async(void);
 void test_factorial_deferred(void);
 void test_factorial_default_async(void);
 void test_factorial_parent_child_async(void);
+void test_pool_factorial_async(void);
+void test_pool_factorial_parent_child_async(void);
+void test_pool_then_when_all(void);
+void test_pool_task_tree(void);
+void test_pool_move_only_tasks(void);
+
+void benchPool(unsigned ntasks);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -58,6 +80,12 @@ TEST_FNS Test_fns[] = {
                                     , test_factorial_default_async }
     , { "test_factorial_parent_child_async"
                                     , test_factorial_parent_child_async }
+    , { "test_pool_factorial_async" , test_pool_factorial_async }
+    , { "test_pool_factorial_parent_child_async"
+                                    , test_pool_factorial_parent_child_async }
+    , { "test_pool_then_when_all"   , test_pool_then_when_all }
+    , { "test_pool_task_tree"       , test_pool_task_tree }
+    , { "test_pool_move_only_tasks" , test_pool_move_only_tasks }
 
 };
 
@@ -91,6 +119,9 @@ main(const int argc, const char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         cout << argv[0] << Usage << endl;
         return 0;
+    } else if (strcmp("--bench-pool", argv[1]) == 0) {
+        unsigned ntasks = ((argc > 2) ? atoi(argv[2]) : (100 * 1000));
+        benchPool(ntasks);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
         // Execute the named test-function, if it's a supported test-function
         int tctr = 0;
@@ -497,6 +528,299 @@ test_factorial_parent_child_async(void)
     TEST_END();
 }
 
+/**
+ * *****************************************************************************
+ * The test_pool_*() cases: The async tests above, on a ThreadPool, which
+ * starts its threads once, and runs every task, and continuation, on them.
+ */
+
+/*
+ * Product lo * (lo + 1) * ... * hi, i.e. hi! / (lo - 1)!, computed on the
+ * worker threads of a ThreadPool.
+ */
+uint64_t
+factorial_range(int lo, int hi)
+{
+    uint64_t res = 1;
+    for (auto i = lo; i <= hi; ++i) {
+        res *= i;
+    }
+    return res;
+}
+
+/* factorial_async_fn() on a pool, without its artificial sleep. */
+int
+factorial_pool_fn(int n, std::thread::id caller_tid)
+{
+    assert(caller_tid != std::this_thread::get_id());
+    return (int) factorial_range(1, n);
+}
+
+void
+test_pool_factorial_async(void)
+{
+    TEST_START();
+
+    ThreadPool pool(2);
+    int n{5};
+
+    // Same as std::async(std::launch::async, ...), but on a pool thread.
+    TaskFuture<int> fu_res = pool.submit(factorial_pool_fn, n,
+                                         std::this_thread::get_id());
+    auto res = fu_res.get();
+    fmt::print("Factorial {}! = {} ", n, res);
+    assert(res == 120);
+    assert(!fu_res.valid());
+
+    // Many at once: Still just the pool's 2 threads.
+    std::vector<TaskFuture<int>> futures;
+    for (int i = 0; i < 1000; i++) {
+        futures.push_back(pool.submit(factorial_pool_fn, ((i % 10) + 1),
+                                      std::this_thread::get_id()));
+    }
+    for (int i = 0; i < 1000; i++) {
+        assert(futures[i].get() == (int) factorial_range(1, ((i % 10) + 1)));
+    }
+    assert(pool.ntasks() == 1001);
+
+    TEST_END();
+}
+
+/*
+ * test_factorial_parent_child_async() without a thread parked in the child,
+ * waiting for 'n': The child is a continuation of the promise's future, so
+ * it is queued when the parent sets 'n', and not before.
+ */
+void
+test_pool_factorial_parent_child_async(void)
+{
+    TEST_START();
+
+    ThreadPool pool(2);
+    int n{5};
+
+    TaskPromise<int> p(pool);
+    std::thread::id this_id = std::this_thread::get_id();
+    TaskFuture<uint64_t> fu_res = p.get_future().then([this_id](int n) {
+                                      assert(this_id != std::this_thread::get_id());
+                                      return factorial_range(1, n);
+                                  });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(!fu_res.ready());
+    assert(pool.ntasks() == 0);     // Nothing ran, or waited, on the pool
+
+    p.set_value(n);
+    auto res = fu_res.get();
+    fmt::print("Factorial {}! = {} ", n, res);
+    assert(res == 120);
+
+    // A promise dropped without a value breaks its continuations' futures.
+    TaskFuture<uint64_t> fu_broken;
+    {
+        TaskPromise<int> p2(pool);
+        fu_broken = p2.get_future().then([](int n) { return factorial_range(1, n); });
+    }
+    bool caught = false;
+    try {
+        fu_broken.get();
+    } catch (const std::future_error& ex) {
+        caught = (ex.code() == std::future_errc::broken_promise);
+    }
+    assert(caught);
+
+    TEST_END();
+}
+
+/*
+ * 20! as a tree with no waits in it: 4 parts run in parallel, when_all()
+ * joins them, and a then() multiplies the parts. Exceptions skip the rest
+ * of a chain, to its end.
+ */
+void
+test_pool_then_when_all(void)
+{
+    TEST_START();
+
+    ThreadPool pool(4);
+
+    std::vector<TaskFuture<uint64_t>> parts;
+    for (int lo = 1; lo <= 20; lo += 5) {
+        parts.push_back(pool.submit(factorial_range, lo, (lo + 4)));
+    }
+    TaskFuture<uint64_t> fu_res = when_all(pool, std::move(parts))
+                                        .then([](std::vector<uint64_t> values) {
+                                            uint64_t res = 1;
+                                            for (uint64_t v : values) {
+                                                res *= v;
+                                            }
+                                            return res;
+                                        });
+    auto res = fu_res.get();
+    fmt::print("Factorial 20! = {} ", res);
+    assert(res == factorial_range(1, 20));
+
+    // when_all() of none is ready at once; of void tasks, is void.
+    assert(when_all(pool, std::vector<TaskFuture<int>>()).get().empty());
+    std::atomic<int> ndone{0};
+    std::vector<TaskFuture<void>> voids;
+    for (int i = 0; i < 100; i++) {
+        voids.push_back(pool.submit([&ndone]() { ndone++; }));
+    }
+    when_all(pool, std::move(voids)).get();
+    assert(ndone.load() == 100);
+
+    // A throw in the middle of a chain: The later steps are skipped.
+    std::atomic<bool> ran_after{false};
+    TaskFuture<int> fu_chain = pool.submit([]() { return 1; })
+                                   .then([](int v) -> int {
+                                       if (v) {
+                                           throw std::runtime_error("step 2");
+                                       }
+                                       return v;
+                                   })
+                                   .then([&ran_after](int v) {
+                                       ran_after = true;
+                                       return v;
+                                   });
+    bool caught = false;
+    try {
+        fu_chain.get();
+    } catch (const std::runtime_error& ex) {
+        caught = (strcmp(ex.what(), "step 2") == 0);
+    }
+    assert(caught);
+    assert(!ran_after.load());
+
+    TEST_END();
+}
+
+/*
+ * Parent tasks that submit children and get() their results, recursively:
+ * On a pool's own threads, get() runs queued tasks while it waits, so even a
+ * 1-thread pool completes the tree. Every task runs on a pool thread.
+ */
+uint64_t
+factorial_tree(ThreadPool& pool, int lo, int hi,
+               std::mutex& mutex, std::set<std::thread::id>& tids)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        tids.insert(std::this_thread::get_id());
+    }
+    if ((hi - lo) < 2) {
+        return factorial_range(lo, hi);
+    }
+    int mid = ((lo + hi) / 2);
+    TaskFuture<uint64_t> left = pool.submit(factorial_tree, std::ref(pool), lo, mid,
+                                            std::ref(mutex), std::ref(tids));
+    TaskFuture<uint64_t> right = pool.submit(factorial_tree, std::ref(pool),
+                                             (mid + 1), hi,
+                                             std::ref(mutex), std::ref(tids));
+    return (left.get() * right.get());
+}
+
+void
+test_pool_task_tree(void)
+{
+    TEST_START();
+
+    for (unsigned nthreads : { 1, 2, 4 }) {
+        ThreadPool pool(nthreads);
+        std::mutex mutex;
+        std::set<std::thread::id> tids;
+        uint64_t res = pool.submit(factorial_tree, std::ref(pool), 1, 20,
+                                   std::ref(mutex), std::ref(tids)).get();
+        assert(res == factorial_range(1, 20));
+        assert(tids.size() <= nthreads);
+        assert(tids.count(std::this_thread::get_id()) == 0);
+    }
+    TEST_END();
+}
+
+/*
+ * Tasks and continuations that own move-only objects, as std::async's may:
+ * A TaskFuture, a TaskPromise, a unique_ptr, captured or passed as an arg.
+ */
+void
+test_pool_move_only_tasks(void)
+{
+    TEST_START();
+
+    ThreadPool pool(2);
+
+    TaskFuture<int> fu = pool.submit([]() { return 6; });
+    TaskFuture<int> fu_owner = pool.submit([fu = std::move(fu)]() mutable {
+                                               return (fu.get() * 7);
+                                           });
+    assert(fu_owner.get() == 42);
+
+    TaskPromise<int> promise(pool);
+    TaskFuture<int> fu_promised = promise.get_future();
+    pool.submit([p = std::move(promise)]() mutable { p.set_value(5); }).get();
+    assert(fu_promised.get() == 5);
+
+    auto uptr = std::make_unique<int>(10);
+    TaskFuture<int> fu_then = pool.submit([]() { return 1; })
+                                  .then([u = std::move(uptr)](int v) {
+                                      return (v + *u);
+                                  });
+    assert(fu_then.get() == 11);
+
+    int res = pool.submit([](std::unique_ptr<int> u) { return *u; },
+                          std::make_unique<int>(3)).get();
+    assert(res == 3);
+
+    TEST_END();
+}
+
+/*
+ * Run 'ntasks' tiny tasks with std::async(std::launch::async), and on a
+ * ThreadPool, and report tasks / second of each.
+ */
+void
+benchPool(unsigned ntasks)
+{
+    using bench_clock = std::chrono::steady_clock;
+    constexpr unsigned nbatch = 100;   // Tasks in flight at once
+    std::atomic<uint64_t> sum{0};
+    auto task = [&sum](int i) { sum.fetch_add(i, std::memory_order_relaxed); };
+
+    auto start = bench_clock::now();
+    for (unsigned i = 0; i < ntasks; i += nbatch) {
+        std::vector<std::future<void>> futures;
+        for (unsigned j = i; (j < ntasks) && (j < (i + nbatch)); j++) {
+            futures.push_back(std::async(std::launch::async, task, j));
+        }
+        for (std::future<void>& fu : futures) {
+            fu.get();
+        }
+    }
+    double async_secs = std::chrono::duration<double>(bench_clock::now()
+                                                        - start).count();
+
+    ThreadPool pool;
+    start = bench_clock::now();
+    for (unsigned i = 0; i < ntasks; i += nbatch) {
+        std::vector<TaskFuture<void>> futures;
+        for (unsigned j = i; (j < ntasks) && (j < (i + nbatch)); j++) {
+            futures.push_back(pool.submit(task, j));
+        }
+        for (TaskFuture<void>& fu : futures) {
+            fu.get();
+        }
+    }
+    double pool_secs = std::chrono::duration<double>(bench_clock::now()
+                                                        - start).count();
+
+    assert(sum.load() == (2 * ((uint64_t) ntasks * (ntasks - 1) / 2)));
+    fmt::print("{} tasks: std::async {:.3f} s, {:.0f} tasks/s;"
+               " ThreadPool({}) {:.3f} s, {:.0f} tasks/s ({:.1f}x)\n",
+               ntasks, async_secs, (ntasks / async_secs),
+               pool.nthreads(), pool_secs, (ntasks / pool_secs),
+               (async_secs / pool_secs));
+}
+
 void
 test_template(void)
 {
@@ -0,0 +1,320 @@
+/*
+ * -----------------------------------------------------------------------------
+ * generator.h: generator<T>, a lazy sequence of T's produced by a coroutine,
+ * for range-for and std::ranges, with pooled coroutine frames and chunked
+ * yields.
+ *
+ *  generator<int>
+ *  iota(int n) {
+ *      for (int i = 0; i < n; i++) {
+ *          co_yield i;                             // One value per resume
+ *      }
+ *  }
+ *
+ *  generator<int>
+ *  iotaChunked(int n) {
+ *      int buf[256];
+ *      for (int i = 0; i < n; ) {
+ *          int nbuf = 0;
+ *          while ((nbuf < 256) && (i < n)) {
+ *              buf[nbuf++] = i++;
+ *          }
+ *          co_yield std::span<const int>(buf, nbuf);   // A chunk per resume
+ *      }
+ *  }
+ *
+ *  for (int v : iota(10)) { ... }
+ *  for (int v : fibonacci() | std::views::take(10)) { ... }
+ *
+ * The two costs of a generator, over a plain loop, and how they are cut:
+ *
+ *  - Frame allocation: Each call of a generator function allocates its
+ *    coroutine frame. promise_type::operator new takes frames from a
+ *    per-thread FramePool of freed frames, by size class, so a program that
+ *    makes generators over and over mallocs their frames just once. (The
+ *    compiler may elide the allocation, if it sees the whole lifetime of the
+ *    generator; the pool covers the cases where it does not.)
+ *  - Resumes: A resume, per value, is an indirect call into the coroutine's
+ *    state machine, and a return from it. co_yield of a std::span hands out a
+ *    chunk of values per resume; the iterator walks the chunk with a pointer
+ *    bump and compare, as a plain loop over an array does, and resumes the
+ *    coroutine only when it runs off the end. Empty chunks are skipped.
+ *
+ * Yielded values are not copied: The promise points at the co_yield operand,
+ * which lives in the coroutine's frame till it is resumed. So a value, or a
+ * chunk's elements, is valid till the iterator is next advanced.
+ *
+ * generator<T> is a move-only, single-pass std::ranges::input_range, and a
+ * view. An exception thrown by the coroutine is rethrown from begin() or ++.
+ *
+ * Ref:
+ *  - P2502R2: std::generator: Synchronous Coroutine Generator for Ranges.
+ *  - Lewis Baker: C++ Coroutines: Understanding the promise type.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef __GENERATOR_H__
+#define __GENERATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+namespace coro_std = std;
+#else
+#include <experimental/coroutine>
+namespace coro_std = std::experimental;
+#endif
+
+// Frames are pooled in size classes of this many bytes ...
+constexpr size_t   Frame_pool_class_size = 64;
+
+// ... up to this many classes, i.e. frames up to 1 KiB; larger ones are not.
+constexpr size_t   Frame_pool_nclasses = 16;
+
+// Max # of free frames a thread keeps, per size class.
+constexpr unsigned Frame_pool_max_free = 64;
+
+/*
+ * Per-thread free lists of coroutine frames. A frame freed by another thread
+ * than the one that allocated it joins the freeing thread's pool. Frames
+ * freed during thread exit, after the thread's pool is gone, are freed to
+ * the heap.
+ */
+class FramePool
+{
+  public:
+    static void *
+    alloc(size_t size) {
+        size_t sclass = sizeClass(size);
+        if (sclass >= Frame_pool_nclasses) {
+            return ::operator new(size);
+        }
+        Pool *pool = myPool();
+        if (pool) {
+            FreeFrame *frame = pool->free[sclass];
+            if (frame) {
+                pool->free[sclass] = frame->next;
+                pool->nfree[sclass]--;
+                pool->nreuses++;
+                return frame;
+            }
+            pool->nallocs++;
+        }
+        return ::operator new(classBytes(sclass));
+    }
+
+    static void
+    release(void *ptr, size_t size) noexcept {
+        size_t sclass = sizeClass(size);
+        Pool *pool = ((sclass < Frame_pool_nclasses) ? myPool() : nullptr);
+        if (!pool || (pool->nfree[sclass] >= Frame_pool_max_free)) {
+            ::operator delete(ptr);
+            return;
+        }
+        FreeFrame *frame = static_cast<FreeFrame *>(ptr);
+        frame->next = pool->free[sclass];
+        pool->free[sclass] = frame;
+        pool->nfree[sclass]++;
+    }
+
+    // This thread's # of frames allocated from the heap, and from the pool.
+    static uint64_t nallocs(void) { return (myPool() ? myPool()->nallocs : 0); }
+    static uint64_t nreuses(void) { return (myPool() ? myPool()->nreuses : 0); }
+
+  private:
+    struct FreeFrame
+    {
+        FreeFrame *next;
+    };
+
+    struct Pool
+    {
+        explicit Pool(bool *gone) : gone{gone} { }
+
+        ~Pool() {
+            for (FreeFrame *frame : free) {
+                while (frame) {
+                    FreeFrame *next = frame->next;
+                    ::operator delete(frame);
+                    frame = next;
+                }
+            }
+            *gone = true;
+        }
+
+        FreeFrame *free[Frame_pool_nclasses] = {};
+        unsigned   nfree[Frame_pool_nclasses] = {};
+        uint64_t   nallocs = 0;
+        uint64_t   nreuses = 0;
+        bool      *gone;
+    };
+
+    static size_t sizeClass(size_t size) { return ((size - 1) / Frame_pool_class_size); }
+    static size_t classBytes(size_t sclass) { return ((sclass + 1) * Frame_pool_class_size); }
+
+    // This thread's pool, or NULL once it has been destroyed, at thread exit.
+    static Pool *
+    myPool(void) {
+        static thread_local bool gone = false;  // Trivial, so outlives 'pool'
+        if (gone) {
+            return nullptr;
+        }
+        static thread_local Pool pool(&gone);
+        return &pool;
+    }
+};
+
+template <typename T>
+class generator : public std::ranges::view_interface<generator<T>>
+{
+  public:
+    struct promise_type
+    {
+        const T             *first = nullptr;   // Current chunk of values
+        const T             *last = nullptr;
+        std::exception_ptr   exception;
+
+        generator
+        get_return_object() {
+            return generator{coro_std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        coro_std::suspend_always initial_suspend() noexcept { return {}; }
+        coro_std::suspend_always final_suspend() noexcept { return {}; }
+
+        coro_std::suspend_always
+        yield_value(const T& value) noexcept {
+            first = std::addressof(value);
+            last = (first + 1);
+            return {};
+        }
+
+        coro_std::suspend_always
+        yield_value(std::span<const T> values) noexcept {
+            first = values.data();
+            last = (first + values.size());
+            return {};
+        }
+
+        void return_void() noexcept { }
+
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        // A generator only yields; it may not co_await.
+        template <typename U> void await_transform(U&&) = delete;
+
+        static void *operator new(size_t size) { return FramePool::alloc(size); }
+
+        static void
+        operator delete(void *ptr, size_t size) noexcept {
+            FramePool::release(ptr, size);
+        }
+    };
+
+    using handle_type = coro_std::coroutine_handle<promise_type>;
+
+    class iterator
+    {
+      public:
+        using value_type = std::remove_cvref_t<T>;
+        using difference_type = std::ptrdiff_t;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const noexcept { return *cur; }
+        const T *operator->() const noexcept { return cur; }
+
+        // Hot path: Next value of the chunk; resume for the next chunk.
+        iterator&
+        operator++() {
+            if (++cur == last) {
+                nextChunk();
+            }
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool
+        operator==(const iterator& it, std::default_sentinel_t) noexcept {
+            return (it.cur == nullptr);
+        }
+
+      private:
+        friend class generator;
+
+        explicit iterator(handle_type h) : coro{h} { nextChunk(); }
+
+        // Resume till the coroutine yields a non-empty chunk, or is done.
+        void
+        nextChunk(void) {
+            promise_type& promise = coro.promise();
+            do {
+                coro.resume();
+                if (coro.done()) {
+                    cur = last = nullptr;
+                    if (promise.exception) {
+                        std::rethrow_exception(std::exchange(promise.exception, nullptr));
+                    }
+                    return;
+                }
+            } while (promise.first == promise.last);
+            cur = promise.first;
+            last = promise.last;
+        }
+
+        handle_type  coro;
+        const T     *cur = nullptr;
+        const T     *last = nullptr;
+    };
+
+    generator() = default;
+
+    generator(generator&& other) noexcept
+        : coro{std::exchange(other.coro, nullptr)} { }
+
+    generator&
+    operator=(generator&& other) noexcept {
+        if (this != &other) {
+            if (coro) {
+                coro.destroy();
+            }
+            coro = std::exchange(other.coro, nullptr);
+        }
+        return *this;
+    }
+
+    ~generator() {
+        if (coro) {
+            coro.destroy();
+        }
+    }
+
+    // Single-pass: Call begin() once. A default-constructed, moved-from or
+    // finished generator has no more values: begin() == end().
+    iterator
+    begin() {
+        if (!coro || coro.done()) {
+            return iterator{};
+        }
+        return iterator{coro};
+    }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+  private:
+    explicit generator(handle_type h) : coro{h} { }
+
+    handle_type coro = nullptr;
+};
+
+#endif // __GENERATOR_H__
@@ -0,0 +1,167 @@
+/*
+ * -----------------------------------------------------------------------------
+ * intrusive-ptr.h: Intrusive reference counting: IntrusivePtr<T> to objects
+ * that carry their own count, by deriving from RefCounted<T, Counter>.
+ *
+ *  class Node : public RefCounted<Node, LocalRefCount> {  // Or AtomicRefCount
+ *    public:
+ *      IntrusivePtr<Node>  next;
+ *      int                 data;
+ *  };
+ *
+ *  IntrusivePtr<Node> head = makeIntrusive<Node>();
+ *  IntrusivePtr<Node> other = head;        // ++count, in the Node itself
+ *
+ * Compared to std::shared_ptr:
+ *
+ *  - No control block: The count lives in the object, so making one is the
+ *    one allocation of the object itself; shared_ptr(new T) makes two, and
+ *    even make_shared<T>() adds a weak count and a deleter to the object.
+ *  - IntrusivePtr is one pointer, not two.
+ *  - The Counter policy picks, at compile-time, how the count is updated:
+ *    AtomicRefCount with atomic read-modify-writes, for objects shared
+ *    across threads, as shared_ptr always does; LocalRefCount with plain
+ *    increments, for objects that never leave the thread that made them.
+ *    Sharing a LocalRefCount object across threads is a data race.
+ *  - No weak pointers, and an object may not be counted in two ways.
+ *
+ * A raw T * can be turned back into an owning IntrusivePtr, as the count is
+ * in the object; e.g. 'this', in a member function.
+ *
+ * Ref: boost::intrusive_ptr, boost::intrusive_ref_counter.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef __INTRUSIVE_PTR_H__
+#define __INTRUSIVE_PTR_H__
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+/*
+ * Counter policies: The count's type, and how to bump it. dec() returns the
+ * count after the decrement, so 0 means the last reference is gone.
+ */
+struct AtomicRefCount
+{
+    using count_type = std::atomic<uint32_t>;
+
+    static void inc(count_type& count) { count.fetch_add(1, std::memory_order_relaxed); }
+
+    // Release, so our writes to the object happen-before its delete, and
+    // acquire, so the deleting thread sees all other threads' writes. (An
+    // acq_rel RMW, not a release RMW + acquire fence, which tsan can't model;
+    // on x86 both are the same locked instruction.)
+    static uint32_t
+    dec(count_type& count) {
+        return (count.fetch_sub(1, std::memory_order_acq_rel) - 1);
+    }
+
+    static uint32_t load(const count_type& count) { return count.load(std::memory_order_relaxed); }
+};
+
+struct LocalRefCount
+{
+    using count_type = uint32_t;
+
+    static void inc(count_type& count) { count++; }
+    static uint32_t dec(count_type& count) { return --count; }
+    static uint32_t load(const count_type& count) { return count; }
+};
+
+/*
+ * Base of intrusively counted objects of type Derived: 'delete's the object,
+ * as a Derived, when its last IntrusivePtr goes away. A copy of an object is
+ * a new object, with no references to it yet.
+ */
+template <typename Derived, typename Counter = AtomicRefCount>
+class RefCounted
+{
+  public:
+    void addRef(void) const { Counter::inc(refcount); }
+
+    void
+    releaseRef(void) const {
+        if (Counter::dec(refcount) == 0) {
+            delete static_cast<const Derived *>(this);
+        }
+    }
+
+    uint32_t useCount(void) const { return Counter::load(refcount); }
+
+  protected:
+    RefCounted() = default;
+    RefCounted(const RefCounted&) { }
+    RefCounted& operator=(const RefCounted&) { return *this; }
+    ~RefCounted() = default;
+
+  private:
+    mutable typename Counter::count_type refcount{0};
+};
+
+template <typename T>
+class IntrusivePtr
+{
+  public:
+    IntrusivePtr() noexcept = default;
+    IntrusivePtr(std::nullptr_t) noexcept { }
+
+    // Take a reference to 'ptr', which may already have others.
+    explicit IntrusivePtr(T *ptr) noexcept : ptr_{ptr} {
+        if (ptr_) {
+            ptr_->addRef();
+        }
+    }
+
+    IntrusivePtr(const IntrusivePtr& src) noexcept : IntrusivePtr(src.ptr_) { }
+
+    IntrusivePtr(IntrusivePtr&& src) noexcept : ptr_{std::exchange(src.ptr_, nullptr)} { }
+
+    // From a pointer to a derived class.
+    template <typename U>
+    IntrusivePtr(const IntrusivePtr<U>& src) noexcept : IntrusivePtr(src.get()) { }
+
+    ~IntrusivePtr() {
+        if (ptr_) {
+            ptr_->releaseRef();
+        }
+    }
+
+    // Copy-and-swap: Right for self-assignment, and for 'src' owned by *this.
+    IntrusivePtr&
+    operator=(IntrusivePtr src) noexcept {
+        std::swap(ptr_, src.ptr_);
+        return *this;
+    }
+
+    void reset(void) noexcept { IntrusivePtr().swap(*this); }
+
+    void swap(IntrusivePtr& other) noexcept { std::swap(ptr_, other.ptr_); }
+
+    T *get(void) const noexcept { return ptr_; }
+    T& operator*() const noexcept { return *ptr_; }
+    T *operator->() const noexcept { return ptr_; }
+
+    explicit operator bool() const noexcept { return (ptr_ != nullptr); }
+
+    // # of references to the object, or 0 if none.
+    uint32_t useCount(void) const { return (ptr_ ? ptr_->useCount() : 0); }
+
+    friend bool
+    operator==(const IntrusivePtr& lhs, const IntrusivePtr& rhs) noexcept {
+        return (lhs.ptr_ == rhs.ptr_);
+    }
+
+  private:
+    T *ptr_ = nullptr;
+};
+
+/* make_shared() for IntrusivePtr: new T(args...), with one reference. */
+template <typename T, typename... Args>
+IntrusivePtr<T>
+makeIntrusive(Args&&... args)
+{
+    return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+#endif // __INTRUSIVE_PTR_H__
@@ -9,9 +9,10 @@
  *
  *  [2] MS https://learn.microsoft.com/en-us/cpp/cpp/examples-of-lambda-expressions?view=msvc-170
  *
- * Usage: g++ -o lamda-expressions-tutorial lamda-expressions-tutorial.cpp
+ * Usage: g++ -std=c++17 -O2 -o lamda-expressions-tutorial lamda-expressions-tutorial.cpp
  *
- * Test case test_lambda_constexpr() needs C++17:
+ * fast-sort.h, for doSortFloats(), and test case test_lambda_constexpr()
+ * need C++17:
  *  # warning: 'constexpr' on lambda expressions is a C++17 extension
  *  # error: constexpr variable cannot have non-literal type 'const (lambda ...)'
  *
@@ -29,6 +30,12 @@
 #include <iostream>
 #include <list>
 #include <vector>
+#include <cassert>
+#include <cmath>                    // std::signbit()
+#include <cstring>
+
+#include "fast-sort.h"              // fastSort()
+#include "../Tools/rand_gen.h"      // Rand_int
 
 using namespace std;
 
@@ -55,6 +62,9 @@ void test_nested_lambda_exprs(void);
 void test_lambda_expr_in_function(void);
 void test_mutable_var_captured_by_value(void);
 void test_lambda_constexpr(void);
+void test_fastSort_floats(void);
+void test_sortNetwork(void);
+void test_parallelSort(void);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -86,6 +96,9 @@ TEST_FNS Test_fns[] = {
                 , { "test_mutable_var_captured_by_value"
                                             , test_mutable_var_captured_by_value }
                 , { "test_lambda_constexpr" , test_lambda_constexpr }
+                , { "test_fastSort_floats"  , test_fastSort_floats }
+                , { "test_sortNetwork"      , test_sortNetwork }
+                , { "test_parallelSort"     , test_parallelSort }
     };
 
 // Test start / end info-msg macros
@@ -168,11 +181,13 @@ main(const int argc, const char *argv[])
 
 /*
  * Receive a reference to a vector of floats. Sort in-place in ascending order.
+ * fastSort() radix sorts the floats, on all CPUs for large vectors; see
+ * fast-sort.h.
  */
 void
 doSortFloats(vector<float>& floats)
 {
-    std::sort(floats.begin(), floats.end());
+    fastSort(floats);
 }
 
 /*
@@ -858,3 +873,147 @@ test_lambda_constexpr(void)
 
     TEST_END();
 }
+
+/*
+ * -----------------------------------------------------------------------------
+ * fastSort() of floats, by all its paths, v/s std::sort(): Random floats,
+ * +/-0, infinities; sizes for the sorting network, std::sort and radix sort.
+ */
+void
+test_fastSort_floats(void)
+{
+    TEST_START();
+
+    const float inf = std::numeric_limits<float>::infinity();
+    Rand_int rnd{-1000000, 1000000};
+
+    for (size_t nitems : { 0, 1, 5, 16, 17, 100, 255, 256, 1000, 100000 }) {
+        vector<float> floats(nitems);
+        for (float& f : floats) {
+            f = (rnd() / 1000.0f);
+        }
+        // Some specials, and many duplicates.
+        for (size_t i = 0; i < (nitems / 4); i++) {
+            floats[(size_t) (rnd() + 1000000) % nitems]
+                = ((i % 2) ? (i % 5 ? 0.0f : inf) : (i % 3 ? -0.0f : -inf));
+        }
+        vector<float> expected = floats;
+        std::sort(expected.begin(), expected.end());
+
+        doSortFloats(floats);
+        assert(floats == expected);
+
+        // -0.0 == 0.0; fastSort() puts all -0.0 before +0.0, as to its bits.
+        for (size_t i = 1; i < nitems; i++) {
+            assert(!(std::signbit(floats[i - 1]) == false && floats[i - 1] == 0.0f
+                     && std::signbit(floats[i]) && floats[i] == 0.0f));
+        }
+    }
+
+    // NaNs, which std::sort cannot order, go to the ends by their sign: By
+    // the sorting network, std::sort of radix keys, and radix sort.
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (size_t nitems : { 8, 40, 1000 }) {
+        vector<float> floats(nitems);
+        for (float& f : floats) {
+            f = (rnd() / 1000.0f);
+        }
+        floats[nitems - 1] = -nan;
+        floats[1] = nan;
+        floats[nitems / 2] = inf;
+        floats[(nitems / 2) + 1] = -inf;
+        vector<float> expected(floats.begin(), floats.end());
+        expected.erase(std::remove_if(expected.begin(), expected.end(),
+                                      [](float f) { return std::isnan(f); }),
+                       expected.end());
+        std::sort(expected.begin(), expected.end());
+
+        doSortFloats(floats);
+        assert(std::isnan(floats.front()) && std::signbit(floats.front()));
+        assert(std::isnan(floats.back()) && !std::signbit(floats.back()));
+        assert(std::equal(expected.begin(), expected.end(), (floats.begin() + 1)));
+    }
+    cout << "sorted 0 .. 100000 floats, and NaNs";
+
+    TEST_END();
+}
+
+/*
+ * Sorting network, for every # of keys it takes, of ints and doubles,
+ * against std::sort.
+ */
+void
+test_sortNetwork(void)
+{
+    TEST_START();
+
+    Rand_int rnd{-50, 50};
+    for (size_t nitems = 0; nitems <= Sort_network_max; nitems++) {
+        for (int rep = 0; rep < 100; rep++) {
+            vector<int> ints(nitems);
+            rnd.fill(ints.data(), ints.size());
+            vector<double> doubles(ints.begin(), ints.end());
+
+            vector<int> ints_exp = ints;
+            std::sort(ints_exp.begin(), ints_exp.end());
+            sortNetwork(ints.data(), ints.size());
+            assert(ints == ints_exp);
+
+            vector<double> doubles_exp = doubles;
+            std::sort(doubles_exp.begin(), doubles_exp.end());
+            sortNetwork(doubles.data(), doubles.size());
+            assert(doubles == doubles_exp);
+        }
+    }
+    cout << "0 .. " << Sort_network_max << " keys";
+
+    TEST_END();
+}
+
+/*
+ * Sample sort, on 1 .. 7 threads: ints, a few distinct ints (large buckets),
+ * and strings by a descending comparator. parallelSort() gives each thread
+ * at least Sort_parallel_min keys, so 7 threads need 7 times that many.
+ */
+void
+test_parallelSort(void)
+{
+    TEST_START();
+
+    const size_t nitems = (7 * Sort_parallel_min);
+    Rand_int rnd{std::numeric_limits<int>::min(), std::numeric_limits<int>::max()};
+    Rand_int few{0, 3};
+
+    vector<int> ints(nitems);
+    rnd.fill(ints.data(), ints.size());
+    vector<int> dups(nitems);
+    few.fill(dups.data(), dups.size());
+
+    vector<int> ints_exp = ints;
+    std::sort(ints_exp.begin(), ints_exp.end());
+    vector<int> dups_exp = dups;
+    std::sort(dups_exp.begin(), dups_exp.end());
+
+    for (unsigned nthreads = 1; nthreads <= 7; nthreads++) {
+        vector<int> sorted = ints;
+        fastSort(sorted, std::less<int>(), nthreads);
+        assert(sorted == ints_exp);
+
+        sorted = dups;
+        fastSort(sorted, std::less<>(), nthreads);
+        assert(sorted == dups_exp);
+    }
+
+    vector<string> strings(Sort_parallel_min * 2);
+    for (string& str : strings) {
+        str = to_string(rnd());
+    }
+    vector<string> strings_exp = strings;
+    std::sort(strings_exp.begin(), strings_exp.end(), std::greater<string>());
+    fastSort(strings, std::greater<string>(), 2);
+    assert(strings == strings_exp);
+
+    cout << nitems << " ints by 1 .. 7 threads";
+
+    TEST_END();
+}
@@ -0,0 +1,449 @@
+/*
+ * -----------------------------------------------------------------------------
+ * lock-bench.h: Contention benchmark of locks and atomics on a shared counter.
+ *
+ * Every thread increments a counter 'nops' times, through one of:
+ *
+ *  - LockedCounter<PthreadMutex> : pthread_mutex_t around a plain counter
+ *  - LockedCounter<TTASLock>     : Test-and-test-and-set spinlock
+ *  - LockedCounter<TicketLock>   : FIFO ticket lock
+ *  - LockedCounter<MCSLock>      : MCS queue lock; each waiter spins on its
+ *                                  own queue node, not on the shared lock
+ *  - AtomicCounter               : std::atomic fetch_add(), no lock
+ *  - PaddedShardCounter          : A counter per thread, each on its own cache
+ *                                  line, summed on read
+ *  - StatCounterAdapter          : StatCounter of stat-counter.h; same, but
+ *                                  each thread finds its slot thread-locally
+ *
+ * lockBenchRun() reports throughput, and latency percentiles of a sample of
+ * increments, timed with steady_clock, from which tail latency under
+ * contention shows. It checks that no increments were lost.
+ *
+ * All spin-waits spin briefly with a pause instruction and then yield the CPU,
+ * so results stay meaningful when threads outnumber CPUs; pure spinning would
+ * then mostly measure scheduler time-slices.
+ *
+ * Ref:
+ *  - Mellor-Crummey, Scott: Algorithms for Scalable Synchronization on
+ *    Shared-Memory Multiprocessors, 1991.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef __LOCK_BENCH_H__
+#define __LOCK_BENCH_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include <fmt/core.h>
+
+#include "stat-counter.h"
+
+constexpr size_t   Cache_line_size = 64;
+
+// Time every Lock_bench_sample_every'th increment; timing each one would
+// measure the clock more than the lock.
+constexpr uint64_t Lock_bench_sample_every = 16;
+
+// Spin this many times before yielding the CPU.
+constexpr int      Lock_spin_tries = 128;
+
+static inline void
+cpuRelax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Spin-wait helper: Call once per failed check.
+class SpinWait
+{
+  public:
+    void
+    wait(void) {
+        if (++nspins < Lock_spin_tries) {
+            cpuRelax();
+        } else {
+            nspins = 0;
+            std::this_thread::yield();
+        }
+    }
+
+  private:
+    int nspins = 0;
+};
+
+// **** Locks: All provide lock() and unlock() ****
+
+class PthreadMutex
+{
+  public:
+    PthreadMutex()  { pthread_mutex_init(&mutex, NULL); }
+    ~PthreadMutex() { pthread_mutex_destroy(&mutex); }
+
+    void lock(void)   { pthread_mutex_lock(&mutex); }
+    void unlock(void) { pthread_mutex_unlock(&mutex); }
+
+  private:
+    pthread_mutex_t mutex;
+};
+
+/*
+ * Test-and-test-and-set: Waiters spin reading the flag, which stays in their
+ * caches, and only try the exchange, which takes the cache line exclusive,
+ * once it reads as free.
+ */
+class TTASLock
+{
+  public:
+    void
+    lock(void) {
+        SpinWait spin;
+        for (;;) {
+            if (!locked.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            while (locked.load(std::memory_order_relaxed)) {
+                spin.wait();
+            }
+        }
+    }
+
+    void unlock(void) { locked.store(false, std::memory_order_release); }
+
+  private:
+    std::atomic<bool> locked{false};
+};
+
+/*
+ * Ticket lock: Take a ticket, wait till it's served. Grants the lock in FIFO
+ * order, but all waiters spin on now_serving.
+ */
+class TicketLock
+{
+  public:
+    void
+    lock(void) {
+        uint32_t ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+        SpinWait spin;
+        while (now_serving.load(std::memory_order_acquire) != ticket) {
+            spin.wait();
+        }
+    }
+
+    void
+    unlock(void) {
+        now_serving.store((now_serving.load(std::memory_order_relaxed) + 1),
+                          std::memory_order_release);
+    }
+
+  private:
+    alignas(Cache_line_size) std::atomic<uint32_t> next_ticket{0};
+    alignas(Cache_line_size) std::atomic<uint32_t> now_serving{0};
+};
+
+/*
+ * MCS lock: Waiters queue up as a linked list of nodes, swapping themselves
+ * in at the tail; each spins on the flag in its own node, which its
+ * predecessor clears on unlock(), so a release touches just one waiter's
+ * cache line.
+ *
+ * The queue node is thread-local, so a thread can hold only one MCSLock at
+ * a time.
+ */
+class MCSLock
+{
+  public:
+    void
+    lock(void) {
+        QNode *node = &myNode();
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->waiting.store(true, std::memory_order_relaxed);
+
+        QNode *prev = tail.exchange(node, std::memory_order_acq_rel);
+        if (prev) {
+            prev->next.store(node, std::memory_order_release);
+            SpinWait spin;
+            while (node->waiting.load(std::memory_order_acquire)) {
+                spin.wait();
+            }
+        }
+    }
+
+    void
+    unlock(void) {
+        QNode *node = &myNode();
+        QNode *next = node->next.load(std::memory_order_acquire);
+        if (!next) {
+            // No known successor: Try to empty the queue.
+            QNode *expected = node;
+            if (tail.compare_exchange_strong(expected, nullptr,
+                                             std::memory_order_acq_rel)) {
+                return;
+            }
+            // A successor swapped in at the tail; wait for it to link in.
+            SpinWait spin;
+            while (!(next = node->next.load(std::memory_order_acquire))) {
+                spin.wait();
+            }
+        }
+        next->waiting.store(false, std::memory_order_release);
+    }
+
+  private:
+    struct alignas(Cache_line_size) QNode
+    {
+        std::atomic<QNode *> next{nullptr};
+        std::atomic<bool>    waiting{false};
+    };
+
+    static QNode&
+    myNode(void) {
+        static thread_local QNode node;
+        return node;
+    }
+
+    alignas(Cache_line_size) std::atomic<QNode *> tail{nullptr};
+};
+
+// **** Counters: All provide increment(tid) and total() ****
+
+template <typename Lock>
+class LockedCounter
+{
+  public:
+    explicit LockedCounter(unsigned nthreads) { (void) nthreads; }
+
+    void
+    increment(unsigned tid) {
+        (void) tid;
+        lock.lock();
+        value++;
+        lock.unlock();
+    }
+
+    uint64_t total(void) const { return value; }
+
+  private:
+    Lock     lock;
+    uint64_t value = 0;
+};
+
+class AtomicCounter
+{
+  public:
+    explicit AtomicCounter(unsigned nthreads) { (void) nthreads; }
+
+    void
+    increment(unsigned tid) {
+        (void) tid;
+        value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t total(void) const { return value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> value{0};
+};
+
+/*
+ * One counter per thread, each on its own cache line, so increments never
+ * contend; readers sum all of them. Only thread 'tid' writes shard 'tid', so
+ * a relaxed load + store suffices, without a locked read-modify-write.
+ */
+class PaddedShardCounter
+{
+  public:
+    explicit PaddedShardCounter(unsigned nthreads) : shards(nthreads) { }
+
+    void
+    increment(unsigned tid) {
+        std::atomic<uint64_t>& value = shards[tid].value;
+        value.store((value.load(std::memory_order_relaxed) + 1),
+                    std::memory_order_relaxed);
+    }
+
+    uint64_t
+    total(void) const {
+        uint64_t sum = 0;
+        for (const Shard& shard : shards) {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+  private:
+    struct alignas(Cache_line_size) Shard
+    {
+        std::atomic<uint64_t> value{0};
+    };
+    std::vector<Shard> shards;
+};
+
+// StatCounter does not need thread ids; it adds the thread_local slot lookup.
+class StatCounterAdapter
+{
+  public:
+    explicit StatCounterAdapter(unsigned nthreads) { (void) nthreads; }
+
+    void increment(unsigned tid) { (void) tid; counter.inc(); }
+
+    uint64_t total(void) const { return counter.read(); }
+
+  private:
+    StatCounter counter;
+};
+
+// **** Benchmark harness ****
+
+struct LockBenchResult
+{
+    const char *    name;
+    unsigned        nthreads;
+    uint64_t        nops;           // Total increments, all threads
+    double          secs;
+    double          mops;           // Million increments / sec
+    double          p50_ns;         // Latency percentiles of sampled ops
+    double          p99_ns;
+    double          p999_ns;
+    double          max_ns;
+    bool            correct;        // Counter total == nops
+};
+
+/*
+ * Run 'nthreads' threads, each doing 'nops_per_thread' increments of a shared
+ * Counter. Threads spin at a start line till all are running, so thread
+ * start-up is not timed.
+ */
+template <typename Counter>
+LockBenchResult
+lockBenchRun(const char *name, unsigned nthreads, uint64_t nops_per_thread)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Counter counter(nthreads);
+    std::vector<std::vector<uint32_t>> samples(nthreads);
+    std::atomic<unsigned> nready{0};
+    std::atomic<bool>     go{false};
+
+    auto worker = [&](unsigned tid) {
+        std::vector<uint32_t>& my_samples = samples[tid];
+        my_samples.reserve((nops_per_thread / Lock_bench_sample_every) + 1);
+
+        nready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire)) {
+            cpuRelax();
+        }
+        for (uint64_t i = 0; i < nops_per_thread; i++) {
+            if ((i % Lock_bench_sample_every) != 0) {
+                counter.increment(tid);
+                continue;
+            }
+            auto start = Clock::now();
+            counter.increment(tid);
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - start).count();
+            my_samples.push_back((uint32_t) std::min<int64_t>(ns, UINT32_MAX));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned tid = 0; tid < nthreads; tid++) {
+        threads.emplace_back(worker, tid);
+    }
+    while (nready.load() < nthreads) {
+        std::this_thread::yield();
+    }
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    for (auto& thread_samples : samples) {
+        all.insert(all.end(), thread_samples.begin(), thread_samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto pct = [&all](double p) {
+        return (all.empty() ? 0.0
+                            : (double) all[std::min(all.size() - 1,
+                                                    (size_t) (p * all.size()))]);
+    };
+
+    LockBenchResult result;
+    result.name = name;
+    result.nthreads = nthreads;
+    result.nops = (nops_per_thread * nthreads);
+    result.secs = secs;
+    result.mops = ((secs > 0) ? (result.nops / secs / 1e6) : 0);
+    result.p50_ns = pct(0.50);
+    result.p99_ns = pct(0.99);
+    result.p999_ns = pct(0.999);
+    result.max_ns = (all.empty() ? 0.0 : (double) all.back());
+    result.correct = (counter.total() == result.nops);
+    return result;
+}
+
+static inline void
+lockBenchPrintHeader(void)
+{
+    fmt::print("{:<14} {:>7} {:>10} {:>10} {:>10} {:>10} {:>12}\n",
+               "Primitive", "Threads", "Mops/s", "p50 ns", "p99 ns", "p99.9 ns",
+               "max ns");
+}
+
+static inline void
+lockBenchPrint(const LockBenchResult& result)
+{
+    fmt::print("{:<14} {:>7} {:>10.2f} {:>10.0f} {:>10.0f} {:>10.0f} {:>12.0f}{}\n",
+               result.name, result.nthreads, result.mops, result.p50_ns,
+               result.p99_ns, result.p999_ns, result.max_ns,
+               (result.correct ? "" : "  ** LOST UPDATES **"));
+}
+
+/*
+ * Run all primitives for 1, 2, 4, ... threads, ending with 'max_threads'.
+ * Returns the results, in the order printed.
+ */
+static inline std::vector<LockBenchResult>
+lockBenchSuite(unsigned max_threads, uint64_t nops_per_thread, bool print = true)
+{
+    std::vector<LockBenchResult> results;
+    if (print) {
+        lockBenchPrintHeader();
+    }
+    for (unsigned nthreads = 1; ;
+         nthreads = std::min((2 * nthreads), max_threads)) {
+        LockBenchResult row[] = {
+            lockBenchRun<LockedCounter<PthreadMutex>>("pthread-mutex", nthreads, nops_per_thread),
+            lockBenchRun<LockedCounter<TTASLock>>("ttas-spinlock", nthreads, nops_per_thread),
+            lockBenchRun<LockedCounter<TicketLock>>("ticket-lock", nthreads, nops_per_thread),
+            lockBenchRun<LockedCounter<MCSLock>>("mcs-lock", nthreads, nops_per_thread),
+            lockBenchRun<AtomicCounter>("atomic-add", nthreads, nops_per_thread),
+            lockBenchRun<PaddedShardCounter>("sharded", nthreads, nops_per_thread),
+            lockBenchRun<StatCounterAdapter>("stat-counter", nthreads, nops_per_thread),
+        };
+        for (const LockBenchResult& result : row) {
+            if (print) {
+                lockBenchPrint(result);
+            }
+            results.push_back(result);
+        }
+        if (nthreads >= max_threads) {
+            break;
+        }
+    }
+    return results;
+}
+
+#endif  // __LOCK_BENCH_H__
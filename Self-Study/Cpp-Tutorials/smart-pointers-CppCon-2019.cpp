@@ -31,6 +31,16 @@
  *
  * On Mac, to detect memory-leaks, do: $ leaks -atExit -- ./smart-pointers-CppCon-2019
  *
+ * The test_intrusive_ptr_* cases exercise IntrusivePtr, of intrusive-ptr.h,
+ * on RcCNode: CNode with its reference count inside it, atomic or not,
+ * instead of in a shared_ptr's separate control block.
+ *
+ *  g++ -std=c++20 -O2 -o smart-pointers-CppCon-2019 smart-pointers-CppCon-2019.cpp -pthread
+ *  ./smart-pointers-CppCon-2019 --bench-refcount [ <nnodes> ]
+ *
+ * --bench-refcount builds, walks and tears down long chains of nodes linked
+ * by shared_ptr, and by IntrusivePtr, with atomic and non-atomic counts.
+ *
  * History:
  * RESOLVE: Under construction ... still incomplete.
  * -----------------------------------------------------------------------------
@@ -39,6 +49,9 @@
 #include <cstdio>
 #include <iostream>
 #include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #if __linux__
 #include <cassert>
@@ -46,9 +59,11 @@
 #include <cstring>  // For strncmp()
 #endif // __linux__
 
+#include "intrusive-ptr.h"
+
 using namespace std;
 
-string Usage = " [ --help | test_<fn-name> ]\n";
+string Usage = " [ --help | test_<fn-name> | --bench-refcount [ <nnodes> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -88,6 +103,34 @@ class CNode {
   private:
 };
 
+// ----------------------------------------------------------------------------
+// CNode, with its reference count inside it, so IntrusivePtrs to it need no
+// shared_ptr control block. 'Counter' is AtomicRefCount or LocalRefCount.
+// ----------------------------------------------------------------------------
+template <typename Counter>
+class RcCNode : public RefCounted<RcCNode<Counter>, Counter> {
+  public:
+    IntrusivePtr<RcCNode>   next;
+    int                     data;
+
+    static inline int       nlive = 0;  // # of RcCNodes in existence
+
+    RcCNode(int value = -1) : data(value) { nlive++; }
+    ~RcCNode() { nlive--; }
+};
+
+using LocalRcCNode = RcCNode<LocalRefCount>;
+using AtomicRcCNode = RcCNode<AtomicRefCount>;
+
+// CNode, linked by shared_ptrs, for comparison.
+class SpCNode {
+  public:
+    std::shared_ptr<SpCNode>    next;
+    int                         data;
+
+    SpCNode(int value = -1) : data(value) { }
+};
+
 
 // -----------------------------------------------------------------------------
 // Test Function Prototypes
@@ -106,6 +149,11 @@ void test_make_unique_ptr_then_move(void);
 void test_shared_ptr_basic(void);
 void test_shared_ptr_nested(void);
 void test_shared_ptr_nested_raise_exception(void);
+void test_intrusive_ptr_basic(void);
+void test_intrusive_ptr_long_chain(void);
+void test_intrusive_ptr_atomic_threads(void);
+
+void benchRefCount(int nnodes);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -128,6 +176,9 @@ TEST_FNS Test_fns[] = {
     , { "test_shared_ptr_nested"            , test_shared_ptr_nested }
     , { "test_shared_ptr_nested_raise_exception"
                                             , test_shared_ptr_nested_raise_exception }
+    , { "test_intrusive_ptr_basic"          , test_intrusive_ptr_basic }
+    , { "test_intrusive_ptr_long_chain"     , test_intrusive_ptr_long_chain }
+    , { "test_intrusive_ptr_atomic_threads" , test_intrusive_ptr_atomic_threads }
 };
 
 // Test start / end info-msg macros
@@ -157,6 +208,9 @@ main(const int argc, const char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         cout << argv[0] << Usage << endl;
         return 0;
+    } else if (strcmp("--bench-refcount", argv[1]) == 0) {
+        int nnodes = ((argc > 2) ? atoi(argv[2]) : (1000 * 1000));
+        benchRefCount(nnodes);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
         // Execute the named test-function, if it's a supported test-function
         int tctr = 0;
@@ -538,3 +592,225 @@ test_shared_ptr_nested_raise_exception(void)
     assert(pSharedPtr1_to_CNode->data == oldval);
     TEST_END();
 }
+
+/*
+ * -----------------------------------------------------------------------------
+ * Helpers for chains of nodes, linked through 'next' by NodePtr: shared_ptr
+ * or IntrusivePtr.
+ * -----------------------------------------------------------------------------
+ */
+// Chain of 'nnodes' nodes, made by make(data), for data = nnodes-1, ..., 0.
+template <typename NodePtr, typename MakeFn>
+NodePtr
+buildChain(int nnodes, MakeFn make)
+{
+    NodePtr head;
+    for (int i = (nnodes - 1); i >= 0; i--) {
+        NodePtr node = make(i);
+        node->next = std::move(head);
+        head = std::move(node);
+    }
+    return head;
+}
+
+// Sum of the chain's data, walked with a counted pointer, as code holding
+// on to the node it is at does: Each step is an increment and a decrement.
+template <typename NodePtr>
+long
+walkChain(const NodePtr& head)
+{
+    long sum = 0;
+    for (NodePtr cur = head; cur; cur = cur->next) {
+        sum += cur->data;
+    }
+    return sum;
+}
+
+// Free the chain a node at a time. Just dropping 'head' would free it
+// recursively, each node's dtor freeing its 'next', and overflow the stack
+// for long chains.
+template <typename NodePtr>
+void
+freeChain(NodePtr& head)
+{
+    while (head) {
+        NodePtr next = std::move(head->next);
+        head = std::move(next);
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * IntrusivePtr semantics are shared_ptr's: Copies count up, moves don't, and
+ * the last reference deletes. The pointer is one word; a raw pointer to a
+ * counted object can be made into an owning IntrusivePtr again.
+ * -----------------------------------------------------------------------------
+ */
+void
+test_intrusive_ptr_basic(void)
+{
+    TEST_START();
+
+    static_assert(sizeof(IntrusivePtr<LocalRcCNode>) == sizeof(LocalRcCNode *));
+    static_assert(sizeof(std::shared_ptr<SpCNode>) == (2 * sizeof(SpCNode *)));
+    {
+        IntrusivePtr<LocalRcCNode> p1 = makeIntrusive<LocalRcCNode>(42);
+        assert(p1.useCount() == 1);
+        assert(LocalRcCNode::nlive == 1);
+
+        IntrusivePtr<LocalRcCNode> p2 = p1;
+        assert((p1 == p2) && (p1.useCount() == 2));
+        p2->data = 41;
+        assert(p1->data == 41);
+
+        IntrusivePtr<LocalRcCNode> p3 = std::move(p2);
+        assert(!p2 && (p3.useCount() == 2));
+
+        // From the raw pointer: A third owner, not a second count.
+        LocalRcCNode *rawp = p1.get();
+        IntrusivePtr<LocalRcCNode> p4(rawp);
+        assert(p4.useCount() == 3);
+
+        p1 = p1;                        // Self-assignment
+        assert(p1.useCount() == 3);
+
+        p3.reset();
+        p4 = nullptr;
+        assert(p1.useCount() == 1);
+        assert(LocalRcCNode::nlive == 1);
+
+        printf("sizeof(IntrusivePtr)=%d, sizeof(shared_ptr)=%d ",
+               (int) sizeof(p1), (int) sizeof(std::shared_ptr<SpCNode>));
+    }
+    assert(LocalRcCNode::nlive == 0);
+
+    TEST_END();
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * Long chains, of both counting policies: Build, walk and free them a node at
+ * a time; all nodes are freed, and walking leaves counts as they were.
+ * -----------------------------------------------------------------------------
+ */
+void
+test_intrusive_ptr_long_chain(void)
+{
+    TEST_START();
+
+    constexpr int nnodes = (1000 * 1000);
+    constexpr long sum = (((long) nnodes * (nnodes - 1)) / 2);
+
+    auto local = buildChain<IntrusivePtr<LocalRcCNode>>(nnodes,
+            [](int i) { return makeIntrusive<LocalRcCNode>(i); });
+    assert(LocalRcCNode::nlive == nnodes);
+    assert(walkChain(local) == sum);
+    assert(local.useCount() == 1);
+    assert(local->next.useCount() == 1);
+    freeChain(local);
+    assert(LocalRcCNode::nlive == 0);
+
+    auto atomic = buildChain<IntrusivePtr<AtomicRcCNode>>(nnodes,
+            [](int i) { return makeIntrusive<AtomicRcCNode>(i); });
+    assert(walkChain(atomic) == sum);
+    freeChain(atomic);
+    assert(AtomicRcCNode::nlive == 0);
+
+    TEST_END();
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * AtomicRefCount objects can be shared across threads: Threads copying and
+ * dropping references to the same chain leave the counts as they were.
+ * -----------------------------------------------------------------------------
+ */
+void
+test_intrusive_ptr_atomic_threads(void)
+{
+    TEST_START();
+
+    constexpr int nthreads = 4;
+    constexpr int nnodes = 1000;
+
+    IntrusivePtr<AtomicRcCNode> head
+        = buildChain<IntrusivePtr<AtomicRcCNode>>(nnodes,
+            [](int i) { return makeIntrusive<AtomicRcCNode>(i); });
+
+    std::vector<std::thread> threads;
+    for (int tctr = 0; tctr < nthreads; tctr++) {
+        threads.emplace_back([&head]() {
+            for (int i = 0; i < 100; i++) {
+                assert(walkChain(head) == (((long) nnodes * (nnodes - 1)) / 2));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    assert(head.useCount() == 1);
+    assert(head->next.useCount() == 1);
+    freeChain(head);
+    assert(AtomicRcCNode::nlive == 0);
+
+    TEST_END();
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * Build, walk and free a chain of 'nnodes' nodes, with each kind of pointer,
+ * and report ns / node for each step.
+ * -----------------------------------------------------------------------------
+ */
+template <typename NodePtr, typename MakeFn>
+void
+benchChain(const char *name, int nnodes, MakeFn make)
+{
+    using bench_clock = std::chrono::steady_clock;
+    auto ns_per_node = [nnodes](bench_clock::time_point start) {
+        return (std::chrono::duration<double, std::nano>(bench_clock::now()
+                                                            - start).count()
+                    / nnodes);
+    };
+
+    auto start = bench_clock::now();
+    NodePtr head = buildChain<NodePtr>(nnodes, make);
+    double build_ns = ns_per_node(start);
+
+    start = bench_clock::now();
+    long sum = walkChain(head);
+    double walk_ns = ns_per_node(start);
+    assert(sum == (((long) nnodes * (nnodes - 1)) / 2));
+
+    start = bench_clock::now();
+    freeChain(head);
+    double free_ns = ns_per_node(start);
+
+    printf("%-32s build %6.2f  walk %6.2f  free %6.2f  total %6.2f ns/node\n",
+           name, build_ns, walk_ns, free_ns, (build_ns + walk_ns + free_ns));
+}
+
+/*
+ * libstdc++'s shared_ptr skips its atomic updates while the process has
+ * never started a thread; so run the benchmark once like that, and once
+ * after starting a thread, as it is in any multi-threaded program.
+ */
+void
+benchRefCount(int nnodes)
+{
+    for (int multi_threaded = 0; multi_threaded < 2; multi_threaded++) {
+        if (multi_threaded) {
+            std::thread([]() { }).join();
+        }
+        printf("%d nodes, %s process:\n", nnodes,
+               (multi_threaded ? "multi-threaded" : "single-threaded"));
+        benchChain<std::shared_ptr<SpCNode>>("shared_ptr(new SpCNode)", nnodes,
+                [](int i) { return std::shared_ptr<SpCNode>(new SpCNode(i)); });
+        benchChain<std::shared_ptr<SpCNode>>("make_shared<SpCNode>", nnodes,
+                [](int i) { return std::make_shared<SpCNode>(i); });
+        benchChain<IntrusivePtr<AtomicRcCNode>>("IntrusivePtr<AtomicRefCount>", nnodes,
+                [](int i) { return makeIntrusive<AtomicRcCNode>(i); });
+        benchChain<IntrusivePtr<LocalRcCNode>>("IntrusivePtr<LocalRefCount>", nnodes,
+                [](int i) { return makeIntrusive<LocalRcCNode>(i); });
+    }
+}
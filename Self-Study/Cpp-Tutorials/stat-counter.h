@@ -0,0 +1,201 @@
+/*
+ * -----------------------------------------------------------------------------
+ * stat-counter.h: Sharded statistics counter, one cache-line padded slot per
+ * thread, summed lazily on read.
+ *
+ *  StatCounter nlookups;
+ *
+ *  nlookups.inc();             // Hot path: Bump calling thread's own slot
+ *  nlookups.add(n);
+ *  uint64_t total = nlookups.read();   // Sum over all threads' slots
+ *
+ * A thread's first add() to a counter allocates its slot and registers it
+ * with the counter; after that, add() is a thread-local lookup and a relaxed
+ * load + store to a cache line no other thread writes. No locked
+ * read-modify-write, and no cache-line ping-pong between incrementing
+ * threads, as with a shared std::atomic.
+ *
+ * When a thread exits, its slots are unregistered, and their values folded
+ * into each counter's 'retired' total, so read() still counts them. If a
+ * counter is destroyed first, it detaches its slots, which the threads then
+ * free on their next add() to a counter reusing its id, or at exit.
+ *
+ * read() takes a registry mutex and walks the slots, so it is O(#threads)
+ * and is meant for reporting, not for the hot path. A read() racing with
+ * add()s returns some value between the totals before and after them.
+ *
+ * Ref: Linux percpu_counter; folly ThreadCachedInt.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef __STAT_COUNTER_H__
+#define __STAT_COUNTER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+constexpr size_t   Stat_counter_cache_line = 64;
+
+class StatCounter
+{
+  public:
+    StatCounter() {
+        std::lock_guard<std::mutex> guard(registryMutex());
+        serial = ++nextSerial();
+        std::vector<uint32_t>& free_ids = freeIds();
+        if (free_ids.empty()) {
+            id = nextId()++;
+        } else {
+            id = free_ids.back();
+            free_ids.pop_back();
+        }
+    }
+
+    ~StatCounter() {
+        std::lock_guard<std::mutex> guard(registryMutex());
+        for (Slot *slotp : slots) {
+            slotp->owner = nullptr;
+        }
+        freeIds().push_back(id);
+    }
+
+    StatCounter(const StatCounter&) = delete;
+    StatCounter& operator=(const StatCounter&) = delete;
+
+    void
+    add(uint64_t n) {
+        std::atomic<uint64_t>& value = mySlot()->value;
+        value.store((value.load(std::memory_order_relaxed) + n),
+                    std::memory_order_relaxed);
+    }
+
+    void inc(void) { add(1); }
+
+    // Sum of all adds, by live and exited threads.
+    uint64_t
+    read(void) const {
+        std::lock_guard<std::mutex> guard(registryMutex());
+        uint64_t sum = retired;
+        for (const Slot *slotp : slots) {
+            sum += slotp->value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    // # of live threads that have added to this counter.
+    size_t
+    nthreads(void) const {
+        std::lock_guard<std::mutex> guard(registryMutex());
+        return slots.size();
+    }
+
+  private:
+    struct alignas(Stat_counter_cache_line) Slot
+    {
+        std::atomic<uint64_t> value{0};
+        uint64_t              serial;   // Of the counter it was made for
+        StatCounter          *owner;    // NULL once that counter is gone
+    };
+
+    /*
+     * A thread's slots, indexed by counter id. Counter ids are reused, so an
+     * entry is valid only if its serial, which is never reused, matches.
+     */
+    struct ThreadSlots
+    {
+        std::vector<Slot *> by_id;
+
+        ~ThreadSlots() {
+            std::lock_guard<std::mutex> guard(registryMutex());
+            for (Slot *slotp : by_id) {
+                if (slotp) {
+                    release(slotp);
+                }
+            }
+        }
+    };
+
+    Slot *
+    mySlot(void) {
+        std::vector<Slot *>& by_id = threadSlots().by_id;
+        if ((id < by_id.size()) && by_id[id] && (by_id[id]->serial == serial)) {
+            return by_id[id];
+        }
+        return newSlot();
+    }
+
+    // Slow path of the first add() by this thread: Make and register a slot.
+    Slot *
+    newSlot(void) {
+        std::vector<Slot *>& by_id = threadSlots().by_id;
+        if (id >= by_id.size()) {
+            by_id.resize(id + 1, nullptr);
+        }
+        std::lock_guard<std::mutex> guard(registryMutex());
+        if (by_id[id]) {
+            release(by_id[id]);     // Left by a destroyed counter of this id
+        }
+        Slot *slotp = new Slot;
+        slotp->serial = serial;
+        slotp->owner = this;
+        slots.push_back(slotp);
+        by_id[id] = slotp;
+        return slotp;
+    }
+
+    // Unregister a slot from its counter, if any, and free it. Locked.
+    static void
+    release(Slot *slotp) {
+        StatCounter *owner = slotp->owner;
+        if (owner) {
+            owner->retired += slotp->value.load(std::memory_order_relaxed);
+            std::vector<Slot *>& owner_slots = owner->slots;
+            for (size_t i = 0; i < owner_slots.size(); i++) {
+                if (owner_slots[i] == slotp) {
+                    owner_slots[i] = owner_slots.back();
+                    owner_slots.pop_back();
+                    break;
+                }
+            }
+        }
+        delete slotp;
+    }
+
+    static ThreadSlots&
+    threadSlots(void) {
+        static thread_local ThreadSlots thread_slots;
+        return thread_slots;
+    }
+
+    static std::mutex&
+    registryMutex(void) {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static uint64_t&
+    nextSerial(void) {
+        static uint64_t next_serial = 0;
+        return next_serial;
+    }
+
+    static uint32_t&
+    nextId(void) {
+        static uint32_t next_id = 0;
+        return next_id;
+    }
+
+    static std::vector<uint32_t>&
+    freeIds(void) {
+        static std::vector<uint32_t> free_ids;
+        return free_ids;
+    }
+
+    uint32_t             id;
+    uint64_t             serial;
+    uint64_t             retired = 0;   // Sum of slots of exited threads
+    std::vector<Slot *>  slots;         // Of live threads
+};
+
+#endif // __STAT_COUNTER_H__
@@ -0,0 +1,501 @@
+/*
+ * -----------------------------------------------------------------------------
+ * thread-pool.h: Fixed-size pool of worker threads, in place of std::async(),
+ * with lightweight task futures, then() continuations and when_all().
+ *
+ *  ThreadPool pool(nthreads);
+ *
+ *  TaskFuture<int> fu = pool.submit(factorial, 5);     // Like std::async(...)
+ *  TaskFuture<std::string> fu_str = fu.then([](int n) {
+ *                                       return std::to_string(n);
+ *                                   });                // Runs once fu is ready
+ *  std::string res = fu_str.get();
+ *
+ *  std::vector<TaskFuture<int>> parts;  ...
+ *  TaskFuture<std::vector<int>> all = when_all(pool, std::move(parts));
+ *
+ *  TaskPromise<int> p(pool);           // Like std::promise<int>
+ *  TaskFuture<int> fu_n = p.get_future();
+ *  ...
+ *  p.set_value(n);                     // Runs continuations of fu_n
+ *
+ * std::async(std::launch::async, ...) may start an OS thread per call, and a
+ * std::future parks a thread in get() till its value arrives. Here, all
+ * tasks run on the pool's nthreads workers, started once; submit() costs a
+ * heap-allocated shared state and a queue push. Trees of dependent tasks are
+ * better chained with then() / when_all(), which park no thread at all: A
+ * continuation is queued to the pool when the value it waits for is set.
+ *
+ * get() / wait() called on one of the pool's own workers do not just block:
+ * The worker keeps running queued tasks till the value is ready, so a parent
+ * task that waits for its children cannot deadlock a fixed-size pool, as
+ * long as the children are queued.
+ *
+ * Tasks, and continuations, may be move-only, as std::async's may: E.g. a
+ * lambda that owns a TaskFuture, a TaskPromise or a unique_ptr.
+ *
+ * A TaskFuture is move-only; get() and then() consume it, as std::future's
+ * get() does. An exception thrown by a task is rethrown by get(), and skips
+ * the continuations chained after it, to the future at the end of the chain.
+ * A TaskPromise destroyed without a value sets a broken_promise future_error.
+ *
+ * The pool's destructor runs all queued tasks, and the continuations they
+ * queue, before joining its workers.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+class ThreadPool;
+template <typename T> class TaskFuture;
+template <typename T> class TaskPromise;
+
+// Result type of continuation 'F' chained to a TaskFuture<T> ...
+template <typename T, typename F>
+struct ThenResult { using type = std::invoke_result_t<std::decay_t<F>, T>; };
+
+template <typename F>
+struct ThenResult<void, F> { using type = std::invoke_result_t<std::decay_t<F>>; };
+
+// ... and of when_all() of TaskFuture<T>s.
+template <typename T>
+using WhenAllResult = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+/*
+ * A queued task or continuation: A type-erased void() callable that, unlike
+ * std::function, need not be copyable. Heap-allocated, as std::function's
+ * targets mostly are; std::move_only_function does the same, from C++23.
+ */
+class PoolTask
+{
+  public:
+    PoolTask() = default;
+
+    template <typename F>
+        requires (!std::is_same_v<std::remove_cvref_t<F>, PoolTask>)
+    PoolTask(F&& fn)
+        : callable{std::make_unique<Callable<std::decay_t<F>>>(std::forward<F>(fn))} { }
+
+    PoolTask(PoolTask&&) noexcept = default;
+    PoolTask& operator=(PoolTask&&) noexcept = default;
+
+    void operator()(void) { callable->call(); }
+
+  private:
+    struct CallableBase
+    {
+        virtual ~CallableBase() = default;
+        virtual void call(void) = 0;
+    };
+
+    template <typename F>
+    struct Callable final : CallableBase
+    {
+        template <typename G>
+        explicit Callable(G&& fn) : fn{std::forward<G>(fn)} { }
+
+        void call(void) override { fn(); }
+
+        F fn;
+    };
+
+    std::unique_ptr<CallableBase> callable;
+};
+
+/*
+ * Shared state of a task's result: Set once, by the task or a TaskPromise,
+ * and read by its TaskFuture, or by the continuation chained to it.
+ */
+template <typename T>
+struct TaskState
+{
+    // What is stored for a 'void' result.
+    using value_type = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    explicit TaskState(ThreadPool *pool) : pool{pool} { }
+
+    // Run 'fn', and store its result, or the exception it threw.
+    template <typename F>
+    void
+    run(F&& fn) {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                std::forward<F>(fn)();
+                setValue(std::monostate{});
+            } else {
+                setValue(std::forward<F>(fn)());
+            }
+        } catch (...) {
+            setException(std::current_exception());
+        }
+    }
+
+    void
+    setValue(value_type v) {
+        value.emplace(std::move(v));
+        complete();
+    }
+
+    void
+    setException(std::exception_ptr ex) {
+        exception = std::move(ex);
+        complete();
+    }
+
+    // Queue 'cont' to the pool once ready; now, if already.
+    void onReady(PoolTask cont);
+
+    // Publish the result, wake waiters, and queue continuations.
+    void complete(void);
+
+    ThreadPool                         *pool;
+    std::atomic<bool>                   ready{false};
+    std::mutex                          mutex;      // Guards continuations
+    std::vector<PoolTask>               continuations;
+    std::optional<value_type>           value;
+    std::exception_ptr                  exception;
+};
+
+class ThreadPool
+{
+  public:
+    explicit ThreadPool(unsigned nthreads = std::thread::hardware_concurrency()) {
+        nthreads = (nthreads ? nthreads : 1);
+        for (unsigned id = 0; id < nthreads; id++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Run fn(args...) on a worker; its result, or exception, is in the future.
+    template <typename F, typename... Args>
+    auto
+    submit(F&& fn, Args&&... args)
+        -> TaskFuture<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+        using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+        auto state = std::make_shared<TaskState<R>>(this);
+        enqueue([state, bound = std::bind_front(std::forward<F>(fn),
+                                                std::forward<Args>(args)...)]() mutable {
+            state->run(std::move(bound));   // Args as rvalues, as std::async's
+        });
+        return TaskFuture<R>(std::move(state));
+    }
+
+    unsigned nthreads(void) const { return workers.size(); }
+
+    // # of tasks, and continuations, started so far. Counted before a task
+    // runs, so a task whose result get() has returned is always counted.
+    uint64_t ntasks(void) const { return ntasks_run.load(std::memory_order_relaxed); }
+
+  private:
+    template <typename T> friend struct TaskState;
+    template <typename T> friend class TaskFuture;
+
+    void
+    enqueue(PoolTask task) {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            queue.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+    void
+    runTask(PoolTask& task) {
+        ntasks_run.fetch_add(1, std::memory_order_relaxed);
+        task();
+    }
+
+    void
+    workerLoop(void) {
+        tl_pool = this;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return (stopping || !queue.empty()); });
+            if (queue.empty()) {
+                break;      // Stopping, and all work is done
+            }
+            PoolTask task = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            runTask(task);
+            lock.lock();
+        }
+        tl_pool = nullptr;
+    }
+
+    /*
+     * Wait till 'state' is ready. On this pool's workers, run queued tasks
+     * meanwhile; completing a state wakes such helpers through 'cv', if its
+     * ready-store sees nhelpers > 0. Both are seq_cst, so either the
+     * completer sees our nhelpers++, or we see it ready.
+     */
+    template <typename T>
+    void
+    waitFor(TaskState<T>& state) {
+        if (tl_pool != this) {
+            while (!state.ready.load(std::memory_order_acquire)) {
+                state.ready.wait(false, std::memory_order_acquire);
+            }
+            return;
+        }
+        nhelpers.fetch_add(1, std::memory_order_seq_cst);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!state.ready.load(std::memory_order_seq_cst)) {
+            if (queue.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+            PoolTask task = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            runTask(task);
+            lock.lock();
+        }
+        nhelpers.fetch_sub(1, std::memory_order_relaxed);
+
+        // We may have taken the wakeup of an enqueue(); pass it on.
+        if (!queue.empty()) {
+            cv.notify_one();
+        }
+    }
+
+    // A state a helper may be waiting for became ready: Wake helpers.
+    void
+    wakeHelpers(void) {
+        if (nhelpers.load(std::memory_order_seq_cst)) {
+            { std::lock_guard<std::mutex> guard(mutex); }
+            cv.notify_all();
+        }
+    }
+
+    std::vector<std::thread>            workers;
+    std::mutex                          mutex;      // Guards queue, stopping
+    std::condition_variable             cv;         // Work queued, or helper's state ready
+    std::deque<PoolTask>                queue;
+    bool                                stopping = false;
+    std::atomic<unsigned>               nhelpers{0};
+    std::atomic<uint64_t>               ntasks_run{0};
+
+    static inline thread_local ThreadPool *tl_pool = nullptr;
+};
+
+template <typename T>
+void
+TaskState<T>::onReady(PoolTask cont) {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!ready.load(std::memory_order_relaxed)) {
+            continuations.push_back(std::move(cont));
+            return;
+        }
+    }
+    pool->enqueue(std::move(cont));
+}
+
+template <typename T>
+void
+TaskState<T>::complete(void) {
+    std::vector<PoolTask> conts;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        ready.store(true, std::memory_order_seq_cst);
+        conts.swap(continuations);
+    }
+    ready.notify_all();
+    pool->wakeHelpers();
+    for (PoolTask& cont : conts) {
+        pool->enqueue(std::move(cont));
+    }
+}
+
+template <typename T>
+class TaskFuture
+{
+  public:
+    TaskFuture() = default;
+    TaskFuture(TaskFuture&&) = default;
+    TaskFuture& operator=(TaskFuture&&) = default;
+
+    bool valid(void) const { return (state != nullptr); }
+    bool ready(void) const { return state->ready.load(std::memory_order_acquire); }
+
+    void wait(void) const { state->pool->waitFor(*state); }
+
+    // Wait for, and return, the result; rethrow the task's exception.
+    T
+    get(void) {
+        std::shared_ptr<TaskState<T>> s = std::move(state);
+        s->pool->waitFor(*s);
+        if (s->exception) {
+            std::rethrow_exception(s->exception);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*s->value);
+        }
+    }
+
+    /*
+     * Run fn(result), or fn() for a void result, on the pool once this is
+     * ready, without waiting for it here. Returns fn's future; an exception
+     * of this task goes straight to it, and fn is not run.
+     */
+    template <typename F>
+    TaskFuture<typename ThenResult<T, F>::type>
+    then(F&& fn) {
+        using R = typename ThenResult<T, F>::type;
+        std::shared_ptr<TaskState<T>> prev = std::move(state);
+        auto next = std::make_shared<TaskState<R>>(prev->pool);
+        TaskState<T> *prevp = prev.get();
+
+        // The continuation holds 'prev' till it runs, and, till then, prev
+        // holds the continuation; complete() breaks the cycle.
+        prevp->onReady([prev = std::move(prev), next, fn = std::forward<F>(fn)]() mutable {
+            if (prev->exception) {
+                next->setException(prev->exception);
+                return;
+            }
+            next->run([&]() -> R {
+                if constexpr (std::is_void_v<T>) {
+                    return fn();
+                } else {
+                    return fn(std::move(*prev->value));
+                }
+            });
+        });
+        return TaskFuture<R>(std::move(next));
+    }
+
+  private:
+    friend class ThreadPool;
+    friend class TaskPromise<T>;
+    template <typename U> friend class TaskFuture;
+    template <typename U>
+    friend TaskFuture<WhenAllResult<U>> when_all(ThreadPool& pool,
+                                                 std::vector<TaskFuture<U>> futures);
+
+    explicit TaskFuture(std::shared_ptr<TaskState<T>> state) : state{std::move(state)} { }
+
+    std::shared_ptr<TaskState<T>> state;
+};
+
+/* Like std::promise: A future whose value is set by hand, from any thread. */
+template <typename T>
+class TaskPromise
+{
+  public:
+    explicit TaskPromise(ThreadPool& pool)
+        : state{std::make_shared<TaskState<T>>(&pool)} { }
+
+    TaskPromise(TaskPromise&&) = default;
+    TaskPromise& operator=(TaskPromise&&) = delete;
+
+    ~TaskPromise() {
+        if (state && !state->ready.load(std::memory_order_acquire)) {
+            state->setException(std::make_exception_ptr(
+                    std::future_error(std::future_errc::broken_promise)));
+        }
+    }
+
+    TaskFuture<T> get_future(void) { return TaskFuture<T>(state); }
+
+    template <typename U = T>
+        requires (!std::is_void_v<U>)
+    void set_value(U v) { state->setValue(std::move(v)); }
+
+    template <typename U = T>
+        requires std::is_void_v<U>
+    void set_value(void) { state->setValue(std::monostate{}); }
+
+    void set_exception(std::exception_ptr ex) { state->setException(std::move(ex)); }
+
+  private:
+    std::shared_ptr<TaskState<T>> state;
+};
+
+/*
+ * A future that is ready once all of 'futures' are: With their results, in
+ * order, or the first exception among them, in order. Nothing waits; the
+ * last one to be ready sets it.
+ */
+template <typename T>
+TaskFuture<WhenAllResult<T>>
+when_all(ThreadPool& pool, std::vector<TaskFuture<T>> futures)
+{
+    using R = WhenAllResult<T>;
+
+    struct Join
+    {
+        std::vector<TaskFuture<T>>      futures;
+        std::atomic<size_t>             nleft;
+        std::shared_ptr<TaskState<R>>   result;
+    };
+    auto join = std::make_shared<Join>();
+    join->nleft.store(futures.size() + 1, std::memory_order_relaxed);
+    join->result = std::make_shared<TaskState<R>>(&pool);
+    join->futures = std::move(futures);
+
+    auto arrive = [join]() {
+        if (join->nleft.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        std::exception_ptr ex;
+        for (TaskFuture<T>& fu : join->futures) {
+            if ((ex = fu.state->exception)) {
+                break;
+            }
+        }
+        if (ex) {
+            join->result->setException(ex);
+        } else {
+            join->result->run([&]() -> R {
+                if constexpr (!std::is_void_v<T>) {
+                    std::vector<T> values;
+                    values.reserve(join->futures.size());
+                    for (TaskFuture<T>& fu : join->futures) {
+                        values.push_back(std::move(*fu.state->value));
+                    }
+                    return values;
+                }
+            });
+        }
+        join->futures.clear();  // Breaks the cycle: join -> futures -> arrive
+    };
+    for (TaskFuture<T>& fu : join->futures) {
+        fu.state->onReady(arrive);
+    }
+    TaskFuture<R> all(join->result);
+    arrive();   // The +1: No future can finish the join before all are added
+    return all;
+}
+
+#endif // __THREAD_POOL_H__
@@ -36,6 +36,16 @@
  *
  *  $ ./threads-concurrency [test_*]
  *  $ ./threads-concurrency [--help | test_<something> | test_<prefix> ]
+ *  $ ./threads-concurrency --bench-locks [ <max-threads> [ <ops-per-thread> ] ]
+ *  $ ./threads-concurrency bench_<name-or-prefix> [ <bench-options> ]
+ *
+ *  --bench-locks runs the shared-counter contention benchmark of
+ *  lock-bench.h: mutex, spinlocks, MCS lock, atomics and sharded counters,
+ *  including the StatCounter of stat-counter.h.
+ *
+ *  bench_* runs the single-threaded micro-benchmarks in Bench_fns[], of the
+ *  uncontended cost of each primitive, by the runner of ../Tools/bench_fns.h;
+ *  see there for <bench-options>, e.g. --reps, --tsc and --json.
  *
  * History:
  * -----------------------------------------------------------------------------
@@ -43,8 +53,14 @@
 #include <iostream>
 
 #include <thread>   // For std::thread, std::this_thread
+#include <atomic>
+#include <mutex>
 #include <fmt/core.h>
 
+#include "lock-bench.h"
+#include "stat-counter.h"
+#include "../Tools/bench_fns.h"
+
 #if __linux__
 #include <cstring>
 #include <cassert>
@@ -52,7 +68,8 @@
 
 using namespace std;
 
-string Usage = " [ --help | test_<fn-name> ]\n";
+string Usage = " [ --help | test_<fn-name> | --bench-locks [ <max-threads> [ <ops-per-thread> ] ]"
+               " | bench_<fn-name> [ <bench-options> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -63,6 +80,18 @@ void test_msg(string);
 void test_threads_basic(void);
 void test_thread_local(void);
 void test_thread_local_incorrect_usage(void);
+void test_atomics(void);
+void test_lock_bench(void);
+void test_stat_counter(void);
+void test_stat_counter_outlived(void);
+void test_bench_fns(void);
+
+// Bench Function Prototypes
+void bench_atomic_fetch_add(uint64_t nops);
+void bench_atomic_cas(uint64_t nops);
+void bench_mutex_lock_unlock(uint64_t nops);
+void bench_stat_counter_add(uint64_t nops);
+void bench_thread_local_inc(uint64_t nops);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -80,6 +109,19 @@ TEST_FNS Test_fns[] = {
     , { "test_thread_local_incorrect_usage"
                                     , test_thread_local_incorrect_usage }
     , { "test_atomics"              , test_atomics }
+    , { "test_lock_bench"           , test_lock_bench }
+    , { "test_stat_counter"         , test_stat_counter }
+    , { "test_stat_counter_outlived", test_stat_counter_outlived }
+    , { "test_bench_fns"            , test_bench_fns }
+};
+
+// List of bench functions one can invoke from the command-line; see bench_fns.h
+BENCH_FNS Bench_fns[] = {
+      { "bench_atomic_fetch_add"    , bench_atomic_fetch_add, 0 }
+    , { "bench_atomic_cas"          , bench_atomic_cas, 0 }
+    , { "bench_mutex_lock_unlock"   , bench_mutex_lock_unlock, 0 }
+    , { "bench_stat_counter_add"    , bench_stat_counter_add, 0 }
+    , { "bench_thread_local_inc"    , bench_thread_local_inc, 0 }
 };
 
 // Test start / end info-msg macros
@@ -100,7 +142,9 @@ int
 main(const int argc, const char *argv[])
 {
     string hello_msg = "Hello World.";
-    cout << argv[0] << ": " << hello_msg << " (argc=" << argc << ")" << endl;
+    // To stderr when benchmarking, so stdout holds only the results.
+    (BENCH_ARGV(argc, argv) ? cerr : cout)
+        << argv[0] << ": " << hello_msg << " (argc=" << argc << ")" << endl;
 
     int rv = 0;
 
@@ -112,6 +156,20 @@ main(const int argc, const char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         cout << argv[0] << Usage << endl;
         return 0;
+    } else if (strcmp("--bench-locks", argv[1]) == 0) {
+        unsigned max_threads = ((argc > 2) ? atoi(argv[2])
+                                           : std::thread::hardware_concurrency());
+        uint64_t nops = ((argc > 3) ? atoll(argv[3]) : 1000 * 1000);
+        if (max_threads < 1) {
+            max_threads = 1;
+        }
+        fmt::print("Shared counter, {} increments per thread, {} CPUs\n",
+                   nops, std::thread::hardware_concurrency());
+        for (const LockBenchResult& result : lockBenchSuite(max_threads, nops)) {
+            rv |= !result.correct;
+        }
+    } else if (BENCH_ARGV(argc, argv)) {
+        rv = bench_main(Bench_fns, ARRAYSIZE(Bench_fns), (argc - 1), &argv[1]);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
         // Execute the named test-function, if it's a supported test-function
         int tctr = 0;
@@ -191,6 +249,10 @@ test_threads_basic(void)
 constexpr uint64_t      tlocal_ctr_initial = 0;
 thread_local uint64_t   tlocal_ctr = tlocal_ctr_initial;
 
+// Total increments by all do_count() threads; per-thread slots, like
+// tlocal_ctr, but the sum can be read from any thread.
+StatCounter             Do_count_incrs;
+
 // Define a thread-function handler to increment this thread-local counter
 // Return the final value via an output reference parameter
 void
@@ -199,6 +261,7 @@ do_count(const string tname, int ntimes, uint64_t& ret)
     // Increment thread-local counter ntimes
     for (auto i = 0; i < ntimes; i++) {
         tlocal_ctr++;
+        Do_count_incrs.inc();
     }
     fmt::print("Excuted ThreadID='{}', new tlocal_ctr={}\n", tname, tlocal_ctr);
 
@@ -231,6 +294,7 @@ test_thread_local(void)
 
     uint64_t    reta{};
     uint64_t    retb{};
+    uint64_t    incrs_before = Do_count_incrs.read();
 
     // Start two threads, invoking the common incrementer function, returning
     // the final result of incremented thread-local counter via output param
@@ -252,6 +316,10 @@ test_thread_local(void)
     // Main thread's counter should have remained unchanged at its initial value.
     assert(tlocal_ctr == tlocal_ctr_initial);
 
+    // The exited threads' increments still count in the shared total.
+    assert(Do_count_incrs.read() == (incrs_before + ntimes_a + ntimes_b));
+    assert(Do_count_incrs.nthreads() == 0);
+
     TEST_END();
 }
 
@@ -350,9 +418,255 @@ test_atomics(void)
 {
     TEST_START();
 
+    // Plain increments of shared int race, and lose updates; fetch_add()
+    // is one indivisible read-modify-write, so none are lost.
+    constexpr unsigned nthreads = 4;
+    constexpr uint64_t nops = (100 * 1000);
+    LockBenchResult result = lockBenchRun<AtomicCounter>("atomic-add", nthreads, nops);
+    assert(result.correct);
+    assert(result.nops == (nthreads * nops));
+
+    // std::atomic on a lock-free type compiles to the instruction itself.
+    assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    cout << endl;
+    lockBenchPrintHeader();
+    lockBenchPrint(result);
+    TEST_END();
+}
+
+/*
+ * Run the lock contention benchmark, briefly, for up to 4 threads: Every
+ * primitive must count all increments.
+ */
+void
+test_lock_bench(void)
+{
+    TEST_START();
+
+    cout << endl;
+    auto results = lockBenchSuite(4, (20 * 1000));
+    assert(results.size() == (3 * 7));      // 1, 2, 4 threads x 7 primitives
+    for (const LockBenchResult& result : results) {
+        assert(result.correct);
+        assert(result.p50_ns <= result.p99_ns);
+        assert(result.p99_ns <= result.max_ns);
+    }
+    TEST_END();
+}
+
+/*
+ * Threads bump a StatCounter while main() reads it: Reads never go backwards
+ * and, once threads exit, the total is exact and no slots remain registered.
+ */
+void
+test_stat_counter(void)
+{
+    TEST_START();
+
+    constexpr unsigned nthreads = 4;
+    constexpr uint64_t nops = (200 * 1000);
+
+    StatCounter counter;
+    std::atomic<unsigned> ndone{0};
+    std::vector<std::thread> threads;
+    for (unsigned tid = 0; tid < nthreads; tid++) {
+        threads.emplace_back([&counter, &ndone, tid]() {
+            for (uint64_t i = 0; i < nops; i++) {
+                counter.add(tid + 1);
+            }
+            ndone.fetch_add(1);
+        });
+    }
+
+    uint64_t prev = 0;
+    while (ndone.load() < nthreads) {
+        uint64_t now = counter.read();
+        assert(now >= prev);
+        assert(counter.nthreads() <= nthreads);
+        prev = now;
+        std::this_thread::yield();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // (1 + 2 + ... + nthreads) * nops
+    assert(counter.read() == ((nthreads * (nthreads + 1) / 2) * nops));
+    assert(counter.nthreads() == 0);
+
+    // main() adding registers its own slot, which stays till main() exits.
+    counter.inc();
+    assert(counter.read() == (((nthreads * (nthreads + 1) / 2) * nops) + 1));
+    assert(counter.nthreads() == 1);
+
+    TEST_END();
+}
+
+/*
+ * Counters destroyed while threads that added to them live on: The threads'
+ * slots must not be counted by a new counter that reuses the old one's id.
+ */
+void
+test_stat_counter_outlived(void)
+{
+    TEST_START();
+
+    StatCounter *counter = new StatCounter;
+    std::atomic<int> phase{0};
+
+    std::thread thread([&]() {
+        counter->add(10);
+        phase.store(1);
+        while (phase.load() != 2) {
+            std::this_thread::yield();
+        }
+        counter->add(5);            // A new counter, likely with the same id
+        phase.store(3);
+        while (phase.load() != 4) {
+            std::this_thread::yield();
+        }
+    });
+
+    while (phase.load() != 1) {
+        std::this_thread::yield();
+    }
+    assert(counter->read() == 10);
+    assert(counter->nthreads() == 1);
+    delete counter;
+
+    counter = new StatCounter;
+    counter->inc();
+    phase.store(2);
+    while (phase.load() != 3) {
+        std::this_thread::yield();
+    }
+    assert(counter->read() == 6);
+    assert(counter->nthreads() == 2);
+
+    phase.store(4);
+    thread.join();
+    assert(counter->read() == 6);
+    assert(counter->nthreads() == 1);
+    delete counter;
+
+    TEST_END();
+}
+
+/*
+ * The bench runner: Statistics of known rep times, and a run of a benchmark
+ * with fixed nops, whose work is checked.
+ */
+static uint64_t Bench_fns_nops_done = 0;
+
+static void
+bench_count_ops(uint64_t nops)
+{
+    for (uint64_t i = 0; i < nops; i++) {
+        Bench_fns_nops_done++;
+        BENCH_CLOBBER();
+    }
+}
+
+void
+test_bench_fns(void)
+{
+    TEST_START();
+
+    // 1 .. 100, shuffled
+    double rep_ns[100];
+    for (int i = 0; i < 100; i++) {
+        rep_ns[i] = ((i * 37) % 100) + 1;
+    }
+    BENCH_RESULT result;
+    bench_stats(rep_ns, 100, &result);
+    assert(result.min_ns == 1);
+    assert(result.median_ns == 50.5);
+    assert(result.p99_ns == 99);
+    assert(result.mean_ns == 50.5);
+
+    bench_stats(rep_ns, 3, &result);    // Sorted: 1, 2, 3
+    assert((result.median_ns == 2) && (result.p99_ns == 3));
+
+    BENCH_OPTS opts;
+    const char *argv[] = { "bench_", "--reps", "5", "--warmup", "1", "--no-counters" };
+    assert(bench_parse_args(ARRAYSIZE(argv), argv, &opts) == 0);
+    assert((opts.nreps == 5) && (opts.nwarmup == 1) && !opts.use_counters);
+
+    const char *bad_argv[] = { "bench_", "--frobnicate" };
+    assert(bench_parse_args(ARRAYSIZE(bad_argv), bad_argv, &opts) != 0);
+
+    BENCH_FNS bfn = { "bench_count_ops", bench_count_ops, 1000 };
+    bench_default_opts(&opts);
+    opts.nreps = 5;
+    assert(bench_run_one(&bfn, &opts, &result) == 0);
+    assert(Bench_fns_nops_done == ((opts.nwarmup + opts.nreps) * 1000));
+    assert((result.nops == 1000) && (result.nreps == 5));
+    assert((result.min_ns > 0) && (result.min_ns <= result.median_ns)
+           && (result.median_ns <= result.p99_ns));
+
+    // Calibrated: A rep takes at least the minimum rep time.
+    bfn.bfn_nops = 0;
+    opts.min_rep_ns = (100 * 1000);
+    assert(bench_run_one(&bfn, &opts, &result) == 0);
+    assert((result.nops * result.median_ns) >= (opts.min_rep_ns / 2));
+
     TEST_END();
 }
 
+/*
+ * bench_* : Uncontended costs of the primitives above, per operation.
+ */
+void
+bench_atomic_fetch_add(uint64_t nops)
+{
+    static std::atomic<uint64_t> counter{0};
+    for (uint64_t i = 0; i < nops; i++) {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void
+bench_atomic_cas(uint64_t nops)
+{
+    static std::atomic<uint64_t> counter{0};
+    for (uint64_t i = 0; i < nops; i++) {
+        uint64_t expected = counter.load(std::memory_order_relaxed);
+        while (!counter.compare_exchange_weak(expected, (expected + 1))) {
+        }
+    }
+}
+
+void
+bench_mutex_lock_unlock(uint64_t nops)
+{
+    static std::mutex mutex;
+    static uint64_t counter = 0;
+    for (uint64_t i = 0; i < nops; i++) {
+        std::lock_guard<std::mutex> guard(mutex);
+        counter++;
+    }
+}
+
+void
+bench_stat_counter_add(uint64_t nops)
+{
+    static StatCounter counter;
+    for (uint64_t i = 0; i < nops; i++) {
+        counter.inc();
+    }
+}
+
+void
+bench_thread_local_inc(uint64_t nops)
+{
+    static thread_local uint64_t counter = 0;
+    for (uint64_t i = 0; i < nops; i++) {
+        counter++;
+        BENCH_CLOBBER();
+    }
+}
+
 void
 test_template(void)
 {
@@ -11,7 +11,7 @@
  * This is an excellent step-by-step tutorial on how-to build a unique_ptr
  * class from the basics, adding different types of constructors.
  *
- * Usage: g++ -o unique-pointer-impl unique-pointer-impl.cpp
+ * Usage: g++ -std=c++20 -o unique-pointer-impl unique-pointer-impl.cpp
  *        ./unique-pointer-impl [test_*]
  *        ././unique-pointer-impl [--help | test_<something> | test_<prefix> ]
  *
@@ -29,10 +29,24 @@
  *   C++ constructs will automatically invoke DELETE behind-the-scenes,
  *   avoiding a memory leak.
  *
+ * - What "DELETE" means is up to UniquePtr's Deleter template parameter, as
+ *   with std::unique_ptr's. An empty (stateless) deleter is stored through
+ *   the empty-base optimization, so it costs no bytes: sizeof(UniquePtr<T>)
+ *   == sizeof(T *). That lets objects of hot, churning types come from an
+ *   ObjectPool, with make_pooled(), or an Arena, with make_arena(), and still
+ *   be RAII-managed.
+ *
  * History:
  * -----------------------------------------------------------------------------
  */
 #include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #if __linux__
 #include <cstring>
@@ -58,6 +72,11 @@ void test_UniquePtr_string_move_assignment(void);
 void test_star_operator(void);
 void test_arrow_operator(void);
 void test_reset(void);
+void test_UniquePtr_ebo_sizeof(void);
+void test_UniquePtr_vector_relocate(void);
+void test_UniquePtr_fn_deleter(void);
+void test_make_pooled(void);
+void test_make_arena(void);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -82,6 +101,11 @@ TEST_FNS Test_fns[] = {
     , { "test_star_operator"                , test_star_operator }
     , { "test_arrow_operator"               , test_arrow_operator }
     , { "test_reset"                        , test_reset }
+    , { "test_UniquePtr_ebo_sizeof"         , test_UniquePtr_ebo_sizeof }
+    , { "test_UniquePtr_vector_relocate"    , test_UniquePtr_vector_relocate }
+    , { "test_UniquePtr_fn_deleter"         , test_UniquePtr_fn_deleter }
+    , { "test_make_pooled"                  , test_make_pooled }
+    , { "test_make_arena"                   , test_make_arena }
 };
 
 // Test start / end info-msg macros
@@ -127,6 +151,50 @@ class UniqueIntPtr {
     int *   val_;
 };
 
+/*
+ * *****************************************************************************
+ * Deleters of UniquePtr: What it does to the object it owns, when done.
+ *
+ * DefaultDelete is plain delete. It is an empty class, as are all stateless
+ * deleters, so UniquePtr stores it in no space at all, via DeleterHolder.
+ * *****************************************************************************
+ */
+template<typename T>
+struct DefaultDelete {
+    void operator()(T *ptr) const noexcept { delete ptr; }
+};
+
+/*
+ * Holds a UniquePtr's deleter: As a base class if it's an empty class, so it
+ * takes no space, the empty-base optimization (EBO); else, e.g. a function
+ * pointer or a deleter with state, as a member.
+ */
+template<typename D, bool = (std::is_empty_v<D> && !std::is_final_v<D>)>
+class DeleterHolder : private D {
+  protected:
+    DeleterHolder() = default;
+    DeleterHolder(D deleter) noexcept : D(std::move(deleter)) { }
+
+    D& deleter() noexcept { return *this; }
+    const D& deleter() const noexcept { return *this; }
+};
+
+template<typename D>
+class DeleterHolder<D, false> {
+  protected:
+    DeleterHolder() = default;
+    DeleterHolder(D deleter) noexcept : deleter_(std::move(deleter)) { }
+
+    D& deleter() noexcept { return deleter_; }
+    const D& deleter() const noexcept { return deleter_; }
+
+  private:
+    D   deleter_{};
+};
+
+// Print UniquePtr's ctor / dtor messages; off for tests churning many objects.
+bool UniquePtr_verbose = true;
+
 /*
  * *****************************************************************************
  * Definition of generic Class UniquePtr(), which is identical to unique_ptr(),
@@ -134,50 +202,75 @@ class UniqueIntPtr {
  *
  * Class is a "resource handle" as it is managing an object for which memory
  * is allocated and the object is accessed through a pointer. [2] Sec. 5.2.1
+ *
+ * Move operations are noexcept, so that std::vector<UniquePtr> relocates its
+ * elements, on growth, by moving them, and not by copying (which is deleted).
  * *****************************************************************************
  */
-template<typename T>
-class UniquePtr {
+template<typename T, typename Deleter = DefaultDelete<T>>
+class UniquePtr : private DeleterHolder<Deleter> {
+    using Holder = DeleterHolder<Deleter>;
+
   public:
     // Default constructor, initializing to nullptr as default value
     // Add constructor with user-specified type and value
     UniquePtr(T *newval = nullptr): val_(newval) {
-        cout << __LOC__ << "Execute "
-             << ((val_ == nullptr) ? "default " : "")
-             << "ctor, this: " << this << " ";
+        if (UniquePtr_verbose) {
+            cout << __LOC__ << "Execute "
+                 << ((val_ == nullptr) ? "default " : "")
+                 << "ctor, this: " << this << " ";
+        }
     }
 
+    // Constructor with the deleter to use, e.g. one that returns the object
+    // to the pool it came from.
+    UniquePtr(T *newval, Deleter deleter) noexcept
+        : Holder(std::move(deleter)), val_(newval) { }
+
     // Copy constructor: Need to relinquish ownership from src - undefined
-    UniquePtr(const UniquePtr<T>& src) = delete;
+    UniquePtr(const UniquePtr& src) = delete;
 
     // Copy assignment: Need to relinquish ownership from src - undefined
-    UniquePtr& operator=(const UniquePtr<T>& src) = delete;
+    UniquePtr& operator=(const UniquePtr& src) = delete;
+
+    // MOVE constructor: Take over 'src's pointer, and its deleter.
+    UniquePtr(UniquePtr&& src) noexcept
+        : Holder(std::move(src.deleter())), val_(src.val_) {
+        src.val_ = nullptr;
+    }
 
     // MOVE assignment: DELETE 'src' memory after move-assignment to dest.
-    UniquePtr& operator=(UniquePtr<T>&& src) {
+    UniquePtr& operator=(UniquePtr&& src) noexcept {
         if (this != &src) {
             // Deallocate existing memory, if it exists, from this dst
-            if (val_) {
-                delete val_;
-            }
-            val_ = src.val_;
-            src.val_ = nullptr;
+            reset(src.release());
+            this->deleter() = std::move(src.deleter());
         }
         return *this;
     }
 
-    // Dereference pointer to print the value
-    T operator *() { return *val_; }
+    // Dereference pointer to the value; a reference, so it is not copied.
+    T& operator *() const { return *val_; }
 
     // UniquePtr<T> operator->() { return this; }
     auto operator->() { return this; }
 
+    explicit operator bool() const noexcept { return (val_ != nullptr); }
+
     // Reset takes a ptr to a Type that this UniquePtr points to.
-    void reset(T* newval = nullptr) {
-        if (val_) {
-            delete val_;
-        }
+    void reset(T* newval = nullptr) noexcept {
+        T *oldval = val_;
         val_ = newval;
+        if (oldval) {
+            this->deleter()(oldval);
+        }
+    }
+
+    // Give up ownership, without deleting; return the ptr.
+    T * release() noexcept {
+        T *oldval = val_;
+        val_ = nullptr;
+        return oldval;
     }
 
     void print() {
@@ -191,14 +284,18 @@ class UniquePtr {
     // Default destructor
     ~UniquePtr() {
         if (val_) {
-            cout << __LOC__ << "Invoke dtor, this: " << this << "\n";
-            delete val_;
+            if (UniquePtr_verbose) {
+                cout << __LOC__ << "Invoke dtor, this: " << this << "\n";
+            }
+            this->deleter()(val_);
             val_ = nullptr;
         }
     }
 
     // Return the ptr itself
-    T * get() { return val_; }
+    T * get() const noexcept { return val_; }
+
+    Deleter& get_deleter() noexcept { return this->deleter(); }
 
     // Return the value
     T data() {
@@ -212,6 +309,179 @@ class UniquePtr {
     T *   val_;
 };
 
+/* make_unique() for UniquePtr: new T(args...), and plain delete. */
+template<typename T, typename... Args>
+UniquePtr<T>
+make_unique_ptr(Args&&... args)
+{
+    return UniquePtr<T>(new T(std::forward<Args>(args)...), DefaultDelete<T>{});
+}
+
+/*
+ * *****************************************************************************
+ * ObjectPool<T>: Typed pool of T-sized slots, carved from slabs of
+ * 'slab_nobjs' slots, with freed slots kept on a free list. create() and
+ * destroy() are a pop / push of the free list, plus T's ctor / dtor; malloc
+ * is called once per slab, not per object. Not thread-safe.
+ * *****************************************************************************
+ */
+template<typename T>
+class ObjectPool {
+  public:
+    explicit ObjectPool(size_t slab_nobjs = 1024) : slab_nobjs_(slab_nobjs) { }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // All objects must have been destroyed, i.e. their UniquePtrs gone.
+    ~ObjectPool() {
+        assert(nlive_ == 0);
+        for (Slot *slab : slabs_) {
+            delete [] slab;
+        }
+    }
+
+    template<typename... Args>
+    T * create(Args&&... args) {
+        if (!free_) {
+            grow();
+        }
+        Slot *slot = free_;
+        free_ = slot->next;     // Before T's ctor overwrites it
+        T *obj;
+        try {
+            obj = ::new (slot->storage) T(std::forward<Args>(args)...);
+        } catch (...) {
+            slot->next = free_;
+            free_ = slot;
+            throw;
+        }
+        nlive_++;
+        return obj;
+    }
+
+    void destroy(T *obj) noexcept {
+        obj->~T();
+        Slot *slot = reinterpret_cast<Slot *>(obj);
+        slot->next = free_;
+        free_ = slot;
+        nlive_--;
+    }
+
+    size_t nlive() const { return nlive_; }
+    size_t nslabs() const { return slabs_.size(); }
+
+  private:
+    union Slot {
+        Slot *                          next;   // When free
+        alignas(T) unsigned char        storage[sizeof(T)];
+    };
+
+    void grow() {
+        Slot *slab = new Slot[slab_nobjs_];
+        for (size_t i = 0; i < slab_nobjs_; i++) {
+            slab[i].next = ((i + 1) < slab_nobjs_) ? &slab[i + 1] : free_;
+        }
+        free_ = slab;
+        slabs_.push_back(slab);
+    }
+
+    size_t              slab_nobjs_;
+    Slot *              free_ = nullptr;
+    size_t              nlive_ = 0;
+    std::vector<Slot *> slabs_;
+};
+
+/* Deleter returning the object to its ObjectPool; holds the pool's address. */
+template<typename T>
+struct PoolDelete {
+    ObjectPool<T> *     pool = nullptr;
+
+    void operator()(T *ptr) const noexcept { pool->destroy(ptr); }
+};
+
+template<typename T>
+using PooledPtr = UniquePtr<T, PoolDelete<T>>;
+
+/* make_unique() from an ObjectPool: Constructs T(args...) in a pool slot. */
+template<typename T, typename... Args>
+PooledPtr<T>
+make_pooled(ObjectPool<T>& pool, Args&&... args)
+{
+    return PooledPtr<T>(pool.create(std::forward<Args>(args)...),
+                        PoolDelete<T>{&pool});
+}
+
+/*
+ * *****************************************************************************
+ * Arena: Bump allocator of objects of any types, from blocks of
+ * 'block_size' bytes. Memory is given back only when the Arena is destroyed,
+ * all at once; so UniquePtrs to arena objects just run the dtor, and must
+ * not outlive the Arena. Not thread-safe.
+ * *****************************************************************************
+ */
+class Arena {
+  public:
+    explicit Arena(size_t block_size = (64 * 1024)) : block_size_(block_size) { }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (unsigned char *block : blocks_) {
+            ::operator delete(block);
+        }
+    }
+
+    void * allocate(size_t size, size_t align) {
+        uintptr_t cur = ((uintptr_t) next_ + (align - 1)) & ~(uintptr_t) (align - 1);
+        if (!next_ || ((cur + size) > (uintptr_t) end_)) {
+            size_t nbytes = std::max(block_size_, (size + align));
+            unsigned char *block = static_cast<unsigned char *>(::operator new(nbytes));
+            blocks_.push_back(block);
+            next_ = block;
+            end_ = (block + nbytes);
+            cur = ((uintptr_t) next_ + (align - 1)) & ~(uintptr_t) (align - 1);
+        }
+        next_ = reinterpret_cast<unsigned char *>(cur + size);
+        nbytes_ += size;
+        return reinterpret_cast<void *>(cur);
+    }
+
+    template<typename T, typename... Args>
+    T * create(Args&&... args) {
+        return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    size_t nbytes() const { return nbytes_; }
+    size_t nblocks() const { return blocks_.size(); }
+
+  private:
+    size_t                          block_size_;
+    unsigned char *                 next_ = nullptr;
+    unsigned char *                 end_ = nullptr;
+    size_t                          nbytes_ = 0;
+    std::vector<unsigned char *>    blocks_;
+};
+
+/* Deleter of arena objects: Only destructs; it is empty, so costs no bytes. */
+template<typename T>
+struct ArenaDelete {
+    void operator()(T *ptr) const noexcept { ptr->~T(); }
+};
+
+template<typename T>
+using ArenaPtr = UniquePtr<T, ArenaDelete<T>>;
+
+/* make_unique() from an Arena: Constructs T(args...) in arena memory. */
+template<typename T, typename... Args>
+ArenaPtr<T>
+make_arena(Arena& arena, Args&&... args)
+{
+    return ArenaPtr<T>(arena.create<T>(std::forward<Args>(args)...),
+                       ArenaDelete<T>{});
+}
+
 /*
  * *****************************************************************************
  * main()
@@ -490,6 +760,188 @@ test_reset(void)
     TEST_END();
 }
 
+/**
+ * *****************************************************************************
+ * Stateless deleters take no room in a UniquePtr, by the empty-base
+ * optimization; deleters with state, or function pointers, a pointer's worth.
+ * Moves are noexcept.
+ * *****************************************************************************
+ */
+void
+test_UniquePtr_ebo_sizeof(void)
+{
+    TEST_START();
+
+    static_assert(sizeof(UniquePtr<string>) == sizeof(string *));
+    static_assert(sizeof(UniquePtr<int, DefaultDelete<int>>) == sizeof(int *));
+    static_assert(sizeof(ArenaPtr<string>) == sizeof(string *));
+    static_assert(sizeof(PooledPtr<string>) == (2 * sizeof(string *)));
+    static_assert(sizeof(UniquePtr<FILE, int (*)(FILE *)>) == (2 * sizeof(FILE *)));
+
+    static_assert(std::is_nothrow_move_constructible_v<UniquePtr<string>>);
+    static_assert(std::is_nothrow_move_assignable_v<UniquePtr<string>>);
+    static_assert(std::is_nothrow_move_constructible_v<PooledPtr<string>>);
+    static_assert(!std::is_copy_constructible_v<UniquePtr<string>>);
+
+    cout << "sizeof(UniquePtr<string>)=" << sizeof(UniquePtr<string>)
+         << ", sizeof(PooledPtr<string>)=" << sizeof(PooledPtr<string>);
+
+    TEST_END();
+}
+
+/**
+ * *****************************************************************************
+ * A growing vector of UniquePtrs moves them into its new storage: The objects
+ * they own stay where they are, and none is deleted.
+ * *****************************************************************************
+ */
+void
+test_UniquePtr_vector_relocate(void)
+{
+    TEST_START();
+
+    UniquePtr_verbose = false;
+    {
+        std::vector<UniquePtr<int>> ptrs;
+        std::vector<int *> addrs;
+        for (int i = 0; i < 1000; i++) {
+            ptrs.push_back(make_unique_ptr<int>(i));
+            addrs.push_back(ptrs.back().get());
+        }
+        for (int i = 0; i < 1000; i++) {
+            assert(ptrs[i].get() == addrs[i]);
+            assert(*ptrs[i] == i);
+        }
+
+        // Move-assigning frees the old object of the target.
+        ptrs[0] = std::move(ptrs[1]);
+        assert(!ptrs[1]);
+        assert(*ptrs[0] == 1);
+    }
+    UniquePtr_verbose = true;
+
+    TEST_END();
+}
+
+/**
+ * *****************************************************************************
+ * A function pointer as the deleter: fclose() a FILE * when done.
+ * *****************************************************************************
+ */
+void
+test_UniquePtr_fn_deleter(void)
+{
+    TEST_START();
+
+    UniquePtr<FILE, int (*)(FILE *)> fp(fopen("/dev/null", "w"), fclose);
+    assert(fp);
+    assert(fp.get_deleter() == fclose);
+    fprintf(fp.get(), "Hello World.\n");
+
+    UniquePtr<FILE, int (*)(FILE *)> fp2 = std::move(fp);
+    assert(!fp && fp2);
+
+    TEST_END();
+}
+
+struct PoolOrder {
+    uint64_t    id;
+    double      price;
+    string      symbol;
+
+    PoolOrder(uint64_t id, double price, string symbol)
+        : id(id), price(price), symbol(std::move(symbol)) { }
+};
+
+/**
+ * *****************************************************************************
+ * Churn of short-lived objects through an ObjectPool: One slab serves them
+ * all, and every object goes back to the pool when its PooledPtr is gone.
+ * Prints the cost per object against new / delete'd UniquePtrs.
+ * *****************************************************************************
+ */
+void
+test_make_pooled(void)
+{
+    TEST_START();
+
+    constexpr int nobjs = (1000 * 1000);
+    UniquePtr_verbose = false;
+
+    ObjectPool<PoolOrder> pool(64);
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nobjs; i++) {
+        PooledPtr<PoolOrder> order = make_pooled(pool, i, 1.5, "ACME");
+        sum += order.get()->id;
+    }
+    double pool_ns = (std::chrono::duration<double, std::nano>(
+                            std::chrono::steady_clock::now() - start).count() / nobjs);
+    assert(sum == ((uint64_t) nobjs * (nobjs - 1) / 2));
+    assert(pool.nslabs() == 1);
+    assert(pool.nlive() == 0);
+
+    sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nobjs; i++) {
+        UniquePtr<PoolOrder> order = make_unique_ptr<PoolOrder>(i, 1.5, "ACME");
+        sum += order.get()->id;
+    }
+    double heap_ns = (std::chrono::duration<double, std::nano>(
+                            std::chrono::steady_clock::now() - start).count() / nobjs);
+    assert(sum == ((uint64_t) nobjs * (nobjs - 1) / 2));
+
+    // Objects alive together spread over slabs; all return to the pool.
+    {
+        std::vector<PooledPtr<PoolOrder>> orders;
+        for (int i = 0; i < 200; i++) {
+            orders.push_back(make_pooled(pool, i, 2.5, "ACME"));
+        }
+        assert(pool.nlive() == 200);
+        assert(pool.nslabs() == 4);
+    }
+    assert(pool.nlive() == 0);
+    UniquePtr_verbose = true;
+
+    cout << "pool " << pool_ns << " ns/object, heap " << heap_ns << " ns/object";
+    TEST_END();
+}
+
+/**
+ * *****************************************************************************
+ * Objects in an Arena: ArenaPtrs run their dtors; the memory is released all
+ * at once, with the Arena.
+ * *****************************************************************************
+ */
+void
+test_make_arena(void)
+{
+    TEST_START();
+
+    UniquePtr_verbose = false;
+    Arena arena(4096);
+    {
+        std::vector<ArenaPtr<string>> strs;
+        for (int i = 0; i < 1000; i++) {
+            strs.push_back(make_arena<string>(arena, "A string long enough to "
+                                                     "be heap-allocated, #"
+                                                     + to_string(i)));
+        }
+        for (int i = 0; i < 1000; i++) {
+            assert(ends_with(*strs[i], ("#" + to_string(i))));
+        }
+        ArenaPtr<uint64_t> num = make_arena<uint64_t>(arena, 42);
+        assert(*num == 42);
+        assert(((uintptr_t) num.get() % alignof(uint64_t)) == 0);
+    }
+    assert(arena.nbytes() == ((1000 * sizeof(string)) + sizeof(uint64_t)));
+    assert(arena.nblocks() > 1);
+    UniquePtr_verbose = true;
+
+    cout << "nbytes=" << arena.nbytes() << ", nblocks=" << arena.nblocks();
+    TEST_END();
+}
+
 void
 test_template(void)
 {
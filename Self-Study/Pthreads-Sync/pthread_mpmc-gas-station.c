@@ -0,0 +1,580 @@
+/*
+ * Lock-free MPMC Ring: Gas Station example, without mutex / condvar.
+ *
+ * Same gas station as pthread_condvar-gas-station.c, where NUM_FILLERS
+ * threads fill fuel which NUM_CARS threads draw. There, all threads contend
+ * on one mutex, and every fill broadcasts the condvar, waking all waiting
+ * cars, of which all but one just go back to sleep: a thundering herd.
+ *
+ * Here, the tank is a bounded, lock-free, multi-producer multi-consumer ring
+ * of fuel deliveries (Vyukov's bounded MPMC queue): Each cell carries a
+ * sequence # which tells producers and consumers, racing on enqueue_pos /
+ * dequeue_pos via compare-and-swap, if the cell is ready for them. Threads
+ * only sleep when the ring is empty (cars) or full (fillers), parked on a
+ * futex; each enqueue / dequeue wakes at most one parked thread, and only if
+ * there are any, so the fast path makes no system calls.
+ *
+ * Ref:
+ *  - https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ *  - Futexes Are Tricky, Ulrich Drepper.
+ *
+ * Usage: gcc -O2 -pthread -o pthread_mpmc-gas-station pthread_mpmc-gas-station.c
+ *        ./pthread_mpmc-gas-station                  # Gas station demo
+ *        ./pthread_mpmc-gas-station --bench [ <nitems> [ <max-threads> ] ]
+ *
+ * --bench removes the sleep()s, and reports ops/sec of passing 'nitems'
+ * through the ring, and through a mutex / condvar ring like the original
+ * program's, for 1 .. max-threads fillers and as many cars.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/* Configuration */
+#define NUM_FILL_LOOPS            5  // Fill gas tank n-times
+#define AMOUNT_FILLED_PER_LOOP   15
+
+// Each car draws this much fuel from the tank
+#define MIN_FUEL_AVAILABLE       40
+
+// # of threads filling gas tank
+#define NUM_FILLERS              3
+
+// # of cars drawing fuel at on time. (Think lanes)
+#define NUM_CARS                 8
+
+// Total # of threads in the system
+#define NUM_THREADS     (NUM_FILLERS + NUM_CARS)
+
+// # of fuel deliveries the tank can hold; must be a power of 2.
+#define TANK_CAPACITY           64
+
+#define MILLION         (1000 * 1000)
+#define CACHE_LINE      64
+
+// Benchmark defaults
+#define BENCH_NITEMS        (4 * MILLION)
+#define BENCH_MAX_THREADS   8
+#define BENCH_RING_SIZE     1024
+
+// # of times to retry a full / empty ring, spinning and then yielding the
+// CPU, before parking on the futex. Yielding lets the other side run when
+// threads outnumber CPUs, rather than paying a futex wait and wake per item.
+#define MPMC_SPIN_TRIES     64
+#define MPMC_YIELD_TRIES    16
+
+const char *Usage = "%s [ --help | --bench [ <nitems> [ <max-threads> ] ] ]\n";
+
+/*
+ * -----------------------------------------------------------------------------
+ * Lock-free bounded MPMC ring.
+ *
+ * Cell i's sequence # starts as i. A producer that claims position 'pos'
+ * may write cell (pos & mask) once its seq == pos, and then publishes it by
+ * setting seq = pos + 1. A consumer that claims 'pos' may read the cell once
+ * its seq == pos + 1, and then frees it for the producer of the next lap by
+ * setting seq = pos + capacity. A seq behind what a thread expects means the
+ * ring is full (producer) or empty (consumer).
+ *
+ * Producer and consumer positions, and the futex words of each side, are on
+ * their own cache lines so producers and consumers don't false-share.
+ * -----------------------------------------------------------------------------
+ */
+typedef struct mpmc_cell
+{
+    _Atomic size_t  seq;
+    int             value;
+} MPMC_CELL;
+
+typedef struct mpmc_ring
+{
+    MPMC_CELL *     cells;
+    size_t          mask;
+
+    _Alignas(CACHE_LINE) _Atomic size_t enqueue_pos;
+    _Alignas(CACHE_LINE) _Atomic size_t dequeue_pos;
+
+    // Parking: Each is a futex word, bumped to wake waiters, and a count of
+    // threads that are, or are about to be, waiting on it.
+    _Alignas(CACHE_LINE) _Atomic uint32_t not_empty;
+    _Atomic uint32_t                      nwait_not_empty;
+    _Alignas(CACHE_LINE) _Atomic uint32_t not_full;
+    _Atomic uint32_t                      nwait_not_full;
+} MPMC_RING;
+
+// Function Prototypes
+int  mpmc_init(MPMC_RING *ring, size_t capacity);
+void mpmc_destroy(MPMC_RING *ring);
+bool mpmc_try_enqueue(MPMC_RING *ring, int value);
+bool mpmc_try_dequeue(MPMC_RING *ring, int *value);
+void mpmc_enqueue(MPMC_RING *ring, int value);
+int  mpmc_dequeue(MPMC_RING *ring);
+
+void *fuel_filling(void *arg);
+void *car(void *arg);
+int   gas_station(void);
+int   bench(int nitems, int max_threads);
+double now_secs(void);
+
+static long
+futex(_Atomic uint32_t *uaddr, int op, uint32_t val)
+{
+    return syscall(SYS_futex, (uint32_t *) uaddr, op, val, NULL, NULL, 0);
+}
+
+static inline void
+cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// 'capacity' must be a power of 2. Returns 0 on success, else errno.
+int
+mpmc_init(MPMC_RING *ring, size_t capacity)
+{
+    if ((capacity < 2) || (capacity & (capacity - 1))) {
+        return EINVAL;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->cells = malloc(capacity * sizeof(*ring->cells));
+    if (!ring->cells) {
+        return ENOMEM;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&ring->cells[i].seq, i);
+    }
+    ring->mask = (capacity - 1);
+    return 0;
+}
+
+void
+mpmc_destroy(MPMC_RING *ring)
+{
+    free(ring->cells);
+    ring->cells = NULL;
+}
+
+// Returns false, without waiting, if the ring is full.
+bool
+mpmc_try_enqueue(MPMC_RING *ring, int value)
+{
+    MPMC_CELL *cell;
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t   seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = ((intptr_t) seq - (intptr_t) pos);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, (pos + 1),
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+            // CAS failure reloaded 'pos'.
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    cell->value = value;
+    atomic_store_explicit(&cell->seq, (pos + 1), memory_order_release);
+    return true;
+}
+
+// Returns false, without waiting, if the ring is empty.
+bool
+mpmc_try_dequeue(MPMC_RING *ring, int *value)
+{
+    MPMC_CELL *cell;
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t   seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = ((intptr_t) seq - (intptr_t) (pos + 1));
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, (pos + 1),
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    *value = cell->value;
+    atomic_store_explicit(&cell->seq, (pos + ring->mask + 1), memory_order_release);
+    return true;
+}
+
+/*
+ * Wake one thread parked on 'word', if any are. The fence orders the
+ * caller's enqueue / dequeue before the load of 'nwaiters', pairing with the
+ * waiter's increment of 'nwaiters' before it re-checks the ring; so either
+ * the waiter sees the change, or we see the waiter.
+ */
+static inline void
+mpmc_wake_one(_Atomic uint32_t *word, _Atomic uint32_t *nwaiters)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(nwaiters, memory_order_relaxed)) {
+        atomic_fetch_add(word, 1);
+        futex(word, FUTEX_WAKE_PRIVATE, 1);
+    }
+}
+
+// Enqueue 'value', parking while the ring is full.
+void
+mpmc_enqueue(MPMC_RING *ring, int value)
+{
+    for (int tries = 0; !mpmc_try_enqueue(ring, value); tries++) {
+        if (tries < MPMC_SPIN_TRIES) {
+            cpu_relax();
+            continue;
+        }
+        if (tries < (MPMC_SPIN_TRIES + MPMC_YIELD_TRIES)) {
+            sched_yield();
+            continue;
+        }
+        uint32_t word = atomic_load(&ring->not_full);
+        atomic_fetch_add(&ring->nwait_not_full, 1);
+        if (mpmc_try_enqueue(ring, value)) {
+            atomic_fetch_sub(&ring->nwait_not_full, 1);
+            break;
+        }
+        // Sleeps only if no dequeue has bumped 'not_full' since we read it.
+        futex(&ring->not_full, FUTEX_WAIT_PRIVATE, word);
+        atomic_fetch_sub(&ring->nwait_not_full, 1);
+    }
+    mpmc_wake_one(&ring->not_empty, &ring->nwait_not_empty);
+}
+
+// Dequeue a value, parking while the ring is empty.
+int
+mpmc_dequeue(MPMC_RING *ring)
+{
+    int value;
+    for (int tries = 0; !mpmc_try_dequeue(ring, &value); tries++) {
+        if (tries < MPMC_SPIN_TRIES) {
+            cpu_relax();
+            continue;
+        }
+        if (tries < (MPMC_SPIN_TRIES + MPMC_YIELD_TRIES)) {
+            sched_yield();
+            continue;
+        }
+        uint32_t word = atomic_load(&ring->not_empty);
+        atomic_fetch_add(&ring->nwait_not_empty, 1);
+        if (mpmc_try_dequeue(ring, &value)) {
+            atomic_fetch_sub(&ring->nwait_not_empty, 1);
+            break;
+        }
+        futex(&ring->not_empty, FUTEX_WAIT_PRIVATE, word);
+        atomic_fetch_sub(&ring->nwait_not_empty, 1);
+    }
+    mpmc_wake_one(&ring->not_full, &ring->nwait_not_full);
+    return value;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * Gas station demo.
+ * -----------------------------------------------------------------------------
+ */
+MPMC_RING  Tank;
+_Atomic int Cars_done = 0;
+
+/*
+ * Producer: Deliver fuel into the tank, NUM_FILL_LOOPS times per round, till
+ * all cars are done.
+ */
+void *
+fuel_filling(void *arg)
+{
+    int thread_id = *(int *) arg;
+    while (atomic_load(&Cars_done) < NUM_CARS) {
+        for (int i = 0; i < NUM_FILL_LOOPS; i++) {
+            mpmc_enqueue(&Tank, AMOUNT_FILLED_PER_LOOP);
+            printf("[PumpID=%d] Filled fuel=%d\n", thread_id, AMOUNT_FILLED_PER_LOOP);
+            sleep(1);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Consumer: Draw deliveries from the tank till the car has its fuel; any
+ * surplus of the last delivery goes back into the tank.
+ */
+void *
+car(void *arg)
+{
+    int thread_id = *(int *) arg;
+    int got = 0;
+    while (got < MIN_FUEL_AVAILABLE) {
+        int fuel = mpmc_dequeue(&Tank);
+        got += fuel;
+        printf("[Car ID=%d] Drew fuel=%d, have %d of %d\n",
+               thread_id, fuel, got, MIN_FUEL_AVAILABLE);
+    }
+    if (got > MIN_FUEL_AVAILABLE) {
+        mpmc_enqueue(&Tank, (got - MIN_FUEL_AVAILABLE));
+    }
+    printf("[Car ID=%d] **** Got fuel=%d, returned fuel=%d. Exiting.\n",
+           thread_id, MIN_FUEL_AVAILABLE, (got - MIN_FUEL_AVAILABLE));
+    atomic_fetch_add(&Cars_done, 1);
+    return NULL;
+}
+
+int
+gas_station(void)
+{
+    pthread_t th[NUM_THREADS]   = {0};
+    int       tid[NUM_THREADS]  = {0};
+    if (mpmc_init(&Tank, TANK_CAPACITY) != 0) {
+        perror("Failed to initialize fuel tank");
+        return 1;
+    }
+
+    int tctr = 0;
+    // Start the set of car-threads, so some of them will wait before the
+    // threads that start filling fuel tanks start-up
+    for (int i = 0; i < NUM_CARS; i++, tctr++) {
+        tid[tctr] = tctr;
+        if (pthread_create(&th[tctr], NULL, &car, (void *) &tid[tctr]) != 0) {
+            perror("Failed to create thread for car pulling fuel");
+            return 1;
+        }
+    }
+
+    // Start n-threads filling up the fuel tank
+    for (int i = 0; i < NUM_FILLERS; i++, tctr++) {
+        tid[tctr] = tctr;
+        if (pthread_create(&th[tctr], NULL, &fuel_filling, (void *) &tid[tctr]) != 0) {
+            perror("Failed to create fuel-filling thread");
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        if (pthread_join(th[i], NULL) != 0) {
+            perror("Failed to join thread");
+        }
+    }
+
+    // Fuel left over in the tank.
+    int left = 0;
+    int fuel;
+    while (mpmc_try_dequeue(&Tank, &fuel)) {
+        left += fuel;
+    }
+    printf("All %d cars filled; fuel left in tank=%d\n", NUM_CARS, left);
+    mpmc_destroy(&Tank);
+    return 0;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * Benchmark: 'nproducers' threads push 'nitems' ints, in all, through a ring
+ * to 'nconsumers' threads, with no sleep()s. Run on the MPMC ring, and on a
+ * ring guarded by a mutex and condvar which is broadcast on each change, as
+ * the original gas station does.
+ * -----------------------------------------------------------------------------
+ */
+typedef struct locked_ring
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    int *           values;
+    size_t          capacity;
+    size_t          head;
+    size_t          count;
+} LOCKED_RING;
+
+static void
+locked_enqueue(LOCKED_RING *ring, int value)
+{
+    pthread_mutex_lock(&ring->mutex);
+    while (ring->count == ring->capacity) {
+        pthread_cond_wait(&ring->cond, &ring->mutex);
+    }
+    ring->values[(ring->head + ring->count++) % ring->capacity] = value;
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->mutex);
+}
+
+static int
+locked_dequeue(LOCKED_RING *ring)
+{
+    pthread_mutex_lock(&ring->mutex);
+    while (ring->count == 0) {
+        pthread_cond_wait(&ring->cond, &ring->mutex);
+    }
+    int value = ring->values[ring->head];
+    ring->head = ((ring->head + 1) % ring->capacity);
+    ring->count--;
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->mutex);
+    return value;
+}
+
+typedef struct bench_arg
+{
+    MPMC_RING *     mpmc;       // One of 'mpmc' or 'locked' is used
+    LOCKED_RING *   locked;
+    int             first;      // Producer: Values [first, first + nitems)
+    int             nitems;
+    long            sum;        // Consumer: Sum of values dequeued
+} BENCH_ARG;
+
+static void *
+bench_producer(void *arg)
+{
+    BENCH_ARG *barg = (BENCH_ARG *) arg;
+    for (int i = barg->first; i < (barg->first + barg->nitems); i++) {
+        if (barg->mpmc) {
+            mpmc_enqueue(barg->mpmc, i);
+        } else {
+            locked_enqueue(barg->locked, i);
+        }
+    }
+    return NULL;
+}
+
+static void *
+bench_consumer(void *arg)
+{
+    BENCH_ARG *barg = (BENCH_ARG *) arg;
+    long sum = 0;
+    for (int i = 0; i < barg->nitems; i++) {
+        sum += (barg->mpmc ? mpmc_dequeue(barg->mpmc) : locked_dequeue(barg->locked));
+    }
+    barg->sum = sum;
+    return NULL;
+}
+
+/*
+ * Run one benchmark; returns elapsed seconds, or -1 if items were lost or
+ * duplicated.
+ */
+static double
+bench_run(MPMC_RING *mpmc, LOCKED_RING *locked, int nitems, int nthreads)
+{
+    pthread_t producers[nthreads];
+    pthread_t consumers[nthreads];
+    BENCH_ARG pargs[nthreads];
+    BENCH_ARG cargs[nthreads];
+
+    double start = now_secs();
+    int per_thread = (nitems / nthreads);
+    for (int tctr = 0; tctr < nthreads; tctr++) {
+        cargs[tctr] = (BENCH_ARG) { mpmc, locked, 0, per_thread, 0 };
+        pargs[tctr] = (BENCH_ARG) { mpmc, locked, (tctr * per_thread), per_thread, 0 };
+        pthread_create(&consumers[tctr], NULL, bench_consumer, &cargs[tctr]);
+        pthread_create(&producers[tctr], NULL, bench_producer, &pargs[tctr]);
+    }
+    long sum = 0;
+    for (int tctr = 0; tctr < nthreads; tctr++) {
+        pthread_join(producers[tctr], NULL);
+        pthread_join(consumers[tctr], NULL);
+        sum += cargs[tctr].sum;
+    }
+    double secs = (now_secs() - start);
+
+    long n = ((long) per_thread * nthreads);
+    long exp_sum = ((n * (n - 1)) / 2);
+    return ((sum == exp_sum) ? secs : -1);
+}
+
+int
+bench(int nitems, int max_threads)
+{
+    if ((nitems <= 0) || (max_threads <= 0)) {
+        printf("Error: Need nitems > 0 and max-threads > 0.\n");
+        return 1;
+    }
+    MPMC_RING   mpmc;
+    LOCKED_RING locked;
+    if (mpmc_init(&mpmc, BENCH_RING_SIZE) != 0) {
+        return 1;
+    }
+    pthread_mutex_init(&locked.mutex, NULL);
+    pthread_cond_init(&locked.cond, NULL);
+    locked.values = malloc(BENCH_RING_SIZE * sizeof(*locked.values));
+    locked.capacity = BENCH_RING_SIZE;
+    locked.head = locked.count = 0;
+    if (!locked.values) {
+        return 1;
+    }
+
+    printf("%d items, ring of %d, %ld CPUs\n", nitems, BENCH_RING_SIZE,
+           sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-9s %-9s %18s %18s %8s\n", "Fillers", "Cars",
+           "Mutex+condvar", "Lock-free MPMC", "Speedup");
+
+    int rv = 0;
+    // 1, 2, 4, ... threads, ending with max_threads.
+    for (int nthreads = 1; ;
+         nthreads = (((2 * nthreads) < max_threads) ? (2 * nthreads) : max_threads)) {
+        double locked_secs = bench_run(NULL, &locked, nitems, nthreads);
+        double mpmc_secs = bench_run(&mpmc, NULL, nitems, nthreads);
+        if ((locked_secs < 0) || (mpmc_secs < 0)) {
+            printf("Error: Items lost or duplicated with %d threads.\n", nthreads);
+            rv = 1;
+            break;
+        }
+        int n = ((nitems / nthreads) * nthreads);
+        printf("%-9d %-9d %12.2f Mops/s %12.2f Mops/s %7.1fx\n",
+               nthreads, nthreads, (n / locked_secs / MILLION),
+               (n / mpmc_secs / MILLION), (locked_secs / mpmc_secs));
+        if (nthreads == max_threads) {
+            break;
+        }
+    }
+
+    free(locked.values);
+    pthread_cond_destroy(&locked.cond);
+    pthread_mutex_destroy(&locked.mutex);
+    mpmc_destroy(&mpmc);
+    return rv;
+}
+
+// Wall-clock time, in seconds.
+double
+now_secs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+int
+main(int argc, char * argv[])
+{
+    if (argc == 1) {
+        return gas_station();
+    }
+    if (strcmp("--bench", argv[1]) == 0) {
+        int nitems = ((argc > 2) ? atoi(argv[2]) : BENCH_NITEMS);
+        int max_threads = ((argc > 3) ? atoi(argv[3]) : BENCH_MAX_THREADS);
+        return bench(nitems, max_threads);
+    }
+    printf(Usage, argv[0]);
+    return (strcmp("--help", argv[1]) == 0) ? 0 : 1;
+}
@@ -0,0 +1,562 @@
+/**
+ * bench_fns.h : Micro-benchmark runner, alongside the TEST_FNS test-runner
+ * of the template programs. Header-only, for C and C++ programs.
+ *
+ * A program lists its benchmarks in a BENCH_FNS table, as it does its tests
+ * in Test_fns[], and hands bench_<prefix> arguments to bench_main():
+ *
+ *  void bench_this(uint64_t nops);         // Do the operation 'nops' times
+ *
+ *  BENCH_FNS Bench_fns[] = {
+ *        { "bench_this"    , bench_this, 0 }   // nops calibrated
+ *      , { "bench_that"    , bench_that, 1 }   // nops fixed, here 1 per rep
+ *  };
+ *  ...
+ *  // Banner to stderr when benchmarking, so stdout has only the results.
+ *  fprintf((BENCH_ARGV(argc, argv) ? stderr : stdout), "%s: ...\n", argv[0]);
+ *  ...
+ *  } else if (BENCH_ARGV(argc, argv)) {
+ *      rv = bench_main(Bench_fns, ARRAYSIZE(Bench_fns), (argc - 1), &argv[1]);
+ *
+ *  $ ./prog bench_<name-or-prefix> [ --reps <n> ] [ --warmup <n> ]
+ *                                  [ --min-ms <ms> ] [ --tsc ] [ --no-counters ]
+ *                                  [ --json <file> | - ]
+ *
+ * Each benchmark is run as:
+ *
+ *  - Calibration, unless its table entry fixes bfn_nops: nops is grown till
+ *    one call of bfn(nops) takes --min-ms (default 1 ms), so that the
+ *    timer's own cost and resolution are lost in the noise.
+ *  - --warmup untimed reps (default 2), to fault in memory and warm caches
+ *    and branch predictors.
+ *  - --reps timed reps (default 31), each one call of bfn(nops), timed with
+ *    CLOCK_MONOTONIC, or, with --tsc, the timestamp counter (x86 only; its
+ *    ticks are converted to ns by a rate measured once against the clock).
+ *
+ * and reported as ns / op of its fastest, median and p99 reps (nearest rank;
+ * with the default 31 reps, p99 is the slowest rep). The min is the best
+ * estimate of the cost of the code; the spread up to the p99 is its noise.
+ *
+ * Hardware counters: On Linux, cycles, instructions, cache-misses and
+ * branch-misses are counted, user-space only, through perf_event_open(), as
+ * one group across all timed reps, and reported per op. Where the kernel or
+ * a VM does not allow it, or with --no-counters, they are reported as n/a,
+ * or null in JSON. Counts are scaled if the kernel multiplexed the group.
+ *
+ * --json writes all results, as one JSON object, to <file>, or to stdout for
+ * '-', in place of the table. Then nothing else may go to stdout: A program
+ * prints its banner, and anything else, to stderr when BENCH_ARGV().
+ *
+ * A benchmark should keep its results live, so the compiler does not delete
+ * the work; BENCH_KEEP(value) does so without a store to memory. Its inputs
+ * should be opaque, so the compiler does not fold the work to a constant,
+ * e.g. strlen() of a literal; BENCH_OPAQUE(var) does so.
+ *
+ * History:
+ *  10/2026 - Started
+ */
+#ifndef __BENCH_FNS_H__
+#define __BENCH_FNS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>      // For __rdtsc(), _mm_lfence()
+#define BENCH_HAVE_TSC 1
+#endif
+
+#if __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+// Whether argv[1] is bench_<name-or-prefix>, i.e. to call bench_main().
+#define BENCH_ARGV(argc, argv)                                          \
+    (((argc) > 1) && (strncmp("bench_", (argv)[1], strlen("bench_")) == 0))
+
+// Defaults of the command-line options.
+#define Bench_def_nwarmup       2
+#define Bench_def_nreps         31
+#define Bench_def_min_rep_ns    (1000 * 1000)
+
+// Calibration gives up doubling nops here.
+#define Bench_max_nops          (1ULL << 40)
+
+// Hardware counters, in the order they are reported.
+#define BENCH_NCOUNTERS         4
+
+static const char *Bench_counter_names[BENCH_NCOUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+// Keep 'value' live, and opaque to the optimizer, at no cost.
+#define BENCH_KEEP(value)   __asm__ __volatile__("" : : "r,m"(value) : "memory")
+
+// Make the optimizer forget what it knows of the value of variable 'var', so
+// work on it is not folded to a constant, or hoisted out of the loop.
+#define BENCH_OPAQUE(var)   __asm__ __volatile__("" : "+r,m"(var) : : "memory")
+
+// Make the optimizer assume all memory was read and written.
+#define BENCH_CLOBBER()     __asm__ __volatile__("" : : : "memory")
+
+/* List of benchmark functions one can invoke from the command-line */
+typedef struct bench_fns
+{
+    const char *    bfn_name;
+    void            (*bfn)(uint64_t nops);
+    uint64_t        bfn_nops;           // Per rep; 0 to calibrate
+} BENCH_FNS;
+
+typedef struct bench_opts
+{
+    uint32_t        nwarmup;
+    uint32_t        nreps;
+    uint64_t        min_rep_ns;
+    int             use_tsc;
+    int             use_counters;
+    const char *    json_path;          // NULL: Print a table
+} BENCH_OPTS;
+
+/* One benchmark's results; times are ns / op. */
+typedef struct bench_result
+{
+    const char *    name;
+    uint64_t        nops;               // Per rep
+    uint32_t        nreps;
+    double          min_ns;
+    double          median_ns;
+    double          p99_ns;
+    double          mean_ns;
+    double          counters[BENCH_NCOUNTERS];  // Per op; < 0 if n/a
+} BENCH_RESULT;
+
+/* Hardware counters of one benchmark: A perf_event group. */
+typedef struct bench_counters
+{
+    int             fds[BENCH_NCOUNTERS];       // -1 if not opened
+    int             leader;                     // fds[] index of group leader
+} BENCH_COUNTERS;
+
+static inline void
+bench_default_opts(BENCH_OPTS *opts)
+{
+    memset(opts, 0, sizeof(*opts));
+    opts->nwarmup = Bench_def_nwarmup;
+    opts->nreps = Bench_def_nreps;
+    opts->min_rep_ns = Bench_def_min_rep_ns;
+    opts->use_counters = 1;
+}
+
+// ---- Timers ----
+
+static inline uint64_t
+bench_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+static inline uint64_t
+bench_tsc(void)
+{
+#ifdef BENCH_HAVE_TSC
+    _mm_lfence();           // Don't let rdtsc start before earlier work is done
+    return __rdtsc();
+#else
+    return bench_clock_ns();
+#endif
+}
+
+/* TSC ticks per ns, measured once, over 20 ms, against the clock. */
+static inline double
+bench_tsc_per_ns(void)
+{
+    static double tsc_per_ns = 0;
+    if (tsc_per_ns == 0) {
+        uint64_t start_ns = bench_clock_ns();
+        uint64_t start_tsc = bench_tsc();
+        while ((bench_clock_ns() - start_ns) < (20 * 1000 * 1000)) {
+        }
+        uint64_t elapsed_ns = (bench_clock_ns() - start_ns);
+        tsc_per_ns = ((double) (bench_tsc() - start_tsc) / elapsed_ns);
+    }
+    return tsc_per_ns;
+}
+
+/* Time of one call of fn(nops), in ns. */
+static inline double
+bench_time_rep(void (*fn)(uint64_t), uint64_t nops, int use_tsc)
+{
+#ifdef BENCH_HAVE_TSC
+    if (use_tsc) {
+        uint64_t start = bench_tsc();
+        fn(nops);
+        return ((bench_tsc() - start) / bench_tsc_per_ns());
+    }
+#endif
+    (void) use_tsc;
+    uint64_t start = bench_clock_ns();
+    fn(nops);
+    return (double) (bench_clock_ns() - start);
+}
+
+// ---- Hardware counters ----
+
+/*
+ * Open what counters we can, disabled, as a group led by the first one to
+ * open. Returns # of counters opened.
+ */
+static inline int
+bench_counters_open(BENCH_COUNTERS *ctrs)
+{
+    int nopen = 0;
+    ctrs->leader = -1;
+    for (int cctr = 0; cctr < BENCH_NCOUNTERS; cctr++) {
+        ctrs->fds[cctr] = -1;
+    }
+#if __linux__
+    static const uint64_t configs[BENCH_NCOUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (int cctr = 0; cctr < BENCH_NCOUNTERS; cctr++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[cctr];
+        attr.disabled = (ctrs->leader < 0);     // Leader starts the group
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = (PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+                            | PERF_FORMAT_TOTAL_TIME_RUNNING);
+        int group_fd = ((ctrs->leader < 0) ? -1 : ctrs->fds[ctrs->leader]);
+        int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+        if (fd < 0) {
+            continue;
+        }
+        ctrs->fds[cctr] = fd;
+        if (ctrs->leader < 0) {
+            ctrs->leader = cctr;
+        }
+        nopen++;
+    }
+#endif // __linux__
+    return nopen;
+}
+
+static inline void
+bench_counters_start(BENCH_COUNTERS *ctrs)
+{
+#if __linux__
+    if (ctrs->leader >= 0) {
+        int fd = ctrs->fds[ctrs->leader];
+        ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    (void) ctrs;
+#endif // __linux__
+}
+
+/* Stop counting; set counts[] to the counts over 'nops', per op, or -1. */
+static inline void
+bench_counters_stop(BENCH_COUNTERS *ctrs, uint64_t nops, double *counts)
+{
+    for (int cctr = 0; cctr < BENCH_NCOUNTERS; cctr++) {
+        counts[cctr] = -1;
+    }
+#if __linux__
+    if (ctrs->leader < 0) {
+        return;
+    }
+    int fd = ctrs->fds[ctrs->leader];
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // { nr, time_enabled, time_running, values[nr] }, in group order
+    uint64_t buf[3 + BENCH_NCOUNTERS];
+    if (read(fd, buf, sizeof(buf)) < (ssize_t) (3 * sizeof(uint64_t))) {
+        return;
+    }
+    double scale = (buf[2] ? ((double) buf[1] / buf[2]) : 0);
+    uint64_t vctr = 0;
+    for (int cctr = 0; (cctr < BENCH_NCOUNTERS) && (vctr < buf[0]); cctr++) {
+        if ((ctrs->fds[cctr] >= 0) && (scale > 0)) {
+            counts[cctr] = ((buf[3 + vctr] * scale) / nops);
+        }
+        vctr += (ctrs->fds[cctr] >= 0);
+    }
+#else
+    (void) nops;
+#endif // __linux__
+}
+
+static inline void
+bench_counters_close(BENCH_COUNTERS *ctrs)
+{
+#if __linux__
+    for (int cctr = 0; cctr < BENCH_NCOUNTERS; cctr++) {
+        if (ctrs->fds[cctr] >= 0) {
+            close(ctrs->fds[cctr]);
+        }
+    }
+#else
+    (void) ctrs;
+#endif // __linux__
+}
+
+// ---- Running, and statistics ----
+
+static inline int
+bench_cmp_double(const void *lhs, const void *rhs)
+{
+    double l = *(const double *) lhs;
+    double r = *(const double *) rhs;
+    return ((l > r) - (l < r));
+}
+
+/*
+ * Fill in result's min, median, p99 and mean of 'nreps' rep times, ns / op.
+ * Sorts rep_ns[].
+ */
+static inline void
+bench_stats(double *rep_ns, uint32_t nreps, BENCH_RESULT *result)
+{
+    qsort(rep_ns, nreps, sizeof(*rep_ns), bench_cmp_double);
+    double sum = 0;
+    for (uint32_t rctr = 0; rctr < nreps; rctr++) {
+        sum += rep_ns[rctr];
+    }
+    result->nreps = nreps;
+    result->min_ns = rep_ns[0];
+    result->median_ns = ((nreps % 2) ? rep_ns[nreps / 2]
+                         : ((rep_ns[(nreps / 2) - 1] + rep_ns[nreps / 2]) / 2));
+
+    // Nearest rank: The smallest time >= 99% of all times.
+    uint32_t p99_rank = (uint32_t) (((uint64_t) nreps * 99 + 99) / 100);
+    result->p99_ns = rep_ns[p99_rank - 1];
+    result->mean_ns = (sum / nreps);
+}
+
+/*
+ * nops for a rep of fn() to take at least min_rep_ns. A first, untimed call
+ * runs any one-time setup the benchmark does lazily, e.g. making its input;
+ * and each guess is timed, so a slow call, e.g. one that allocates, does not
+ * leave nops too low.
+ */
+static inline uint64_t
+bench_calibrate(void (*fn)(uint64_t), uint64_t min_rep_ns, int use_tsc)
+{
+    fn(1);
+
+    uint64_t nops = 1;
+    while (nops < Bench_max_nops) {
+        double rep_ns = bench_time_rep(fn, nops, use_tsc);
+        if (rep_ns >= min_rep_ns) {
+            break;
+        }
+        // Jump close to the target, with 10% to spare, once a rep takes
+        // measurable time.
+        uint64_t guess = 0;
+        if (rep_ns > (min_rep_ns / 16)) {
+            guess = (uint64_t) ((nops * 1.1 * min_rep_ns / rep_ns) + 1);
+        }
+        nops = ((guess > nops) ? guess : (nops * 2));
+    }
+    return nops;
+}
+
+/* Run one benchmark, by 'opts'. Returns 0, or -1 if out of memory. */
+static inline int
+bench_run_one(const BENCH_FNS *bfn, const BENCH_OPTS *opts, BENCH_RESULT *result)
+{
+    double *rep_ns = (double *) malloc(opts->nreps * sizeof(*rep_ns));
+    if (!rep_ns) {
+        return -1;
+    }
+    memset(result, 0, sizeof(*result));
+    result->name = bfn->bfn_name;
+    result->nops = (bfn->bfn_nops ? bfn->bfn_nops
+                    : bench_calibrate(bfn->bfn, opts->min_rep_ns, opts->use_tsc));
+
+    for (uint32_t rctr = 0; rctr < opts->nwarmup; rctr++) {
+        bfn->bfn(result->nops);
+    }
+
+    BENCH_COUNTERS ctrs;
+    if (opts->use_counters) {
+        bench_counters_open(&ctrs);
+    } else {
+        ctrs.leader = -1;
+    }
+    bench_counters_start(&ctrs);
+    for (uint32_t rctr = 0; rctr < opts->nreps; rctr++) {
+        rep_ns[rctr] = (bench_time_rep(bfn->bfn, result->nops, opts->use_tsc)
+                        / result->nops);
+    }
+    bench_counters_stop(&ctrs, (opts->nreps * result->nops), result->counters);
+    if (opts->use_counters) {
+        bench_counters_close(&ctrs);
+    }
+
+    bench_stats(rep_ns, opts->nreps, result);
+    free(rep_ns);
+    return 0;
+}
+
+// ---- Reporting ----
+
+static inline void
+bench_print_result(const BENCH_RESULT *result)
+{
+    printf("%-32s nops=%-10lu min=%10.2f median=%10.2f p99=%10.2f ns/op",
+           result->name, (unsigned long) result->nops,
+           result->min_ns, result->median_ns, result->p99_ns);
+
+    const double *counts = result->counters;
+    if (counts[0] >= 0) {
+        printf("  cycles=%.1f", counts[0]);
+        if (counts[1] >= 0) {
+            printf(" instrs=%.1f IPC=%.2f", counts[1],
+                   (counts[0] ? (counts[1] / counts[0]) : 0));
+        }
+        for (int cctr = 2; cctr < BENCH_NCOUNTERS; cctr++) {
+            if (counts[cctr] >= 0) {
+                printf(" %s=%.3f", Bench_counter_names[cctr], counts[cctr]);
+            }
+        }
+    } else {
+        printf("  counters=n/a");
+    }
+    printf("\n");
+}
+
+static inline void
+bench_fprint_json(FILE *fp, const BENCH_RESULT *results, int nresults,
+                  const BENCH_OPTS *opts)
+{
+    fprintf(fp, "{\n  \"timer\": \"%s\",\n  \"nwarmup\": %u,\n  \"nreps\": %u,\n"
+            "  \"benchmarks\": [\n",
+            (opts->use_tsc ? "tsc" : "clock_monotonic"),
+            opts->nwarmup, opts->nreps);
+    for (int bctr = 0; bctr < nresults; bctr++) {
+        const BENCH_RESULT *result = &results[bctr];
+        fprintf(fp, "    { \"name\": \"%s\", \"nops\": %lu, \"nreps\": %u, "
+                "\"min_ns\": %.3f, \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+                "\"mean_ns\": %.3f",
+                result->name, (unsigned long) result->nops, result->nreps,
+                result->min_ns, result->median_ns, result->p99_ns,
+                result->mean_ns);
+        for (int cctr = 0; cctr < BENCH_NCOUNTERS; cctr++) {
+            if (result->counters[cctr] >= 0) {
+                fprintf(fp, ", \"%s\": %.3f", Bench_counter_names[cctr],
+                        result->counters[cctr]);
+            } else {
+                fprintf(fp, ", \"%s\": null", Bench_counter_names[cctr]);
+            }
+        }
+        fprintf(fp, " }%s\n", ((bctr < (nresults - 1)) ? "," : ""));
+    }
+    fprintf(fp, "  ]\n}\n");
+}
+
+/*
+ * Parse options, argv[1 ...], into 'opts'. argv[0] is the bench_<prefix>.
+ * Returns 0, or -1 on a bad option.
+ */
+static inline int
+bench_parse_args(int argc, const char *argv[], BENCH_OPTS *opts)
+{
+    bench_default_opts(opts);
+    for (int argi = 1; argi < argc; argi++) {
+        const char *arg = argv[argi];
+        int has_value = (argi < (argc - 1));
+        if (!strcmp(arg, "--reps") && has_value) {
+            opts->nreps = (uint32_t) atoi(argv[++argi]);
+        } else if (!strcmp(arg, "--warmup") && has_value) {
+            opts->nwarmup = (uint32_t) atoi(argv[++argi]);
+        } else if (!strcmp(arg, "--min-ms") && has_value) {
+            opts->min_rep_ns = ((uint64_t) atoi(argv[++argi]) * 1000 * 1000);
+        } else if (!strcmp(arg, "--json") && has_value) {
+            opts->json_path = argv[++argi];
+        } else if (!strcmp(arg, "--tsc")) {
+#ifdef BENCH_HAVE_TSC
+            opts->use_tsc = 1;
+#else
+            fprintf(stderr, "--tsc: No timestamp counter; using the clock\n");
+#endif
+        } else if (!strcmp(arg, "--no-counters")) {
+            opts->use_counters = 0;
+        } else {
+            fprintf(stderr, "Unknown bench option: '%s'\n", arg);
+            return -1;
+        }
+    }
+    if (opts->nreps < 1) {
+        opts->nreps = 1;
+    }
+    if (opts->min_rep_ns < 1) {
+        opts->min_rep_ns = 1;
+    }
+    return 0;
+}
+
+/*
+ * Run all benchmarks in fns[] whose names start with argv[0], by the options
+ * in argv[1 ...], then print or write their results.  Returns 0, or 1 if none
+ * matched or an option is bad.
+ */
+static inline int
+bench_main(const BENCH_FNS *fns, int nfns, int argc, const char *argv[])
+{
+    BENCH_OPTS opts;
+    if (bench_parse_args(argc, argv, &opts)) {
+        return 1;
+    }
+    BENCH_RESULT *results = (BENCH_RESULT *) calloc(nfns, sizeof(*results));
+    if (!results) {
+        return 1;
+    }
+    int nresults = 0;
+    for (int bctr = 0; bctr < nfns; bctr++) {
+        if (strncmp(fns[bctr].bfn_name, argv[0], strlen(argv[0]))) {
+            continue;
+        }
+        if (bench_run_one(&fns[bctr], &opts, &results[nresults])) {
+            break;
+        }
+        if (!opts.json_path) {
+            bench_print_result(&results[nresults]);
+        }
+        nresults++;
+    }
+
+    int rv = 0;
+    if (!nresults) {
+        printf("Warning: Named bench-function '%s' not found.\n", argv[0]);
+        rv = 1;
+    } else if (opts.json_path) {
+        int to_stdout = !strcmp(opts.json_path, "-");
+        FILE *fp = (to_stdout ? stdout : fopen(opts.json_path, "w"));
+        if (fp) {
+            bench_fprint_json(fp, results, nresults, &opts);
+            if (!to_stdout) {
+                fclose(fp);
+            }
+        } else {
+            perror(opts.json_path);
+            rv = 1;
+        }
+    }
+    free(results);
+    return rv;
+}
+
+#endif // __BENCH_FNS_H__
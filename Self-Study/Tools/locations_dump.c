@@ -9,6 +9,10 @@
  *   Run: $ ./locations_dump ./locations_dump
  *        $ ./locations_dump ./locations_example
  *
+ * Decode a trace file, written by trace_ring.c from a run of the binary:
+ *
+ *        $ ./locations_dump ./trace_example --trace trace_example.trace [ <npairs> ]
+ *
  * Note: The final output that is displayed after some parsing by
  * dump_loc_ids() is also obtained by:
  *
@@ -25,6 +29,7 @@
  *
  * History:
  *  3/2024  - Restarted; to get something working on Linux-VM
+ *  10/2026 - Decode trace files of trace_ring.h
  */
 #include <stdio.h>
 #include <stdint.h>     // uint32_t etc.
@@ -33,18 +38,13 @@
 #include <unistd.h>     // For file read(), close() etc.
 #include <string.h>     // For strncmp() etc.
 #include <stdbool.h>    // For _Bool
+#include <sys/mman.h>   // For mmap() of trace files
+#include <sys/stat.h>   // For fstat()
 #include <libelf.h>     // For ELF apis: elf_begin(), elf_kind() etc.
 #include <gelf.h>       // For ELF apis: GElf_Shdr{}, gelf_getshdr() etc.
 
-// Define the struct location
-struct location
-{
-    const char *const   fn;
-    const char *const   file;
-    const uint32_t      line;
-    const uint32_t      spare;      // Compiler pad-bytes
-    const uint64_t      spare2;     // Compiler pad-bytes
-};
+// struct location, and the trace file format
+#include "trace_ring.h"
 
 /* Is 'str2' equal to null-terminated string 'str1'? */
 #define STR_EQ(str1, str2)  (strncmp(str1, str2, strlen(str1)) == 0)
@@ -57,20 +57,15 @@ struct location
 #define IS_REQD_SECTION(name)       STR_EQ(REQD_SECTION_NAME, (name))
 #define IS_RODATA_SECTION(name)     STR_EQ(RODATA_SECTION_NAME, (name))
 
-// Tracing macros
-
-#define STRINGIFY(x)       #x
-#define STRINGIFY_VALUE(s) STRINGIFY(s)
-
-// Fabricate a string to track code-location of call-site.
-#define __LOC__     "[" __FILE__ ":" STRINGIFY_VALUE(__LINE__) "]"
-
 // Function prototypes
 _Bool print_this_section(const char *name);
 void prGElf_Shdr(const GElf_Shdr *shdr, Elf_Scn *scn, const char *name);
 void prSection_details(const char *name, Elf_Scn *scn, GElf_Shdr *shdr);
 void readSection_data(char *buffer, Elf_Scn *scn, GElf_Shdr *shdr);
 void hexdump(const void* data, size_t size, size_t sh_addr);
+int decode_trace(const char *trace_file, const struct location *locs,
+                 uint32_t nlocs, const char *rodata_buf, size_t rodata_addr,
+                 size_t rodata_size, int npairs);
 
 /**
  * *****************************************************************************
@@ -113,7 +108,8 @@ dump_loc_ids(struct location *loc_id_ref, size_t count,
         size_t file_offset = (intptr_t) loc_id_ref[i].file;
         printf("%zu\tfn=0x%lx, \tfile=0x%lx, \tline=%u",
                 i, func_offset, file_offset, loc_id_ref[i].line);
-        if (extract_data) {
+        // loc_id_ref itself is all zeros, and has no strings.
+        if (extract_data && func_offset && file_offset) {
             printf(" fn='%s', file='%s'",
                    (rodata_buf + (func_offset - rodata_addr)),
                    (rodata_buf + (file_offset - rodata_addr)));
@@ -122,6 +118,365 @@ dump_loc_ids(struct location *loc_id_ref, size_t count,
     }
 }
 
+/**
+ * *****************************************************************************
+ * Trace decoder: Map the records of a trace file written by trace_ring.c to
+ * their call-sites, through the loc_ids section of the traced binary, and
+ * report:
+ *
+ *  - Per location: # of events, and a histogram of the latency since the
+ *    previous event of the same thread, i.e. of the code path leading to it.
+ *  - Per pair of locations, {previous event -> this event} on a thread:
+ *    # of times, and min / avg / ~p50 / ~p99 / max latency.
+ *
+ * The trace is mmap()'ed and scanned once, sequentially; each record costs
+ * an array index for its location and, mostly, a hit on the last pair seen.
+ * Latencies are bucketed by log2(ns), so percentiles are upper bounds of
+ * their bucket, i.e. within 2x.
+ * *****************************************************************************
+ */
+#define TRACE_NBUCKETS          64      // log2(ns) buckets; [0] is 0 ns
+#define TRACE_DEF_NPAIRS        20      // # of most frequent pairs to print
+#define TRACE_PAIRS_INIT_SIZE   1024    // Initial # of pair hash-table slots
+
+typedef struct lat_stats
+{
+    uint64_t    count;
+    uint64_t    sum_ns;
+    uint64_t    min_ns;
+    uint64_t    max_ns;
+    uint64_t    buckets[TRACE_NBUCKETS];
+} LAT_STATS;
+
+typedef struct loc_stats
+{
+    uint64_t    nevents;
+    LAT_STATS   since_prev;     // Of events that had a previous one
+} LOC_STATS;
+
+typedef struct pair_stats
+{
+    uint64_t    key;            // (from * nlocs + to + 1); 0 if slot is free
+    uint32_t    from;
+    uint32_t    to;
+    LAT_STATS   lat;
+} PAIR_STATS;
+
+typedef struct pair_table
+{
+    PAIR_STATS *slots;
+    size_t      size;           // Power-of-2
+    size_t      nused;
+} PAIR_TABLE;
+
+static inline void
+lat_add(LAT_STATS *lat, uint64_t ns)
+{
+    if (!lat->count || (ns < lat->min_ns)) {
+        lat->min_ns = ns;
+    }
+    if (ns > lat->max_ns) {
+        lat->max_ns = ns;
+    }
+    lat->count++;
+    lat->sum_ns += ns;
+    // Bucket [b] holds [2^(b-1), 2^b) ns; the last one, all above that.
+    int b = (ns ? (64 - __builtin_clzll(ns)) : 0);
+    lat->buckets[(b < TRACE_NBUCKETS) ? b : (TRACE_NBUCKETS - 1)]++;
+}
+
+/* Upper bound of bucket holding the 'pct' percentile latency. */
+static uint64_t
+lat_percentile(const LAT_STATS *lat, double pct)
+{
+    uint64_t rank = (uint64_t) (pct * lat->count);
+    uint64_t seen = 0;
+    for (int b = 0; b < TRACE_NBUCKETS; b++) {
+        seen += lat->buckets[b];
+        if (seen > rank) {
+            uint64_t upper = (b ? ((1ULL << b) - 1) : 0);
+            return ((upper < lat->max_ns) ? upper : lat->max_ns);
+        }
+    }
+    return lat->max_ns;
+}
+
+static PAIR_STATS *
+pair_find(PAIR_TABLE *table, uint64_t key)
+{
+    size_t mask = (table->size - 1);
+    size_t slot = ((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (table->slots[slot].key && (table->slots[slot].key != key)) {
+        slot = ((slot + 1) & mask);
+    }
+    return &table->slots[slot];
+}
+
+/* Stats of pair {from -> to}, adding it if new. Returns NULL if no memory. */
+static PAIR_STATS *
+pair_lookup(PAIR_TABLE *table, uint32_t from, uint32_t to, uint32_t nlocs)
+{
+    uint64_t key = (((uint64_t) from * nlocs) + to + 1);
+    PAIR_STATS *pair = pair_find(table, key);
+    if (pair->key) {
+        return pair;
+    }
+    // Keep load under 1/2; rehash into a table twice the size.
+    if ((2 * (table->nused + 1)) > table->size) {
+        PAIR_TABLE bigger = { NULL, (2 * table->size), table->nused };
+        if ((bigger.slots = calloc(bigger.size, sizeof(PAIR_STATS))) == NULL) {
+            return NULL;
+        }
+        for (size_t i = 0; i < table->size; i++) {
+            if (table->slots[i].key) {
+                *pair_find(&bigger, table->slots[i].key) = table->slots[i];
+            }
+        }
+        free(table->slots);
+        *table = bigger;
+        pair = pair_find(table, key);
+    }
+    pair->key = key;
+    pair->from = from;
+    pair->to = to;
+    table->nused++;
+    return pair;
+}
+
+/*
+ * Print 'fn file:line' of location # 'idx' into 'buf'. Strings are looked up
+ * in .rodata, as in dump_loc_ids(); index 'nlocs' is for unknown ids.
+ */
+static const char *
+loc_name(char *buf, size_t buflen, uint32_t idx,
+         const struct location *locs, uint32_t nlocs,
+         const char *rodata_buf, size_t rodata_addr, size_t rodata_size)
+{
+    if (idx >= nlocs) {
+        snprintf(buf, buflen, "<unknown-id>");
+        return buf;
+    }
+    size_t fn_addr = (intptr_t) locs[idx].fn;
+    size_t file_addr = (intptr_t) locs[idx].file;
+    if (!rodata_buf
+        || (fn_addr < rodata_addr) || (fn_addr >= (rodata_addr + rodata_size))
+        || (file_addr < rodata_addr) || (file_addr >= (rodata_addr + rodata_size))) {
+        snprintf(buf, buflen, "fn=0x%lx file=0x%lx:%u",
+                 fn_addr, file_addr, locs[idx].line);
+    } else {
+        snprintf(buf, buflen, "%s() %s:%u",
+                 (rodata_buf + (fn_addr - rodata_addr)),
+                 (rodata_buf + (file_addr - rodata_addr)), locs[idx].line);
+    }
+    return buf;
+}
+
+// qsort() comparators: Most frequent first; their arg is via these globals.
+static LOC_STATS *Sort_locs;
+
+static int
+cmp_locs_by_count(const void *a, const void *b)
+{
+    uint64_t na = Sort_locs[*(const uint32_t *) a].nevents;
+    uint64_t nb = Sort_locs[*(const uint32_t *) b].nevents;
+    return ((na < nb) - (na > nb));
+}
+
+static int
+cmp_pairs_by_count(const void *a, const void *b)
+{
+    uint64_t na = (*(PAIR_STATS *const *) a)->lat.count;
+    uint64_t nb = (*(PAIR_STATS *const *) b)->lat.count;
+    return ((na < nb) - (na > nb));
+}
+
+/**
+ * decode_trace(): Decode trace file 'trace_file', using 'nlocs' location
+ * entries 'locs' of the loc_ids section of the traced binary, and print the
+ * 'npairs' most frequent pairs.
+ *
+ * Returns 0 on success, -1 on bad or unreadable trace file.
+ */
+int
+decode_trace(const char *trace_file, const struct location *locs,
+             uint32_t nlocs, const char *rodata_buf, size_t rodata_addr,
+             size_t rodata_size, int npairs)
+{
+    int fd = open(trace_file, O_RDONLY);
+    if (fd < 0) {
+        perror(trace_file);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || ((size_t) st.st_size < sizeof(TRACE_FILE_HDR))) {
+        fprintf(stderr, "%s: '%s' is too short for a trace file.\n",
+                __LOC__, trace_file);
+        close(fd);
+        return -1;
+    }
+    size_t file_size = st.st_size;
+    const char *base = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    madvise((void *) base, file_size, MADV_SEQUENTIAL);
+
+    int rv = -1;
+    LOC_STATS *loc_stats = NULL;
+    PAIR_TABLE pairs = { NULL, TRACE_PAIRS_INIT_SIZE, 0 };
+    PAIR_STATS **sorted_pairs = NULL;
+    uint32_t *sorted_locs = NULL;
+
+    const TRACE_FILE_HDR *hdr = (const TRACE_FILE_HDR *) base;
+    if (memcmp(hdr->magic, TRACE_FILE_MAGIC, sizeof(hdr->magic))
+        || (hdr->version != TRACE_FILE_VERSION)
+        || (hdr->rec_size != sizeof(TRACE_REC))) {
+        fprintf(stderr, "%s: '%s' is not a version %d trace file.\n",
+                __LOC__, trace_file, TRACE_FILE_VERSION);
+        goto out;
+    }
+    double ns_per_tick = (hdr->ticks_per_sec ? (1e9 / hdr->ticks_per_sec) : 1.0);
+    uint32_t nrings = hdr->nrings;
+    uint64_t ticks_per_sec = hdr->ticks_per_sec;
+
+    // One more slot, [nlocs], for ids not in the loc_ids section.
+    loc_stats = calloc((nlocs + 1), sizeof(LOC_STATS));
+    pairs.slots = calloc(pairs.size, sizeof(PAIR_STATS));
+    if (!loc_stats || !pairs.slots) {
+        fprintf(stderr, "%s: Out of memory.\n", __LOC__);
+        goto out;
+    }
+
+    uint64_t nevents = 0;
+    const char *curr = (base + sizeof(*hdr));
+    for (uint32_t rctr = 0; rctr < nrings; rctr++) {
+        const TRACE_RING_HDR *ring_hdr = (const TRACE_RING_HDR *) curr;
+        if (((curr + sizeof(*ring_hdr)) > (base + file_size))
+            || (ring_hdr->nrecords
+                    > (((base + file_size) - (curr + sizeof(*ring_hdr)))
+                            / sizeof(TRACE_REC)))) {
+            fprintf(stderr, "%s: Ring %u of '%s' is truncated.\n",
+                    __LOC__, rctr, trace_file);
+            goto out;
+        }
+        const TRACE_REC *recs = (const TRACE_REC *) (curr + sizeof(*ring_hdr));
+        curr = (const char *) (recs + ring_hdr->nrecords);
+
+        uint32_t prev = 0;
+        PAIR_STATS *pair = NULL;
+        for (uint64_t i = 0; i < ring_hdr->nrecords; i++) {
+            // Location ids are offsets from loc_id_ref, which is at
+            // loc_id_ref_offset in the section: Make that an index.
+            int64_t offset = ((int64_t) recs[i].loc_id + hdr->loc_id_ref_offset);
+            uint32_t idx = ((offset >= 0) && ((offset / sizeof(struct location)) < nlocs))
+                                ? (uint32_t) (offset / sizeof(struct location))
+                                : nlocs;
+            loc_stats[idx].nevents++;
+            if (i) {
+                // TSCs of CPUs may be out of sync a little, across a
+                // migration of the thread; count going back as 0 ns.
+                uint64_t ns = ((recs[i].tsc > recs[i - 1].tsc)
+                                ? (uint64_t) ((recs[i].tsc - recs[i - 1].tsc)
+                                                * ns_per_tick)
+                                : 0);
+                lat_add(&loc_stats[idx].since_prev, ns);
+                if (!pair || (pair->from != prev) || (pair->to != idx)) {
+                    if ((pair = pair_lookup(&pairs, prev, idx, (nlocs + 1))) == NULL) {
+                        fprintf(stderr, "%s: Out of memory.\n", __LOC__);
+                        goto out;
+                    }
+                }
+                lat_add(&pair->lat, ns);
+            }
+            prev = idx;
+        }
+        nevents += ring_hdr->nrecords;
+    }
+    munmap((void *) base, file_size);
+    base = NULL;
+
+    printf("\n%s: Trace '%s': %lu events in %u rings, %lu ticks / sec\n",
+           __LOC__, trace_file, nevents, nrings, ticks_per_sec);
+
+    // Locations, most frequent first, with the log2 latency histogram.
+    char name[256];
+    sorted_locs = malloc((nlocs + 1) * sizeof(uint32_t));
+    sorted_pairs = malloc((pairs.nused + 1) * sizeof(PAIR_STATS *));
+    if (!sorted_locs || !sorted_pairs) {
+        fprintf(stderr, "%s: Out of memory.\n", __LOC__);
+        goto out;
+    }
+    for (uint32_t i = 0; i <= nlocs; i++) {
+        sorted_locs[i] = i;
+    }
+    Sort_locs = loc_stats;
+    qsort(sorted_locs, (nlocs + 1), sizeof(uint32_t), cmp_locs_by_count);
+
+    printf("\n%10s %6s %10s %10s  %s\n",
+           "Events", "%", "~p50 ns", "~p99 ns", "Location");
+    for (uint32_t i = 0; i <= nlocs; i++) {
+        const LOC_STATS *loc = &loc_stats[sorted_locs[i]];
+        if (!loc->nevents) {
+            break;
+        }
+        printf("%10lu %6.2f %10lu %10lu  %s\n", loc->nevents,
+               (100.0 * loc->nevents / nevents),
+               lat_percentile(&loc->since_prev, 0.50),
+               lat_percentile(&loc->since_prev, 0.99),
+               loc_name(name, sizeof(name), sorted_locs[i], locs, nlocs,
+                        rodata_buf, rodata_addr, rodata_size));
+
+        // Histogram, by ranges of ns since previous event: [lo, hi) count
+        printf("%29s", "");
+        for (int b = 0; b < TRACE_NBUCKETS; b++) {
+            if (loc->since_prev.buckets[b]) {
+                printf(" [%lu,%lu):%lu", (uint64_t) (b ? (1ULL << (b - 1)) : 0),
+                       (uint64_t) (b ? (1ULL << b) : 1),
+                       loc->since_prev.buckets[b]);
+            }
+        }
+        printf("\n");
+    }
+
+    // Pairs of events, most frequent first.
+    size_t nsorted = 0;
+    for (size_t i = 0; i < pairs.size; i++) {
+        if (pairs.slots[i].key) {
+            sorted_pairs[nsorted++] = &pairs.slots[i];
+        }
+    }
+    qsort(sorted_pairs, nsorted, sizeof(PAIR_STATS *), cmp_pairs_by_count);
+
+    printf("\n%10s %10s %10s %10s %10s %10s  %s\n",
+           "Count", "min ns", "avg ns", "~p50 ns", "~p99 ns", "max ns",
+           "Previous event -> Event");
+    for (size_t i = 0; (i < nsorted) && ((int) i < npairs); i++) {
+        const LAT_STATS *lat = &sorted_pairs[i]->lat;
+        char to_name[256];
+        printf("%10lu %10lu %10lu %10lu %10lu %10lu  %s -> %s\n",
+               lat->count, lat->min_ns, (lat->sum_ns / lat->count),
+               lat_percentile(lat, 0.50), lat_percentile(lat, 0.99),
+               lat->max_ns,
+               loc_name(name, sizeof(name), sorted_pairs[i]->from, locs, nlocs,
+                        rodata_buf, rodata_addr, rodata_size),
+               loc_name(to_name, sizeof(to_name), sorted_pairs[i]->to, locs,
+                        nlocs, rodata_buf, rodata_addr, rodata_size));
+    }
+    rv = 0;
+
+out:
+    if (base) {
+        munmap((void *) base, file_size);
+    }
+    free(sorted_pairs);
+    free(sorted_locs);
+    free(pairs.slots);
+    free(loc_stats);
+    return rv;
+}
+
 /**
  * *****************************************************************************
  * main() begins here.
@@ -130,8 +485,16 @@ dump_loc_ids(struct location *loc_id_ref, size_t count,
 int
 main(const int argc, const char *argv[])
 {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <binary_file>\n", argv[0]);
+    const char *trace_file = NULL;
+    int npairs = TRACE_DEF_NPAIRS;
+    if ((argc >= 4) && (strcmp(argv[2], "--trace") == 0)) {
+        trace_file = argv[3];
+        if (argc > 4) {
+            npairs = atoi(argv[4]);
+        }
+    } else if (argc != 2) {
+        fprintf(stderr, "Usage: %s <binary_file> [ --trace <trace_file> [ <npairs> ] ]\n",
+                argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -176,6 +539,9 @@ main(const int argc, const char *argv[])
     Elf_Scn *scn = NULL;
     char *rodata_buf = NULL;
     size_t rodata_addr = 0;
+    size_t rodata_size = 0;
+    struct location *locs = NULL;   // loc_ids section, to decode a trace
+    uint32_t nlocs = 0;
     char *name = NULL;
     while ((scn = elf_nextscn(elf, scn)) != NULL) {
 
@@ -196,9 +562,20 @@ main(const int argc, const char *argv[])
             rodata_buf = (char *)malloc(shdr.sh_size);
             readSection_data(rodata_buf, scn, &shdr);
             rodata_addr = shdr.sh_addr;
+            rodata_size = shdr.sh_size;
 
-            prGElf_Shdr(&shdr, scn, name);
-            hexdump(rodata_buf, shdr.sh_size, rodata_addr);
+            if (!trace_file) {
+                prGElf_Shdr(&shdr, scn, name);
+                hexdump(rodata_buf, shdr.sh_size, rodata_addr);
+            }
+        } else if (IS_REQD_SECTION(name) && trace_file) {
+            // Index the section once, as an array of locations.
+            if ((locs = malloc(shdr.sh_size)) == NULL) {
+                fprintf(stderr, "%s: Out of memory.\n", __LOC__);
+                return EXIT_FAILURE;
+            }
+            readSection_data((char *) locs, scn, &shdr);
+            nlocs = (shdr.sh_size / sizeof(struct location));
         } else if (IS_REQD_SECTION(name)) {
 
             int nloc_id_entries = 0;
@@ -218,13 +595,26 @@ main(const int argc, const char *argv[])
         }
     }
 
+    int rv = 0;
+    if (trace_file) {
+        if (!locs) {
+            fprintf(stderr, "%s: '%s' has no %s section.\n",
+                    __LOC__, binary_file, REQD_SECTION_NAME);
+            rv = EXIT_FAILURE;
+        } else if (decode_trace(trace_file, locs, nlocs, rodata_buf,
+                                rodata_addr, rodata_size, npairs)) {
+            rv = EXIT_FAILURE;
+        }
+    }
+
     // Cleanup.
     if (rodata_buf) {
         free(rodata_buf);
     }
+    free(locs);
     elf_end(elf);
     close(fd);
-    return 0;
+    return rv;
 }
 
 /**
@@ -0,0 +1,173 @@
+/**
+ * A demo of trace_ring.h: A few threads trace events from a couple of
+ * call-sites, the rings are dumped on SIGUSR1 and at exit, and the dump is
+ * read back to check it.
+ *
+ * Call-sites of trace levels and categories that are compiled out, or
+ * disabled at run-time, sit in the same loops; the read-back check, that
+ * args count up by 1, fails if any of them traced.
+ *
+ * Build: gcc -O2 -o trace_example trace_example.c trace_ring.c locations.c -pthread
+ * Usage: ./trace_example [ <trace-file> [ <nthreads> [ <nevents-per-thread> ] ] ]
+ *
+ * The trace file can be decoded with locations_dump.
+ *
+ * History:
+ *  10/2026 - Started
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+
+// Trace categories of this program
+#define TRACE_CAT_MAIN          0x02u
+#define TRACE_CAT_WORKER        0x04u
+#define TRACE_CAT_SPARE         0x08u   // Disabled at run-time
+#define TRACE_CAT_COLD          0x10u   // Compiled out
+
+// Compile in INFO and above, except for TRACE_CAT_COLD.
+#define TRACE_LEVEL             TRACE_LEVEL_INFO
+#define TRACE_CATEGORIES        (TRACE_CAT_ALL & ~TRACE_CAT_COLD)
+
+#include "trace_ring.h"
+
+#define TRACE_RING_NRECORDS     (16 * 1024)
+
+typedef struct worker_args
+{
+    uint64_t    nevents;
+} WORKER_ARGS;
+
+// Function prototypes
+void *worker(void *arg);
+int check_trace_file(const char *path, uint32_t nthreads, uint64_t nevents);
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+int
+main(const int argc, const char *argv[])
+{
+    const char *path = ((argc > 1) ? argv[1] : "trace_example.trace");
+    uint32_t nthreads = ((argc > 2) ? atoi(argv[2]) : 4);
+    uint64_t nevents = ((argc > 3) ? atoll(argv[3]) : (1000 * 1000));
+
+    if (trace_init(path, TRACE_RING_NRECORDS, SIGUSR1)) {
+        perror("trace_init");
+        return EXIT_FAILURE;
+    }
+
+    // Cost of an event, single-threaded, once the ring is attached.
+    TRACE(0);
+    uint64_t start_ns = now_ns();
+    for (uint64_t i = 0; i < nevents; i++) {
+        TRACE(i);
+    }
+    double ns_per_event = ((double) (now_ns() - start_ns) / nevents);
+    printf("%s: %lu events, %.2f ns / event\n", __LOC__, nevents, ns_per_event);
+
+    // Same, through a call-site filtered by its category at run-time.
+    start_ns = now_ns();
+    for (uint64_t i = 0; i < nevents; i++) {
+        TRACE_INFO(TRACE_CAT_MAIN, (nevents + i));
+        TRACE_DEBUG(TRACE_CAT_MAIN, 0);        // Compiled out: level
+        TRACE_INFO(TRACE_CAT_COLD, 0);         // Compiled out: category
+    }
+    ns_per_event = ((double) (now_ns() - start_ns) / nevents);
+    printf("%s: %lu TRACE_INFO() events, %.2f ns / event\n",
+           __LOC__, nevents, ns_per_event);
+
+    trace_set_categories(TRACE_CAT_ALL & ~TRACE_CAT_SPARE);
+
+    pthread_t threads[nthreads];
+    WORKER_ARGS args[nthreads];
+    for (uint32_t tctr = 0; tctr < nthreads; tctr++) {
+        args[tctr].nevents = nevents;
+        pthread_create(&threads[tctr], NULL, worker, &args[tctr]);
+    }
+    for (uint32_t tctr = 0; tctr < nthreads; tctr++) {
+        pthread_join(threads[tctr], NULL);
+    }
+
+    // Dump as a signal would, and check it: main() + nthreads rings.
+    raise(SIGUSR1);
+    int rv = check_trace_file(path, (nthreads + 1), nevents);
+    printf("%s: Trace file '%s' %s\n", __LOC__, path, (rv ? "BAD" : "OK"));
+    return (rv ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/* Trace pairs of begin / end events, 'arg' being the event #. */
+void *
+worker(void *arg)
+{
+    WORKER_ARGS *args = arg;
+    for (uint64_t i = 0; i < args->nevents; i += 2) {
+        TRACE(i);
+        TRACE_INFO(TRACE_CAT_SPARE, 0);        // Disabled at run-time
+        TRACE_ERROR(TRACE_CAT_WORKER, (i + 1));
+    }
+    return NULL;
+}
+
+/*
+ * Read back the trace file: Expect 'nrings' rings, each holding the last
+ * TRACE_RING_NRECORDS of its events, with args counting up by 1 and
+ * non-decreasing timestamps.
+ */
+int
+check_trace_file(const char *path, uint32_t nrings, uint64_t nevents)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    int rv = -1;
+    TRACE_FILE_HDR hdr;
+    if ((fread(&hdr, sizeof(hdr), 1, fp) != 1)
+        || memcmp(hdr.magic, TRACE_FILE_MAGIC, sizeof(hdr.magic))
+        || (hdr.rec_size != sizeof(TRACE_REC)) || (hdr.nrings != nrings)) {
+        fprintf(stderr, "%s: Bad trace file header\n", __LOC__);
+        goto out;
+    }
+    printf("%s: %u rings, %lu ticks / sec\n", __LOC__, hdr.nrings,
+           hdr.ticks_per_sec);
+
+    static TRACE_REC recs[TRACE_RING_NRECORDS];
+    for (uint32_t rctr = 0; rctr < hdr.nrings; rctr++) {
+        TRACE_RING_HDR ring_hdr;
+        if ((fread(&ring_hdr, sizeof(ring_hdr), 1, fp) != 1)
+            || (ring_hdr.nrecords > TRACE_RING_NRECORDS)
+            || (fread(recs, sizeof(TRACE_REC), ring_hdr.nrecords, fp)
+                    != ring_hdr.nrecords)) {
+            fprintf(stderr, "%s: Truncated ring %u\n", __LOC__, rctr);
+            goto out;
+        }
+        if ((ring_hdr.nevents < nevents)
+            || (ring_hdr.nrecords != TRACE_RING_NRECORDS)) {
+            fprintf(stderr, "%s: Ring %u: nevents=%lu, nrecords=%lu\n",
+                    __LOC__, rctr, ring_hdr.nevents, ring_hdr.nrecords);
+            goto out;
+        }
+        for (uint64_t i = 1; i < ring_hdr.nrecords; i++) {
+            if ((recs[i].arg != (recs[i - 1].arg + 1))
+                || (recs[i].tsc < recs[i - 1].tsc)) {
+                fprintf(stderr, "%s: Ring %u: Bad record %lu\n",
+                        __LOC__, rctr, i);
+                goto out;
+            }
+        }
+    }
+    rv = 0;
+out:
+    fclose(fp);
+    return rv;
+}
@@ -0,0 +1,239 @@
+/**
+ * trace_ring.c: Per-thread trace rings, and dumping them to a trace file.
+ *
+ * Rings are allocated on a thread's first event and pushed, lock-free, onto
+ * a global list, from which trace_dump() writes them out. Rings are never
+ * freed, so the last events of threads that have exited are dumped, too.
+ *
+ * trace_dump() uses only async-signal-safe calls, open(), write() and
+ * clock_gettime(), so it can run from a signal handler. A dump taken while
+ * threads are tracing may catch the oldest record of a running thread's
+ * ring being overwritten; the decoder sees that as one stray record.
+ *
+ * History:
+ *  10/2026 - Started
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "trace_ring.h"
+
+__thread TRACE_RING *Trace_my_ring = NULL;
+
+uint32_t            Trace_enabled_categories = TRACE_CAT_ALL;
+
+static TRACE_RING  *Trace_rings = NULL;     // All rings, newest first
+static uint32_t     Trace_nrecords = Trace_ring_def_nrecords;
+static char         Trace_path[256];        // Where to dump at exit / signal
+
+// Start of timestamps, to measure TSC ticks / sec at dump time
+static uint64_t     Trace_start_tsc;
+static uint64_t     Trace_start_ns;
+
+#if !__APPLE__
+// Start of the 'loc_ids' section; defined by the GNU linker.
+extern struct location __start_loc_ids[];
+#endif  // !__APPLE__
+
+static uint64_t
+trace_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+static void __attribute__((constructor))
+trace_start(void)
+{
+    Trace_start_ns = trace_now_ns();
+    Trace_start_tsc = trace_tsc();
+}
+
+static void
+trace_dump_at_exit(void)
+{
+    trace_dump(Trace_path);
+}
+
+static void
+trace_dump_on_signal(int signo)
+{
+    (void) signo;
+    int saved_errno = errno;
+    trace_dump(Trace_path);
+    errno = saved_errno;
+}
+
+/**
+ * trace_init(): Set up dumping of all threads' rings to 'path' at exit, and,
+ * if 'dump_signo' is non-zero, on that signal. 'nrecords' sizes the rings of
+ * threads that have not traced yet; 0 means Trace_ring_def_nrecords.
+ *
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int
+trace_init(const char *path, uint32_t nrecords, int dump_signo)
+{
+    if (!path || (strlen(path) >= sizeof(Trace_path))) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nrecords) {
+        // Round up to a power-of-2, so ring index is a mask.
+        uint32_t pow2 = 1;
+        while (pow2 < nrecords) {
+            pow2 <<= 1;
+        }
+        Trace_nrecords = pow2;
+    }
+    strcpy(Trace_path, path);
+
+    static int registered = 0;
+    if (!registered && atexit(trace_dump_at_exit)) {
+        return -1;
+    }
+    registered = 1;
+
+    if (dump_signo) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = trace_dump_on_signal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(dump_signo, &sa, NULL)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * trace_set_categories(): Enable tracing of just 'categories', of those
+ * compiled in. Other threads see the change soon, not at once.
+ */
+void
+trace_set_categories(uint32_t categories)
+{
+    __atomic_store_n(&Trace_enabled_categories, categories, __ATOMIC_RELAXED);
+}
+
+/**
+ * trace_ring_attach(): Allocate calling thread's ring, and add it to the
+ * list of rings to dump. Returns NULL if out of memory.
+ */
+TRACE_RING *
+trace_ring_attach(void)
+{
+    uint32_t nrecords = Trace_nrecords;
+    TRACE_RING *ring = NULL;
+    if (posix_memalign((void **) &ring, 64,
+                       (sizeof(*ring) + (nrecords * sizeof(TRACE_REC))))) {
+        return NULL;
+    }
+    ring->head = 0;
+    ring->mask = (nrecords - 1);
+#if __linux__
+    ring->tid = syscall(SYS_gettid);
+#else
+    ring->tid = (uint64_t) getpid();
+#endif
+    ring->next = __atomic_load_n(&Trace_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&Trace_rings, &ring->next, ring, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        ;
+    }
+    Trace_my_ring = ring;
+    return ring;
+}
+
+/* write() all of 'buf', across partial writes. */
+static int
+trace_write(int fd, const void *buf, size_t len)
+{
+    const char *bufp = buf;
+    while (len) {
+        ssize_t nbytes = write(fd, bufp, len);
+        if (nbytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        bufp += nbytes;
+        len -= nbytes;
+    }
+    return 0;
+}
+
+/**
+ * trace_dump(): Write all threads' rings to trace file 'path'.
+ *
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int
+trace_dump(const char *path)
+{
+    int fd = open(path, (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    TRACE_RING *rings = __atomic_load_n(&Trace_rings, __ATOMIC_ACQUIRE);
+
+    TRACE_FILE_HDR hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACE_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = TRACE_FILE_VERSION;
+    hdr.rec_size = sizeof(TRACE_REC);
+    for (TRACE_RING *ring = rings; ring; ring = ring->next) {
+        hdr.nrings++;
+    }
+#if !__APPLE__
+    hdr.loc_id_ref_offset = ((intptr_t) &loc_id_ref - (intptr_t) __start_loc_ids);
+#endif  // !__APPLE__
+
+    uint64_t elapsed_ns = (trace_now_ns() - Trace_start_ns);
+    uint64_t elapsed_tsc = (trace_tsc() - Trace_start_tsc);
+    hdr.ticks_per_sec = (elapsed_ns
+                            ? (uint64_t) ((double) elapsed_tsc * 1e9 / elapsed_ns)
+                            : 1000000000ULL);
+
+    int rv = trace_write(fd, &hdr, sizeof(hdr));
+    for (TRACE_RING *ring = rings; ring && !rv; ring = ring->next) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t capacity = (ring->mask + 1);
+        uint64_t nrecords = ((head < capacity) ? head : capacity);
+
+        TRACE_RING_HDR ring_hdr;
+        memset(&ring_hdr, 0, sizeof(ring_hdr));
+        ring_hdr.tid = ring->tid;
+        ring_hdr.nevents = head;
+        ring_hdr.nrecords = nrecords;
+        rv = trace_write(fd, &ring_hdr, sizeof(ring_hdr));
+
+        // Oldest record is at 'head - nrecords'; write up to the end of the
+        // ring, and then its wrapped-around start.
+        uint64_t start = ((head - nrecords) & ring->mask);
+        uint64_t ntail = (((capacity - start) < nrecords)
+                                ? (capacity - start) : nrecords);
+        if (!rv) {
+            rv = trace_write(fd, &ring->recs[start], (ntail * sizeof(TRACE_REC)));
+        }
+        if (!rv && (nrecords > ntail)) {
+            rv = trace_write(fd, &ring->recs[0],
+                             ((nrecords - ntail) * sizeof(TRACE_REC)));
+        }
+    }
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return rv;
+}
@@ -0,0 +1,206 @@
+/**
+ * trace_ring.h : Always-on, low-overhead event tracing, built on CREATE_ID().
+ *
+ * Each event is a fixed-size binary record, { tsc, arg, loc_id }, where
+ * loc_id is the 4-byte code-location id from CREATE_ID(). No formatting, no
+ * strings and no locks on the hot path: every thread appends to its own
+ * ring of records, and only that thread writes it. Rings are flight
+ * recorders; they keep the last 'nrecords' events of each thread, and an
+ * event costs a timestamp read and three stores.
+ *
+ * Rings are dumped, as a binary trace file, at exit and, optionally, on a
+ * signal. All string work is left to the offline decoder, which maps loc_ids
+ * back to fn/file:line through the program's 'loc_ids' ELF section.
+ *
+ * Usage:
+ *
+ *  trace_init("/tmp/prog.trace", 0, SIGUSR1);  // 0: Trace_ring_def_nrecords
+ *  ...
+ *  TRACE(nbytes);      // Record this call-site, with an argument
+ *  TRACE_DEBUG(TRACE_CAT_IO, nbytes);  // Only if compiled-in, and enabled
+ *
+ * Levels and categories: TRACE_<level>(category, arg) call-sites are compiled
+ * in only if their level is at or below TRACE_LEVEL, and their category's bit
+ * is in TRACE_CATEGORIES. Both are compile-time constants, default INFO and
+ * all categories; override them with -D, or #define them before including
+ * this file. Call-sites that are filtered out compile to nothing, even at
+ * -O0: No code, no branch, and no struct location in 'loc_ids'. Those that
+ * are compiled in test their category against the run-time mask,
+ * trace_set_categories(), a well-predicted branch.
+ *
+ * As the filter is evaluated where the call-site expands, a file can, e.g.,
+ * re-#define TRACE_LEVEL around a hot loop to compile its tracing out.
+ *
+ * Trace file layout, all in host byte-order:
+ *
+ *  TRACE_FILE_HDR
+ *  { TRACE_RING_HDR, TRACE_REC[nrecords] }  x nrings; records oldest first
+ *
+ * History:
+ *  10/2026 - Started
+ */
+#ifndef __TRACE_RING_H__
+#define __TRACE_RING_H__
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>      // For __rdtsc()
+#else
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "locations.h"
+
+#define TRACE_FILE_MAGIC    "LOCTRACE"
+#define TRACE_FILE_VERSION  1
+
+// # of records per thread's ring, by default; rounded up to a power of 2.
+#define Trace_ring_def_nrecords     (64 * 1024)
+
+/* One traced event: 24 bytes */
+typedef struct trace_rec
+{
+    uint64_t    tsc;        // Timestamp counter, in ticks
+    uint64_t    arg;        // Caller-supplied argument
+    int32_t     loc_id;     // CREATE_ID() of the call-site
+    uint32_t    spare;
+} TRACE_REC;
+
+/* Header of a trace file: 64 bytes */
+typedef struct trace_file_hdr
+{
+    char        magic[8];           // TRACE_FILE_MAGIC, not null-terminated
+    uint32_t    version;
+    uint32_t    rec_size;           // sizeof(TRACE_REC)
+    uint64_t    ticks_per_sec;      // Of TRACE_REC.tsc, as measured
+    int64_t     loc_id_ref_offset;  // Of loc_id_ref from start of 'loc_ids'
+    uint32_t    nrings;
+    uint32_t    spare;
+    uint64_t    spare2[3];
+} TRACE_FILE_HDR;
+
+/* Header of one thread's records in a trace file: 32 bytes */
+typedef struct trace_ring_hdr
+{
+    uint64_t    tid;                // Linux thread-id
+    uint64_t    nevents;            // Ever traced by the thread
+    uint64_t    nrecords;           // Following; the last ones traced
+    uint64_t    spare;
+} TRACE_RING_HDR;
+
+/* One thread's ring; only 'head' is read by other threads, by the dumper. */
+typedef struct trace_ring
+{
+    uint64_t            head;       // # of events traced
+    uint64_t            mask;       // nrecords - 1
+    uint64_t            tid;
+    struct trace_ring  *next;       // List of all rings
+    TRACE_REC           recs[];
+} TRACE_RING;
+
+extern __thread TRACE_RING *Trace_my_ring;
+
+// Categories enabled at run-time, of those compiled in.
+extern uint32_t Trace_enabled_categories;
+
+// Function prototypes
+int  trace_init(const char *path, uint32_t nrecords, int dump_signo);
+int  trace_dump(const char *path);
+TRACE_RING * trace_ring_attach(void);
+void trace_set_categories(uint32_t categories);
+
+static inline uint64_t
+trace_tsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+#endif
+}
+
+/*
+ * Append an event to the calling thread's ring; the first event of a thread
+ * allocates its ring. 'head' is published with release, so a dumper that
+ * acquires it sees the records before it filled-in.
+ */
+static inline void
+trace_event(int32_t loc_id, uint64_t arg)
+{
+    TRACE_RING *ring = Trace_my_ring;
+    if (__builtin_expect((ring == NULL), 0)) {
+        if ((ring = trace_ring_attach()) == NULL) {
+            return;
+        }
+    }
+    uint64_t head = ring->head;
+    TRACE_REC *rec = &ring->recs[head & ring->mask];
+    rec->tsc = trace_tsc();
+    rec->arg = arg;
+    rec->loc_id = loc_id;
+    __atomic_store_n(&ring->head, (head + 1), __ATOMIC_RELEASE);
+}
+
+/* Trace this call-site, with an argument */
+#define TRACE(arg)  trace_event(CREATE_ID(), (uint64_t) (arg))
+
+// Trace levels; a call-site is compiled in if its level <= TRACE_LEVEL.
+#define TRACE_LEVEL_OFF         0
+#define TRACE_LEVEL_ERROR       1
+#define TRACE_LEVEL_INFO        2
+#define TRACE_LEVEL_DEBUG       3
+#define TRACE_LEVEL_VERBOSE     4
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL             TRACE_LEVEL_INFO
+#endif
+
+// Trace categories are bits, defined by the program; TRACE_CAT_DEFAULT is
+// for call-sites that do not need one.
+#define TRACE_CAT_DEFAULT       0x00000001u
+#define TRACE_CAT_ALL           0xFFFFFFFFu
+
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES        TRACE_CAT_ALL
+#endif
+
+#define TRACE_COMPILED_IN(level, cat)                                       \
+    (((level) <= TRACE_LEVEL) && ((TRACE_CATEGORIES & (cat)) != 0))
+
+/*
+ * Compile 'stmt' only if constant 'cond' is true. An if (0) would leave the
+ * static struct location of CREATE_ID() in 'loc_ids' at -O0; these discard
+ * the statement at any optimization level. Both need 'cond' to be constant.
+ */
+#ifdef __cplusplus
+#define TRACE_IF_COMPILED_IN(cond, stmt)                                    \
+    do { if constexpr (cond) { stmt; } } while (0)
+#else
+#define TRACE_IF_COMPILED_IN(cond, stmt)                                    \
+    __builtin_choose_expr((cond), ({ stmt; }), (void) 0)
+#endif
+
+/* Trace this call-site, at 'level', in 'cat', if compiled-in and enabled */
+#define TRACE_AT(level, cat, arg)                                           \
+    TRACE_IF_COMPILED_IN(TRACE_COMPILED_IN((level), (cat)),                 \
+        if (__builtin_expect(((Trace_enabled_categories & (cat)) != 0), 1)) { \
+            trace_event(CREATE_ID(), (uint64_t) (arg));                     \
+        })
+
+#define TRACE_ERROR(cat, arg)       TRACE_AT(TRACE_LEVEL_ERROR, (cat), (arg))
+#define TRACE_INFO(cat, arg)        TRACE_AT(TRACE_LEVEL_INFO, (cat), (arg))
+#define TRACE_DEBUG(cat, arg)       TRACE_AT(TRACE_LEVEL_DEBUG, (cat), (arg))
+#define TRACE_VERBOSE(cat, arg)     TRACE_AT(TRACE_LEVEL_VERBOSE, (cat), (arg))
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif  // __TRACE_RING_H__
@@ -6,6 +6,10 @@
  *
  * Usage: gcc -o template-program-c template-program.c
  *        ./template-program-c [--help | test_<something> | test_<prefix> ]
+ *        ./template-program-c bench_<something> | bench_<prefix> [ <bench-options> ]
+ *
+ * bench_* runs the benchmarks in Bench_fns[], by the runner of
+ * Self-Study/Tools/bench_fns.h; see there for <bench-options>.
  *
  * History:
  * -----------------------------------------------------------------------------
@@ -13,8 +17,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
+#if __linux__
+#include <unistd.h>     // readlink()
+#endif // __linux__
+
+#include "Self-Study/Tools/bench_fns.h"
 
-const char *Usage = "%s [ --help | test_<fn-name> ]\n";
+const char *Usage = "%s [ --help | test_<fn-name> | bench_<fn-name> [ <bench-options> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -22,6 +32,10 @@ const char *Usage = "%s [ --help | test_<fn-name> ]\n";
 void test_this(void);
 void test_that(void);
 void test_msg(const char *msg);
+void test_bench_json_stdout(void);
+
+// Bench Function Prototypes
+void bench_this(uint64_t nops);
 
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
@@ -34,8 +48,14 @@ typedef struct test_fns
 TEST_FNS Test_fns[] = {
                           { "test_this"     , test_this }
                         , { "test_that"     , test_that }
+                        , { "test_bench_json_stdout", test_bench_json_stdout }
                       };
 
+// List of bench functions one can invoke from the command-line
+BENCH_FNS Bench_fns[] = {
+                          { "bench_this"    , bench_this, 0 }
+                        };
+
 // Test start / end info-msg macros
 #define TEST_START()  printf("%s ", __func__)
 #define TEST_END()    printf(" ...OK\n")
@@ -59,7 +79,9 @@ int
 main(int argc, char *argv[])
 {
     const char *hello_msg = "Hello World";
-    printf("%s: %s. (argc=%d)\n", argv[0], hello_msg, argc);
+    // To stderr when benchmarking, so stdout holds only the results.
+    fprintf((BENCH_ARGV(argc, argv) ? stderr : stdout), "%s: %s. (argc=%d)\n",
+            argv[0], hello_msg, argc);
 
     int rv = 0;
     // Run all test cases if no args are provided.
@@ -72,6 +94,9 @@ main(int argc, char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         printf(Usage, argv[0]);
         return rv;
+    } else if (BENCH_ARGV(argc, argv)) {
+        rv = bench_main(Bench_fns, ARRAYSIZE(Bench_fns), (argc - 1),
+                        (const char **) &argv[1]);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
 
         // Execute the named test-function, if it's a supported test-function
@@ -124,3 +149,71 @@ test_msg(const char *msg)
     assert(strncmp(expmsg, msg, strlen(expmsg)) == 0);
     TEST_END();
 }
+
+/*
+ * Check that bench_ --json - writes nothing to stdout but one JSON object:
+ * Run ourselves so, and check the output is one '{ ... }', with balanced
+ * brackets outside of strings, and nothing after it.
+ */
+void
+test_bench_json_stdout(void)
+{
+    TEST_START();
+#if __linux__
+    char self[1024];
+    ssize_t len = readlink("/proc/self/exe", self, (sizeof(self) - 1));
+    assert(len > 0);
+    self[len] = '\0';
+
+    char cmd[sizeof(self) + 128];
+    snprintf(cmd, sizeof(cmd), "'%s' bench_this --reps 3 --warmup 0"
+             " --no-counters --json - 2>/dev/null", self);
+    FILE *fp = popen(cmd, "r");
+    assert(fp);
+
+    char out[4096];
+    size_t nbytes = fread(out, 1, (sizeof(out) - 1), fp);
+    out[nbytes] = '\0';
+    assert(pclose(fp) == 0);
+
+    int depth = 0;
+    int in_string = 0;
+    size_t end = 0;     // Just past the top-level object's closing '}'
+    assert(out[0] == '{');
+    for (size_t i = 0; (i < nbytes) && !end; i++) {
+        char c = out[i];
+        if (in_string) {
+            if (c == '\\') {
+                i++;
+            } else if (c == '"') {
+                in_string = 0;
+            }
+        } else if (c == '"') {
+            in_string = 1;
+        } else if ((c == '{') || (c == '[')) {
+            depth++;
+        } else if ((c == '}') || (c == ']')) {
+            assert(depth > 0);
+            if (--depth == 0) {
+                end = (i + 1);
+            }
+        }
+    }
+    assert(end);
+    assert(strspn(&out[end], " \t\n") == strlen(&out[end]));
+    assert(strstr(out, "\"name\": \"bench_this\""));
+#endif // __linux__
+    TEST_END();
+}
+
+// **** Benchmarks ****
+
+void
+bench_this(uint64_t nops)
+{
+    const char *msg = "Hello World";
+    for (uint64_t i = 0; i < nops; i++) {
+        BENCH_OPAQUE(msg);          // Else strlen() of a literal is a constant
+        BENCH_KEEP(strlen(msg));
+    }
+}
@@ -7,20 +7,27 @@
  * Usage: g++ -o template-program-cpp template-program.cpp
  *        ./template-program-cpp [test_*]
  *        ./template-program-c [--help | test_<something> | test_<prefix> ]
+ *        ./template-program-cpp bench_<something> | bench_<prefix> [ <bench-options> ]
+ *
+ * bench_* runs the benchmarks in Bench_fns[], by the runner of
+ * Self-Study/Tools/bench_fns.h; see there for <bench-options>.
  *
  * History:
  * -----------------------------------------------------------------------------
  */
 #include <iostream>
+#include <cstdint>
 
 #if __linux__
 #include <cstring>
 #include <cassert>
 #endif // __linux__
 
+#include "Self-Study/Tools/bench_fns.h"
+
 using namespace std;
 
-string Usage = " [ --help | test_<fn-name> ]\n";
+string Usage = " [ --help | test_<fn-name> | bench_<fn-name> [ <bench-options> ] ]\n";
 
 #define ARRAYSIZE(arr) ((int) (sizeof(arr) / sizeof(*arr)))
 
@@ -29,6 +36,9 @@ void test_this(void);
 void test_that(void);
 void test_msg(string);
 
+// Bench Function Prototypes
+void bench_this(uint64_t nops);
+
 // -----------------------------------------------------------------------------
 // List of test functions one can invoke from the command-line
 typedef struct test_fns
@@ -42,6 +52,11 @@ TEST_FNS Test_fns[] = {
                         , { "test_that"     , test_that }
                       };
 
+// List of bench functions one can invoke from the command-line
+BENCH_FNS Bench_fns[] = {
+                          { "bench_this"    , bench_this, 0 }
+                        };
+
 // Test start / end info-msg macros
 #define TEST_START()  cout << __func__ << "() "
 #define TEST_END()    cout << " ...OK" << endl
@@ -60,7 +75,9 @@ int
 main(const int argc, const char *argv[])
 {
     string hello_msg = "Hello World.";
-    cout << argv[0] << ": " << hello_msg << " (argc=" << argc << ")" << endl;
+    // To stderr when benchmarking, so stdout holds only the results.
+    (BENCH_ARGV(argc, argv) ? cerr : cout)
+        << argv[0] << ": " << hello_msg << " (argc=" << argc << ")" << endl;
 
     int rv = 0;
 
@@ -72,6 +89,8 @@ main(const int argc, const char *argv[])
     } else if (strncmp("--help", argv[1], strlen("--help")) == 0) {
         cout << argv[0] << Usage << endl;
         return 0;
+    } else if (BENCH_ARGV(argc, argv)) {
+        rv = bench_main(Bench_fns, ARRAYSIZE(Bench_fns), (argc - 1), &argv[1]);
     } else if (strncmp("test_", argv[1], strlen("test_")) == 0) {
         // Execute the named test-function, if it's a supported test-function
         int tctr = 0;
@@ -162,3 +181,14 @@ test_template(void)
 
     TEST_END();
 }
+
+// **** Benchmarks ****
+
+void
+bench_this(uint64_t nops)
+{
+    string str = "Hello World.";
+    for (uint64_t i = 0; i < nops; i++) {
+        BENCH_KEEP(ends_with(str, "World."));
+    }
+}